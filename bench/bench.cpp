@@ -0,0 +1,391 @@
+/*
+ * Copyright 2019-2020 Jonathan Eyolfson
+ *
+ * This program is free software: you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License version 3 as published by the
+ * Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE. See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "allocation_stats.hpp"
+#include "class_file.hpp"
+#include "code.hpp"
+#include "constant_pool.hpp"
+#include "method.hpp"
+#include "methods.hpp"
+#include "probe.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <vector>
+
+using namespace project_rescribo;
+
+namespace {
+
+struct ClassBytes {
+	std::string path;
+	std::vector<uint8_t> bytes;
+};
+
+struct PhaseResult {
+	const char* name;
+	uint64_t classes;
+	uint64_t bytes;
+	double seconds;
+	uint64_t p50_ns;
+	uint64_t p99_ns;
+	uint64_t allocations;
+	uint64_t allocated_bytes;
+};
+
+typedef void (*Phase)(const ClassBytes& input, std::vector<uint8_t>& output);
+
+const char* PROBE_CLASS = "project/rescribo/Probe";
+const char* PROBE_METHOD = "enter";
+const char* PROBE_DESCRIPTOR = "()V";
+const char* PROBE_ARGS_DESCRIPTOR
+	= "(Ljava/lang/String;Ljava/lang/String;Ljava/lang/String;)V";
+
+// The JDK module descriptors use attributes we don't parse yet
+bool is_benchmark_class(const std::filesystem::path& path) {
+	return path.extension() == ".class"
+	       && path.filename() != "module-info.class";
+}
+
+std::vector<ClassBytes> load_corpus(const char* root) {
+	std::vector<ClassBytes> corpus;
+	for (const auto& entry
+	     : std::filesystem::recursive_directory_iterator(root)) {
+		if (!entry.is_regular_file() || !is_benchmark_class(entry.path())) {
+			continue;
+		}
+		std::ifstream file(entry.path(), std::ios::binary);
+		std::vector<uint8_t> bytes(
+			(std::istreambuf_iterator<char>(file)),
+			std::istreambuf_iterator<char>()
+		);
+		corpus.push_back({entry.path().string(), std::move(bytes)});
+	}
+	std::sort(corpus.begin(), corpus.end(),
+	          [](const ClassBytes& a, const ClassBytes& b) {
+		return a.path < b.path;
+	});
+	return corpus;
+}
+
+void write_class_file(ClassFile& class_file, std::vector<uint8_t>& output) {
+	output.resize(class_file.get_byte_size());
+	uint8_t* buffer = output.data();
+	class_file.write_buffer(&buffer);
+}
+
+void parse(const ClassBytes& input, std::vector<uint8_t>& output) {
+	const uint8_t* buffer = input.bytes.data();
+	ClassFile class_file(&buffer);
+}
+
+void round_trip(const ClassBytes& input, std::vector<uint8_t>& output) {
+	const uint8_t* buffer = input.bytes.data();
+	ClassFile class_file(&buffer);
+	write_class_file(class_file, output);
+}
+
+void constant_pool_insert(const ClassBytes& input,
+                          std::vector<uint8_t>& output) {
+	const uint8_t* buffer = input.bytes.data();
+	ClassFile class_file(&buffer);
+	ConstantPool* constant_pool = class_file.get_constant_pool();
+	constant_pool->get_or_create_methodref_index(
+		PROBE_CLASS, PROBE_METHOD, PROBE_DESCRIPTOR
+	);
+	constant_pool->get_or_create_string_index(
+		constant_pool->get_or_create_utf8_index(PROBE_CLASS)
+	);
+	write_class_file(class_file, output);
+}
+
+void probe_insert(const ClassBytes& input, std::vector<uint8_t>& output) {
+	const uint8_t* buffer = input.bytes.data();
+	ClassFile class_file(&buffer);
+	ConstantPool* constant_pool = class_file.get_constant_pool();
+	uint16_t methodref_index = constant_pool->get_or_create_methodref_index(
+		PROBE_CLASS, PROBE_METHOD, PROBE_DESCRIPTOR
+	);
+	for (auto& method : class_file.get_methods()->get()) {
+		Code* code = method->get_code();
+		if (!code) {
+			continue;
+		}
+		auto inserter = code->create_front_inserter();
+		inserter.insert_invokestatic(methodref_index);
+		code->sync();
+		if (code->fix_offsets()) {
+			code->sync();
+		}
+	}
+	write_class_file(class_file, output);
+}
+
+// The class, method name and descriptor at every entry, by hand
+void probe_insert_args(const ClassBytes& input, std::vector<uint8_t>& output) {
+	const uint8_t* buffer = input.bytes.data();
+	ClassFile class_file(&buffer);
+	ConstantPool* constant_pool = class_file.get_constant_pool();
+	for (auto& method : class_file.get_methods()->get()) {
+		Code* code = method->get_code();
+		if (!code) {
+			continue;
+		}
+		uint16_t methodref_index
+			= constant_pool->get_or_create_methodref_index(
+				PROBE_CLASS, PROBE_METHOD, PROBE_ARGS_DESCRIPTOR
+			);
+		uint16_t class_index = constant_pool->get_or_create_string_index(
+			constant_pool->get_class(
+				class_file.get_this_class()
+			).get_name_index()
+		);
+		auto inserter = code->create_front_inserter();
+		inserter.insert_ldc(class_index);
+		inserter.insert_ldc(constant_pool->get_or_create_string_index(
+			method->get_name_index()
+		));
+		inserter.insert_ldc(constant_pool->get_or_create_string_index(
+			method->get_descriptor_index()
+		));
+		inserter.insert_invokestatic(methodref_index);
+		code->set_max_stack(std::max<uint16_t>(code->get_max_stack(), 3));
+		code->sync();
+		if (code->fix_offsets()) {
+			code->sync();
+		}
+	}
+	write_class_file(class_file, output);
+}
+
+const Probe& get_args_probe() {
+	static Probe probe = [] {
+		Probe probe(Probe::Location::Entry, PROBE_CLASS, PROBE_METHOD,
+		            Probe::ClassName | Probe::MethodName
+		            | Probe::MethodDescriptor);
+		probe.compile();
+		return probe;
+	}();
+	return probe;
+}
+
+// The same as probe_insert_args, from a template
+void probe_template_args(const ClassBytes& input,
+                         std::vector<uint8_t>& output) {
+	const uint8_t* buffer = input.bytes.data();
+	ClassFile class_file(&buffer);
+	get_args_probe().apply(&class_file);
+	write_class_file(class_file, output);
+}
+
+uint64_t percentile(std::vector<uint64_t>& samples, double fraction) {
+	if (samples.empty()) {
+		return 0;
+	}
+	size_t index = static_cast<size_t>(fraction * (samples.size() - 1));
+	std::nth_element(samples.begin(), samples.begin() + index,
+	                 samples.end());
+	return samples[index];
+}
+
+PhaseResult run_phase(const char* name, Phase phase,
+                      const std::vector<ClassBytes>& corpus,
+                      uint32_t iterations) {
+	typedef std::chrono::steady_clock Clock;
+
+	std::vector<uint64_t> samples;
+	samples.reserve(corpus.size() * iterations);
+	std::vector<uint8_t> output;
+
+	AllocationStats& allocation_stats = AllocationStats::get_global();
+	allocation_stats.reset();
+
+	uint64_t bytes = 0;
+	auto start = Clock::now();
+	for (uint32_t i = 0; i < iterations; ++i) {
+		for (const auto& input : corpus) {
+			auto class_start = Clock::now();
+			phase(input, output);
+			auto class_end = Clock::now();
+			samples.push_back(
+				std::chrono::duration_cast<
+					std::chrono::nanoseconds
+				>(class_end - class_start).count()
+			);
+			bytes += input.bytes.size();
+		}
+	}
+	auto end = Clock::now();
+
+	PhaseResult result;
+	result.name = name;
+	result.classes = samples.size();
+	result.bytes = bytes;
+	result.seconds = std::chrono::duration<double>(end - start).count();
+	result.p50_ns = percentile(samples, 0.50);
+	result.p99_ns = percentile(samples, 0.99);
+	result.allocations = 0;
+	result.allocated_bytes = 0;
+	for (size_t i = 0; i < AllocationStats::NUM_TYPES; ++i) {
+		const auto& counter = allocation_stats.get(
+			static_cast<AllocationStats::Type>(i)
+		);
+		result.allocations += counter.count;
+		result.allocated_bytes += counter.bytes;
+	}
+	return result;
+}
+
+double classes_per_second(const PhaseResult& result) {
+	return result.classes / result.seconds;
+}
+
+double mb_per_second(const PhaseResult& result) {
+	return result.bytes / result.seconds / (1024.0 * 1024.0);
+}
+
+void print_text(const std::vector<PhaseResult>& results) {
+	printf("%-22s %10s %12s %10s %12s %12s\n",
+	       "phase", "classes", "classes/s", "MB/s", "p50 (ns)", "p99 (ns)");
+	for (const auto& result : results) {
+		printf("%-22s %10lu %12.1f %10.2f %12lu %12lu\n",
+		       result.name,
+		       static_cast<unsigned long>(result.classes),
+		       classes_per_second(result),
+		       mb_per_second(result),
+		       static_cast<unsigned long>(result.p50_ns),
+		       static_cast<unsigned long>(result.p99_ns));
+	}
+	if (!AllocationStats::is_enabled()) {
+		return;
+	}
+	printf("\n%-22s %14s %16s\n", "phase", "allocations", "bytes");
+	for (const auto& result : results) {
+		printf("%-22s %14lu %16lu\n",
+		       result.name,
+		       static_cast<unsigned long>(result.allocations),
+		       static_cast<unsigned long>(result.allocated_bytes));
+	}
+}
+
+void print_json(const std::vector<ClassBytes>& corpus,
+                uint32_t iterations,
+                const std::vector<PhaseResult>& results) {
+	uint64_t corpus_bytes = 0;
+	for (const auto& input : corpus) {
+		corpus_bytes += input.bytes.size();
+	}
+	printf("{\n");
+	printf("  \"corpus\": {\"classes\": %lu, \"bytes\": %lu},\n",
+	       static_cast<unsigned long>(corpus.size()),
+	       static_cast<unsigned long>(corpus_bytes));
+	printf("  \"iterations\": %u,\n", iterations);
+	printf("  \"phases\": [\n");
+	for (size_t i = 0; i < results.size(); ++i) {
+		const auto& result = results[i];
+		printf("    {\"name\": \"%s\", \"classes\": %lu, "
+		       "\"bytes\": %lu, \"seconds\": %.6f, "
+		       "\"classes_per_second\": %.1f, "
+		       "\"mb_per_second\": %.3f, "
+		       "\"p50_ns\": %lu, \"p99_ns\": %lu, "
+		       "\"allocations\": %lu, \"allocated_bytes\": %lu}%s\n",
+		       result.name,
+		       static_cast<unsigned long>(result.classes),
+		       static_cast<unsigned long>(result.bytes),
+		       result.seconds,
+		       classes_per_second(result),
+		       mb_per_second(result),
+		       static_cast<unsigned long>(result.p50_ns),
+		       static_cast<unsigned long>(result.p99_ns),
+		       static_cast<unsigned long>(result.allocations),
+		       static_cast<unsigned long>(result.allocated_bytes),
+		       i + 1 == results.size() ? "" : ",");
+	}
+	printf("  ]\n");
+	printf("}\n");
+}
+
+void usage(const char* argv0) {
+	fprintf(stderr,
+	        "usage: %s [--json] [--iterations N] CORPUS_DIR\n"
+	        "\n"
+	        "CORPUS_DIR is searched recursively for .class files, e.g.\n"
+	        "  $JAVA_HOME/bin/jmod extract --dir corpus "
+	        "$JAVA_HOME/jmods/java.base.jmod\n",
+	        argv0);
+}
+
+}
+
+int main(int argc, char** argv) {
+	bool json = false;
+	uint32_t iterations = 1;
+	const char* corpus_dir = nullptr;
+	for (int i = 1; i < argc; ++i) {
+		if (strcmp(argv[i], "--json") == 0) {
+			json = true;
+		}
+		else if (strcmp(argv[i], "--iterations") == 0 && i + 1 < argc) {
+			iterations = std::max(1, atoi(argv[++i]));
+		}
+		else if (argv[i][0] != '-' && !corpus_dir) {
+			corpus_dir = argv[i];
+		}
+		else {
+			usage(argv[0]);
+			return 1;
+		}
+	}
+	if (!corpus_dir) {
+		usage(argv[0]);
+		return 1;
+	}
+
+	std::vector<ClassBytes> corpus = load_corpus(corpus_dir);
+	if (corpus.empty()) {
+		fprintf(stderr, "No class files found in %s\n", corpus_dir);
+		return 1;
+	}
+
+	std::vector<PhaseResult> results;
+	results.push_back(run_phase("parse", parse, corpus, iterations));
+	results.push_back(run_phase("round_trip", round_trip, corpus,
+	                            iterations));
+	results.push_back(run_phase("constant_pool_insert",
+	                            constant_pool_insert, corpus,
+	                            iterations));
+	results.push_back(run_phase("probe_insert", probe_insert, corpus,
+	                            iterations));
+	results.push_back(run_phase("probe_insert_args", probe_insert_args,
+	                            corpus, iterations));
+	results.push_back(run_phase("probe_template_args",
+	                            probe_template_args, corpus, iterations));
+
+	if (json) {
+		print_json(corpus, iterations, results);
+	}
+	else {
+		print_text(results);
+	}
+	return 0;
+}
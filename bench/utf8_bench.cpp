@@ -0,0 +1,194 @@
+/*
+ * Copyright 2019-2020 Jonathan Eyolfson
+ *
+ * This program is free software: you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License version 3 as published by the
+ * Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE. See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "utf8.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+using namespace project_rescribo;
+
+namespace {
+
+typedef std::vector<uint8_t> Bytes;
+
+const char* PACKAGES[] = {
+	"java/lang/",
+	"java/util/concurrent/",
+	"jdk/internal/misc/",
+	"sun/nio/cs/",
+	"com/example/generated/proxies/",
+};
+
+// Names shaped like the class names and descriptors in a JDK constant pool,
+// with every eighth one containing non-ASCII characters
+std::vector<Bytes> make_corpus(size_t count) {
+	std::vector<Bytes> corpus;
+	srand(1);
+	for (size_t i = 0; i < count; ++i) {
+		std::string name = PACKAGES[i % 5];
+		size_t length = 4 + rand() % 60;
+		for (size_t j = 0; j < length; ++j) {
+			name.push_back('a' + rand() % 26);
+		}
+		if (i % 8 == 0) {
+			name += "\xC3\xA9t\xC3\xA9"; // été
+		}
+		if (i % 3 == 0) {
+			name += "$Inner";
+		}
+		corpus.emplace_back(name.begin(), name.end());
+	}
+	return corpus;
+}
+
+typedef uint64_t (*Operation)(const std::vector<Bytes>& corpus);
+
+uint64_t run_equals(const std::vector<Bytes>& corpus) {
+	uint64_t result = 0;
+	for (size_t i = 0; i < corpus.size(); ++i) {
+		const Bytes& a = corpus[i];
+		const Bytes& b = corpus[(i * 7) % corpus.size()];
+		result += utf8_equals(a.data(), a.size(), b.data(), b.size());
+		result += utf8_equals(a.data(), a.size(), a.data(), a.size());
+	}
+	return result;
+}
+
+uint64_t run_starts_with(const std::vector<Bytes>& corpus) {
+	uint64_t result = 0;
+	for (const auto& name : corpus) {
+		for (const char* package : PACKAGES) {
+			result += utf8_starts_with(
+				name.data(), name.size(),
+				reinterpret_cast<const uint8_t*>(package),
+				strlen(package)
+			);
+		}
+	}
+	return result;
+}
+
+uint64_t run_ends_with(const std::vector<Bytes>& corpus) {
+	const uint8_t* suffix = reinterpret_cast<const uint8_t*>("$Inner");
+	uint64_t result = 0;
+	for (const auto& name : corpus) {
+		result += utf8_ends_with(name.data(), name.size(), suffix, 6);
+	}
+	return result;
+}
+
+uint64_t run_is_ascii(const std::vector<Bytes>& corpus) {
+	uint64_t result = 0;
+	for (const auto& name : corpus) {
+		result += utf8_is_ascii(name.data(), name.size());
+	}
+	return result;
+}
+
+uint64_t run_hash(const std::vector<Bytes>& corpus) {
+	uint64_t result = 0;
+	for (const auto& name : corpus) {
+		result ^= utf8_hash(name.data(), name.size());
+	}
+	return result;
+}
+
+uint64_t run_to_utf16(const std::vector<Bytes>& corpus) {
+	uint64_t result = 0;
+	for (const auto& name : corpus) {
+		result += utf8_to_utf16(name.data(), name.size()).back();
+	}
+	return result;
+}
+
+uint64_t run_to_string(const std::vector<Bytes>& corpus) {
+	uint64_t result = 0;
+	for (const auto& name : corpus) {
+		result += utf8_to_string(name.data(), name.size()).size();
+	}
+	return result;
+}
+
+struct Benchmark {
+	const char* name;
+	Operation operation;
+};
+
+const Benchmark BENCHMARKS[] = {
+	{"equals", run_equals},
+	{"starts_with", run_starts_with},
+	{"ends_with", run_ends_with},
+	{"is_ascii", run_is_ascii},
+	{"hash", run_hash},
+	{"to_utf16", run_to_utf16},
+	{"to_string", run_to_string},
+};
+
+}
+
+int main(int argc, char** argv) {
+	uint32_t iterations = argc > 1 ? std::max(1, atoi(argv[1])) : 200;
+	std::vector<Bytes> corpus = make_corpus(10000);
+
+	const Utf8Implementation implementations[] = {
+		Utf8Implementation::Scalar,
+		Utf8Implementation::SSE2,
+		Utf8Implementation::AVX2,
+	};
+
+	printf("%-12s", "operation");
+	for (auto implementation : implementations) {
+		printf(" %12s", get_utf8_implementation_name(implementation));
+	}
+	printf("   (ns per string)\n");
+
+	int status = 0;
+	for (const auto& benchmark : BENCHMARKS) {
+		printf("%-12s", benchmark.name);
+		bool have_expected = false;
+		uint64_t expected = 0;
+		for (auto implementation : implementations) {
+			if (!set_utf8_implementation(implementation)) {
+				printf(" %12s", "-");
+				continue;
+			}
+			uint64_t result = 0;
+			auto start = std::chrono::steady_clock::now();
+			for (uint32_t i = 0; i < iterations; ++i) {
+				result += benchmark.operation(corpus);
+			}
+			auto end = std::chrono::steady_clock::now();
+			double ns = std::chrono::duration<double, std::nano>(
+				end - start
+			).count();
+			printf(" %12.2f", ns / iterations / corpus.size());
+			if (have_expected && result != expected) {
+				printf(" (mismatch)");
+				status = 1;
+			}
+			have_expected = true;
+			expected = result;
+		}
+		printf("\n");
+	}
+	return status;
+}
@@ -0,0 +1,133 @@
+/*
+ * Copyright 2019-2020 Jonathan Eyolfson
+ *
+ * This program is free software: you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License version 3 as published by the
+ * Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE. See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef PROJECT_RESCRIBO_ALLOCATION_STATS_HPP
+#define PROJECT_RESCRIBO_ALLOCATION_STATS_HPP
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <new>
+
+// Allocation accounting is a build mode, enable it by defining
+// PROJECT_RESCRIBO_ALLOCATION_STATS (the CMake option of the same name). When
+// disabled, all of the recording hooks compile to nothing.
+#ifdef PROJECT_RESCRIBO_ALLOCATION_STATS
+#define PROJECT_RESCRIBO_TRACK_ALLOCATIONS(type) \
+	static void* operator new(size_t size) { \
+		AllocationStats::record(AllocationStats::Type::type, size); \
+		return ::operator new(size); \
+	} \
+	static void operator delete(void* pointer) { \
+		::operator delete(pointer); \
+	}
+#else
+#define PROJECT_RESCRIBO_TRACK_ALLOCATIONS(type)
+#endif
+
+namespace project_rescribo {
+
+class ClassFile;
+
+class AllocationStats {
+public:
+	enum class Phase : uint8_t {
+		Other,
+		ConstantPoolDecode,
+		AttributeDecode,
+		InstructionDecode,
+		Sync,
+		Write,
+	};
+	static constexpr size_t NUM_PHASES = 6;
+
+	enum class Type : uint8_t {
+		Attribute,
+		Instruction,
+		StackMapFrame,
+		VariableInfo,
+		Field,
+		Method,
+	};
+	static constexpr size_t NUM_TYPES = 6;
+
+	// Indexed by the Instruction::Kind opcode
+	static constexpr size_t NUM_INSTRUCTION_KINDS = 256;
+
+	struct Counter {
+		std::atomic<uint64_t> count{0};
+		std::atomic<uint64_t> bytes{0};
+	};
+
+	static constexpr bool is_enabled() {
+#ifdef PROJECT_RESCRIBO_ALLOCATION_STATS
+		return true;
+#else
+		return false;
+#endif
+	}
+
+	const Counter& get(Phase phase) const {
+		return phases[static_cast<size_t>(phase)];
+	}
+	const Counter& get(Type type) const {
+		return types[static_cast<size_t>(type)];
+	}
+	const Counter& get_instruction(uint8_t kind) const {
+		return instruction_kinds[kind];
+	}
+
+	void reset();
+	void print() const;
+
+	// Process-wide totals across every ClassFile and thread
+	static AllocationStats& get_global();
+
+#ifdef PROJECT_RESCRIBO_ALLOCATION_STATS
+	static void record(Type type, size_t size);
+	static void record_instruction(uint8_t kind);
+#else
+	static void record(Type, size_t) {}
+	static void record_instruction(uint8_t) {}
+#endif
+
+	// Attributes allocations on this thread to a class file and phase until
+	// destroyed. Scopes nest, the previous phase is restored on exit.
+	class Scope {
+	public:
+#ifdef PROJECT_RESCRIBO_ALLOCATION_STATS
+		Scope(const ClassFile* class_file, Phase phase);
+		~Scope();
+	private:
+		AllocationStats* previous_stats;
+		Phase previous_phase;
+#else
+		Scope(const ClassFile*, Phase) {}
+#endif
+	};
+
+private:
+	Counter phases[NUM_PHASES];
+	Counter types[NUM_TYPES];
+	Counter instruction_kinds[NUM_INSTRUCTION_KINDS];
+
+	void add(Phase phase, Type type, size_t size);
+	void add_instruction(uint8_t kind, size_t size);
+};
+
+}
+
+#endif
@@ -26,6 +26,7 @@ namespace project_rescribo {
 class Annotation;
 class Code;
 class ConstantPool;
+class ConstantPoolIndexVisitor;
 class Field;
 class Instruction;
 class Method;
@@ -49,6 +50,8 @@ public:
 
 	virtual uint32_t get_byte_size() const = 0;
 	virtual void write_buffer(uint8_t** buffer) const = 0;
+	virtual void visit_constant_pool_indices(
+		ConstantPoolIndexVisitor& visitor) = 0;
 
 	Kind get_kind() const {
 		return kind;
@@ -79,6 +82,8 @@ public:
 
 	uint32_t get_byte_size() const override;
 	void write_buffer(uint8_t** buffer) const override;
+	void visit_constant_pool_indices(
+		ConstantPoolIndexVisitor& visitor) override;
 
 private:
 	std::unique_ptr<Annotation> value;
@@ -98,6 +103,8 @@ public:
 
 	uint32_t get_byte_size() const override;
 	void write_buffer(uint8_t** buffer) const override;
+	void visit_constant_pool_indices(
+		ConstantPoolIndexVisitor& visitor) override;
 
 private:
 	std::vector<std::unique_ptr<ElementValue>> value;
@@ -118,6 +125,8 @@ public:
 		return 3;
 	}
 	void write_buffer(uint8_t** buffer) const override;
+	void visit_constant_pool_indices(
+		ConstantPoolIndexVisitor& visitor) override;
 
 	uint16_t get_index() const {
 		return index;
@@ -141,6 +150,8 @@ public:
 		return 3;
 	}
 	void write_buffer(uint8_t** buffer) const override;
+	void visit_constant_pool_indices(
+		ConstantPoolIndexVisitor& visitor) override;
 
 	uint16_t get_index() const {
 		return index;
@@ -165,6 +176,8 @@ public:
 		return 5;
 	}
 	void write_buffer(uint8_t** buffer) const override;
+	void visit_constant_pool_indices(
+		ConstantPoolIndexVisitor& visitor) override;
 
 	uint16_t get_type_name_index() const {
 		return type_name_index;
@@ -184,6 +197,7 @@ public:
 
 	uint32_t get_byte_size() const;
 	void write_buffer(uint8_t** buffer) const;
+	void visit_constant_pool_indices(ConstantPoolIndexVisitor& visitor);
 
 	uint16_t get_name_index() const {
 		return name_index;
@@ -201,6 +215,7 @@ public:
 
 	uint32_t get_byte_size() const;
 	void write_buffer(uint8_t** buffer) const;
+	void visit_constant_pool_indices(ConstantPoolIndexVisitor& visitor);
 
 private:
 	std::vector<std::unique_ptr<ElementValuePair>> element_value_pairs;
@@ -213,6 +228,7 @@ public:
 
 	uint32_t get_byte_size() const;
 	void write_buffer(uint8_t** buffer) const;
+	void visit_constant_pool_indices(ConstantPoolIndexVisitor& visitor);
 
 	ConstantPool* get_constant_pool() const {
 		return constant_pool;
@@ -344,6 +360,7 @@ public:
 
 	uint32_t get_byte_size() const;
 	void write_buffer(uint8_t** buffer) const;
+	void visit_constant_pool_indices(ConstantPoolIndexVisitor& visitor);
 
 	TypeTarget* get_target() const {
 		return target.get();
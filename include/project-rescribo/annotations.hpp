@@ -26,6 +26,7 @@ namespace project_rescribo {
 class Annotation;
 class Code;
 class ConstantPool;
+class ConstantPoolIndexVisitor;
 class Field;
 class TypeAnnotation;
 class Method;
@@ -41,6 +42,7 @@ public:
 
 	uint32_t get_byte_size() const;
 	void write_buffer(uint8_t** buffer) const;
+	void visit_constant_pool_indices(ConstantPoolIndexVisitor& visitor);
 
 private:
 	std::vector<std::unique_ptr<Annotation>> annotations;
@@ -60,6 +62,7 @@ public:
 
 	uint32_t get_byte_size() const;
 	void write_buffer(uint8_t** buffer) const;
+	void visit_constant_pool_indices(ConstantPoolIndexVisitor& visitor);
 
 private:
 	std::vector<std::unique_ptr<TypeAnnotation>> annotations;
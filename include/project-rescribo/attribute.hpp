@@ -18,6 +18,7 @@
 #define PROJECT_RESCRIBO_ATTRIBUTE_HPP
 
 #include "access.hpp"
+#include "allocation_stats.hpp"
 
 #include <cstdint>
 #include <memory>
@@ -29,6 +30,7 @@ class Annotations;
 class ClassFile;
 class Code;
 class ConstantPool;
+class ConstantPoolIndexVisitor;
 class ElementValue;
 class Field;
 class Instruction;
@@ -68,11 +70,13 @@ public:
 		NestMembers,
 		Scala,
 		ScalaInlineInfo,
-		ScalaSig
+		ScalaSig,
+		Unknown // Only returned for names without an attribute class
 	};
 	Attribute(Kind kind, uint16_t attribute_name_index)
 		: kind(kind), attribute_name_index(attribute_name_index) {}
 	virtual ~Attribute();
+	PROJECT_RESCRIBO_TRACK_ALLOCATIONS(Attribute)
 	Kind get_kind() const {
 		return kind;
 	}
@@ -85,6 +89,9 @@ public:
 
 	virtual uint32_t get_byte_size() const = 0;
 	virtual void write_buffer(uint8_t** buffer) const = 0;
+	// Overrides call this first for the attribute name
+	virtual void visit_constant_pool_indices(
+		ConstantPoolIndexVisitor& visitor);
 
 	static std::unique_ptr<Attribute> make(const uint8_t** buffer,
 	                                       ClassFile* class_file);
@@ -94,6 +101,9 @@ public:
 	                                       Method* method);
 	static std::unique_ptr<Attribute> make(const uint8_t** buffer,
 	                                       Code* code);
+
+	// Uncached, use ConstantPool::get_attribute_kind instead
+	static Kind find_kind(const uint8_t* name, uint16_t length);
 private:
 	Kind kind;
 	uint16_t attribute_name_index;
@@ -115,6 +125,8 @@ public:
 
 	virtual uint32_t get_byte_size() const override;
 	virtual void write_buffer(uint8_t** buffer) const override;
+	virtual void visit_constant_pool_indices(
+		ConstantPoolIndexVisitor& visitor) override;
 
 private:
 	Method* method;
@@ -144,6 +156,8 @@ public:
 		return result;
 	}
 	virtual void write_buffer(uint8_t** buffer) const override;
+	virtual void visit_constant_pool_indices(
+		ConstantPoolIndexVisitor& visitor) override;
 
 	ClassFile* get_class_file() const {
 		return class_file;
@@ -170,6 +184,8 @@ public:
 		return 8;
 	}
 	virtual void write_buffer(uint8_t** buffer) const override;
+	virtual void visit_constant_pool_indices(
+		ConstantPoolIndexVisitor& visitor) override;
 private:
 	uint16_t index;
 };
@@ -199,6 +215,8 @@ public:
 		return 10;
 	}
 	virtual void write_buffer(uint8_t** buffer) const override;
+	virtual void visit_constant_pool_indices(
+		ConstantPoolIndexVisitor& visitor) override;
 
 	ClassFile* get_class_file() const {
 		return class_file;
@@ -228,6 +246,8 @@ public:
 		return 8 + 2 * exception_index_table.size();
 	}
 	virtual void write_buffer(uint8_t** buffer) const override;
+	virtual void visit_constant_pool_indices(
+		ConstantPoolIndexVisitor& visitor) override;
 
 private:
 	Method* method;
@@ -251,6 +271,8 @@ public:
 		return 8 + 8 * classes.size();
 	}
 	virtual void write_buffer(uint8_t** buffer) const override;
+	virtual void visit_constant_pool_indices(
+		ConstantPoolIndexVisitor& visitor) override;
 
 	ClassFile* get_class_file() const {
 		return class_file;
@@ -309,11 +331,15 @@ public:
 	Code* get_code() const {
 		return code;
 	}
+	// Ranges starting or ending at old_bound use new_bound instead
+	void replace_bound(Instruction* old_bound, Instruction* new_bound);
 
 	virtual uint32_t get_byte_size() const override {
 		return 8 + 10 * local_variable_table.size();
 	}
 	virtual void write_buffer(uint8_t** buffer) const override;
+	virtual void visit_constant_pool_indices(
+		ConstantPoolIndexVisitor& visitor) override;
 private:
 	Code* code;
 	std::vector<Entry> local_variable_table;
@@ -340,11 +366,15 @@ public:
 	Code* get_code() const {
 		return code;
 	}
+	// Ranges starting or ending at old_bound use new_bound instead
+	void replace_bound(Instruction* old_bound, Instruction* new_bound);
 
 	virtual uint32_t get_byte_size() const override {
 		return 8 + 10 * local_variable_type_table.size();
 	}
 	virtual void write_buffer(uint8_t** buffer) const override;
+	virtual void visit_constant_pool_indices(
+		ConstantPoolIndexVisitor& visitor) override;
 private:
 	Code* code;
 	std::vector<Entry> local_variable_type_table;
@@ -373,6 +403,8 @@ public:
 		return 7 + 4 * parameters.size();
 	}
 	virtual void write_buffer(uint8_t** buffer) const override;
+	virtual void visit_constant_pool_indices(
+		ConstantPoolIndexVisitor& visitor) override;
 
 private:
 	Method* method;
@@ -393,6 +425,8 @@ public:
 		return 8;
 	}
 	virtual void write_buffer(uint8_t** buffer) const override;
+	virtual void visit_constant_pool_indices(
+		ConstantPoolIndexVisitor& visitor) override;
 
 	ClassFile* get_class_file() const {
 		return class_file;
@@ -417,6 +451,8 @@ public:
 		return 8 + 2 * classes.size();
 	}
 	virtual void write_buffer(uint8_t** buffer) const override;
+	virtual void visit_constant_pool_indices(
+		ConstantPoolIndexVisitor& visitor) override;
 
 	ClassFile* get_class_file() const {
 		return class_file;
@@ -440,6 +476,8 @@ public:
 
 	virtual uint32_t get_byte_size() const override;
 	virtual void write_buffer(uint8_t** buffer) const override;
+	virtual void visit_constant_pool_indices(
+		ConstantPoolIndexVisitor& visitor) override;
 
 private:
 	std::unique_ptr<Annotations> annotations;
@@ -458,6 +496,8 @@ public:
 
 	virtual uint32_t get_byte_size() const override;
 	virtual void write_buffer(uint8_t** buffer) const override;
+	virtual void visit_constant_pool_indices(
+		ConstantPoolIndexVisitor& visitor) override;
 
 private:
 	std::vector<std::unique_ptr<Annotations>> parameter_annotations;
@@ -475,6 +515,8 @@ public:
 
 	virtual uint32_t get_byte_size() const override;
 	virtual void write_buffer(uint8_t** buffer) const override;
+	virtual void visit_constant_pool_indices(
+		ConstantPoolIndexVisitor& visitor) override;
 
 private:
 	std::unique_ptr<Annotations> annotations;
@@ -493,6 +535,8 @@ public:
 
 	virtual uint32_t get_byte_size() const override;
 	virtual void write_buffer(uint8_t** buffer) const override;
+	virtual void visit_constant_pool_indices(
+		ConstantPoolIndexVisitor& visitor) override;
 
 private:
 	std::vector<std::unique_ptr<Annotations>> parameter_annotations;
@@ -520,6 +564,8 @@ public:
 
 	virtual uint32_t get_byte_size() const override;
 	virtual void write_buffer(uint8_t** buffer) const override;
+	virtual void visit_constant_pool_indices(
+		ConstantPoolIndexVisitor& visitor) override;
 
 private:
 	std::unique_ptr<TypeAnnotations> annotations;
@@ -541,6 +587,8 @@ public:
 		return 8;
 	}
 	virtual void write_buffer(uint8_t** buffer) const override;
+	virtual void visit_constant_pool_indices(
+		ConstantPoolIndexVisitor& visitor) override;
 private:
 	uint16_t signature_index;
 };
@@ -562,6 +610,8 @@ public:
 		return 8;
 	}
 	virtual void write_buffer(uint8_t** buffer) const override;
+	virtual void visit_constant_pool_indices(
+		ConstantPoolIndexVisitor& visitor) override;
 private:
 	uint16_t sourcefile_index;
 };
@@ -615,6 +665,8 @@ public:
 		return result;
 	}
 	virtual void write_buffer(uint8_t** buffer) const override;
+	virtual void visit_constant_pool_indices(
+		ConstantPoolIndexVisitor& visitor) override;
 
 	ClassFile* get_class_file() const {
 		return class_file;
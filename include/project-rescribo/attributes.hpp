@@ -27,6 +27,7 @@ namespace project_rescribo {
 
 class ClassFile;
 class Code;
+class ConstantPoolIndexVisitor;
 class Field;
 class Method;
 
@@ -48,6 +49,7 @@ public:
 
 	uint32_t get_byte_size() const;
 	void write_buffer(uint8_t** buffer) const;
+	void visit_constant_pool_indices(ConstantPoolIndexVisitor& visitor);
 
 private:
 	std::vector<std::unique_ptr<Attribute>> attributes;
@@ -21,20 +21,32 @@
 #include <memory>
 
 #include "access.hpp"
+#include "allocation_stats.hpp"
+#include "transform_stats.hpp"
 
 namespace project_rescribo {
 
 class Attributes;
 class ConstantPool;
+class ConstantPoolIndexVisitor;
 class Fields;
 class Interfaces;
 class Methods;
+class SegmentedOutput;
 
 class ClassFile {
 public:
-	ClassFile(const uint8_t** buffer);
+	// Any more than one thread is only used to decode method bodies, for
+	// classes with enough of them to be worth it. The result is the same.
+	ClassFile(const uint8_t** buffer, uint32_t num_threads = 1);
 	~ClassFile();
 
+	uint16_t get_major_version() const {
+		return major_version;
+	}
+	const Access& get_access() const {
+		return access;
+	}
 	uint16_t get_this_class() const {
 		return this_class;
 	}
@@ -45,12 +57,37 @@ public:
 		return constant_pool.get();
 	}
 
+	Fields* get_fields() {
+		return fields.get();
+	}
+	Interfaces* get_interfaces() {
+		return interfaces.get();
+	}
 	Methods* get_methods() {
 		return methods.get();
 	}
 
+	// Only allocated when built with PROJECT_RESCRIBO_ALLOCATION_STATS
+	AllocationStats* get_allocation_stats() const {
+		return allocation_stats.get();
+	}
+
+	// Wrap transformations in a TransformStats::Timer for the Transform phase
+	TransformStats* get_transform_stats() {
+		return &transform_stats;
+	}
+
 	uint32_t get_byte_size();
 	void write_buffer(uint8_t** buffer);
+	// The same bytes, but the parts unchanged since parsing refer to the
+	// input, which has to outlive the output
+	void write_segments(SegmentedOutput* output);
+
+	// Every index outside of the constant pool itself
+	void visit_constant_pool_indices(ConstantPoolIndexVisitor& visitor);
+	// Removes the entries nothing refers to, such as the ones left behind
+	// by rewriting, and renumbers the rest. Returns the bytes saved.
+	uint32_t compact_constant_pool();
 
 private:
 	uint16_t major_version;
@@ -63,6 +100,18 @@ private:
 	std::unique_ptr<Interfaces> interfaces;
 	std::unique_ptr<Methods> methods;
 	std::unique_ptr<Attributes> attributes;
+	std::unique_ptr<AllocationStats> allocation_stats;
+	TransformStats transform_stats;
+
+	// Up to the end of the constant pool, then the fields with their count
+	const uint8_t* input;
+	uint32_t constant_pool_input_size;
+	const uint8_t* fields_input;
+	uint32_t fields_input_size;
+	uint16_t input_fields_count;
+	// Compacting moved entries, so nothing refers to the same ones as the
+	// input did
+	bool remapped;
 };
 
 }
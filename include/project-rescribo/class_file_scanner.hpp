@@ -0,0 +1,144 @@
+/*
+ * Copyright 2019-2020 Jonathan Eyolfson
+ *
+ * This program is free software: you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License version 3 as published by the
+ * Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE. See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef PROJECT_RESCRIBO_CLASS_FILE_SCANNER_HPP
+#define PROJECT_RESCRIBO_CLASS_FILE_SCANNER_HPP
+
+#include <cstdint>
+#include <vector>
+
+namespace project_rescribo {
+
+// Finds where everything is in a class file without decoding it, jumping
+// over attributes and code by their lengths. One pass fills a table of
+// offsets from the start of the class file, and a scanner that's reused
+// keeps its table, so scanning more classes doesn't allocate.
+//
+// Unlike ClassFile it checks every length against the size it's given, so
+// it's safe to use on bytes that haven't been verified.
+class ClassFileScanner {
+public:
+	struct Range {
+		uint32_t offset;
+		uint32_t size;
+	};
+	struct Attribute {
+		uint16_t name_index;
+		// The info after attribute_name_index and attribute_length
+		Range info;
+	};
+	struct AttributeRange {
+		const Attribute* first;
+		const Attribute* last;
+
+		const Attribute* begin() const {
+			return first;
+		}
+		const Attribute* end() const {
+			return last;
+		}
+		uint32_t size() const {
+			return last - first;
+		}
+	};
+	// A field or a method
+	struct Member {
+		// All of the field_info or method_info
+		Range range;
+		uint16_t access_flags;
+		uint16_t name_index;
+		uint16_t descriptor_index;
+		uint16_t num_attributes;
+		uint32_t first_attribute;
+		// The bytecode in a Code attribute, empty for fields and for
+		// methods without one
+		Range code;
+	};
+
+	// Returns false if the bytes end early or an entry isn't known, leaving
+	// the table incomplete
+	bool scan(const uint8_t* data, uint32_t size);
+
+	// Everything from constant_pool_count up to access_flags
+	Range get_constant_pool() const {
+		return constant_pool;
+	}
+	uint16_t get_constant_pool_count() const {
+		return constant_pool_offsets.size();
+	}
+	// The offset of an entry's tag, 0 for index 0 and for the index after
+	// a Long or Double
+	uint32_t get_constant_pool_offset(uint16_t index) const {
+		return constant_pool_offsets[index];
+	}
+	// True if the entry is a Utf8 with exactly these bytes
+	bool is_utf8(uint16_t index, const char* value) const;
+
+	uint16_t get_access_flags() const {
+		return access_flags;
+	}
+	uint16_t get_this_class() const {
+		return this_class;
+	}
+	uint16_t get_super_class() const {
+		return super_class;
+	}
+	// The interface indices, after interfaces_count
+	Range get_interfaces() const {
+		return interfaces;
+	}
+
+	const std::vector<Member>& get_fields() const {
+		return fields;
+	}
+	const std::vector<Member>& get_methods() const {
+		return methods;
+	}
+	AttributeRange get_attributes(const Member& member) const {
+		const Attribute* first = attributes.data()
+		                         + member.first_attribute;
+		return {first, first + member.num_attributes};
+	}
+	// The class's own attributes, after every member's
+	AttributeRange get_class_attributes() const {
+		const Attribute* first = attributes.data()
+		                         + first_class_attribute;
+		return {first, attributes.data() + attributes.size()};
+	}
+private:
+	const uint8_t* data;
+	uint32_t size;
+
+	Range constant_pool;
+	std::vector<uint32_t> constant_pool_offsets;
+	uint16_t access_flags;
+	uint16_t this_class;
+	uint16_t super_class;
+	Range interfaces;
+	std::vector<Member> fields;
+	std::vector<Member> methods;
+	std::vector<Attribute> attributes;
+	uint32_t first_class_attribute;
+
+	bool scan_constant_pool(uint32_t* offset);
+	bool scan_members(uint32_t* offset, std::vector<Member>* members,
+	                  bool is_method);
+	bool scan_attributes(uint32_t* offset, uint16_t* count);
+};
+
+}
+
+#endif
@@ -0,0 +1,125 @@
+/*
+ * Copyright 2019-2020 Jonathan Eyolfson
+ *
+ * This program is free software: you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License version 3 as published by the
+ * Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE. See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef PROJECT_RESCRIBO_CLASS_HIERARCHY_HPP
+#define PROJECT_RESCRIBO_CLASS_HIERARCHY_HPP
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace project_rescribo {
+
+class ClassFile;
+class ClassHierarchy;
+
+// Supplies the classes a ClassHierarchy hasn't seen, usually by finding their
+// class file bytes and calling ClassHierarchy::add. It may be called from any
+// thread doing a query, more than once for the same name.
+class ClassHierarchyLoader {
+public:
+	virtual ~ClassHierarchyLoader() = default;
+	// Returns false if the class can't be found, it isn't asked for again
+	virtual bool load(ClassHierarchy* hierarchy, const std::string& name) = 0;
+};
+
+// The supertypes of every class added, shared by all threads transforming
+// classes. Names are as they appear in the class file, like java/lang/Object.
+//
+// Queries never lock, and their answers are memoized in fixed size caches.
+// Adding a class takes a lock. Nothing is removed, so memory is bounded by
+// the capacity instead, once it's reached classes aren't recorded and any
+// query involving them gets the conservative answer.
+class ClassHierarchy {
+public:
+	ClassHierarchy(uint32_t capacity = 1 << 16,
+	               ClassHierarchyLoader* loader = nullptr);
+	~ClassHierarchy();
+
+	// Both return false if the hierarchy is full. The first add of a class
+	// wins, an empty super_name means it has none.
+	bool add(ClassFile* class_file);
+	bool add(const std::string& name, const std::string& super_name,
+	         const std::vector<std::string>& interface_names,
+	         bool is_interface);
+
+	// Whether a value of type from can be stored as type to, false if a
+	// class in between can't be found
+	bool is_assignable(const std::string& to, const std::string& from);
+	// The closest class both extend, which is a or b themselves if one is
+	// assignable to the other. Interfaces, arrays of different types and
+	// classes that can't be found all give java/lang/Object. A copy, since
+	// the answer may be one of the arguments.
+	std::string get_common_super_class(const std::string& a,
+	                                   const std::string& b);
+
+	// Classes added, not counting ones only referred to as a supertype
+	uint32_t get_num_classes() const {
+		return num_classes.load(std::memory_order_relaxed);
+	}
+	uint32_t get_capacity() const {
+		return capacity;
+	}
+private:
+	struct Info {
+		uint32_t super_id;
+		std::vector<uint32_t> interface_ids;
+		bool is_interface;
+	};
+	// Every name seen, with the Info published once the class is added
+	struct Node {
+		Node(const std::string& name, uint64_t hash, uint32_t id, Node* next)
+		: name(name), hash(hash), id(id), next(next), info(nullptr),
+		  missing(false) {}
+		const std::string name;
+		const uint64_t hash;
+		const uint32_t id;
+		Node* const next;
+		std::atomic<const Info*> info;
+		std::atomic<bool> missing;
+	};
+
+	uint32_t capacity;
+	ClassHierarchyLoader* loader;
+	std::mutex add_mutex;
+	std::atomic<uint32_t> num_classes;
+	uint32_t num_nodes;
+	uint32_t bucket_mask;
+	std::unique_ptr<std::atomic<Node*>[]> buckets;
+	// Indexed by id, 0 is never used
+	std::unique_ptr<std::atomic<Node*>[]> nodes;
+	std::unique_ptr<std::atomic<uint64_t>[]> assignable_cache;
+	std::unique_ptr<std::atomic<uint64_t>[]> common_super_cache;
+	Node* object;
+
+	Node* find(const std::string& name) const;
+	Node* get_node(uint32_t id) const {
+		return nodes[id].load(std::memory_order_acquire);
+	}
+	Node* intern(const std::string& name);
+	const Info* get_info(Node* node);
+	Node* resolve(const std::string& name);
+	bool is_assignable(Node* to, Node* from, bool* complete);
+	bool is_array_assignable(const std::string& to,
+	                         const std::string& from);
+};
+
+}
+
+#endif
@@ -32,13 +32,17 @@ namespace project_rescribo {
 class Attributes;
 class BranchInstruction;
 class LineNumberTable;
+class Liveness;
 class LookupSwitch;
 class Method;
 class StackMapTable;
 class TableSwitch;
+class VariableInfo;
 
 class Code : public Attribute {
 public:
+	typedef std::list<std::unique_ptr<Instruction>> Instructions;
+
 	struct ExceptionTableEntry {
 		Instruction* start;
 		Instruction* end;
@@ -48,6 +52,7 @@ public:
 
 	Code(const uint8_t** buffer, uint16_t attribute_name_index, Method* method);
 	Code(Method* method);
+	~Code();
 
 	static bool classof(const Attribute* attribute) {
 		return attribute->get_kind() == Kind::Code;
@@ -64,27 +69,58 @@ public:
 	}
 
 	Instruction* get_instruction(uint32_t bci) const;
-
-	virtual uint32_t get_byte_size() const {
-		return 18 + next_bci +
-		       attributes->get_byte_size() +
-		       8 * exception_table.size();
+	// Insert through an InstructionInserter to keep the side lists current
+	Instructions& get_instructions() {
+		return instructions;
+	}
+	StackMapTable* get_stack_map_table() const {
+		return stack_map_table;
+	}
+	// Only class files from version 50 on have stack map frames
+	StackMapTable* get_or_create_stack_map_table();
+	// An end of nullptr is the end of the code
+	const std::vector<ExceptionTableEntry>& get_exception_table() const {
+		return exception_table;
 	}
 
+	// Built when first needed and kept until an instruction, jump target
+	// or range changes. Needs the code synced.
+	const Liveness& get_liveness();
+
+	// Cached until the code or one of its attributes changes size
+	virtual uint32_t get_byte_size() const;
+	// Tells the method the first time, it's already been told until the
+	// size is computed again
+	void invalidate_byte_size();
+
 	uint16_t get_max_stack() const {
 		return max_stack;
 	}
 	void set_max_stack(uint16_t v) {
 		max_stack = v;
+		++version;
 	}
 	uint16_t get_max_locals() const {
 		return max_locals;
 	}
 	void set_max_locals(uint16_t v) {
 		max_locals = v;
+		++version;
+	}
+
+	// Nothing has changed since it was parsed, so its input can be written
+	// as is
+	bool is_unchanged() const {
+		return version == 0;
+	}
+	// For changes made to its attributes
+	void mark_changed() {
+		++version;
 	}
 
 	virtual void write_buffer(uint8_t** buffer) const;
+	virtual void visit_constant_pool_indices(
+		ConstantPoolIndexVisitor& visitor) override;
 private:
 	Method* method;
 	LineNumberTable* line_number_table;
@@ -92,14 +128,36 @@ private:
 
 	uint16_t max_stack;
 	uint16_t max_locals;
-	typedef std::list<std::unique_ptr<Instruction>> Instructions;
+	mutable uint32_t byte_size;
+	mutable bool is_byte_size_current;
 	Instructions instructions;
 	std::vector<ExceptionTableEntry> exception_table;
 	std::unique_ptr<Attributes> attributes;
+	// By size, one slot or two, only ones past the method's own locals
+	std::vector<uint16_t> released_locals[2];
+	uint16_t num_own_locals;
+	// Counts changes, so liveness knows it's stale
+	uint32_t version;
+	std::unique_ptr<Liveness> liveness;
+	uint32_t liveness_version;
 
 	uint32_t next_bci;
 	std::unordered_map<uint32_t, Instruction*> instruction_map;
 
+	// Only these instructions carry targets, so the offset passes skip the
+	// rest. Branches keep their position since fixing one may insert after it.
+	std::vector<Instructions::iterator> branches;
+	std::vector<LookupSwitch*> lookup_switches;
+	std::vector<TableSwitch*> table_switches;
+
+	Instructions::iterator insert_instruction(
+		Instructions::iterator insertion_point,
+		std::unique_ptr<Instruction> instruction
+	);
+	Instructions::iterator erase_instruction(Instructions::iterator iter);
+	void track_instruction(Instructions::iterator iter);
+	void untrack_instruction(Instructions::iterator iter);
+
 	void set_branch_target(BranchInstruction* branch);
 	void set_lookup_switch_targets(LookupSwitch* lookup_switch);
 	void set_table_switch_targets(TableSwitch* table_switch);
@@ -111,6 +169,15 @@ private:
 	void sync_instruction_offsets();
 
 	void replace_targets(Instruction* old_target, Instruction* new_target);
+	// Locals for a frame at the instruction that every handler covering it
+	// accepts. False if some handler has no frame or two disagree on a
+	// type. Needs the code synced.
+	bool get_handler_locals(
+		Instruction* instruction,
+		std::vector<std::unique_ptr<VariableInfo>>* locals
+	) const;
+	void replace_range_bounds(Instruction* old_bound,
+	                          Instruction* new_bound);
 	void replace_branch_targets(BranchInstruction* branch,
 	                            Instruction* old_target,
 	                            Instruction* new_target);
@@ -183,12 +250,21 @@ public:
 		void insert_ifeq(Instruction* target);
 		void insert_invokestatic(uint16_t index);
 		void insert_ldc(uint16_t index);
+		// The shortest form for the local's index and field type,
+		// wide above 255
+		void insert_load(const char* descriptor, uint16_t index);
+		void insert_store(const char* descriptor, uint16_t index);
 		void insert_nop();
 		void insert_pop();
 		void insert_putstatic(uint16_t index);
 		void insert_return();
 		void insert_sipush(uint16_t value);
 
+		// Decodes instructions that are already encoded, which can't
+		// include branches or switches. Returns the first one.
+		Instruction* insert_bytecode(const uint8_t* bytecode,
+		                             uint32_t length);
+
 		void insert_method_name_and_descriptor_ldc(
 			InvokeInstruction* invoke_instruction
 		);
@@ -203,6 +279,56 @@ public:
 	InstructionInserter create_front_inserter() {
 		return InstructionInserter(this, instructions.begin());
 	}
+
+	// Jumps, handlers and stack map frames at old_target move to new_target,
+	// which should be inserted right before it. Exception ranges ending at
+	// old_target end at new_target instead, so they don't grow.
+	void retarget(Instruction* old_target, Instruction* new_target);
+
+	// Everything referring to the instruction at iter refers to the new one
+	// instead, which takes its place. Returns the new one's position.
+	Instructions::iterator replace(Instructions::iterator iter,
+	                               std::unique_ptr<Instruction> instruction);
+	// Exception and local variable ranges starting or ending at the
+	// instruction move to the next one, and an exception range left empty
+	// is removed. Jumps, handlers and frames can't refer to it, and it
+	// can't be the last instruction.
+	Instructions::iterator erase(Instructions::iterator iter);
+	// Type annotations hold offsets of their own, such as the ranges of a
+	// localvar_target, which neither replace nor erase update
+	bool has_type_annotations() const;
+
+	// A local for a temporary of a single field type, such as I, J or
+	// Ljava/lang/String;. It's past the method's own locals, growing
+	// max_locals to fit, or one released before that's the same size.
+	uint16_t allocate_local(const char* descriptor);
+	// The same, but first trying one of the method's own locals after its
+	// parameters, if it's dead everywhere from begin up to end, or the end
+	// of the code if that's nullptr, no instruction there uses it, and no
+	// stack map frame gives it a type. A debugger may show the temporary
+	// for a variable still in scope there. Needs the code synced.
+	uint16_t allocate_local(const char* descriptor,
+	                        Instruction* begin, Instruction* end);
+	void release_local(uint16_t index, const char* descriptor);
+	// Only needed when the temporary is live at a stack map frame, from
+	// begin up to end, or the end of the code if that's nullptr. Those
+	// frames list it with its type. Needs the code synced.
+	void declare_local(uint16_t index, const char* descriptor,
+	                   Instruction* begin, Instruction* end);
+
+	// Inserts the same encoded instructions before every return, so jumps
+	// to a return run them as well. Returns the number of returns.
+	uint32_t insert_before_returns(const uint8_t* bytecode, uint32_t length);
+	// The same, but skipped unless the static boolean field is true. Adds
+	// a frame at each return for the jump, assuming only the return value
+	// is on the stack, as compilers leave it. Its locals can't be used
+	// unless exception ranges cover the return, then they're the ones
+	// every covering handler accepts. A return whose handlers can't agree
+	// gets the call unguarded. Syncs to place the frames, so sync again
+	// once done.
+	uint32_t insert_guarded_before_returns(const uint8_t* bytecode,
+	                                       uint32_t length,
+	                                       uint16_t flag_index);
 };
 
 }
@@ -17,33 +17,67 @@
 #ifndef PROJECT_RESCRIBO_CONSTANT_POOL_HPP
 #define PROJECT_RESCRIBO_CONSTANT_POOL_HPP
 
+#include "attribute.hpp"
 #include "constant_pool_entry.hpp"
 
+#include <cassert>
 #include <cstdint>
-#include <memory>
-#include <unordered_map>
 #include <vector>
 
 namespace project_rescribo {
 
-class ConstantPoolEntry;
-
 class ConstantPool {
 public:
+	typedef ConstantPoolEntry::Kind Kind;
+
 	ConstantPool(const uint8_t** buffer, uint16_t count);
 	~ConstantPool();
-	uint32_t get_byte_size() const;
+	uint32_t get_byte_size() const {
+		return entries_byte_size + utf8_bytes.size();
+	}
+
+	// Entries were added or removed since parsing
+	bool is_modified() const {
+		return modified;
+	}
 
-	ConstantPoolEntry* get_entry(uint16_t index) const;
+	// Number of indices in use, including the ones after Long and Double
 	uint32_t get_size() const {
-		return entries.size();
+		return tags.size() - 1;
 	}
 
+	Kind get_kind(uint16_t index) const {
+		assert(index > 0 && index < tags.size());
+		return static_cast<Kind>(tags[index]);
+	}
+	ConstantPoolUtf8 get_utf8(uint16_t index) const;
+	ConstantPoolInteger get_integer(uint16_t index) const;
+	ConstantPoolFloat get_float(uint16_t index) const;
+	ConstantPoolLong get_long(uint16_t index) const;
+	ConstantPoolDouble get_double(uint16_t index) const;
+	ConstantPoolClass get_class(uint16_t index) const;
+	ConstantPoolString get_string(uint16_t index) const;
+	ConstantPoolRef get_ref(uint16_t index) const;
+	ConstantPoolNameAndType get_name_and_type(uint16_t index) const;
+	ConstantPoolMethodHandle get_method_handle(uint16_t index) const;
+	ConstantPoolMethodType get_method_type(uint16_t index) const;
+	ConstantPoolDynamic get_dynamic(uint16_t index) const;
+
+	// Memoized per index, so attribute dispatch is a table lookup after the
+	// first time a name is seen
+	Attribute::Kind get_attribute_kind(uint16_t name_index);
+	// Looks up every Utf8 ahead of time, so until another entry is added
+	// get_attribute_kind only reads and can be called from several threads
+	void resolve_attribute_kinds();
+
+	// Each returns 0 if the constant pool is full, or if an index it's
+	// given is 0, so a failure anywhere in a chain of calls reaches the end
 	uint16_t get_or_create_utf8_index(const char* str);
 	uint16_t get_or_create_name_and_type_index(uint16_t name_index,
 	                                           uint16_t type_index);
 	uint16_t get_or_create_class_index(uint16_t name_index);
 	uint16_t get_or_create_string_index(uint16_t index);
+	uint16_t get_or_create_integer_index(int32_t value);
 	uint16_t get_or_create_fieldref_index(uint16_t class_index,
 	                                      uint16_t name_and_type_index);
 	uint16_t get_or_create_fieldref_index(uint16_t class_index,
@@ -56,8 +90,33 @@ public:
 	                                       const char* method_descriptor);
 
 	void write_buffer(uint8_t** buffer) const;
+
+	// Only the indices entries hold to other entries
+	void visit_constant_pool_indices(ConstantPoolIndexVisitor& visitor);
+	void visit_constant_pool_indices(uint16_t index,
+	                                 ConstantPoolIndexVisitor& visitor);
+	// Drops the entries not marked as used, leaving the indices they hold
+	// untouched. Returns the new index for each old one, 0 if dropped.
+	std::vector<uint16_t> remove_unused(const std::vector<bool>& used);
 private:
-	std::vector<std::unique_ptr<ConstantPoolEntry>> entries;
+	// All indexed by constant pool index. Operands are one or two u16s packed
+	// high to low, the MethodHandle kind above its u16, the u32 of Integer
+	// and Float, the high then low u32 of Long and Double across both of
+	// their indices, or the offset of a Utf8 in utf8_bytes.
+	std::vector<uint8_t> tags;
+	std::vector<uint32_t> operands;
+	// Each Utf8 exactly as in the class file, a u16 length then the bytes
+	std::vector<uint8_t> utf8_bytes;
+	std::vector<uint8_t> attribute_kinds;
+	// Every entry's tag and operands, kept current as entries are added
+	uint32_t entries_byte_size;
+	bool modified;
+	// Counts every change that can move utf8_bytes, see ConstantPoolUtf8
+	uint32_t generation;
+
+	uint16_t add_entry(Kind kind, uint32_t operand);
+	uint16_t find_entry(Kind kind, uint32_t operand) const;
+	uint16_t get_or_create_entry(Kind kind, uint32_t operand);
 };
 
 }
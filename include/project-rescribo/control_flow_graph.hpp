@@ -0,0 +1,88 @@
+/*
+ * Copyright 2019-2020 Jonathan Eyolfson
+ *
+ * This program is free software: you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License version 3 as published by the
+ * Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE. See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef PROJECT_RESCRIBO_CONTROL_FLOW_GRAPH_HPP
+#define PROJECT_RESCRIBO_CONTROL_FLOW_GRAPH_HPP
+
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+#include "code.hpp"
+
+namespace project_rescribo {
+
+// The basic blocks of a method in bytecode order, built from Code that is
+// synced. A block starts at the first instruction, a jump or handler target,
+// an exception range boundary or after a jump, switch, return or athrow.
+//
+// The blocks refer into the Code's instructions, inserting keeps them valid
+// but the graph only describes the code as it was when built.
+class ControlFlowGraph {
+public:
+	struct Block {
+		Code::Instructions::iterator begin;
+		Code::Instructions::iterator end;
+		uint32_t start_bci;
+		uint32_t end_bci;
+		// Normal flow, without duplicates
+		std::vector<uint32_t> successors;
+		std::vector<uint32_t> predecessors;
+		// The handlers of every range covering the block
+		std::vector<uint32_t> handlers;
+		// Ends in a return or athrow
+		bool is_exit;
+		bool is_handler;
+
+		Instruction* get_first() const {
+			return begin->get();
+		}
+		Instruction* get_last() const {
+			return std::prev(end)->get();
+		}
+	};
+
+	ControlFlowGraph(Code* code);
+
+	Code* get_code() const {
+		return code;
+	}
+	std::vector<Block>& get_blocks() {
+		return blocks;
+	}
+	const std::vector<Block>& get_blocks() const {
+		return blocks;
+	}
+	// Every leader starts a block, so any other instruction is UINT32_MAX
+	uint32_t get_block_index(const Instruction* leader) const;
+
+	// Uses jsr and ret, where a ret's successors depend on the return
+	// address. The blocks are still built, but ret has no successors.
+	bool has_subroutines() const {
+		return subroutines;
+	}
+private:
+	Code* code;
+	std::vector<Block> blocks;
+	std::unordered_map<const Instruction*, uint32_t> block_indices;
+	bool subroutines;
+
+	void add_edge(uint32_t from, const Instruction* to);
+};
+
+}
+
+#endif
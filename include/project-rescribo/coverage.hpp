@@ -0,0 +1,138 @@
+/*
+ * Copyright 2019-2020 Jonathan Eyolfson
+ *
+ * This program is free software: you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License version 3 as published by the
+ * Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE. See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef PROJECT_RESCRIBO_COVERAGE_HPP
+#define PROJECT_RESCRIBO_COVERAGE_HPP
+
+#include <cstdint>
+#include <cstdio>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "name_matcher.hpp"
+
+namespace project_rescribo {
+
+class ClassFile;
+
+// Everything needed to get block counts back from the counters once the
+// instrumented code has run, possibly in another process.
+//
+// Each method's flow graph has an entry and exit vertex, 0 and 1, and splits
+// block b into 2 + 2b, where it's entered, and 3 + 2b, where it's left. The
+// first edges are the blocks themselves, from 2 + 2b to 3 + 2b, so edge b
+// counts block b. The rest are jumps, fallthroughs, the entry to the first
+// block and to each handler, and exit back to entry, which makes the flow
+// into every vertex equal the flow out of it.
+class CoverageMap {
+public:
+	static constexpr uint32_t NO_COUNTER = UINT32_MAX;
+
+	struct Edge {
+		uint32_t from;
+		uint32_t to;
+		uint32_t counter;
+	};
+	struct Method {
+		std::string class_name;
+		std::string name;
+		std::string descriptor;
+		// Of each block before instrumenting
+		std::vector<uint32_t> block_bcis;
+		std::vector<Edge> edges;
+		uint32_t num_counters;
+	};
+
+	CoverageMap();
+
+	// Safe to call from any number of threads
+	void add(Method&& method);
+	void add_skipped();
+
+	const std::vector<Method>& get_methods() const {
+		return methods;
+	}
+	uint32_t get_num_counters() const {
+		return num_counters;
+	}
+	uint32_t get_num_blocks() const {
+		return num_blocks;
+	}
+	// Methods using jsr and ret aren't instrumented
+	uint32_t get_num_skipped() const {
+		return num_skipped;
+	}
+
+	// Solves for the edges without a counter using flow conservation.
+	// Counters are indexed by id, as passed to the hook. Exact as long as
+	// no exception was thrown, which leaves a block part way through.
+	static std::vector<uint64_t> get_block_counts(const Method& method,
+	                                              const uint64_t* counters);
+
+	// Counters compared to a counter in every block
+	void print(FILE* file) const;
+
+	// One method per line, as whitespace separated fields
+	void write(FILE* file) const;
+	bool read(FILE* file);
+private:
+	std::mutex mutex;
+	std::vector<Method> methods;
+	uint32_t num_counters;
+	uint32_t num_blocks;
+	uint32_t num_skipped;
+};
+
+// Block coverage with counters on as few edges as possible, using the method
+// from Ball and Larus, "Optimally Profiling and Tracing Programs". The edges
+// of a spanning tree are left out, since flow conservation gives their
+// counts from the rest, and the edges most likely to run often are put in
+// the tree first. Only a block itself, or entering the method, gets a
+// counter so nothing needs a new jump. If the tree can't be built from only
+// those, the method gets a counter in every block instead.
+//
+// A counter passes its id to a static hook taking an int. Add rules to
+// get_classes and get_methods then call compile, after that any number of
+// threads can apply it.
+class Coverage {
+public:
+	Coverage(const std::string& hook_class, const std::string& hook_method);
+
+	NameMatcher& get_classes() {
+		return classes;
+	}
+	NameMatcher& get_methods() {
+		return methods;
+	}
+	void compile();
+
+	// Numbers the counters from first_counter and adds the instrumented
+	// methods to map. Syncs every method it changes. A method is skipped,
+	// like one using subroutines, if the constant pool is too full for its
+	// counters. Returns the number of counters used.
+	uint32_t apply(ClassFile* class_file, uint32_t first_counter,
+	               CoverageMap* map) const;
+private:
+	std::string hook_class;
+	std::string hook_method;
+	NameMatcher classes;
+	NameMatcher methods;
+};
+
+}
+
+#endif
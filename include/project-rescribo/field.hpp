@@ -21,6 +21,8 @@
 #include <memory>
 
 #include "access.hpp"
+#include "allocation_stats.hpp"
+#include "constant_pool_entry.hpp"
 
 namespace project_rescribo {
 
@@ -36,14 +38,27 @@ public:
 	      const char* name,
 	      const char* descriptor);
 	~Field();
+	PROJECT_RESCRIBO_TRACK_ALLOCATIONS(Field)
 
 	ClassFile* get_class_file() const {
 		return class_file;
 	}
 	ConstantPool* get_constant_pool() const;
 
+	uint16_t get_name_index() const {
+		return name_index;
+	}
+	ConstantPoolUtf8 get_name_utf8() const;
+	uint16_t get_descriptor_index() const {
+		return descriptor_index;
+	}
+	ConstantPoolUtf8 get_descriptor_utf8() const;
+
+	bool is_name(const char* str) const;
+
 	uint32_t get_byte_size() const;
 	void write_buffer(uint8_t** buffer) const;
+	void visit_constant_pool_indices(ConstantPoolIndexVisitor& visitor);
 private:
 	ClassFile* class_file;
 	Access access;
@@ -21,25 +21,40 @@
 #include <memory>
 #include <vector>
 
+#include "member_index.hpp"
+
 namespace project_rescribo {
 
 class Field;
 class ClassFile;
+class ConstantPoolIndexVisitor;
 
 class Fields {
 public:
 	Fields(const uint8_t** buffer, uint16_t count, ClassFile* class_file);
 	~Fields();
 
-	void add(std::unique_ptr<Field> field) {
-		fields.push_back(std::move(field));
+	std::vector<std::unique_ptr<Field>>& get() {
+		return fields;
 	}
+	void add(std::unique_ptr<Field> field);
+
+	// nullptr if there isn't one
+	Field* find(uint16_t name_index, uint16_t descriptor_index);
+	// With a nullptr descriptor, any field with the name
+	Field* find(const char* name, const char* descriptor = nullptr);
 
-	uint32_t get_byte_size() const;
+	// Kept as fields are added, nothing changes a field's size after
+	uint32_t get_byte_size() const {
+		return byte_size;
+	}
 	void write_buffer(uint8_t** buffer) const;
+	void visit_constant_pool_indices(ConstantPoolIndexVisitor& visitor);
 
 private:
 	std::vector<std::unique_ptr<Field>> fields;
+	uint32_t byte_size;
+	MemberIndex<Field> index;
 };
 
 }
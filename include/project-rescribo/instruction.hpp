@@ -21,11 +21,15 @@
 #include <memory>
 #include <vector>
 
+#include "allocation_stats.hpp"
+#include "opcode_info.hpp"
+
 namespace project_rescribo {
 
 class ClassFile;
 class Code;
 class ConstantPool;
+class ConstantPoolIndexVisitor;
 class ConstantPoolUtf8;
 class Method;
 
@@ -235,8 +239,11 @@ public:
 		Goto_W = 0xC8,
 		Jsr_W = 0xC9,
 	};
-	Instruction(Kind kind, Code* code) : kind(kind), code(code) {}
+	Instruction(Kind kind, Code* code) : kind(kind), code(code) {
+		AllocationStats::record_instruction(static_cast<uint8_t>(kind));
+	}
 	virtual ~Instruction();
+	PROJECT_RESCRIBO_TRACK_ALLOCATIONS(Instruction)
 	Kind get_kind() const {
 		return kind;
 	}
@@ -246,10 +253,35 @@ public:
 	Method* get_method() const;
 	ClassFile* get_class_file() const;
 	ConstantPool* get_constant_pool() const;
-	virtual uint16_t get_byte_size() const = 0;
-	virtual const char* get_mnemonic() const = 0;
-	virtual int8_t get_stack_delta() const;
+	const OpcodeInfo& get_opcode_info() const {
+		return OPCODE_INFO[static_cast<uint8_t>(kind)];
+	}
+
+	// Fixed sizes and stack effects come from the opcode table, only the
+	// variable ones need a virtual call
+	uint16_t get_byte_size() const {
+		const OpcodeInfo& info = get_opcode_info();
+		if (info.has_fixed_length()) {
+			return info.length;
+		}
+		return get_variable_byte_size();
+	}
+	int8_t get_stack_delta() const {
+		const OpcodeInfo& info = get_opcode_info();
+		if (info.has_fixed_stack_delta()) {
+			return info.get_stack_delta();
+		}
+		return get_variable_stack_delta();
+	}
+	virtual uint16_t get_variable_byte_size() const;
+	virtual int8_t get_variable_stack_delta() const;
+	virtual const char* get_mnemonic() const {
+		return get_opcode_info().mnemonic;
+	}
 	virtual void write_buffer(uint8_t** buffer) const = 0;
+	// Only for opcodes in the OpcodeInfo::ConstantPoolIndex category
+	virtual void visit_constant_pool_indices(
+		ConstantPoolIndexVisitor& visitor);
 
 	uint32_t get_bci() const {
 		return bci;
@@ -276,26 +308,7 @@ public:
 	: Instruction(kind, code), target(target) {}
 
 	static bool classof(const Instruction* instruction) {
-		return instruction->get_kind() == Kind::Goto
-		       || instruction->get_kind() == Kind::Goto_W
-		       || instruction->get_kind() == Kind::If_ACmpEq
-		       || instruction->get_kind() == Kind::If_ACmpNe
-		       || instruction->get_kind() == Kind::If_ICmpEq
-		       || instruction->get_kind() == Kind::If_ICmpNe
-		       || instruction->get_kind() == Kind::If_ICmpLt
-		       || instruction->get_kind() == Kind::If_ICmpGe
-		       || instruction->get_kind() == Kind::If_ICmpGt
-		       || instruction->get_kind() == Kind::If_ICmpLe
-		       || instruction->get_kind() == Kind::IfEq
-		       || instruction->get_kind() == Kind::IfNe
-		       || instruction->get_kind() == Kind::IfLt
-		       || instruction->get_kind() == Kind::IfGe
-		       || instruction->get_kind() == Kind::IfGt
-		       || instruction->get_kind() == Kind::IfLe
-		       || instruction->get_kind() == Kind::IfNonNull
-		       || instruction->get_kind() == Kind::IfNull
-		       || instruction->get_kind() == Kind::Jsr
-		       || instruction->get_kind() == Kind::Jsr_W;
+		return instruction->get_opcode_info().is(OpcodeInfo::Branch);
 	}
 
 	bool is_wide() const {
@@ -327,11 +340,7 @@ public:
 	: Instruction(kind, code), index(index) {}
 
 	static bool classof(const Instruction* instruction) {
-		return instruction->get_kind() == Kind::InvokeVirtual
-		       || instruction->get_kind() == Kind::InvokeSpecial
-		       || instruction->get_kind() == Kind::InvokeStatic
-		       || instruction->get_kind() == Kind::InvokeInterface
-		       || instruction->get_kind() == Kind::InvokeDynamic;
+		return instruction->get_opcode_info().is(OpcodeInfo::Invoke);
 	}
 
 	bool has_objectref() const {
@@ -340,7 +349,9 @@ public:
 		       || get_kind() == Kind::InvokeSpecial;
 	}
 
-	int8_t get_stack_delta() const override;
+	int8_t get_variable_stack_delta() const override;
+	void visit_constant_pool_indices(
+		ConstantPoolIndexVisitor& visitor) override;
 
 	uint16_t get_index() const {
 		return index;
@@ -355,7 +366,7 @@ public:
 private:
 	uint16_t index;
 
-	ConstantPoolUtf8* get_descriptor() const;
+	ConstantPoolUtf8 get_descriptor() const;
 };
 
 class AALoad : public Instruction {
@@ -366,15 +377,6 @@ public:
 		return instruction->get_kind() == Kind::AALoad;
 	}
 
-	uint16_t get_byte_size() const override {
-		return 1;
-	}
-	const char* get_mnemonic() const override {
-		return "aaload";
-	}
-	int8_t get_stack_delta() const override {
-		return -1;
-	}
 	void write_buffer(uint8_t** buffer) const override;
 };
 
@@ -386,15 +388,6 @@ public:
 		return instruction->get_kind() == Kind::AAStore;
 	}
 
-	uint16_t get_byte_size() const override {
-		return 1;
-	}
-	const char* get_mnemonic() const override {
-		return "aastore";
-	}
-	int8_t get_stack_delta() const override {
-		return -3;
-	}
 	void write_buffer(uint8_t** buffer) const override;
 };
 
@@ -406,15 +399,6 @@ public:
 		return instruction->get_kind() == Kind::AConst_Null;
 	}
 
-	uint16_t get_byte_size() const override {
-		return 1;
-	}
-	const char* get_mnemonic() const override {
-		return "aconst_null";
-	}
-	int8_t get_stack_delta() const override {
-		return 1;
-	}
 	void write_buffer(uint8_t** buffer) const override;
 };
 
@@ -427,16 +411,6 @@ public:
 		return instruction->get_kind() == Kind::ALoad;
 	}
 
-	uint16_t get_byte_size() const override {
-		return 2;
-	}
-	const char* get_mnemonic() const override {
-		return "aload";
-	}
-	int8_t get_stack_delta() const override {
-		return 1;
-	}
-
 	uint8_t get_index() const {
 		return index;
 	}
@@ -453,17 +427,6 @@ public:
 		return instruction->get_kind() == Kind::ALoad_0;
 	}
 
-	uint16_t get_byte_size() const override {
-		return 1;
-	}
-	const char* get_mnemonic() const override {
-		return "aload_0";
-	}
-
-	int8_t get_stack_delta() const override {
-		return 1;
-	}
-
 	void write_buffer(uint8_t** buffer) const override;
 };
 
@@ -475,17 +438,6 @@ public:
 		return instruction->get_kind() == Kind::ALoad_1;
 	}
 
-	uint16_t get_byte_size() const override {
-		return 1;
-	}
-	const char* get_mnemonic() const override {
-		return "aload_1";
-	}
-
-	int8_t get_stack_delta() const override {
-		return 1;
-	}
-
 	void write_buffer(uint8_t** buffer) const override;
 
 };
@@ -498,17 +450,6 @@ public:
 		return instruction->get_kind() == Kind::ALoad_2;
 	}
 
-	uint16_t get_byte_size() const override {
-		return 1;
-	}
-	const char* get_mnemonic() const override {
-		return "aload_2";
-	}
-
-	int8_t get_stack_delta() const override {
-		return 1;
-	}
-
 	void write_buffer(uint8_t** buffer) const override;
 };
 
@@ -520,17 +461,6 @@ public:
 		return instruction->get_kind() == Kind::ALoad_3;
 	}
 
-	uint16_t get_byte_size() const override {
-		return 1;
-	}
-	const char* get_mnemonic() const override {
-		return "aload_3";
-	}
-
-	int8_t get_stack_delta() const override {
-		return 1;
-	}
-
 	void write_buffer(uint8_t** buffer) const override;
 };
 
@@ -543,20 +473,12 @@ public:
 		return instruction->get_kind() == Kind::ANewArray;
 	}
 
-	uint16_t get_byte_size() const override {
-		return 3;
-	}
-	const char* get_mnemonic() const override {
-		return "anewarray";
-	}
-	int8_t get_stack_delta() const override {
-		return 0;
-	}
-
 	uint16_t get_index() const {
 		return index;
 	}
 	void write_buffer(uint8_t** buffer) const override;
+	void visit_constant_pool_indices(
+		ConstantPoolIndexVisitor& visitor) override;
 private:
 	uint16_t index;
 };
@@ -569,12 +491,6 @@ public:
 		return instruction->get_kind() == Kind::AReturn;
 	}
 
-	uint16_t get_byte_size() const override {
-		return 1;
-	}
-	const char* get_mnemonic() const override {
-		return "areturn";
-	}
 	void write_buffer(uint8_t** buffer) const override;
 };
 
@@ -586,17 +502,6 @@ public:
 		return instruction->get_kind() == Kind::ArrayLength;
 	}
 
-	uint16_t get_byte_size() const override {
-		return 1;
-	}
-	const char* get_mnemonic() const override {
-		return "arraylength";
-	}
-
-	int8_t get_stack_delta() const override {
-		return 0;
-	}
-
 	void write_buffer(uint8_t** buffer) const override;
 };
 
@@ -609,16 +514,6 @@ public:
 		return instruction->get_kind() == Kind::AStore;
 	}
 
-	uint16_t get_byte_size() const override {
-		return 2;
-	}
-	const char* get_mnemonic() const override {
-		return "astore";
-	}
-	int8_t get_stack_delta() const override {
-		return -1;
-	}
-
 	uint8_t get_index() const {
 		return index;
 	}
@@ -635,17 +530,6 @@ public:
 		return instruction->get_kind() == Kind::AStore_0;
 	}
 
-	uint16_t get_byte_size() const override {
-		return 1;
-	}
-	const char* get_mnemonic() const override {
-		return "astore_0";
-	}
-
-	int8_t get_stack_delta() const override {
-		return -1;
-	}
-
 	void write_buffer(uint8_t** buffer) const override;
 };
 
@@ -657,17 +541,6 @@ public:
 		return instruction->get_kind() == Kind::AStore_1;
 	}
 
-	uint16_t get_byte_size() const override {
-		return 1;
-	}
-	const char* get_mnemonic() const override {
-		return "astore_1";
-	}
-
-	int8_t get_stack_delta() const override {
-		return -1;
-	}
-
 	void write_buffer(uint8_t** buffer) const override;
 };
 
@@ -679,17 +552,6 @@ public:
 		return instruction->get_kind() == Kind::AStore_2;
 	}
 
-	uint16_t get_byte_size() const override {
-		return 1;
-	}
-	const char* get_mnemonic() const override {
-		return "astore_2";
-	}
-
-	int8_t get_stack_delta() const override {
-		return -1;
-	}
-
 	void write_buffer(uint8_t** buffer) const override;
 };
 
@@ -701,17 +563,6 @@ public:
 		return instruction->get_kind() == Kind::AStore_3;
 	}
 
-	uint16_t get_byte_size() const override {
-		return 1;
-	}
-	const char* get_mnemonic() const override {
-		return "astore_3";
-	}
-
-	int8_t get_stack_delta() const override {
-		return -1;
-	}
-
 	void write_buffer(uint8_t** buffer) const override;
 };
 
@@ -723,12 +574,6 @@ public:
 		return instruction->get_kind() == Kind::AThrow;
 	}
 
-	uint16_t get_byte_size() const override {
-		return 1;
-	}
-	const char* get_mnemonic() const override {
-		return "athrow";
-	}
 	void write_buffer(uint8_t** buffer) const override;
 };
 
@@ -740,17 +585,6 @@ public:
 		return instruction->get_kind() == Kind::BALoad;
 	}
 
-	uint16_t get_byte_size() const override {
-		return 1;
-	}
-	const char* get_mnemonic() const override {
-		return "baload";
-	}
-
-	int8_t get_stack_delta() const override {
-		return -1;
-	}
-
 	void write_buffer(uint8_t** buffer) const override;
 };
 
@@ -762,17 +596,6 @@ public:
 		return instruction->get_kind() == Kind::BAStore;
 	}
 
-	uint16_t get_byte_size() const override {
-		return 1;
-	}
-	const char* get_mnemonic() const override {
-		return "bastore";
-	}
-
-	int8_t get_stack_delta() const override {
-		return -3;
-	}
-
 	void write_buffer(uint8_t** buffer) const override;
 };
 
@@ -785,16 +608,6 @@ public:
 		return instruction->get_kind() == Kind::BIPush ;
 	}
 
-	uint16_t get_byte_size() const override {
-		return 2;
-	}
-	const char* get_mnemonic() const override {
-		return "bipush";
-	}
-	int8_t get_stack_delta() const override {
-		return 1;
-	}
-
 	uint8_t get_value() const {
 		return value;
 	}
@@ -811,17 +624,6 @@ public:
 		return instruction->get_kind() == Kind::CALoad;
 	}
 
-	uint16_t get_byte_size() const override {
-		return 1;
-	}
-	const char* get_mnemonic() const override {
-		return "caload";
-	}
-
-	int8_t get_stack_delta() const override {
-		return -1;
-	}
-
 	void write_buffer(uint8_t** buffer) const override;
 };
 
@@ -833,17 +635,6 @@ public:
 		return instruction->get_kind() == Kind::CAStore;
 	}
 
-	uint16_t get_byte_size() const override {
-		return 1;
-	}
-	const char* get_mnemonic() const override {
-		return "castore";
-	}
-
-	int8_t get_stack_delta() const override {
-		return -3;
-	}
-
 	void write_buffer(uint8_t** buffer) const override;
 };
 
@@ -856,20 +647,12 @@ public:
 		return instruction->get_kind() == Kind::CheckCast;
 	}
 
-	uint16_t get_byte_size() const override {
-		return 3;
-	}
-	const char* get_mnemonic() const override {
-		return "checkcast";
-	}
-	int8_t get_stack_delta() const override {
-		return 0;
-	}
-
 	uint16_t get_index() const {
 		return index;
 	}
 	void write_buffer(uint8_t** buffer) const override;
+	void visit_constant_pool_indices(
+		ConstantPoolIndexVisitor& visitor) override;
 private:
 	uint16_t index;
 };
@@ -882,17 +665,6 @@ public:
 		return instruction->get_kind() == Kind::D2F;
 	}
 
-	uint16_t get_byte_size() const override {
-		return 1;
-	}
-	const char* get_mnemonic() const override {
-		return "d2f";
-	}
-
-	int8_t get_stack_delta() const override {
-		return 0;
-	}
-
 	void write_buffer(uint8_t** buffer) const override;
 };
 
@@ -904,17 +676,6 @@ public:
 		return instruction->get_kind() == Kind::D2I;
 	}
 
-	uint16_t get_byte_size() const override {
-		return 1;
-	}
-	const char* get_mnemonic() const override {
-		return "d2i";
-	}
-
-	int8_t get_stack_delta() const override {
-		return 0;
-	}
-
 	void write_buffer(uint8_t** buffer) const override;
 
 };
@@ -927,17 +688,6 @@ public:
 		return instruction->get_kind() == Kind::D2L;
 	}
 
-	uint16_t get_byte_size() const override {
-		return 1;
-	}
-	const char* get_mnemonic() const override {
-		return "d2l";
-	}
-
-	int8_t get_stack_delta() const override {
-		return 0;
-	}
-
 	void write_buffer(uint8_t** buffer) const override;
 };
 
@@ -949,17 +699,6 @@ public:
 		return instruction->get_kind() == Kind::DAdd;
 	}
 
-	uint16_t get_byte_size() const override {
-		return 1;
-	}
-	const char* get_mnemonic() const override {
-		return "dadd";
-	}
-
-	int8_t get_stack_delta() const override {
-		return -1;
-	}
-
 	void write_buffer(uint8_t** buffer) const override;
 };
 
@@ -971,17 +710,6 @@ public:
 		return instruction->get_kind() == Kind::DALoad;
 	}
 
-	uint16_t get_byte_size() const override {
-		return 1;
-	}
-	const char* get_mnemonic() const override {
-		return "daload";
-	}
-
-	int8_t get_stack_delta() const override {
-		return -1;
-	}
-
 	void write_buffer(uint8_t** buffer) const override;
 };
 
@@ -993,17 +721,6 @@ public:
 		return instruction->get_kind() == Kind::DAStore;
 	}
 
-	uint16_t get_byte_size() const override {
-		return 1;
-	}
-	const char* get_mnemonic() const override {
-		return "dastore";
-	}
-
-	int8_t get_stack_delta() const override {
-		return -3;
-	}
-
 	void write_buffer(uint8_t** buffer) const override;
 };
 
@@ -1015,17 +732,6 @@ public:
 		return instruction->get_kind() == Kind::DCmpG;
 	}
 
-	uint16_t get_byte_size() const override {
-		return 1;
-	}
-	const char* get_mnemonic() const override {
-		return "dcmpg";
-	}
-
-	int8_t get_stack_delta() const override {
-		return -1;
-	}
-
 	void write_buffer(uint8_t** buffer) const override;
 };
 
@@ -1037,17 +743,6 @@ public:
 		return instruction->get_kind() == Kind::DCmpL;
 	}
 
-	uint16_t get_byte_size() const override {
-		return 1;
-	}
-	const char* get_mnemonic() const override {
-		return "dcmpl";
-	}
-
-	int8_t get_stack_delta() const override {
-		return -1;
-	}
-
 	void write_buffer(uint8_t** buffer) const override;
 };
 
@@ -1059,17 +754,6 @@ public:
 		return instruction->get_kind() == Kind::DConst_0;
 	}
 
-	uint16_t get_byte_size() const override {
-		return 1;
-	}
-	const char* get_mnemonic() const override {
-		return "dconst_0";
-	}
-
-	int8_t get_stack_delta() const override {
-		return 1;
-	}
-
 	void write_buffer(uint8_t** buffer) const override;
 };
 
@@ -1081,17 +765,6 @@ public:
 		return instruction->get_kind() == Kind::DConst_1;
 	}
 
-	uint16_t get_byte_size() const override {
-		return 1;
-	}
-	const char* get_mnemonic() const override {
-		return "dconst_1";
-	}
-
-	int8_t get_stack_delta() const override {
-		return 1;
-	}
-
 	void write_buffer(uint8_t** buffer) const override;
 };
 
@@ -1103,17 +776,6 @@ public:
 		return instruction->get_kind() == Kind::DDiv;
 	}
 
-	uint16_t get_byte_size() const override {
-		return 1;
-	}
-	const char* get_mnemonic() const override {
-		return "ddiv";
-	}
-
-	int8_t get_stack_delta() const override {
-		return -1;
-	}
-
 	void write_buffer(uint8_t** buffer) const override;
 };
 
@@ -1126,16 +788,6 @@ public:
 		return instruction->get_kind() == Kind::DLoad;
 	}
 
-	uint16_t get_byte_size() const override {
-		return 2;
-	}
-	const char* get_mnemonic() const override {
-		return "dload";
-	}
-	int8_t get_stack_delta() const override {
-		return 1;
-	}
-
 	uint8_t get_index() const {
 		return index;
 	}
@@ -1152,17 +804,6 @@ public:
 		return instruction->get_kind() == Kind::DLoad_0;
 	}
 
-	uint16_t get_byte_size() const override {
-		return 1;
-	}
-	const char* get_mnemonic() const override {
-		return "dload_0";
-	}
-
-	int8_t get_stack_delta() const override {
-		return 1;
-	}
-
 	void write_buffer(uint8_t** buffer) const override;
 };
 
@@ -1174,17 +815,6 @@ public:
 		return instruction->get_kind() == Kind::DLoad_1;
 	}
 
-	uint16_t get_byte_size() const override {
-		return 1;
-	}
-	const char* get_mnemonic() const override {
-		return "dload_1";
-	}
-
-	int8_t get_stack_delta() const override {
-		return 1;
-	}
-
 	void write_buffer(uint8_t** buffer) const override;
 };
 
@@ -1196,17 +826,6 @@ public:
 		return instruction->get_kind() == Kind::DLoad_2;
 	}
 
-	uint16_t get_byte_size() const override {
-		return 1;
-	}
-	const char* get_mnemonic() const override {
-		return "dload_2";
-	}
-
-	int8_t get_stack_delta() const override {
-		return 1;
-	}
-
 	void write_buffer(uint8_t** buffer) const override;
 };
 
@@ -1218,17 +837,6 @@ public:
 		return instruction->get_kind() == Kind::DLoad_3;
 	}
 
-	uint16_t get_byte_size() const override {
-		return 1;
-	}
-	const char* get_mnemonic() const override {
-		return "dload_3";
-	}
-
-	int8_t get_stack_delta() const override {
-		return 1;
-	}
-
 	void write_buffer(uint8_t** buffer) const override;
 };
 
@@ -1240,17 +848,6 @@ public:
 		return instruction->get_kind() == Kind::DMul;
 	}
 
-	uint16_t get_byte_size() const override {
-		return 1;
-	}
-	const char* get_mnemonic() const override {
-		return "dmul";
-	}
-
-	int8_t get_stack_delta() const override {
-		return -1;
-	}
-
 	void write_buffer(uint8_t** buffer) const override;
 };
 
@@ -1262,17 +859,6 @@ public:
 		return instruction->get_kind() == Kind::DNeg;
 	}
 
-	uint16_t get_byte_size() const override {
-		return 1;
-	}
-	const char* get_mnemonic() const override {
-		return "dneg";
-	}
-
-	int8_t get_stack_delta() const override {
-		return 0;
-	}
-
 	void write_buffer(uint8_t** buffer) const override;
 };
 
@@ -1284,17 +870,6 @@ public:
 		return instruction->get_kind() == Kind::DRem;
 	}
 
-	uint16_t get_byte_size() const override {
-		return 1;
-	}
-	const char* get_mnemonic() const override {
-		return "drem";
-	}
-
-	int8_t get_stack_delta() const override {
-		return -1;
-	}
-
 	void write_buffer(uint8_t** buffer) const override;
 
 };
@@ -1307,12 +882,6 @@ public:
 		return instruction->get_kind() == Kind::DReturn;
 	}
 
-	uint16_t get_byte_size() const override {
-		return 1;
-	}
-	const char* get_mnemonic() const override {
-		return "dreturn";
-	}
 	void write_buffer(uint8_t** buffer) const override;
 };
 
@@ -1325,16 +894,6 @@ public:
 		return instruction->get_kind() == Kind::DStore;
 	}
 
-	uint16_t get_byte_size() const override {
-		return 2;
-	}
-	const char* get_mnemonic() const override {
-		return "dstore";
-	}
-	int8_t get_stack_delta() const override {
-		return -1;
-	}
-
 	uint8_t get_index() const {
 		return index;
 	}
@@ -1351,17 +910,6 @@ public:
 		return instruction->get_kind() == Kind::DStore_0;
 	}
 
-	uint16_t get_byte_size() const override {
-		return 1;
-	}
-	const char* get_mnemonic() const override {
-		return "dstore_0";
-	}
-
-	int8_t get_stack_delta() const override {
-		return -1;
-	}
-
 	void write_buffer(uint8_t** buffer) const override;
 };
 
@@ -1373,17 +921,6 @@ public:
 		return instruction->get_kind() == Kind::DStore_1;
 	}
 
-	uint16_t get_byte_size() const override {
-		return 1;
-	}
-	const char* get_mnemonic() const override {
-		return "dstore_1";
-	}
-
-	int8_t get_stack_delta() const override {
-		return -1;
-	}
-
 	void write_buffer(uint8_t** buffer) const override;
 };
 
@@ -1395,17 +932,6 @@ public:
 		return instruction->get_kind() == Kind::DStore_2;
 	}
 
-	uint16_t get_byte_size() const override {
-		return 1;
-	}
-	const char* get_mnemonic() const override {
-		return "dstore_2";
-	}
-
-	int8_t get_stack_delta() const override {
-		return -1;
-	}
-
 	void write_buffer(uint8_t** buffer) const override;
 
 };
@@ -1418,17 +944,6 @@ public:
 		return instruction->get_kind() == Kind::DStore_3;
 	}
 
-	uint16_t get_byte_size() const override {
-		return 1;
-	}
-	const char* get_mnemonic() const override {
-		return "dstore_3";
-	}
-
-	int8_t get_stack_delta() const override {
-		return -1;
-	}
-
 	void write_buffer(uint8_t** buffer) const override;
 };
 
@@ -1440,17 +955,6 @@ public:
 		return instruction->get_kind() == Kind::DSub;
 	}
 
-	uint16_t get_byte_size() const override {
-		return 1;
-	}
-	const char* get_mnemonic() const override {
-		return "dsub";
-	}
-
-	int8_t get_stack_delta() const override {
-		return -1;
-	}
-
 	void write_buffer(uint8_t** buffer) const override;
 
 };
@@ -1463,17 +967,6 @@ public:
 		return instruction->get_kind() == Kind::Dup;
 	}
 
-	uint16_t get_byte_size() const override {
-		return 1;
-	}
-	const char* get_mnemonic() const override {
-		return "dup";
-	}
-
-	int8_t get_stack_delta() const override {
-		return 1;
-	}
-
 	void write_buffer(uint8_t** buffer) const override;
 };
 
@@ -1485,17 +978,6 @@ public:
 		return instruction->get_kind() == Kind::Dup_X1;
 	}
 
-	uint16_t get_byte_size() const override {
-		return 1;
-	}
-	const char* get_mnemonic() const override {
-		return "dup_x1";
-	}
-
-	int8_t get_stack_delta() const override {
-		return 1;
-	}
-
 	void write_buffer(uint8_t** buffer) const override;
 };
 
@@ -1507,17 +989,6 @@ public:
 		return instruction->get_kind() == Kind::Dup_X2;
 	}
 
-	uint16_t get_byte_size() const override {
-		return 1;
-	}
-	const char* get_mnemonic() const override {
-		return "dup_x2";
-	}
-
-	int8_t get_stack_delta() const override {
-		return 1;
-	}
-
 	void write_buffer(uint8_t** buffer) const override;
 };
 
@@ -1529,17 +1000,6 @@ public:
 		return instruction->get_kind() == Kind::Dup2;
 	}
 
-	uint16_t get_byte_size() const override {
-		return 1;
-	}
-	const char* get_mnemonic() const override {
-		return "dup2";
-	}
-
-	int8_t get_stack_delta() const override {
-		return 1;
-	}
-
 	void write_buffer(uint8_t** buffer) const override;
 };
 
@@ -1551,17 +1011,6 @@ public:
 		return instruction->get_kind() == Kind::Dup2_X1;
 	}
 
-	uint16_t get_byte_size() const override {
-		return 1;
-	}
-	const char* get_mnemonic() const override {
-		return "dup2_x1";
-	}
-
-	int8_t get_stack_delta() const override {
-		return 1;
-	}
-
 	void write_buffer(uint8_t** buffer) const override;
 };
 
@@ -1573,17 +1022,6 @@ public:
 		return instruction->get_kind() == Kind::Dup2_X2;
 	}
 
-	uint16_t get_byte_size() const override {
-		return 1;
-	}
-	const char* get_mnemonic() const override {
-		return "dup2_x2";
-	}
-
-	int8_t get_stack_delta() const override {
-		return 1;
-	}
-
 	void write_buffer(uint8_t** buffer) const override;
 };
 
@@ -1595,17 +1033,6 @@ public:
 		return instruction->get_kind() == Kind::F2D;
 	}
 
-	uint16_t get_byte_size() const override {
-		return 1;
-	}
-	const char* get_mnemonic() const override {
-		return "f2d";
-	}
-
-	int8_t get_stack_delta() const override {
-		return 0;
-	}
-
 	void write_buffer(uint8_t** buffer) const override;
 };
 
@@ -1617,17 +1044,6 @@ public:
 		return instruction->get_kind() == Kind::F2I;
 	}
 
-	uint16_t get_byte_size() const override {
-		return 1;
-	}
-	const char* get_mnemonic() const override {
-		return "f2i";
-	}
-
-	int8_t get_stack_delta() const override {
-		return 0;
-	}
-
 	void write_buffer(uint8_t** buffer) const override;
 
 };
@@ -1640,17 +1056,6 @@ public:
 		return instruction->get_kind() == Kind::F2L;
 	}
 
-	uint16_t get_byte_size() const override {
-		return 1;
-	}
-	const char* get_mnemonic() const override {
-		return "f2l";
-	}
-
-	int8_t get_stack_delta() const override {
-		return 0;
-	}
-
 	void write_buffer(uint8_t** buffer) const override;
 };
 
@@ -1662,17 +1067,6 @@ public:
 		return instruction->get_kind() == Kind::FAdd;
 	}
 
-	uint16_t get_byte_size() const override {
-		return 1;
-	}
-	const char* get_mnemonic() const override {
-		return "fadd";
-	}
-
-	int8_t get_stack_delta() const override {
-		return -1;
-	}
-
 	void write_buffer(uint8_t** buffer) const override;
 };
 
@@ -1684,17 +1078,6 @@ public:
 		return instruction->get_kind() == Kind::FALoad;
 	}
 
-	uint16_t get_byte_size() const override {
-		return 1;
-	}
-	const char* get_mnemonic() const override {
-		return "faload";
-	}
-
-	int8_t get_stack_delta() const override {
-		return -1;
-	}
-
 	void write_buffer(uint8_t** buffer) const override;
 };
 
@@ -1706,17 +1089,6 @@ public:
 		return instruction->get_kind() == Kind::FAStore;
 	}
 
-	uint16_t get_byte_size() const override {
-		return 1;
-	}
-	const char* get_mnemonic() const override {
-		return "fastore";
-	}
-
-	int8_t get_stack_delta() const override {
-		return -3;
-	}
-
 	void write_buffer(uint8_t** buffer) const override;
 };
 
@@ -1728,17 +1100,6 @@ public:
 		return instruction->get_kind() == Kind::FCmpG;
 	}
 
-	uint16_t get_byte_size() const override {
-		return 1;
-	}
-	const char* get_mnemonic() const override {
-		return "fcmpg";
-	}
-
-	int8_t get_stack_delta() const override {
-		return -1;
-	}
-
 	void write_buffer(uint8_t** buffer) const override;
 
 };
@@ -1751,17 +1112,6 @@ public:
 		return instruction->get_kind() == Kind::FCmpL;
 	}
 
-	uint16_t get_byte_size() const override {
-		return 1;
-	}
-	const char* get_mnemonic() const override {
-		return "fcmpl";
-	}
-
-	int8_t get_stack_delta() const override {
-		return -1;
-	}
-
 	void write_buffer(uint8_t** buffer) const override;
 };
 
@@ -1773,17 +1123,6 @@ public:
 		return instruction->get_kind() == Kind::FConst_0;
 	}
 
-	uint16_t get_byte_size() const override {
-		return 1;
-	}
-	const char* get_mnemonic() const override {
-		return "fconst_0";
-	}
-
-	int8_t get_stack_delta() const override {
-		return 1;
-	}
-
 	void write_buffer(uint8_t** buffer) const override;
 
 };
@@ -1796,17 +1135,6 @@ public:
 		return instruction->get_kind() == Kind::FConst_1;
 	}
 
-	uint16_t get_byte_size() const override {
-		return 1;
-	}
-	const char* get_mnemonic() const override {
-		return "fconst_1";
-	}
-
-	int8_t get_stack_delta() const override {
-		return 1;
-	}
-
 	void write_buffer(uint8_t** buffer) const override;
 };
 
@@ -1818,17 +1146,6 @@ public:
 		return instruction->get_kind() == Kind::FConst_2;
 	}
 
-	uint16_t get_byte_size() const override {
-		return 1;
-	}
-	const char* get_mnemonic() const override {
-		return "fconst_2";
-	}
-
-	int8_t get_stack_delta() const override {
-		return 1;
-	}
-
 	void write_buffer(uint8_t** buffer) const override;
 };
 
@@ -1840,17 +1157,6 @@ public:
 		return instruction->get_kind() == Kind::FDiv;
 	}
 
-	uint16_t get_byte_size() const override {
-		return 1;
-	}
-	const char* get_mnemonic() const override {
-		return "fdiv";
-	}
-
-	int8_t get_stack_delta() const override {
-		return -1;
-	}
-
 	void write_buffer(uint8_t** buffer) const override;
 
 };
@@ -1864,16 +1170,6 @@ public:
 		return instruction->get_kind() == Kind::FLoad;
 	}
 
-	uint16_t get_byte_size() const override {
-		return 2;
-	}
-	const char* get_mnemonic() const override {
-		return "fload";
-	}
-	int8_t get_stack_delta() const override {
-		return 1;
-	}
-
 	uint8_t get_index() const {
 		return index;
 	}
@@ -1890,17 +1186,6 @@ public:
 		return instruction->get_kind() == Kind::FLoad_0;
 	}
 
-	uint16_t get_byte_size() const override {
-		return 1;
-	}
-	const char* get_mnemonic() const override {
-		return "fload_0";
-	}
-
-	int8_t get_stack_delta() const override {
-		return 1;
-	}
-
 	void write_buffer(uint8_t** buffer) const override;
 };
 
@@ -1912,17 +1197,6 @@ public:
 		return instruction->get_kind() == Kind::FLoad_1;
 	}
 
-	uint16_t get_byte_size() const override {
-		return 1;
-	}
-	const char* get_mnemonic() const override {
-		return "fload_1";
-	}
-
-	int8_t get_stack_delta() const override {
-		return 1;
-	}
-
 	void write_buffer(uint8_t** buffer) const override;
 };
 
@@ -1934,17 +1208,6 @@ public:
 		return instruction->get_kind() == Kind::FLoad_2;
 	}
 
-	uint16_t get_byte_size() const override {
-		return 1;
-	}
-	const char* get_mnemonic() const override {
-		return "fload_2";
-	}
-
-	int8_t get_stack_delta() const override {
-		return 1;
-	}
-
 	void write_buffer(uint8_t** buffer) const override;
 };
 
@@ -1952,19 +1215,8 @@ class FLoad_3 : public Instruction {
 public:
 	FLoad_3(Code* code) : Instruction(Kind::FLoad_3, code) {}
 
-	static bool classof(const Instruction* instruction) {
-		return instruction->get_kind() == Kind::FLoad_3;
-	}
-
-	uint16_t get_byte_size() const override {
-		return 1;
-	}
-	const char* get_mnemonic() const override {
-		return "fload_3";
-	}
-
-	int8_t get_stack_delta() const override {
-		return 1;
+	static bool classof(const Instruction* instruction) {
+		return instruction->get_kind() == Kind::FLoad_3;
 	}
 
 	void write_buffer(uint8_t** buffer) const override;
@@ -1978,17 +1230,6 @@ public:
 		return instruction->get_kind() == Kind::FMul;
 	}
 
-	uint16_t get_byte_size() const override {
-		return 1;
-	}
-	const char* get_mnemonic() const override {
-		return "fmul";
-	}
-
-	int8_t get_stack_delta() const override {
-		return -1;
-	}
-
 	void write_buffer(uint8_t** buffer) const override;
 };
 
@@ -2000,17 +1241,6 @@ public:
 		return instruction->get_kind() == Kind::FNeg;
 	}
 
-	uint16_t get_byte_size() const override {
-		return 1;
-	}
-	const char* get_mnemonic() const override {
-		return "fneg";
-	}
-
-	int8_t get_stack_delta() const override {
-		return 0;
-	}
-
 	void write_buffer(uint8_t** buffer) const override;
 };
 
@@ -2022,17 +1252,6 @@ public:
 		return instruction->get_kind() == Kind::FRem;
 	}
 
-	uint16_t get_byte_size() const override {
-		return 1;
-	}
-	const char* get_mnemonic() const override {
-		return "frem";
-	}
-
-	int8_t get_stack_delta() const override {
-		return -1;
-	}
-
 	void write_buffer(uint8_t** buffer) const override;
 };
 
@@ -2044,12 +1263,6 @@ public:
 		return instruction->get_kind() == Kind::FReturn;
 	}
 
-	uint16_t get_byte_size() const override {
-		return 1;
-	}
-	const char* get_mnemonic() const override {
-		return "freturn";
-	}
 	void write_buffer(uint8_t** buffer) const override;
 };
 
@@ -2062,16 +1275,6 @@ public:
 		return instruction->get_kind() == Kind::FStore;
 	}
 
-	uint16_t get_byte_size() const override {
-		return 2;
-	}
-	const char* get_mnemonic() const override {
-		return "fstore";
-	}
-	int8_t get_stack_delta() const override {
-		return -1;
-	}
-
 	uint8_t get_index() const {
 		return index;
 	}
@@ -2088,17 +1291,6 @@ public:
 		return instruction->get_kind() == Kind::FStore_0;
 	}
 
-	uint16_t get_byte_size() const override {
-		return 1;
-	}
-	const char* get_mnemonic() const override {
-		return "fstore_0";
-	}
-
-	int8_t get_stack_delta() const override {
-		return -1;
-	}
-
 	void write_buffer(uint8_t** buffer) const override;
 };
 
@@ -2110,17 +1302,6 @@ public:
 		return instruction->get_kind() == Kind::FStore_1;
 	}
 
-	uint16_t get_byte_size() const override {
-		return 1;
-	}
-	const char* get_mnemonic() const override {
-		return "fstore_1";
-	}
-
-	int8_t get_stack_delta() const override {
-		return -1;
-	}
-
 	void write_buffer(uint8_t** buffer) const override;
 };
 
@@ -2132,17 +1313,6 @@ public:
 		return instruction->get_kind() == Kind::FStore_2;
 	}
 
-	uint16_t get_byte_size() const override {
-		return 1;
-	}
-	const char* get_mnemonic() const override {
-		return "fstore_2";
-	}
-
-	int8_t get_stack_delta() const override {
-		return -1;
-	}
-
 	void write_buffer(uint8_t** buffer) const override;
 };
 
@@ -2154,17 +1324,6 @@ public:
 		return instruction->get_kind() == Kind::FStore_3;
 	}
 
-	uint16_t get_byte_size() const override {
-		return 1;
-	}
-	const char* get_mnemonic() const override {
-		return "fstore_3";
-	}
-
-	int8_t get_stack_delta() const override {
-		return -1;
-	}
-
 	void write_buffer(uint8_t** buffer) const override;
 };
 
@@ -2176,17 +1335,6 @@ public:
 		return instruction->get_kind() == Kind::FSub;
 	}
 
-	uint16_t get_byte_size() const override {
-		return 1;
-	}
-	const char* get_mnemonic() const override {
-		return "fsub";
-	}
-
-	int8_t get_stack_delta() const override {
-		return -1;
-	}
-
 	void write_buffer(uint8_t** buffer) const override;
 };
 
@@ -2199,20 +1347,12 @@ public:
 		return instruction->get_kind() == Kind::GetField;
 	}
 
-	uint16_t get_byte_size() const override {
-		return 3;
-	}
-	const char* get_mnemonic() const override {
-		return "getfield";
-	}
-	int8_t get_stack_delta() const override {
-		return 0;
-	}
-
 	uint16_t get_index() const {
 		return index;
 	}
 	void write_buffer(uint8_t** buffer) const override;
+	void visit_constant_pool_indices(
+		ConstantPoolIndexVisitor& visitor) override;
 private:
 	uint16_t index;
 };
@@ -2226,20 +1366,12 @@ public:
 		return instruction->get_kind() == Kind::GetStatic;
 	}
 
-	uint16_t get_byte_size() const override {
-		return 3;
-	}
-	const char* get_mnemonic() const override {
-		return "getstatic";
-	}
-	int8_t get_stack_delta() const override {
-		return 1;
-	}
-
 	uint16_t get_index() const {
 		return index;
 	}
 	void write_buffer(uint8_t** buffer) const override;
+	void visit_constant_pool_indices(
+		ConstantPoolIndexVisitor& visitor) override;
 private:
 	uint16_t index;
 };
@@ -2253,11 +1385,8 @@ public:
 		return instruction->get_kind() == Kind::Goto;
 	}
 
-	uint16_t get_byte_size() const override;
+	uint16_t get_variable_byte_size() const override;
 	const char* get_mnemonic() const override;
-	int8_t get_stack_delta() const override {
-		return 0;
-	}
 
 	void write_buffer(uint8_t** buffer) const override;
 
@@ -2283,16 +1412,6 @@ public:
 		return instruction->get_kind() == Kind::Goto_W;
 	}
 
-	uint16_t get_byte_size() const override {
-		return 5;
-	}
-	const char* get_mnemonic() const override {
-		return "goto_w";
-	}
-	int8_t get_stack_delta() const override {
-		return 0;
-	}
-
 	void write_buffer(uint8_t** buffer) const override;
 };
 
@@ -2304,17 +1423,6 @@ public:
 		return instruction->get_kind() == Kind::I2B;
 	}
 
-	uint16_t get_byte_size() const override {
-		return 1;
-	}
-	const char* get_mnemonic() const override {
-		return "i2b";
-	}
-
-	int8_t get_stack_delta() const override {
-		return 0;
-	}
-
 	void write_buffer(uint8_t** buffer) const override;
 };
 
@@ -2326,17 +1434,6 @@ public:
 		return instruction->get_kind() == Kind::I2C;
 	}
 
-	uint16_t get_byte_size() const override {
-		return 1;
-	}
-	const char* get_mnemonic() const override {
-		return "i2c";
-	}
-
-	int8_t get_stack_delta() const override {
-		return 0;
-	}
-
 	void write_buffer(uint8_t** buffer) const override;
 };
 
@@ -2348,17 +1445,6 @@ public:
 		return instruction->get_kind() == Kind::I2D;
 	}
 
-	uint16_t get_byte_size() const override {
-		return 1;
-	}
-	const char* get_mnemonic() const override {
-		return "i2d";
-	}
-
-	int8_t get_stack_delta() const override {
-		return 0;
-	}
-
 	void write_buffer(uint8_t** buffer) const override;
 };
 
@@ -2370,17 +1456,6 @@ public:
 		return instruction->get_kind() == Kind::I2F;
 	}
 
-	uint16_t get_byte_size() const override {
-		return 1;
-	}
-	const char* get_mnemonic() const override {
-		return "i2f";
-	}
-
-	int8_t get_stack_delta() const override {
-		return 0;
-	}
-
 	void write_buffer(uint8_t** buffer) const override;
 };
 
@@ -2392,17 +1467,6 @@ public:
 		return instruction->get_kind() == Kind::I2L;
 	}
 
-	uint16_t get_byte_size() const override {
-		return 1;
-	}
-	const char* get_mnemonic() const override {
-		return "i2l";
-	}
-
-	int8_t get_stack_delta() const override {
-		return 0;
-	}
-
 	void write_buffer(uint8_t** buffer) const override;
 };
 
@@ -2414,17 +1478,6 @@ public:
 		return instruction->get_kind() == Kind::I2S;
 	}
 
-	uint16_t get_byte_size() const override {
-		return 1;
-	}
-	const char* get_mnemonic() const override {
-		return "i2s";
-	}
-
-	int8_t get_stack_delta() const override {
-		return 0;
-	}
-
 	void write_buffer(uint8_t** buffer) const override;
 };
 
@@ -2436,17 +1489,6 @@ public:
 		return instruction->get_kind() == Kind::IAdd;
 	}
 
-	uint16_t get_byte_size() const override {
-		return 1;
-	}
-	const char* get_mnemonic() const override {
-		return "iadd";
-	}
-
-	int8_t get_stack_delta() const override {
-		return -1;
-	}
-
 	void write_buffer(uint8_t** buffer) const override;
 };
 
@@ -2458,17 +1500,6 @@ public:
 		return instruction->get_kind() == Kind::IALoad;
 	}
 
-	uint16_t get_byte_size() const override {
-		return 1;
-	}
-	const char* get_mnemonic() const override {
-		return "iaload";
-	}
-
-	int8_t get_stack_delta() const override {
-		return -1;
-	}
-
 	void write_buffer(uint8_t** buffer) const override;
 };
 
@@ -2480,17 +1511,6 @@ public:
 		return instruction->get_kind() == Kind::IAnd;
 	}
 
-	uint16_t get_byte_size() const override {
-		return 1;
-	}
-	const char* get_mnemonic() const override {
-		return "iand";
-	}
-
-	int8_t get_stack_delta() const override {
-		return -1;
-	}
-
 	void write_buffer(uint8_t** buffer) const override;
 };
 
@@ -2502,17 +1522,6 @@ public:
 		return instruction->get_kind() == Kind::IAStore;
 	}
 
-	uint16_t get_byte_size() const override {
-		return 1;
-	}
-	const char* get_mnemonic() const override {
-		return "istore";
-	}
-
-	int8_t get_stack_delta() const override {
-		return -3;
-	}
-
 	void write_buffer(uint8_t** buffer) const override;
 };
 
@@ -2524,17 +1533,6 @@ public:
 		return instruction->get_kind() == Kind::IConst_M1;
 	}
 
-	uint16_t get_byte_size() const override {
-		return 1;
-	}
-	const char* get_mnemonic() const override {
-		return "iconst_m1";
-	}
-
-	int8_t get_stack_delta() const override {
-		return 1;
-	}
-
 	void write_buffer(uint8_t** buffer) const override;
 };
 
@@ -2546,17 +1544,6 @@ public:
 		return instruction->get_kind() == Kind::IConst_0;
 	}
 
-	uint16_t get_byte_size() const override {
-		return 1;
-	}
-	const char* get_mnemonic() const override {
-		return "iconst_0";
-	}
-
-	int8_t get_stack_delta() const override {
-		return 1;
-	}
-
 	void write_buffer(uint8_t** buffer) const override;
 };
 
@@ -2568,17 +1555,6 @@ public:
 		return instruction->get_kind() == Kind::IConst_1;
 	}
 
-	uint16_t get_byte_size() const override {
-		return 1;
-	}
-	const char* get_mnemonic() const override {
-		return "iconst_1";
-	}
-
-	int8_t get_stack_delta() const override {
-		return 1;
-	}
-
 	void write_buffer(uint8_t** buffer) const override;
 };
 
@@ -2590,17 +1566,6 @@ public:
 		return instruction->get_kind() == Kind::IConst_2;
 	}
 
-	uint16_t get_byte_size() const override {
-		return 1;
-	}
-	const char* get_mnemonic() const override {
-		return "iconst_2";
-	}
-
-	int8_t get_stack_delta() const override {
-		return 1;
-	}
-
 	void write_buffer(uint8_t** buffer) const override;
 };
 
@@ -2612,17 +1577,6 @@ public:
 		return instruction->get_kind() == Kind::IConst_3;
 	}
 
-	uint16_t get_byte_size() const override {
-		return 1;
-	}
-	const char* get_mnemonic() const override {
-		return "iconst_3";
-	}
-
-	int8_t get_stack_delta() const override {
-		return 1;
-	}
-
 	void write_buffer(uint8_t** buffer) const override;
 };
 
@@ -2634,17 +1588,6 @@ public:
 		return instruction->get_kind() == Kind::IConst_4;
 	}
 
-	uint16_t get_byte_size() const override {
-		return 1;
-	}
-	const char* get_mnemonic() const override {
-		return "iconst_4";
-	}
-
-	int8_t get_stack_delta() const override {
-		return 1;
-	}
-
 	void write_buffer(uint8_t** buffer) const override;
 };
 
@@ -2656,17 +1599,6 @@ public:
 		return instruction->get_kind() == Kind::IConst_5;
 	}
 
-	uint16_t get_byte_size() const override {
-		return 1;
-	}
-	const char* get_mnemonic() const override {
-		return "iconst_5";
-	}
-
-	int8_t get_stack_delta() const override {
-		return 1;
-	}
-
 	void write_buffer(uint8_t** buffer) const override;
 };
 
@@ -2678,17 +1610,6 @@ public:
 		return instruction->get_kind() == Kind::IDiv;
 	}
 
-	uint16_t get_byte_size() const override {
-		return 1;
-	}
-	const char* get_mnemonic() const override {
-		return "idiv";
-	}
-
-	int8_t get_stack_delta() const override {
-		return -1;
-	}
-
 	void write_buffer(uint8_t** buffer) const override;
 };
 
@@ -2701,16 +1622,6 @@ public:
 		return instruction->get_kind() == Kind::If_ACmpEq;
 	}
 
-	uint16_t get_byte_size() const override {
-		return 3;
-	}
-	const char* get_mnemonic() const override {
-		return "if_acmpeq";
-	}
-	int8_t get_stack_delta() const override {
-		return -2;
-	}
-
 	void write_buffer(uint8_t** buffer) const override;
 };
 
@@ -2723,16 +1634,6 @@ public:
 		return instruction->get_kind() == Kind::If_ACmpNe;
 	}
 
-	uint16_t get_byte_size() const override {
-		return 3;
-	}
-	const char* get_mnemonic() const override {
-		return "if_acmpne";
-	}
-	int8_t get_stack_delta() const override {
-		return -2;
-	}
-
 	void write_buffer(uint8_t** buffer) const override;
 };
 
@@ -2741,18 +1642,8 @@ public:
 	If_ICmpEq(Code* code, int16_t offset)
 	: BranchInstruction(Kind::If_ICmpEq, code, offset) {}
 
-	static bool classof(const Instruction* instruction) {
-		return instruction->get_kind() == Kind::If_ICmpEq;
-	}
-
-	uint16_t get_byte_size() const override {
-		return 3;
-	}
-	const char* get_mnemonic() const override {
-		return "if_icmpeq";
-	}
-	int8_t get_stack_delta() const override {
-		return -2;
+	static bool classof(const Instruction* instruction) {
+		return instruction->get_kind() == Kind::If_ICmpEq;
 	}
 
 	void write_buffer(uint8_t** buffer) const override;
@@ -2767,13 +1658,7 @@ public:
 		return instruction->get_kind() == Kind::If_ICmpNe;
 	}
 
-	uint16_t get_byte_size() const override {
-		return 3;
-	}
 	const char* get_mnemonic() const override;
-	int8_t get_stack_delta() const override {
-		return -2;
-	}
 
 	void write_buffer(uint8_t** buffer) const override;
 
@@ -2796,16 +1681,6 @@ public:
 		return instruction->get_kind() == Kind::If_ICmpLt;
 	}
 
-	uint16_t get_byte_size() const override {
-		return 3;
-	}
-	const char* get_mnemonic() const override {
-		return "if_icmplt";
-	}
-	int8_t get_stack_delta() const override {
-		return -2;
-	}
-
 	void write_buffer(uint8_t** buffer) const override;
 };
 
@@ -2818,16 +1693,6 @@ public:
 		return instruction->get_kind() == Kind::If_ICmpGe;
 	}
 
-	uint16_t get_byte_size() const override {
-		return 3;
-	}
-	const char* get_mnemonic() const override {
-		return "if_icmpge";
-	}
-	int8_t get_stack_delta() const override {
-		return -2;
-	}
-
 	void write_buffer(uint8_t** buffer) const override;
 };
 
@@ -2840,16 +1705,6 @@ public:
 		return instruction->get_kind() == Kind::If_ICmpGt;
 	}
 
-	uint16_t get_byte_size() const override {
-		return 3;
-	}
-	const char* get_mnemonic() const override {
-		return "if_icmpgt";
-	}
-	int8_t get_stack_delta() const override {
-		return -2;
-	}
-
 	void write_buffer(uint8_t** buffer) const override;
 };
 
@@ -2862,16 +1717,6 @@ public:
 		return instruction->get_kind() == Kind::If_ICmpLe;
 	}
 
-	uint16_t get_byte_size() const override {
-		return 3;
-	}
-	const char* get_mnemonic() const override {
-		return "if_icmple";
-	}
-	int8_t get_stack_delta() const override {
-		return -2;
-	}
-
 	void write_buffer(uint8_t** buffer) const override;
 };
 
@@ -2887,16 +1732,6 @@ public:
 		return instruction->get_kind() == Kind::IfEq;
 	}
 
-	uint16_t get_byte_size() const override {
-		return 3;
-	}
-	const char* get_mnemonic() const override {
-		return "ifeq";
-	}
-	int8_t get_stack_delta() const override {
-		return -1;
-	}
-
 	void write_buffer(uint8_t** buffer) const override;
 };
 
@@ -2909,16 +1744,6 @@ public:
 		return instruction->get_kind() == Kind::IfNe;
 	}
 
-	uint16_t get_byte_size() const override {
-		return 3;
-	}
-	const char* get_mnemonic() const override {
-		return "ifne";
-	}
-	int8_t get_stack_delta() const override {
-		return -1;
-	}
-
 	void write_buffer(uint8_t** buffer) const override;
 };
 
@@ -2931,16 +1756,6 @@ public:
 		return instruction->get_kind() == Kind::IfLt;
 	}
 
-	uint16_t get_byte_size() const override {
-		return 3;
-	}
-	const char* get_mnemonic() const override {
-		return "iflt";
-	}
-	int8_t get_stack_delta() const override {
-		return -1;
-	}
-
 	void write_buffer(uint8_t** buffer) const override;
 };
 
@@ -2953,16 +1768,6 @@ public:
 		return instruction->get_kind() == Kind::IfGe;
 	}
 
-	uint16_t get_byte_size() const override {
-		return 3;
-	}
-	const char* get_mnemonic() const override {
-		return "ifge";
-	}
-	int8_t get_stack_delta() const override {
-		return -1;
-	}
-
 	void write_buffer(uint8_t** buffer) const override;
 };
 
@@ -2975,16 +1780,6 @@ public:
 		return instruction->get_kind() == Kind::IfGt;
 	}
 
-	uint16_t get_byte_size() const override {
-		return 3;
-	}
-	const char* get_mnemonic() const override {
-		return "ifgt";
-	}
-	int8_t get_stack_delta() const override {
-		return -1;
-	}
-
 	void write_buffer(uint8_t** buffer) const override;
 };
 
@@ -2997,16 +1792,6 @@ public:
 		return instruction->get_kind() == Kind::IfLe;
 	}
 
-	uint16_t get_byte_size() const override {
-		return 3;
-	}
-	const char* get_mnemonic() const override {
-		return "ifle";
-	}
-	int8_t get_stack_delta() const override {
-		return -1;
-	}
-
 	void write_buffer(uint8_t** buffer) const override;
 };
 
@@ -3019,16 +1804,6 @@ public:
 		return instruction->get_kind() == Kind::IfNonNull;
 	}
 
-	uint16_t get_byte_size() const override {
-		return 3;
-	}
-	const char* get_mnemonic() const override {
-		return "ifnonnull";
-	}
-	int8_t get_stack_delta() const override {
-		return -1;
-	}
-
 	void write_buffer(uint8_t** buffer) const override;
 };
 
@@ -3041,16 +1816,6 @@ public:
 		return instruction->get_kind() == Kind::IfNull;
 	}
 
-	uint16_t get_byte_size() const override {
-		return 3;
-	}
-	const char* get_mnemonic() const override {
-		return "ifnull";
-	}
-	int8_t get_stack_delta() const override {
-		return -1;
-	}
-
 	void write_buffer(uint8_t** buffer) const override;
 };
 
@@ -3063,16 +1828,6 @@ public:
 		return instruction->get_kind() == Kind::IInc;
 	}
 
-	uint16_t get_byte_size() const override {
-		return 3;
-	}
-	const char* get_mnemonic() const override {
-		return "iinc";
-	}
-	int8_t get_stack_delta() const override {
-		return 0;
-	}
-
 	uint8_t get_index() const {
 		return index;
 	}
@@ -3094,16 +1849,6 @@ public:
 		return instruction->get_kind() == Kind::ILoad;
 	}
 
-	uint16_t get_byte_size() const override {
-		return 2;
-	}
-	const char* get_mnemonic() const override {
-		return "iload";
-	}
-	int8_t get_stack_delta() const override {
-		return 1;
-	}
-
 	uint8_t get_index() const {
 		return index;
 	}
@@ -3120,17 +1865,6 @@ public:
 		return instruction->get_kind() == Kind::ILoad_0;
 	}
 
-	uint16_t get_byte_size() const override {
-		return 1;
-	}
-	const char* get_mnemonic() const override {
-		return "iload_0";
-	}
-
-	int8_t get_stack_delta() const override {
-		return 1;
-	}
-
 	void write_buffer(uint8_t** buffer) const override;
 };
 
@@ -3142,17 +1876,6 @@ public:
 		return instruction->get_kind() == Kind::ILoad_1;
 	}
 
-	uint16_t get_byte_size() const override {
-		return 1;
-	}
-	const char* get_mnemonic() const override {
-		return "iload_1";
-	}
-
-	int8_t get_stack_delta() const override {
-		return 1;
-	}
-
 	void write_buffer(uint8_t** buffer) const override;
 };
 
@@ -3164,17 +1887,6 @@ public:
 		return instruction->get_kind() == Kind::ILoad_2;
 	}
 
-	uint16_t get_byte_size() const override {
-		return 1;
-	}
-	const char* get_mnemonic() const override {
-		return "iload_2";
-	}
-
-	int8_t get_stack_delta() const override {
-		return 1;
-	}
-
 	void write_buffer(uint8_t** buffer) const override;
 };
 
@@ -3186,17 +1898,6 @@ public:
 		return instruction->get_kind() == Kind::ILoad_3;
 	}
 
-	uint16_t get_byte_size() const override {
-		return 1;
-	}
-	const char* get_mnemonic() const override {
-		return "iload_3";
-	}
-
-	int8_t get_stack_delta() const override {
-		return 1;
-	}
-
 	void write_buffer(uint8_t** buffer) const override;
 };
 
@@ -3208,17 +1909,6 @@ public:
 		return instruction->get_kind() == Kind::IMul;
 	}
 
-	uint16_t get_byte_size() const override {
-		return 1;
-	}
-	const char* get_mnemonic() const override {
-		return "imul";
-	}
-
-	int8_t get_stack_delta() const override {
-		return -1;
-	}
-
 	void write_buffer(uint8_t** buffer) const override;
 };
 
@@ -3230,17 +1920,6 @@ public:
 		return instruction->get_kind() == Kind::INeg;
 	}
 
-	uint16_t get_byte_size() const override {
-		return 1;
-	}
-	const char* get_mnemonic() const override {
-		return "ineg";
-	}
-
-	int8_t get_stack_delta() const override {
-		return 0;
-	}
-
 	void write_buffer(uint8_t** buffer) const override;
 };
 
@@ -3253,20 +1932,12 @@ public:
 		return instruction->get_kind() == Kind::InstanceOf;
 	}
 
-	uint16_t get_byte_size() const override {
-		return 3;
-	}
-	const char* get_mnemonic() const override {
-		return "instanceof";
-	}
-	int8_t get_stack_delta() const override {
-		return 0;
-	}
-
 	uint16_t get_index() const {
 		return index;
 	}
 	void write_buffer(uint8_t** buffer) const override;
+	void visit_constant_pool_indices(
+		ConstantPoolIndexVisitor& visitor) override;
 private:
 	uint16_t index;
 };
@@ -3280,13 +1951,6 @@ public:
 		return instruction->get_kind() == Kind::InvokeDynamic;
 	}
 
-	uint16_t get_byte_size() const override {
-		return 5;
-	}
-	const char* get_mnemonic() const override {
-		return "invokedynamic";
-	}
-
 	void write_buffer(uint8_t** buffer) const override;
 };
 
@@ -3300,13 +1964,6 @@ public:
 		return instruction->get_kind() == Kind::InvokeInterface;
 	}
 
-	uint16_t get_byte_size() const override {
-		return 5;
-	}
-	const char* get_mnemonic() const override {
-		return "invokeinterface";
-	}
-
 	uint8_t get_count() const {
 		return count;
 	}
@@ -3324,13 +1981,6 @@ public:
 		return instruction->get_kind() == Kind::InvokeSpecial;
 	}
 
-	uint16_t get_byte_size() const override {
-		return 3;
-	}
-	const char* get_mnemonic() const override {
-		return "invokespecial";
-	}
-
 	void write_buffer(uint8_t** buffer) const override;
 };
 
@@ -3343,13 +1993,6 @@ public:
 		return instruction->get_kind() == Kind::InvokeStatic;
 	}
 
-	uint16_t get_byte_size() const override {
-		return 3;
-	}
-	const char* get_mnemonic() const override {
-		return "invokestatic";
-	}
-
 	void write_buffer(uint8_t** buffer) const override;
 };
 
@@ -3362,13 +2005,6 @@ public:
 		return instruction->get_kind() == Kind::InvokeVirtual;
 	}
 
-	uint16_t get_byte_size() const override {
-		return 3;
-	}
-	const char* get_mnemonic() const override {
-		return "invokevirtual";
-	}
-
 	void write_buffer(uint8_t** buffer) const override;
 };
 
@@ -3380,16 +2016,6 @@ public:
 		return instruction->get_kind() == Kind::IOr;
 	}
 
-	uint16_t get_byte_size() const override {
-		return 1;
-	}
-	const char* get_mnemonic() const override {
-		return "ior";
-	}
-	int8_t get_stack_delta() const override {
-		return -1;
-	}
-
 	void write_buffer(uint8_t** buffer) const override;
 };
 
@@ -3401,16 +2027,6 @@ public:
 		return instruction->get_kind() == Kind::IRem;
 	}
 
-	uint16_t get_byte_size() const override {
-		return 1;
-	}
-	const char* get_mnemonic() const override {
-		return "irem";
-	}
-	int8_t get_stack_delta() const override {
-		return -1;
-	}
-
 	void write_buffer(uint8_t** buffer) const override;
 };
 
@@ -3422,12 +2038,6 @@ public:
 		return instruction->get_kind() == Kind::IReturn;
 	}
 
-	uint16_t get_byte_size() const override {
-		return 1;
-	}
-	const char* get_mnemonic() const override {
-		return "ireturn";
-	}
 	void write_buffer(uint8_t** buffer) const override;
 };
 
@@ -3439,17 +2049,6 @@ public:
 		return instruction->get_kind() == Kind::IShl;
 	}
 
-	uint16_t get_byte_size() const override {
-		return 1;
-	}
-	const char* get_mnemonic() const override {
-		return "ishl";
-	}
-
-	int8_t get_stack_delta() const override {
-		return -1;
-	}
-
 	void write_buffer(uint8_t** buffer) const override;
 };
 
@@ -3461,17 +2060,6 @@ public:
 		return instruction->get_kind() == Kind::IShr;
 	}
 
-	uint16_t get_byte_size() const override {
-		return 1;
-	}
-	const char* get_mnemonic() const override {
-		return "ishr";
-	}
-
-	int8_t get_stack_delta() const override {
-		return -1;
-	}
-
 	void write_buffer(uint8_t** buffer) const override;
 };
 
@@ -3484,16 +2072,6 @@ public:
 		return instruction->get_kind() == Kind::IStore;
 	}
 
-	uint16_t get_byte_size() const override {
-		return 2;
-	}
-	const char* get_mnemonic() const override {
-		return "istore";
-	}
-	int8_t get_stack_delta() const override {
-		return -1;
-	}
-
 	uint8_t get_index() const {
 		return index;
 	}
@@ -3510,17 +2088,6 @@ public:
 		return instruction->get_kind() == Kind::IStore_0;
 	}
 
-	uint16_t get_byte_size() const override {
-		return 1;
-	}
-	const char* get_mnemonic() const override {
-		return "istore_0";
-	}
-
-	int8_t get_stack_delta() const override {
-		return -1;
-	}
-
 	void write_buffer(uint8_t** buffer) const override;
 };
 
@@ -3532,17 +2099,6 @@ public:
 		return instruction->get_kind() == Kind::IStore_1;
 	}
 
-	uint16_t get_byte_size() const override {
-		return 1;
-	}
-	const char* get_mnemonic() const override {
-		return "istore_1";
-	}
-
-	int8_t get_stack_delta() const override {
-		return -1;
-	}
-
 	void write_buffer(uint8_t** buffer) const override;
 };
 
@@ -3554,17 +2110,6 @@ public:
 		return instruction->get_kind() == Kind::IStore_2;
 	}
 
-	uint16_t get_byte_size() const override {
-		return 1;
-	}
-	const char* get_mnemonic() const override {
-		return "istore_2";
-	}
-
-	int8_t get_stack_delta() const override {
-		return -1;
-	}
-
 	void write_buffer(uint8_t** buffer) const override;
 };
 
@@ -3576,17 +2121,6 @@ public:
 		return instruction->get_kind() == Kind::IStore_3;
 	}
 
-	uint16_t get_byte_size() const override {
-		return 1;
-	}
-	const char* get_mnemonic() const override {
-		return "istore_3";
-	}
-
-	int8_t get_stack_delta() const override {
-		return -1;
-	}
-
 	void write_buffer(uint8_t** buffer) const override;
 };
 
@@ -3598,17 +2132,6 @@ public:
 		return instruction->get_kind() == Kind::ISub;
 	}
 
-	uint16_t get_byte_size() const override {
-		return 1;
-	}
-	const char* get_mnemonic() const override {
-		return "isub";
-	}
-
-	int8_t get_stack_delta() const override {
-		return -1;
-	}
-
 	void write_buffer(uint8_t** buffer) const override;
 };
 
@@ -3620,37 +2143,15 @@ public:
 		return instruction->get_kind() == Kind::IUShr;
 	}
 
-	uint16_t get_byte_size() const override {
-		return 1;
-	}
-	const char* get_mnemonic() const override {
-		return "iushr";
-	}
-
-	int8_t get_stack_delta() const override {
-		return -1;
-	}
-
 	void write_buffer(uint8_t** buffer) const override;
 };
 
 class IXor : public Instruction {
 public:
-	IXor(Code* code) : Instruction(Kind::IXor, code) {}
-
-	static bool classof(const Instruction* instruction) {
-		return instruction->get_kind() == Kind::IXor;
-	}
-
-	uint16_t get_byte_size() const override {
-		return 1;
-	}
-	const char* get_mnemonic() const override {
-		return "ixor";
-	}
+	IXor(Code* code) : Instruction(Kind::IXor, code) {}
 
-	int8_t get_stack_delta() const override {
-		return -1;
+	static bool classof(const Instruction* instruction) {
+		return instruction->get_kind() == Kind::IXor;
 	}
 
 	void write_buffer(uint8_t** buffer) const override;
@@ -3665,13 +2166,6 @@ public:
 		return instruction->get_kind() == Kind::Jsr;
 	}
 
-	uint16_t get_byte_size() const override {
-		return 3;
-	}
-	const char* get_mnemonic() const override {
-		return "jsr";
-	}
-
 	void write_buffer(uint8_t** buffer) const override;
 };
 
@@ -3684,13 +2178,6 @@ public:
 		return instruction->get_kind() == Kind::Jsr_W;
 	}
 
-	uint16_t get_byte_size() const override {
-		return 5;
-	}
-	const char* get_mnemonic() const override {
-		return "jsr_w";
-	}
-
 	void write_buffer(uint8_t** buffer) const override;
 };
 
@@ -3702,17 +2189,6 @@ public:
 		return instruction->get_kind() == Kind::L2D;
 	}
 
-	uint16_t get_byte_size() const override {
-		return 1;
-	}
-	const char* get_mnemonic() const override {
-		return "l2d";
-	}
-
-	int8_t get_stack_delta() const override {
-		return 0;
-	}
-
 	void write_buffer(uint8_t** buffer) const override;
 };
 
@@ -3724,17 +2200,6 @@ public:
 		return instruction->get_kind() == Kind::L2I;
 	}
 
-	uint16_t get_byte_size() const override {
-		return 1;
-	}
-	const char* get_mnemonic() const override {
-		return "l2i";
-	}
-
-	int8_t get_stack_delta() const override {
-		return 0;
-	}
-
 	void write_buffer(uint8_t** buffer) const override;
 };
 
@@ -3746,17 +2211,6 @@ public:
 		return instruction->get_kind() == Kind::L2F;
 	}
 
-	uint16_t get_byte_size() const override {
-		return 1;
-	}
-	const char* get_mnemonic() const override {
-		return "l2f";
-	}
-
-	int8_t get_stack_delta() const override {
-		return 0;
-	}
-
 	void write_buffer(uint8_t** buffer) const override;
 };
 
@@ -3768,17 +2222,6 @@ public:
 		return instruction->get_kind() == Kind::LAdd;
 	}
 
-	uint16_t get_byte_size() const override {
-		return 1;
-	}
-	const char* get_mnemonic() const override {
-		return "ladd";
-	}
-
-	int8_t get_stack_delta() const override {
-		return -1;
-	}
-
 	void write_buffer(uint8_t** buffer) const override;
 };
 
@@ -3790,17 +2233,6 @@ public:
 		return instruction->get_kind() == Kind::LALoad;
 	}
 
-	uint16_t get_byte_size() const override {
-		return 1;
-	}
-	const char* get_mnemonic() const override {
-		return "laload";
-	}
-
-	int8_t get_stack_delta() const override {
-		return -1;
-	}
-
 	void write_buffer(uint8_t** buffer) const override;
 };
 
@@ -3812,17 +2244,6 @@ public:
 		return instruction->get_kind() == Kind::LAnd;
 	}
 
-	uint16_t get_byte_size() const override {
-		return 1;
-	}
-	const char* get_mnemonic() const override {
-		return "land";
-	}
-
-	int8_t get_stack_delta() const override {
-		return -1;
-	}
-
 	void write_buffer(uint8_t** buffer) const override;
 };
 
@@ -3834,17 +2255,6 @@ public:
 		return instruction->get_kind() == Kind::LAStore;
 	}
 
-	uint16_t get_byte_size() const override {
-		return 1;
-	}
-	const char* get_mnemonic() const override {
-		return "lastore";
-	}
-
-	int8_t get_stack_delta() const override {
-		return -3;
-	}
-
 	void write_buffer(uint8_t** buffer) const override;
 };
 
@@ -3856,17 +2266,6 @@ public:
 		return instruction->get_kind() == Kind::LCmp;
 	}
 
-	uint16_t get_byte_size() const override {
-		return 1;
-	}
-	const char* get_mnemonic() const override {
-		return "lcmp";
-	}
-
-	int8_t get_stack_delta() const override {
-		return -1;
-	}
-
 	void write_buffer(uint8_t** buffer) const override;
 };
 
@@ -3878,17 +2277,6 @@ public:
 		return instruction->get_kind() == Kind::LConst_0;
 	}
 
-	uint16_t get_byte_size() const override {
-		return 1;
-	}
-	const char* get_mnemonic() const override {
-		return "lconst_0";
-	}
-
-	int8_t get_stack_delta() const override {
-		return 1;
-	}
-
 	void write_buffer(uint8_t** buffer) const override;
 };
 
@@ -3900,17 +2288,6 @@ public:
 		return instruction->get_kind() == Kind::LConst_1;
 	}
 
-	uint16_t get_byte_size() const override {
-		return 1;
-	}
-	const char* get_mnemonic() const override {
-		return "lconst_1";
-	}
-
-	int8_t get_stack_delta() const override {
-		return 1;
-	}
-
 	void write_buffer(uint8_t** buffer) const override;
 };
 
@@ -3923,20 +2300,12 @@ public:
 		return instruction->get_kind() == Kind::Ldc;
 	}
 
-	uint16_t get_byte_size() const override {
-		return 2;
-	}
-	const char* get_mnemonic() const override {
-		return "ldc";
-	}
-	int8_t get_stack_delta() const override {
-		return 1;
-	}
-
 	uint8_t get_index() const {
 		return index;
 	}
 	void write_buffer(uint8_t** buffer) const override;
+	void visit_constant_pool_indices(
+		ConstantPoolIndexVisitor& visitor) override;
 private:
 	uint8_t index;
 };
@@ -3950,20 +2319,12 @@ public:
 		return instruction->get_kind() == Kind::Ldc_W;
 	}
 
-	uint16_t get_byte_size() const override {
-		return 3;
-	}
-	const char* get_mnemonic() const override {
-		return "ldc_w";
-	}
-	int8_t get_stack_delta() const override {
-		return 1;
-	}
-
 	uint16_t get_index() const {
 		return index;
 	}
 	void write_buffer(uint8_t** buffer) const override;
+	void visit_constant_pool_indices(
+		ConstantPoolIndexVisitor& visitor) override;
 private:
 	uint16_t index;
 };
@@ -3977,20 +2338,12 @@ public:
 		return instruction->get_kind() == Kind::Ldc2_W;
 	}
 
-	uint16_t get_byte_size() const override {
-		return 3;
-	}
-	const char* get_mnemonic() const override {
-		return "ldc2_w";
-	}
-	int8_t get_stack_delta() const override {
-		return 1;
-	}
-
 	uint16_t get_index() const {
 		return index;
 	}
 	void write_buffer(uint8_t** buffer) const override;
+	void visit_constant_pool_indices(
+		ConstantPoolIndexVisitor& visitor) override;
 private:
 	uint16_t index;
 };
@@ -4003,17 +2356,6 @@ public:
 		return instruction->get_kind() == Kind::LDiv;
 	}
 
-	uint16_t get_byte_size() const override {
-		return 1;
-	}
-	const char* get_mnemonic() const override {
-		return "ldiv";
-	}
-
-	int8_t get_stack_delta() const override {
-		return -1;
-	}
-
 	void write_buffer(uint8_t** buffer) const override;
 };
 
@@ -4026,16 +2368,6 @@ public:
 		return instruction->get_kind() == Kind::LLoad;
 	}
 
-	uint16_t get_byte_size() const override {
-		return 2;
-	}
-	const char* get_mnemonic() const override {
-		return "lload";
-	}
-	int8_t get_stack_delta() const override {
-		return 1;
-	}
-
 	uint8_t get_index() const {
 		return index;
 	}
@@ -4052,17 +2384,6 @@ public:
 		return instruction->get_kind() == Kind::LLoad_0;
 	}
 
-	uint16_t get_byte_size() const override {
-		return 1;
-	}
-	const char* get_mnemonic() const override {
-		return "lload_0";
-	}
-
-	int8_t get_stack_delta() const override {
-		return 1;
-	}
-
 	void write_buffer(uint8_t** buffer) const override;
 };
 
@@ -4074,17 +2395,6 @@ public:
 		return instruction->get_kind() == Kind::LLoad_1;
 	}
 
-	uint16_t get_byte_size() const override {
-		return 1;
-	}
-	const char* get_mnemonic() const override {
-		return "lload_1";
-	}
-
-	int8_t get_stack_delta() const override {
-		return 1;
-	}
-
 	void write_buffer(uint8_t** buffer) const override;
 };
 
@@ -4096,17 +2406,6 @@ public:
 		return instruction->get_kind() == Kind::LLoad_2;
 	}
 
-	uint16_t get_byte_size() const override {
-		return 1;
-	}
-	const char* get_mnemonic() const override {
-		return "lload_2";
-	}
-
-	int8_t get_stack_delta() const override {
-		return 1;
-	}
-
 	void write_buffer(uint8_t** buffer) const override;
 };
 
@@ -4118,17 +2417,6 @@ public:
 		return instruction->get_kind() == Kind::LLoad_3;
 	}
 
-	uint16_t get_byte_size() const override {
-		return 1;
-	}
-	const char* get_mnemonic() const override {
-		return "lload_3";
-	}
-
-	int8_t get_stack_delta() const override {
-		return 1;
-	}
-
 	void write_buffer(uint8_t** buffer) const override;
 };
 
@@ -4140,15 +2428,6 @@ public:
 		return instruction->get_kind() == Kind::LMul;
 	}
 
-	uint16_t get_byte_size() const override {
-		return 1;
-	}
-	const char* get_mnemonic() const override {
-		return "lmul";
-	}
-	int8_t get_stack_delta() const override {
-		return -1;
-	}
 	void write_buffer(uint8_t** buffer) const override;
 };
 
@@ -4160,16 +2439,6 @@ public:
 		return instruction->get_kind() == Kind::LNeg;
 	}
 
-	uint16_t get_byte_size() const override {
-		return 1;
-	}
-	const char* get_mnemonic() const override {
-		return "lneg";
-	}
-
-	int8_t get_stack_delta() const override {
-		return 0;
-	}
 	void write_buffer(uint8_t** buffer) const override;
 };
 
@@ -4185,13 +2454,7 @@ public:
 		return instruction->get_kind() == Kind::LookupSwitch;
 	}
 
-	uint16_t get_byte_size() const override;
-	const char* get_mnemonic() const override {
-		return "lookupswitch";
-	}
-	int8_t get_stack_delta() const override {
-		return -1;
-	}
+	uint16_t get_variable_byte_size() const override;
 	void write_buffer(uint8_t** buffer) const override;
 
 	uint8_t get_padding() const {
@@ -4249,17 +2512,6 @@ public:
 		return instruction->get_kind() == Kind::LOr;
 	}
 
-	uint16_t get_byte_size() const override {
-		return 1;
-	}
-	const char* get_mnemonic() const override {
-		return "lor";
-	}
-
-	int8_t get_stack_delta() const override {
-		return -1;
-	}
-
 	void write_buffer(uint8_t** buffer) const override;
 };
 
@@ -4271,17 +2523,6 @@ public:
 		return instruction->get_kind() == Kind::LRem;
 	}
 
-	uint16_t get_byte_size() const override {
-		return 1;
-	}
-	const char* get_mnemonic() const override {
-		return "lrem";
-	}
-
-	int8_t get_stack_delta() const override {
-		return -1;
-	}
-
 	void write_buffer(uint8_t** buffer) const override;
 };
 
@@ -4293,12 +2534,6 @@ public:
 		return instruction->get_kind() == Kind::LReturn;
 	}
 
-	uint16_t get_byte_size() const override {
-		return 1;
-	}
-	const char* get_mnemonic() const override {
-		return "lreturn";
-	}
 	void write_buffer(uint8_t** buffer) const override;
 };
 
@@ -4310,17 +2545,6 @@ public:
 		return instruction->get_kind() == Kind::LShl;
 	}
 
-	uint16_t get_byte_size() const override {
-		return 1;
-	}
-	const char* get_mnemonic() const override {
-		return "lshl";
-	}
-
-	int8_t get_stack_delta() const override {
-		return -1;
-	}
-
 	void write_buffer(uint8_t** buffer) const override;
 };
 
@@ -4332,17 +2556,6 @@ public:
 		return instruction->get_kind() == Kind::LShr;
 	}
 
-	uint16_t get_byte_size() const override {
-		return 1;
-	}
-	const char* get_mnemonic() const override {
-		return "lshr";
-	}
-
-	int8_t get_stack_delta() const override {
-		return -1;
-	}
-
 	void write_buffer(uint8_t** buffer) const override;
 };
 
@@ -4355,16 +2568,6 @@ public:
 		return instruction->get_kind() == Kind::LStore;
 	}
 
-	uint16_t get_byte_size() const override {
-		return 2;
-	}
-	const char* get_mnemonic() const override {
-		return "lstore";
-	}
-	int8_t get_stack_delta() const override {
-		return -1;
-	}
-
 	uint8_t get_index() const {
 		return index;
 	}
@@ -4381,17 +2584,6 @@ public:
 		return instruction->get_kind() == Kind::LStore_0;
 	}
 
-	uint16_t get_byte_size() const override {
-		return 1;
-	}
-	const char* get_mnemonic() const override {
-		return "lstore_0";
-	}
-
-	int8_t get_stack_delta() const override {
-		return -1;
-	}
-
 	void write_buffer(uint8_t** buffer) const override;
 };
 
@@ -4403,17 +2595,6 @@ public:
 		return instruction->get_kind() == Kind::LStore_1;
 	}
 
-	uint16_t get_byte_size() const override {
-		return 1;
-	}
-	const char* get_mnemonic() const override {
-		return "lstore_1";
-	}
-
-	int8_t get_stack_delta() const override {
-		return -1;
-	}
-
 	void write_buffer(uint8_t** buffer) const override;
 };
 
@@ -4425,17 +2606,6 @@ public:
 		return instruction->get_kind() == Kind::LStore_2;
 	}
 
-	uint16_t get_byte_size() const override {
-		return 1;
-	}
-	const char* get_mnemonic() const override {
-		return "lstore_2";
-	}
-
-	int8_t get_stack_delta() const override {
-		return -1;
-	}
-
 	void write_buffer(uint8_t** buffer) const override;
 };
 
@@ -4447,17 +2617,6 @@ public:
 		return instruction->get_kind() == Kind::LStore_3;
 	}
 
-	uint16_t get_byte_size() const override {
-		return 1;
-	}
-	const char* get_mnemonic() const override {
-		return "lstore_3";
-	}
-
-	int8_t get_stack_delta() const override {
-		return -1;
-	}
-
 	void write_buffer(uint8_t** buffer) const override;
 };
 
@@ -4465,19 +2624,8 @@ class LSub : public Instruction {
 public:
 	LSub(Code* code) : Instruction(Kind::LSub, code) {}
 
-	static bool classof(const Instruction* instruction) {
-		return instruction->get_kind() == Kind::LSub;
-	}
-
-	uint16_t get_byte_size() const override {
-		return 1;
-	}
-	const char* get_mnemonic() const override {
-		return "lsub";
-	}
-
-	int8_t get_stack_delta() const override {
-		return -1;
+	static bool classof(const Instruction* instruction) {
+		return instruction->get_kind() == Kind::LSub;
 	}
 
 	void write_buffer(uint8_t** buffer) const override;
@@ -4491,17 +2639,6 @@ public:
 		return instruction->get_kind() == Kind::LUShr;
 	}
 
-	uint16_t get_byte_size() const override {
-		return 1;
-	}
-	const char* get_mnemonic() const override {
-		return "lushr";
-	}
-
-	int8_t get_stack_delta() const override {
-		return -1;
-	}
-
 	void write_buffer(uint8_t** buffer) const override;
 };
 
@@ -4513,17 +2650,6 @@ public:
 		return instruction->get_kind() == Kind::LXor;
 	}
 
-	uint16_t get_byte_size() const override {
-		return 1;
-	}
-	const char* get_mnemonic() const override {
-		return "lxor";
-	}
-
-	int8_t get_stack_delta() const override {
-		return -1;
-	}
-
 	void write_buffer(uint8_t** buffer) const override;
 
 };
@@ -4537,17 +2663,6 @@ public:
 		return instruction->get_kind() == Kind::MonitorEnter;
 	}
 
-	uint16_t get_byte_size() const override {
-		return 1;
-	}
-	const char* get_mnemonic() const override {
-		return "monitorenter";
-	}
-
-	int8_t get_stack_delta() const override {
-		return -1;
-	}
-
 	void write_buffer(uint8_t** buffer) const override;
 };
 
@@ -4559,17 +2674,6 @@ public:
 		return instruction->get_kind() == Kind::MonitorExit;
 	}
 
-	uint16_t get_byte_size() const override {
-		return 1;
-	}
-	const char* get_mnemonic() const override {
-		return "monitorexit";
-	}
-
-	int8_t get_stack_delta() const override {
-		return -1;
-	}
-
 	void write_buffer(uint8_t** buffer) const override;
 };
 
@@ -4583,14 +2687,7 @@ public:
 		return instruction->get_kind() == Kind::MultiANewArray;
 	}
 
-	uint16_t get_byte_size() const override {
-		return 4;
-	}
-	const char* get_mnemonic() const override {
-		return "multianewarray";
-	}
-
-	int8_t get_stack_delta() const override {
+	int8_t get_variable_stack_delta() const override {
 		return -dimensions + 1;
 	}
 
@@ -4601,6 +2698,8 @@ public:
 		return dimensions;
 	}
 	void write_buffer(uint8_t** buffer) const override;
+	void visit_constant_pool_indices(
+		ConstantPoolIndexVisitor& visitor) override;
 private:
 	uint16_t index;
 	uint8_t dimensions;
@@ -4615,20 +2714,12 @@ public:
 		return instruction->get_kind() == Kind::New;
 	}
 
-	uint16_t get_byte_size() const override {
-		return 3;
-	}
-	const char* get_mnemonic() const override {
-		return "new";
-	}
-	int8_t get_stack_delta() const override {
-		return 1;
-	}
-
 	uint16_t get_index() const {
 		return index;
 	}
 	void write_buffer(uint8_t** buffer) const override;
+	void visit_constant_pool_indices(
+		ConstantPoolIndexVisitor& visitor) override;
 private:
 	uint16_t index;
 };
@@ -4642,16 +2733,6 @@ public:
 		return instruction->get_kind() == Kind::NewArray;
 	}
 
-	uint16_t get_byte_size() const override {
-		return 2;
-	}
-	const char* get_mnemonic() const override {
-		return "newarray";
-	}
-	int8_t get_stack_delta() const override {
-		return 0;
-	}
-
 	uint8_t get_atype() const {
 		return atype;
 	}
@@ -4668,17 +2749,6 @@ public:
 		return instruction->get_kind() == Kind::Nop;
 	}
 
-	uint16_t get_byte_size() const override {
-		return 1;
-	}
-	const char* get_mnemonic() const override {
-		return "nop";
-	}
-
-	int8_t get_stack_delta() const override {
-		return 0;
-	}
-
 	void write_buffer(uint8_t** buffer) const override;
 
 };
@@ -4691,17 +2761,6 @@ public:
 		return instruction->get_kind() == Kind::Pop;
 	}
 
-	uint16_t get_byte_size() const override {
-		return 1;
-	}
-	const char* get_mnemonic() const override {
-		return "pop";
-	}
-
-	int8_t get_stack_delta() const override {
-		return -1;
-	}
-
 	void write_buffer(uint8_t** buffer) const override;
 };
 
@@ -4713,17 +2772,6 @@ public:
 		return instruction->get_kind() == Kind::Pop2;
 	}
 
-	uint16_t get_byte_size() const override {
-		return 1;
-	}
-	const char* get_mnemonic() const override {
-		return "pop2";
-	}
-
-	int8_t get_stack_delta() const override {
-		return -1;
-	}
-
 	void write_buffer(uint8_t** buffer) const override;
 };
 
@@ -4736,20 +2784,12 @@ public:
 		return instruction->get_kind() == Kind::PutField;
 	}
 
-	uint16_t get_byte_size() const override {
-		return 3;
-	}
-	const char* get_mnemonic() const override {
-		return "putfield";
-	}
-	int8_t get_stack_delta() const override {
-		return -2;
-	}
-
 	uint16_t get_index() const {
 		return index;
 	}
 	void write_buffer(uint8_t** buffer) const override;
+	void visit_constant_pool_indices(
+		ConstantPoolIndexVisitor& visitor) override;
 private:
 	uint16_t index;
 };
@@ -4763,20 +2803,12 @@ public:
 		return instruction->get_kind() == Kind::PutStatic;
 	}
 
-	uint16_t get_byte_size() const override {
-		return 3;
-	}
-	const char* get_mnemonic() const override {
-		return "putstatic";
-	}
-	int8_t get_stack_delta() const override {
-		return -1;
-	}
-
 	uint16_t get_index() const {
 		return index;
 	}
 	void write_buffer(uint8_t** buffer) const override;
+	void visit_constant_pool_indices(
+		ConstantPoolIndexVisitor& visitor) override;
 private:
 	uint16_t index;
 };
@@ -4790,16 +2822,6 @@ public:
 		return instruction->get_kind() == Kind::Ret;
 	}
 
-	uint16_t get_byte_size() const override {
-		return 2;
-	}
-	const char* get_mnemonic() const override {
-		return "ret";
-	}
-	int8_t get_stack_delta() const override {
-		return 0;
-	}
-
 	uint8_t get_index() const {
 		return index;
 	}
@@ -4816,12 +2838,6 @@ public:
 		return instruction->get_kind() == Kind::Return;
 	}
 
-	uint16_t get_byte_size() const override {
-		return 1;
-	}
-	const char* get_mnemonic() const override {
-		return "return";
-	}
 	void write_buffer(uint8_t** buffer) const override;
 };
 
@@ -4833,17 +2849,6 @@ public:
 		return instruction->get_kind() == Kind::SALoad;
 	}
 
-	uint16_t get_byte_size() const override {
-		return 1;
-	}
-	const char* get_mnemonic() const override {
-		return "saload";
-	}
-
-	int8_t get_stack_delta() const override {
-		return -1;
-	}
-
 	void write_buffer(uint8_t** buffer) const override;
 };
 
@@ -4855,17 +2860,6 @@ public:
 		return instruction->get_kind() == Kind::SAStore;
 	}
 
-	uint16_t get_byte_size() const override {
-		return 1;
-	}
-	const char* get_mnemonic() const override {
-		return "sastore";
-	}
-
-	int8_t get_stack_delta() const override {
-		return -3;
-	}
-
 	void write_buffer(uint8_t** buffer) const override;
 };
 
@@ -4878,16 +2872,6 @@ public:
 		return instruction->get_kind() == Kind::SIPush ;
 	}
 
-	uint16_t get_byte_size() const override {
-		return 3;
-	}
-	const char* get_mnemonic() const override {
-		return "sipush";
-	}
-	int8_t get_stack_delta() const override {
-		return 1;
-	}
-
 	uint16_t get_value() const {
 		return value;
 	}
@@ -4904,17 +2888,6 @@ public:
 		return instruction->get_kind() == Kind::Swap;
 	}
 
-	uint16_t get_byte_size() const override {
-		return 1;
-	}
-	const char* get_mnemonic() const override {
-		return "swap";
-	}
-
-	int8_t get_stack_delta() const override {
-		return 0;
-	}
-
 	void write_buffer(uint8_t** buffer) const override;
 };
 
@@ -4930,16 +2903,9 @@ public:
 		return instruction->get_kind() == Kind::TableSwitch;
 	}
 
-	uint16_t get_byte_size() const override;
-	const char* get_mnemonic() const override {
-		return "tableswitch";
-	}
+	uint16_t get_variable_byte_size() const override;
 	void write_buffer(uint8_t** buffer) const override;
 
-	int8_t get_stack_delta() const override {
-		return -1;
-	}
-
 	uint8_t get_padding() const {
 		return padding;
 	}
@@ -4986,344 +2952,249 @@ private:
 	std::vector<Instruction*> targets;
 };
 
-class WideALoad : public Instruction {
+// Every wide form shares the Wide kind, so they're told apart by the kind of
+// instruction they modify
+class WideInstruction : public Instruction {
 public:
-	WideALoad(Code* code, uint16_t index)
-	: Instruction(Kind::Wide, code), index(index) {}
+	WideInstruction(Kind modified_kind, Code* code, uint16_t index)
+	: Instruction(Kind::Wide, code), modified_kind(modified_kind),
+	  index(index) {}
 
 	static bool classof(const Instruction* instruction) {
 		return instruction->get_kind() == Kind::Wide;
 	}
 
-	uint16_t get_byte_size() const override {
+	Kind get_modified_kind() const {
+		return modified_kind;
+	}
+	uint16_t get_index() const {
+		return index;
+	}
+private:
+	Kind modified_kind;
+	uint16_t index;
+};
+
+class WideALoad : public WideInstruction {
+public:
+	WideALoad(Code* code, uint16_t index)
+	: WideInstruction(Kind::ALoad, code, index) {}
+
+	uint16_t get_variable_byte_size() const override {
 		return 4;
 	}
 	const char* get_mnemonic() const override {
 		return "wide aload";
 	}
-	int8_t get_stack_delta() const override {
+	int8_t get_variable_stack_delta() const override {
 		return 1;
 	}
 
 	void write_buffer(uint8_t** buffer) const override;
-
-	uint16_t get_index() const {
-		return index;
-	}
-private:
-	uint16_t index;
 };
 
-class WideAStore : public Instruction {
+class WideAStore : public WideInstruction {
 public:
 	WideAStore(Code* code, uint16_t index)
-	: Instruction(Kind::Wide, code), index(index) {}
-
-	static bool classof(const Instruction* instruction) {
-		return instruction->get_kind() == Kind::Wide;
-	}
+	: WideInstruction(Kind::AStore, code, index) {}
 
-	uint16_t get_byte_size() const override {
+	uint16_t get_variable_byte_size() const override {
 		return 4;
 	}
 	const char* get_mnemonic() const override {
 		return "wide astore";
 	}
-	int8_t get_stack_delta() const override {
+	int8_t get_variable_stack_delta() const override {
 		return -1;
 	}
 
 	void write_buffer(uint8_t** buffer) const override;
-
-	uint16_t get_index() const {
-		return index;
-	}
-private:
-	uint16_t index;
 };
 
-class WideDLoad : public Instruction {
+class WideDLoad : public WideInstruction {
 public:
 	WideDLoad(Code* code, uint16_t index)
-	: Instruction(Kind::Wide, code), index(index) {}
-
-	static bool classof(const Instruction* instruction) {
-		return instruction->get_kind() == Kind::Wide;
-	}
+	: WideInstruction(Kind::DLoad, code, index) {}
 
-	uint16_t get_byte_size() const override {
+	uint16_t get_variable_byte_size() const override {
 		return 4;
 	}
 	const char* get_mnemonic() const override {
 		return "wide dload";
 	}
-	int8_t get_stack_delta() const override {
+	int8_t get_variable_stack_delta() const override {
 		return 1;
 	}
 
 	void write_buffer(uint8_t** buffer) const override;
-
-	uint16_t get_index() const {
-		return index;
-	}
-private:
-	uint16_t index;
 };
 
-class WideDStore : public Instruction {
+class WideDStore : public WideInstruction {
 public:
 	WideDStore(Code* code, uint16_t index)
-	: Instruction(Kind::Wide, code), index(index) {}
+	: WideInstruction(Kind::DStore, code, index) {}
 
-	static bool classof(const Instruction* instruction) {
-		return instruction->get_kind() == Kind::Wide;
-	}
-
-	uint16_t get_byte_size() const override {
+	uint16_t get_variable_byte_size() const override {
 		return 4;
 	}
 	const char* get_mnemonic() const override {
 		return "wide dstore";
 	}
-	int8_t get_stack_delta() const override {
+	int8_t get_variable_stack_delta() const override {
 		return -1;
 	}
 
 	void write_buffer(uint8_t** buffer) const override;
-
-	uint16_t get_index() const {
-		return index;
-	}
-private:
-	uint16_t index;
 };
 
-class WideFLoad : public Instruction {
+class WideFLoad : public WideInstruction {
 public:
 	WideFLoad(Code* code, uint16_t index)
-	: Instruction(Kind::Wide, code), index(index) {}
-
-	static bool classof(const Instruction* instruction) {
-		return instruction->get_kind() == Kind::Wide;
-	}
+	: WideInstruction(Kind::FLoad, code, index) {}
 
-	uint16_t get_byte_size() const override {
+	uint16_t get_variable_byte_size() const override {
 		return 4;
 	}
 	const char* get_mnemonic() const override {
 		return "wide fload";
 	}
-	int8_t get_stack_delta() const override {
+	int8_t get_variable_stack_delta() const override {
 		return 1;
 	}
 
 	void write_buffer(uint8_t** buffer) const override;
-
-	uint16_t get_index() const {
-		return index;
-	}
-private:
-	uint16_t index;
 };
 
-class WideFStore : public Instruction {
+class WideFStore : public WideInstruction {
 public:
 	WideFStore(Code* code, uint16_t index)
-	: Instruction(Kind::Wide, code), index(index) {}
-
-	static bool classof(const Instruction* instruction) {
-		return instruction->get_kind() == Kind::Wide;
-	}
+	: WideInstruction(Kind::FStore, code, index) {}
 
-	uint16_t get_byte_size() const override {
+	uint16_t get_variable_byte_size() const override {
 		return 4;
 	}
 	const char* get_mnemonic() const override {
 		return "wide fstore";
 	}
-	int8_t get_stack_delta() const override {
+	int8_t get_variable_stack_delta() const override {
 		return -1;
 	}
 
 	void write_buffer(uint8_t** buffer) const override;
-
-	uint16_t get_index() const {
-		return index;
-	}
-private:
-	uint16_t index;
 };
 
-class WideIInc : public Instruction {
+class WideIInc : public WideInstruction {
 public:
 	WideIInc(Code* code, uint16_t index, uint16_t value)
-	: Instruction(Kind::Wide, code), index(index), value(value) {}
-
-	static bool classof(const Instruction* instruction) {
-		return instruction->get_kind() == Kind::Wide;
-	}
+	: WideInstruction(Kind::IInc, code, index), value(value) {}
 
-	uint16_t get_byte_size() const override {
+	uint16_t get_variable_byte_size() const override {
 		return 6;
 	}
 	const char* get_mnemonic() const override {
 		return "wide iinc";
 	}
-	int8_t get_stack_delta() const override {
+	int8_t get_variable_stack_delta() const override {
 		return 0;
 	}
 
 	void write_buffer(uint8_t** buffer) const override;
 
-	uint16_t get_index() const {
-		return index;
-	}
 	uint16_t get_value() const {
 		return value;
 	}
 private:
-	uint16_t index;
 	uint16_t value;
 };
 
-class WideILoad : public Instruction {
+class WideILoad : public WideInstruction {
 public:
 	WideILoad(Code* code, uint16_t index)
-	: Instruction(Kind::Wide, code), index(index) {}
-
-	static bool classof(const Instruction* instruction) {
-		return instruction->get_kind() == Kind::Wide;
-	}
+	: WideInstruction(Kind::ILoad, code, index) {}
 
-	uint16_t get_byte_size() const override {
+	uint16_t get_variable_byte_size() const override {
 		return 4;
 	}
 	const char* get_mnemonic() const override {
 		return "wide iload";
 	}
-	int8_t get_stack_delta() const override {
+	int8_t get_variable_stack_delta() const override {
 		return 1;
 	}
 
 	void write_buffer(uint8_t** buffer) const override;
-
-	uint16_t get_index() const {
-		return index;
-	}
-private:
-	uint16_t index;
 };
 
-class WideIStore : public Instruction {
+class WideIStore : public WideInstruction {
 public:
 	WideIStore(Code* code, uint16_t index)
-	: Instruction(Kind::Wide, code), index(index) {}
+	: WideInstruction(Kind::IStore, code, index) {}
 
-	static bool classof(const Instruction* instruction) {
-		return instruction->get_kind() == Kind::Wide;
-	}
-
-	uint16_t get_byte_size() const override {
+	uint16_t get_variable_byte_size() const override {
 		return 4;
 	}
 	const char* get_mnemonic() const override {
 		return "wide istore";
 	}
-	int8_t get_stack_delta() const override {
+	int8_t get_variable_stack_delta() const override {
 		return -1;
 	}
 
 	void write_buffer(uint8_t** buffer) const override;
-
-	uint16_t get_index() const {
-		return index;
-	}
-private:
-	uint16_t index;
 };
 
-class WideLLoad : public Instruction {
+class WideLLoad : public WideInstruction {
 public:
 	WideLLoad(Code* code, uint16_t index)
-	: Instruction(Kind::Wide, code), index(index) {}
-
-	static bool classof(const Instruction* instruction) {
-		return instruction->get_kind() == Kind::Wide;
-	}
+	: WideInstruction(Kind::LLoad, code, index) {}
 
-	uint16_t get_byte_size() const override {
+	uint16_t get_variable_byte_size() const override {
 		return 4;
 	}
 	const char* get_mnemonic() const override {
 		return "wide lload";
 	}
-	int8_t get_stack_delta() const override {
+	int8_t get_variable_stack_delta() const override {
 		return 1;
 	}
 
 	void write_buffer(uint8_t** buffer) const override;
-
-	uint16_t get_index() const {
-		return index;
-	}
-private:
-	uint16_t index;
 };
 
-class WideLStore : public Instruction {
+class WideLStore : public WideInstruction {
 public:
 	WideLStore(Code* code, uint16_t index)
-	: Instruction(Kind::Wide, code), index(index) {}
-
-	static bool classof(const Instruction* instruction) {
-		return instruction->get_kind() == Kind::Wide;
-	}
+	: WideInstruction(Kind::LStore, code, index) {}
 
-	uint16_t get_byte_size() const override {
+	uint16_t get_variable_byte_size() const override {
 		return 4;
 	}
 	const char* get_mnemonic() const override {
 		return "wide lstore";
 	}
-	int8_t get_stack_delta() const override {
+	int8_t get_variable_stack_delta() const override {
 		return -1;
 	}
 
 	void write_buffer(uint8_t** buffer) const override;
-
-	uint16_t get_index() const {
-		return index;
-	}
-private:
-	uint16_t index;
 };
 
-class WideRet : public Instruction {
+class WideRet : public WideInstruction {
 public:
 	WideRet(Code* code, uint16_t index)
-	: Instruction(Kind::Wide, code), index(index) {}
-
-	static bool classof(const Instruction* instruction) {
-		return instruction->get_kind() == Kind::Wide;
-	}
+	: WideInstruction(Kind::Ret, code, index) {}
 
-	uint16_t get_byte_size() const override {
+	uint16_t get_variable_byte_size() const override {
 		return 4;
 	}
 	const char* get_mnemonic() const override {
 		return "wide ret";
 	}
-	int8_t get_stack_delta() const override {
+	int8_t get_variable_stack_delta() const override {
 		return 0;
 	}
 
 	void write_buffer(uint8_t** buffer) const override;
-
-	uint16_t get_index() const {
-		return index;
-	}
-private:
-	uint16_t index;
 };
 
 }
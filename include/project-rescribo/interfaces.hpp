@@ -24,6 +24,7 @@
 namespace project_rescribo {
 
 class ClassFile;
+class ConstantPoolIndexVisitor;
 class Interface;
 
 class Interfaces {
@@ -32,8 +33,14 @@ public:
 		   ClassFile* class_file);
 	~Interfaces();
 
+	// Constant pool indices of each Class
+	const std::vector<uint16_t>& get() const {
+		return interfaces;
+	}
+
 	uint32_t get_byte_size() const;
 	void write_buffer(uint8_t** buffer) const;
+	void visit_constant_pool_indices(ConstantPoolIndexVisitor& visitor);
 
 	ClassFile* get_class_file() const {
 		return class_file;
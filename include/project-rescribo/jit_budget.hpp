@@ -0,0 +1,83 @@
+/*
+ * Copyright 2019-2020 Jonathan Eyolfson
+ *
+ * This program is free software: you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License version 3 as published by the
+ * Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE. See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef PROJECT_RESCRIBO_JIT_BUDGET_HPP
+#define PROJECT_RESCRIBO_JIT_BUDGET_HPP
+
+#include <cstdint>
+#include <cstdio>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace project_rescribo {
+
+// Bytecode sizes where HotSpot changes how it compiles a method, and every
+// method instrumentation pushed over one of them. The defaults match
+// -XX:MaxInlineSize, -XX:FreqInlineSize and the limit for
+// -XX:-DontCompileHugeMethods. A method already over a limit before it was
+// instrumented isn't reported for it.
+class JitBudget {
+public:
+	enum class Limit : uint8_t {
+		MaxInlineSize, // Inlined at any call site
+		FreqInlineSize, // Inlined at hot call sites
+		HugeMethodLimit, // Compiled at all
+	};
+	static constexpr size_t NUM_LIMITS = 3;
+
+	struct Method {
+		std::string class_name;
+		std::string name;
+		std::string descriptor;
+		uint32_t old_size;
+		uint32_t new_size;
+		Limit limit; // The lowest one crossed
+		bool fell_back; // Used the compact variant instead
+	};
+
+	JitBudget();
+
+	uint32_t get_limit(Limit limit) const {
+		return limits[static_cast<size_t>(limit)];
+	}
+	void set_limit(Limit limit, uint32_t size) {
+		limits[static_cast<size_t>(limit)] = size;
+	}
+
+	// The lowest limit growing from old_size to new_size crosses
+	bool crosses(uint32_t old_size, uint32_t new_size, Limit* limit) const;
+
+	// These are safe to call from any number of threads, get_methods returns
+	// a copy since other threads may still be adding to it
+	void add(Method&& method);
+	void add_checked();
+	std::vector<Method> get_methods() const;
+	uint32_t get_num_checked() const;
+
+	// Totals for each limit, then every method that crossed one
+	void print(FILE* file) const;
+private:
+	uint32_t limits[NUM_LIMITS];
+
+	mutable std::mutex mutex;
+	std::vector<Method> methods;
+	uint32_t num_checked;
+};
+
+}
+
+#endif
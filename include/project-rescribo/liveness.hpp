@@ -0,0 +1,87 @@
+/*
+ * Copyright 2019-2020 Jonathan Eyolfson
+ *
+ * This program is free software: you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License version 3 as published by the
+ * Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE. See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef PROJECT_RESCRIBO_LIVENESS_HPP
+#define PROJECT_RESCRIBO_LIVENESS_HPP
+
+#include <cstdint>
+#include <vector>
+
+#include "control_flow_graph.hpp"
+
+namespace project_rescribo {
+
+class Instruction;
+
+// Which locals may be read before they're written again, for every block of
+// a method, found by backward dataflow over its ControlFlowGraph. A long or
+// double is live in both of its slots. Anything live at a handler is live
+// throughout the blocks it covers, since any of their instructions could
+// throw. Methods with subroutines have every local live everywhere.
+//
+// Each set is a bitset of max_locals bits, stored flat for all blocks. Use
+// Code::get_liveness to share one until the code changes.
+class Liveness {
+public:
+	typedef std::vector<uint64_t> Bits;
+
+	// Needs the code synced
+	Liveness(Code* code);
+
+	const ControlFlowGraph& get_graph() const {
+		return graph;
+	}
+	uint16_t get_num_locals() const {
+		return num_locals;
+	}
+
+	bool is_live_in(uint32_t block, uint16_t index) const {
+		return is_set(live_in, block, index);
+	}
+	bool is_live_out(uint32_t block, uint16_t index) const {
+		return is_set(live_out, block, index);
+	}
+	// Right before it runs, found by walking back from the end of its
+	// block. The instruction has to be in the code the graph was built
+	// from.
+	Bits get_live_before(const Instruction* instruction) const;
+	bool is_live_before(const Instruction* instruction,
+	                    uint16_t index) const;
+	// Every local live before, or used by, any instruction from begin up
+	// to end, or the end of the code if that's nullptr
+	Bits get_used_between(const Instruction* begin,
+	                      const Instruction* end) const;
+private:
+	ControlFlowGraph graph;
+	uint16_t num_locals;
+	uint32_t num_words;
+	std::vector<uint64_t> uses;
+	std::vector<uint64_t> defs;
+	std::vector<uint64_t> live_in;
+	std::vector<uint64_t> live_out;
+
+	bool is_set(const std::vector<uint64_t>& sets, uint32_t block,
+	            uint16_t index) const {
+		return (sets[block * num_words + index / 64]
+		        >> (index % 64)) & 1;
+	}
+	uint32_t find_block(const Instruction* instruction) const;
+	void add_handlers(uint32_t block, uint64_t* live) const;
+};
+
+}
+
+#endif
@@ -0,0 +1,116 @@
+/*
+ * Copyright 2019-2020 Jonathan Eyolfson
+ *
+ * This program is free software: you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License version 3 as published by the
+ * Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE. See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef PROJECT_RESCRIBO_MEMBER_INDEX_HPP
+#define PROJECT_RESCRIBO_MEMBER_INDEX_HPP
+
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+#include "constant_pool_entry.hpp"
+#include "utf8.hpp"
+
+namespace project_rescribo {
+
+// Finds a Field or Method by name and descriptor without comparing against
+// every one. Members are keyed by their constant pool indices, and by the
+// hash of their name so lookups by string don't need the indices, which
+// a class may have more than one of for the same string.
+//
+// Nothing is built until the first lookup, after that members are added as
+// they're added to the class. Compacting the constant pool renumbers the
+// indices, so the owner clears it then.
+template <typename Member>
+class MemberIndex {
+public:
+	typedef std::vector<std::unique_ptr<Member>> Members;
+
+	MemberIndex() : is_built(false) {}
+
+	void add(Member* member) {
+		if (is_built) {
+			insert(member);
+		}
+	}
+	void clear() {
+		is_built = false;
+		by_indices.clear();
+		by_name.clear();
+	}
+
+	Member* find(const Members& members, uint16_t name_index,
+	             uint16_t descriptor_index) {
+		build(members);
+		auto it = by_indices.find(pack(name_index, descriptor_index));
+		if (it == by_indices.end()) {
+			return nullptr;
+		}
+		return it->second;
+	}
+	// Any descriptor matches if it's nullptr
+	Member* find(const Members& members, const char* name,
+	             const char* descriptor) {
+		build(members);
+		size_t name_length = strlen(name);
+		auto range = by_name.equal_range(utf8_hash(
+			reinterpret_cast<const uint8_t*>(name), name_length
+		));
+		for (auto it = range.first; it != range.second; ++it) {
+			Member* member = it->second;
+			if (member->get_name_utf8().equals(name)
+			    && (descriptor == nullptr
+			        || member->get_descriptor_utf8().equals(
+			                descriptor))) {
+				return member;
+			}
+		}
+		return nullptr;
+	}
+private:
+	bool is_built;
+	std::unordered_map<uint32_t, Member*> by_indices;
+	std::unordered_multimap<uint64_t, Member*> by_name;
+
+	static uint32_t pack(uint16_t name_index, uint16_t descriptor_index) {
+		return (static_cast<uint32_t>(name_index) << 16)
+		       | descriptor_index;
+	}
+	void build(const Members& members) {
+		if (is_built) {
+			return;
+		}
+		by_indices.reserve(members.size());
+		by_name.reserve(members.size());
+		for (const auto& member : members) {
+			insert(member.get());
+		}
+		is_built = true;
+	}
+	// The first one added wins if a class repeats a name and descriptor
+	void insert(Member* member) {
+		by_indices.emplace(pack(member->get_name_index(),
+		                        member->get_descriptor_index()),
+		                   member);
+		by_name.emplace(member->get_name_utf8().get_hash(), member);
+	}
+};
+
+}
+
+#endif
@@ -21,6 +21,8 @@
 #include <memory>
 
 #include "access.hpp"
+#include "allocation_stats.hpp"
+#include "constant_pool_entry.hpp"
 
 namespace project_rescribo {
 
@@ -28,7 +30,6 @@ class Attributes;
 class ClassFile;
 class Code;
 class ConstantPool;
-class ConstantPoolUtf8;
 
 class Method {
 public:
@@ -38,6 +39,7 @@ public:
 	       const char *name,
 	       const char* descriptor);
 	~Method();
+	PROJECT_RESCRIBO_TRACK_ALLOCATIONS(Method)
 	ClassFile* get_class_file() const {
 		return class_file;
 	}
@@ -46,22 +48,38 @@ public:
 	uint16_t get_name_index() const {
 		return name_index;
 	}
-	ConstantPoolUtf8* get_name_utf8() const;
+	ConstantPoolUtf8 get_name_utf8() const;
 	uint16_t get_descriptor_index() const {
 		return descriptor_index;
 	}
-	ConstantPoolUtf8* get_descriptor_utf8() const;
+	ConstantPoolUtf8 get_descriptor_utf8() const;
 	bool is_static() const {
 		return access.is_static();
 	}
 
+	// Cached, and Methods keeps the total. Called when anything in the
+	// method changes size, it tells Methods the first time, and again only
+	// once the size is computed again.
 	uint32_t get_byte_size() const;
+	void invalidate_byte_size();
 
 	Code* get_code() {
 		return code;
 	}
 
+	// Where it was in the class file it was parsed from, nullptr if it was
+	// created instead
+	const uint8_t* get_input() const {
+		return input;
+	}
+	uint32_t get_input_size() const {
+		return input_size;
+	}
+	// Parsed and its code hasn't changed, its input is what it would write
+	bool is_unchanged() const;
+
 	void write_buffer(uint8_t** buffer) const;
+	void visit_constant_pool_indices(ConstantPoolIndexVisitor& visitor);
 
 	bool is_name(const char* str) const;
 
@@ -72,6 +90,10 @@ private:
 	uint16_t name_index;
 	uint16_t descriptor_index;
 	std::unique_ptr<Attributes> attributes;
+	mutable uint32_t byte_size;
+	mutable bool is_byte_size_current;
+	const uint8_t* input;
+	uint32_t input_size;
 
 	Code* code;
 };
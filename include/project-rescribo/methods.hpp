@@ -19,31 +19,52 @@
 
 #include <cstdint>
 #include <memory>
+#include <utility>
 #include <vector>
 
+#include "member_index.hpp"
+
 namespace project_rescribo {
 
 class ClassFile;
+class ConstantPoolIndexVisitor;
 class Method;
 
 class Methods {
 public:
-	Methods(const uint8_t** buffer, uint16_t count, ClassFile* class_file);
+	// With more than one thread, the method bodies of a large class are
+	// decoded on that many threads, giving the same methods in the same
+	// order as decoding them one by one
+	Methods(const uint8_t** buffer, uint16_t count, ClassFile* class_file,
+	        uint32_t num_threads);
 	~Methods();
 
 	std::vector<std::unique_ptr<Method>>& get() {
 		return methods;
 	}
 
-	void add(std::unique_ptr<Method> method) {
-		methods.push_back(std::move(method));
-	}
+	void add(std::unique_ptr<Method> method);
 
+	// nullptr if there isn't one
+	Method* find(uint16_t name_index, uint16_t descriptor_index);
+	// With a nullptr descriptor, any method with the name
+	Method* find(const char* name, const char* descriptor = nullptr);
+
+	// Only recomputes the methods that changed since the last time
 	uint32_t get_byte_size() const;
+	// From Method::invalidate_byte_size, with the size it last had
+	void invalidate_byte_size(Method* method, uint32_t old_byte_size);
 	void write_buffer(uint8_t** buffer) const;
+	void visit_constant_pool_indices(ConstantPoolIndexVisitor& visitor);
 
 private:
 	std::vector<std::unique_ptr<Method>> methods;
+	mutable uint32_t byte_size;
+	mutable std::vector<std::pair<Method*, uint32_t>> changed;
+	MemberIndex<Method> index;
+
+	void decode(const uint8_t** buffer, uint16_t count,
+	            ClassFile* class_file, uint32_t num_threads);
 };
 
 }
@@ -0,0 +1,100 @@
+/*
+ * Copyright 2019-2020 Jonathan Eyolfson
+ *
+ * This program is free software: you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License version 3 as published by the
+ * Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE. See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef PROJECT_RESCRIBO_NAME_MATCHER_HPP
+#define PROJECT_RESCRIBO_NAME_MATCHER_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace project_rescribo {
+
+class ConstantPoolUtf8;
+
+// Include and exclude rules compiled into a DFA each, so a name is checked
+// against every rule in at most two passes over its bytes without
+// allocating. A name matches if any include matches and no exclude does,
+// with no includes at all meaning everything is included. The two are kept
+// apart since a single DFA needs a state for every combination of them.
+//
+// Patterns are globs, ? is any byte but /, * is any run of bytes without a
+// / and ** is any run at all. Class patterns may use . for /, as in
+// com.example.**. Method patterns are a name followed by an optional
+// descriptor, like get*()* or main([Ljava/lang/String;)V, a name alone
+// matches any descriptor.
+class NameMatcher {
+public:
+	enum class Kind : uint8_t {
+		Class,
+		Method,
+	};
+
+	NameMatcher(Kind kind);
+
+	void include(const std::string& pattern);
+	void exclude(const std::string& pattern);
+	// Call once after adding every rule, before matching
+	void compile();
+
+	uint32_t get_num_states() const {
+		return includes.flags.size() + excludes.flags.size();
+	}
+
+	// The bytes may come straight from a class file that isn't parsed yet
+	bool matches(const uint8_t* data, size_t length) const;
+	bool matches(const ConstantPoolUtf8& name) const;
+	bool matches(const ConstantPoolUtf8& name,
+	             const ConstantPoolUtf8& descriptor) const;
+	bool matches(const uint8_t* name, size_t name_length,
+	             const uint8_t* descriptor, size_t descriptor_length) const;
+
+	// Built from the same rules, so they match the same names
+	bool operator==(const NameMatcher& other) const {
+		return kind == other.kind && include_rules == other.include_rules
+		       && exclude_rules == other.exclude_rules;
+	}
+	bool operator!=(const NameMatcher& other) const {
+		return !(*this == other);
+	}
+private:
+	typedef std::vector<uint16_t> Rule;
+	struct Dfa {
+		std::vector<uint8_t> flags;
+		std::vector<uint32_t> transitions;
+	};
+
+	Kind kind;
+	std::vector<Rule> include_rules;
+	std::vector<Rule> exclude_rules;
+
+	uint8_t byte_classes[256];
+	std::vector<uint8_t> representatives;
+	Dfa includes;
+	Dfa excludes;
+
+	Rule parse(const std::string& pattern) const;
+	void compile(const std::vector<Rule>& rules, Dfa* dfa);
+	uint32_t run(const Dfa& dfa, uint32_t state,
+	             const uint8_t* data, size_t length) const;
+	bool accepts(const Dfa& dfa, const uint8_t* name, size_t name_length,
+	             const uint8_t* descriptor, size_t descriptor_length) const;
+};
+
+}
+
+#endif
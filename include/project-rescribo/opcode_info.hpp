@@ -0,0 +1,284 @@
+/*
+ * Copyright 2019-2020 Jonathan Eyolfson
+ *
+ * This program is free software: you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License version 3 as published by the
+ * Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE. See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef PROJECT_RESCRIBO_OPCODE_INFO_HPP
+#define PROJECT_RESCRIBO_OPCODE_INFO_HPP
+
+#include <cstddef>
+#include <cstdint>
+
+namespace project_rescribo {
+
+// Static properties of each opcode, so hot loops can avoid virtual calls on
+// Instruction. Stack effects count values (not slots), matching
+// Instruction::get_stack_delta.
+struct OpcodeInfo {
+	enum Category : uint8_t {
+		Branch = 1 << 0,
+		Switch = 1 << 1,
+		Invoke = 1 << 2,
+		Return = 1 << 3,
+		Load = 1 << 4, // Local variable loads
+		Store = 1 << 5, // Local variable stores
+		WideCapable = 1 << 6,
+		ConstantPoolIndex = 1 << 7, // Has a constant pool operand
+	};
+
+	// Depends on the operands or on state the instruction can change
+	static constexpr int8_t VARIABLE = -1;
+
+	const char* mnemonic;
+	int8_t length;
+	int8_t pop;
+	int8_t push;
+	uint8_t categories;
+
+	constexpr bool has_fixed_length() const {
+		return length != VARIABLE;
+	}
+	constexpr bool has_fixed_stack_delta() const {
+		return pop != VARIABLE && push != VARIABLE;
+	}
+	constexpr int8_t get_stack_delta() const {
+		return push - pop;
+	}
+	constexpr bool is(uint8_t category) const {
+		return (categories & category) != 0;
+	}
+};
+
+constexpr size_t NUM_OPCODES = 256;
+
+// https://docs.oracle.com/javase/specs/jvms/se11/html/jvms-6.html
+// Fields are mnemonic, length, pop, push and categories, -1 is VARIABLE.
+// Unassigned opcodes are left zeroed.
+inline constexpr OpcodeInfo OPCODE_INFO[NUM_OPCODES] = {
+	{"nop", 1, 0, 0, 0}, // 0x00
+	{"aconst_null", 1, 0, 1, 0}, // 0x01
+	{"iconst_m1", 1, 0, 1, 0}, // 0x02
+	{"iconst_0", 1, 0, 1, 0}, // 0x03
+	{"iconst_1", 1, 0, 1, 0}, // 0x04
+	{"iconst_2", 1, 0, 1, 0}, // 0x05
+	{"iconst_3", 1, 0, 1, 0}, // 0x06
+	{"iconst_4", 1, 0, 1, 0}, // 0x07
+	{"iconst_5", 1, 0, 1, 0}, // 0x08
+	{"lconst_0", 1, 0, 1, 0}, // 0x09
+	{"lconst_1", 1, 0, 1, 0}, // 0x0A
+	{"fconst_0", 1, 0, 1, 0}, // 0x0B
+	{"fconst_1", 1, 0, 1, 0}, // 0x0C
+	{"fconst_2", 1, 0, 1, 0}, // 0x0D
+	{"dconst_0", 1, 0, 1, 0}, // 0x0E
+	{"dconst_1", 1, 0, 1, 0}, // 0x0F
+	{"bipush", 2, 0, 1, 0}, // 0x10
+	{"sipush", 3, 0, 1, 0}, // 0x11
+	{"ldc", 2, 0, 1, OpcodeInfo::ConstantPoolIndex}, // 0x12
+	{"ldc_w", 3, 0, 1, OpcodeInfo::ConstantPoolIndex}, // 0x13
+	{"ldc2_w", 3, 0, 1, OpcodeInfo::ConstantPoolIndex}, // 0x14
+	{"iload", 2, 0, 1, OpcodeInfo::Load | OpcodeInfo::WideCapable}, // 0x15
+	{"lload", 2, 0, 1, OpcodeInfo::Load | OpcodeInfo::WideCapable}, // 0x16
+	{"fload", 2, 0, 1, OpcodeInfo::Load | OpcodeInfo::WideCapable}, // 0x17
+	{"dload", 2, 0, 1, OpcodeInfo::Load | OpcodeInfo::WideCapable}, // 0x18
+	{"aload", 2, 0, 1, OpcodeInfo::Load | OpcodeInfo::WideCapable}, // 0x19
+	{"iload_0", 1, 0, 1, OpcodeInfo::Load}, // 0x1A
+	{"iload_1", 1, 0, 1, OpcodeInfo::Load}, // 0x1B
+	{"iload_2", 1, 0, 1, OpcodeInfo::Load}, // 0x1C
+	{"iload_3", 1, 0, 1, OpcodeInfo::Load}, // 0x1D
+	{"lload_0", 1, 0, 1, OpcodeInfo::Load}, // 0x1E
+	{"lload_1", 1, 0, 1, OpcodeInfo::Load}, // 0x1F
+	{"lload_2", 1, 0, 1, OpcodeInfo::Load}, // 0x20
+	{"lload_3", 1, 0, 1, OpcodeInfo::Load}, // 0x21
+	{"fload_0", 1, 0, 1, OpcodeInfo::Load}, // 0x22
+	{"fload_1", 1, 0, 1, OpcodeInfo::Load}, // 0x23
+	{"fload_2", 1, 0, 1, OpcodeInfo::Load}, // 0x24
+	{"fload_3", 1, 0, 1, OpcodeInfo::Load}, // 0x25
+	{"dload_0", 1, 0, 1, OpcodeInfo::Load}, // 0x26
+	{"dload_1", 1, 0, 1, OpcodeInfo::Load}, // 0x27
+	{"dload_2", 1, 0, 1, OpcodeInfo::Load}, // 0x28
+	{"dload_3", 1, 0, 1, OpcodeInfo::Load}, // 0x29
+	{"aload_0", 1, 0, 1, OpcodeInfo::Load}, // 0x2A
+	{"aload_1", 1, 0, 1, OpcodeInfo::Load}, // 0x2B
+	{"aload_2", 1, 0, 1, OpcodeInfo::Load}, // 0x2C
+	{"aload_3", 1, 0, 1, OpcodeInfo::Load}, // 0x2D
+	{"iaload", 1, 2, 1, 0}, // 0x2E
+	{"laload", 1, 2, 1, 0}, // 0x2F
+	{"faload", 1, 2, 1, 0}, // 0x30
+	{"daload", 1, 2, 1, 0}, // 0x31
+	{"aaload", 1, 2, 1, 0}, // 0x32
+	{"baload", 1, 2, 1, 0}, // 0x33
+	{"caload", 1, 2, 1, 0}, // 0x34
+	{"saload", 1, 2, 1, 0}, // 0x35
+	{"istore", 2, 1, 0, OpcodeInfo::Store | OpcodeInfo::WideCapable}, // 0x36
+	{"lstore", 2, 1, 0, OpcodeInfo::Store | OpcodeInfo::WideCapable}, // 0x37
+	{"fstore", 2, 1, 0, OpcodeInfo::Store | OpcodeInfo::WideCapable}, // 0x38
+	{"dstore", 2, 1, 0, OpcodeInfo::Store | OpcodeInfo::WideCapable}, // 0x39
+	{"astore", 2, 1, 0, OpcodeInfo::Store | OpcodeInfo::WideCapable}, // 0x3A
+	{"istore_0", 1, 1, 0, OpcodeInfo::Store}, // 0x3B
+	{"istore_1", 1, 1, 0, OpcodeInfo::Store}, // 0x3C
+	{"istore_2", 1, 1, 0, OpcodeInfo::Store}, // 0x3D
+	{"istore_3", 1, 1, 0, OpcodeInfo::Store}, // 0x3E
+	{"lstore_0", 1, 1, 0, OpcodeInfo::Store}, // 0x3F
+	{"lstore_1", 1, 1, 0, OpcodeInfo::Store}, // 0x40
+	{"lstore_2", 1, 1, 0, OpcodeInfo::Store}, // 0x41
+	{"lstore_3", 1, 1, 0, OpcodeInfo::Store}, // 0x42
+	{"fstore_0", 1, 1, 0, OpcodeInfo::Store}, // 0x43
+	{"fstore_1", 1, 1, 0, OpcodeInfo::Store}, // 0x44
+	{"fstore_2", 1, 1, 0, OpcodeInfo::Store}, // 0x45
+	{"fstore_3", 1, 1, 0, OpcodeInfo::Store}, // 0x46
+	{"dstore_0", 1, 1, 0, OpcodeInfo::Store}, // 0x47
+	{"dstore_1", 1, 1, 0, OpcodeInfo::Store}, // 0x48
+	{"dstore_2", 1, 1, 0, OpcodeInfo::Store}, // 0x49
+	{"dstore_3", 1, 1, 0, OpcodeInfo::Store}, // 0x4A
+	{"astore_0", 1, 1, 0, OpcodeInfo::Store}, // 0x4B
+	{"astore_1", 1, 1, 0, OpcodeInfo::Store}, // 0x4C
+	{"astore_2", 1, 1, 0, OpcodeInfo::Store}, // 0x4D
+	{"astore_3", 1, 1, 0, OpcodeInfo::Store}, // 0x4E
+	{"iastore", 1, 3, 0, 0}, // 0x4F
+	{"lastore", 1, 3, 0, 0}, // 0x50
+	{"fastore", 1, 3, 0, 0}, // 0x51
+	{"dastore", 1, 3, 0, 0}, // 0x52
+	{"aastore", 1, 3, 0, 0}, // 0x53
+	{"bastore", 1, 3, 0, 0}, // 0x54
+	{"castore", 1, 3, 0, 0}, // 0x55
+	{"sastore", 1, 3, 0, 0}, // 0x56
+	{"pop", 1, 1, 0, 0}, // 0x57
+	{"pop2", 1, 1, 0, 0}, // 0x58
+	{"dup", 1, 1, 2, 0}, // 0x59
+	{"dup_x1", 1, 2, 3, 0}, // 0x5A
+	{"dup_x2", 1, 3, 4, 0}, // 0x5B
+	{"dup2", 1, 1, 2, 0}, // 0x5C
+	{"dup2_x1", 1, 2, 3, 0}, // 0x5D
+	{"dup2_x2", 1, 3, 4, 0}, // 0x5E
+	{"swap", 1, 2, 2, 0}, // 0x5F
+	{"iadd", 1, 2, 1, 0}, // 0x60
+	{"ladd", 1, 2, 1, 0}, // 0x61
+	{"fadd", 1, 2, 1, 0}, // 0x62
+	{"dadd", 1, 2, 1, 0}, // 0x63
+	{"isub", 1, 2, 1, 0}, // 0x64
+	{"lsub", 1, 2, 1, 0}, // 0x65
+	{"fsub", 1, 2, 1, 0}, // 0x66
+	{"dsub", 1, 2, 1, 0}, // 0x67
+	{"imul", 1, 2, 1, 0}, // 0x68
+	{"lmul", 1, 2, 1, 0}, // 0x69
+	{"fmul", 1, 2, 1, 0}, // 0x6A
+	{"dmul", 1, 2, 1, 0}, // 0x6B
+	{"idiv", 1, 2, 1, 0}, // 0x6C
+	{"ldiv", 1, 2, 1, 0}, // 0x6D
+	{"fdiv", 1, 2, 1, 0}, // 0x6E
+	{"ddiv", 1, 2, 1, 0}, // 0x6F
+	{"irem", 1, 2, 1, 0}, // 0x70
+	{"lrem", 1, 2, 1, 0}, // 0x71
+	{"frem", 1, 2, 1, 0}, // 0x72
+	{"drem", 1, 2, 1, 0}, // 0x73
+	{"ineg", 1, 1, 1, 0}, // 0x74
+	{"lneg", 1, 1, 1, 0}, // 0x75
+	{"fneg", 1, 1, 1, 0}, // 0x76
+	{"dneg", 1, 1, 1, 0}, // 0x77
+	{"ishl", 1, 2, 1, 0}, // 0x78
+	{"lshl", 1, 2, 1, 0}, // 0x79
+	{"ishr", 1, 2, 1, 0}, // 0x7A
+	{"lshr", 1, 2, 1, 0}, // 0x7B
+	{"iushr", 1, 2, 1, 0}, // 0x7C
+	{"lushr", 1, 2, 1, 0}, // 0x7D
+	{"iand", 1, 2, 1, 0}, // 0x7E
+	{"land", 1, 2, 1, 0}, // 0x7F
+	{"ior", 1, 2, 1, 0}, // 0x80
+	{"lor", 1, 2, 1, 0}, // 0x81
+	{"ixor", 1, 2, 1, 0}, // 0x82
+	{"lxor", 1, 2, 1, 0}, // 0x83
+	{"iinc", 3, 0, 0, OpcodeInfo::WideCapable}, // 0x84
+	{"i2l", 1, 1, 1, 0}, // 0x85
+	{"i2f", 1, 1, 1, 0}, // 0x86
+	{"i2d", 1, 1, 1, 0}, // 0x87
+	{"l2i", 1, 1, 1, 0}, // 0x88
+	{"l2f", 1, 1, 1, 0}, // 0x89
+	{"l2d", 1, 1, 1, 0}, // 0x8A
+	{"f2i", 1, 1, 1, 0}, // 0x8B
+	{"f2l", 1, 1, 1, 0}, // 0x8C
+	{"f2d", 1, 1, 1, 0}, // 0x8D
+	{"d2i", 1, 1, 1, 0}, // 0x8E
+	{"d2l", 1, 1, 1, 0}, // 0x8F
+	{"d2f", 1, 1, 1, 0}, // 0x90
+	{"i2b", 1, 1, 1, 0}, // 0x91
+	{"i2c", 1, 1, 1, 0}, // 0x92
+	{"i2s", 1, 1, 1, 0}, // 0x93
+	{"lcmp", 1, 2, 1, 0}, // 0x94
+	{"fcmpl", 1, 2, 1, 0}, // 0x95
+	{"fcmpg", 1, 2, 1, 0}, // 0x96
+	{"dcmpl", 1, 2, 1, 0}, // 0x97
+	{"dcmpg", 1, 2, 1, 0}, // 0x98
+	{"ifeq", 3, 1, 0, OpcodeInfo::Branch}, // 0x99
+	{"ifne", 3, 1, 0, OpcodeInfo::Branch}, // 0x9A
+	{"iflt", 3, 1, 0, OpcodeInfo::Branch}, // 0x9B
+	{"ifge", 3, 1, 0, OpcodeInfo::Branch}, // 0x9C
+	{"ifgt", 3, 1, 0, OpcodeInfo::Branch}, // 0x9D
+	{"ifle", 3, 1, 0, OpcodeInfo::Branch}, // 0x9E
+	{"if_icmpeq", 3, 2, 0, OpcodeInfo::Branch}, // 0x9F
+	{"if_icmpne", 3, 2, 0, OpcodeInfo::Branch}, // 0xA0
+	{"if_icmplt", 3, 2, 0, OpcodeInfo::Branch}, // 0xA1
+	{"if_icmpge", 3, 2, 0, OpcodeInfo::Branch}, // 0xA2
+	{"if_icmpgt", 3, 2, 0, OpcodeInfo::Branch}, // 0xA3
+	{"if_icmple", 3, 2, 0, OpcodeInfo::Branch}, // 0xA4
+	{"if_acmpeq", 3, 2, 0, OpcodeInfo::Branch}, // 0xA5
+	{"if_acmpne", 3, 2, 0, OpcodeInfo::Branch}, // 0xA6
+	{"goto", -1, 0, 0, OpcodeInfo::Branch}, // 0xA7
+	{"jsr", 3, 0, 1, OpcodeInfo::Branch}, // 0xA8
+	{"ret", 2, 0, 0, OpcodeInfo::WideCapable}, // 0xA9
+	{"tableswitch", -1, 1, 0, OpcodeInfo::Switch}, // 0xAA
+	{"lookupswitch", -1, 1, 0, OpcodeInfo::Switch}, // 0xAB
+	{"ireturn", 1, 1, 0, OpcodeInfo::Return}, // 0xAC
+	{"lreturn", 1, 1, 0, OpcodeInfo::Return}, // 0xAD
+	{"freturn", 1, 1, 0, OpcodeInfo::Return}, // 0xAE
+	{"dreturn", 1, 1, 0, OpcodeInfo::Return}, // 0xAF
+	{"areturn", 1, 1, 0, OpcodeInfo::Return}, // 0xB0
+	{"return", 1, 0, 0, OpcodeInfo::Return}, // 0xB1
+	{"getstatic", 3, 0, 1, OpcodeInfo::ConstantPoolIndex}, // 0xB2
+	{"putstatic", 3, 1, 0, OpcodeInfo::ConstantPoolIndex}, // 0xB3
+	{"getfield", 3, 1, 1, OpcodeInfo::ConstantPoolIndex}, // 0xB4
+	{"putfield", 3, 2, 0, OpcodeInfo::ConstantPoolIndex}, // 0xB5
+	{"invokevirtual", 3, -1, -1,
+	 OpcodeInfo::Invoke | OpcodeInfo::ConstantPoolIndex}, // 0xB6
+	{"invokespecial", 3, -1, -1,
+	 OpcodeInfo::Invoke | OpcodeInfo::ConstantPoolIndex}, // 0xB7
+	{"invokestatic", 3, -1, -1,
+	 OpcodeInfo::Invoke | OpcodeInfo::ConstantPoolIndex}, // 0xB8
+	{"invokeinterface", 5, -1, -1,
+	 OpcodeInfo::Invoke | OpcodeInfo::ConstantPoolIndex}, // 0xB9
+	{"invokedynamic", 5, -1, -1,
+	 OpcodeInfo::Invoke | OpcodeInfo::ConstantPoolIndex}, // 0xBA
+	{"new", 3, 0, 1, OpcodeInfo::ConstantPoolIndex}, // 0xBB
+	{"newarray", 2, 1, 1, 0}, // 0xBC
+	{"anewarray", 3, 1, 1, OpcodeInfo::ConstantPoolIndex}, // 0xBD
+	{"arraylength", 1, 1, 1, 0}, // 0xBE
+	{"athrow", 1, 1, 0, 0}, // 0xBF
+	{"checkcast", 3, 1, 1, OpcodeInfo::ConstantPoolIndex}, // 0xC0
+	{"instanceof", 3, 1, 1, OpcodeInfo::ConstantPoolIndex}, // 0xC1
+	{"monitorenter", 1, 1, 0, 0}, // 0xC2
+	{"monitorexit", 1, 1, 0, 0}, // 0xC3
+	{"wide", -1, -1, -1, 0}, // 0xC4
+	{"multianewarray", 4, -1, 1, OpcodeInfo::ConstantPoolIndex}, // 0xC5
+	{"ifnull", 3, 1, 0, OpcodeInfo::Branch}, // 0xC6
+	{"ifnonnull", 3, 1, 0, OpcodeInfo::Branch}, // 0xC7
+	{"goto_w", 5, 0, 0, OpcodeInfo::Branch}, // 0xC8
+	{"jsr_w", 5, 0, 1, OpcodeInfo::Branch}, // 0xC9
+};
+
+constexpr const OpcodeInfo& get_opcode_info(uint8_t opcode) {
+	return OPCODE_INFO[opcode];
+}
+
+}
+
+#endif
@@ -0,0 +1,54 @@
+/*
+ * Copyright 2019-2020 Jonathan Eyolfson
+ *
+ * This program is free software: you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License version 3 as published by the
+ * Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE. See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef PROJECT_RESCRIBO_PEEPHOLE_OPTIMIZER_HPP
+#define PROJECT_RESCRIBO_PEEPHOLE_OPTIMIZER_HPP
+
+#include <cstdint>
+#include <vector>
+
+namespace project_rescribo {
+
+class ClassFile;
+class Code;
+class Method;
+
+// Cleans up after code inserted one instruction at a time, which is larger
+// than it needs to be and counts against the JIT's inlining budget. It
+// shortens ldc_w to ldc when the index fits, drops a push that's popped
+// right away, including dup and pop, drops a goto to the next instruction,
+// and loads the same static field twice in a row with a dup instead.
+//
+// An instruction is only removed when nothing jumps to it and it has no
+// stack map frame, so the frames stay valid as they are. Methods with type
+// annotations are left alone since their ranges aren't kept current.
+class PeepholeOptimizer {
+public:
+	struct Result {
+		Method* method;
+		uint32_t bytes_removed;
+	};
+
+	// Needs the code synced, and syncs it again if anything changed.
+	// Returns the bytes removed.
+	uint32_t apply(Code* code) const;
+	// Only the methods that got smaller are in the result
+	std::vector<Result> apply(ClassFile* class_file) const;
+};
+
+}
+
+#endif
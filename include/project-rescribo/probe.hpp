@@ -0,0 +1,158 @@
+/*
+ * Copyright 2019-2020 Jonathan Eyolfson
+ *
+ * This program is free software: you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License version 3 as published by the
+ * Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE. See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef PROJECT_RESCRIBO_PROBE_HPP
+#define PROJECT_RESCRIBO_PROBE_HPP
+
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "name_matcher.hpp"
+
+namespace project_rescribo {
+
+class ClassFile;
+class Code;
+class JitBudget;
+class Method;
+
+// A call to a static hook method at the entry or every exit of the methods
+// its matchers select. The call is encoded once as a bytecode template, and
+// applying it to a class only fills in constant pool indices, once per class
+// for the hook and once per method for the method's own strings.
+//
+// Add rules to get_classes and get_methods then call compile. After that a
+// Probe is never modified, so any number of threads can apply it.
+class Probe {
+public:
+	enum class Location : uint8_t {
+		Entry,
+		Exit, // Before every return, not when an exception is thrown
+	};
+	// Passed to the hook in this order, each one adds a parameter
+	enum Argument : uint8_t {
+		// Object, null for static methods and at constructor entry
+		This = 1 << 0,
+		ClassName = 1 << 1, // String
+		MethodName = 1 << 2, // String
+		MethodDescriptor = 1 << 3, // String
+	};
+
+	Probe(Location location,
+	      const std::string& hook_class,
+	      const std::string& hook_method,
+	      uint8_t arguments);
+
+	NameMatcher& get_classes() {
+		return classes;
+	}
+	NameMatcher& get_methods() {
+		return methods;
+	}
+	void compile();
+
+	// Skips the call unless a static boolean field is true, so a probe
+	// that's off costs a load and a branch. With an empty flag_class the
+	// field is added to each class the probe applies to, making it a flag
+	// per class, and interfaces are left alone since their fields are
+	// final.
+	void set_guard(const std::string& flag_class,
+	               const std::string& flag_field);
+
+	// Checks every method's size before and after against the budget's
+	// limits, and adds each one that crossed a limit to it. With a
+	// fallback, usually a probe passing fewer arguments, a method this
+	// probe would push over a limit gets the fallback instead, whatever
+	// the fallback's own matchers select.
+	void set_budget(JitBudget* budget, const Probe* fallback);
+
+	// Moves the call into a private static synthetic helper in the class,
+	// one for each distinct sequence of constants, so each call site is
+	// only an invokestatic, after aload_0 or aconst_null if it passes This.
+	// Interfaces keep the call inline.
+	void set_out_of_line(bool out_of_line);
+
+	// Before widening any jumps that no longer reach
+	uint32_t get_inserted_size(Code* code) const;
+
+	// The hook always returns void
+	const std::string& get_hook_descriptor() const {
+		return hook_descriptor;
+	}
+
+	// Syncs every method it changes. Returns how many that was, which
+	// leaves out any it couldn't change once the constant pool was full.
+	uint32_t apply(ClassFile* class_file) const;
+private:
+	enum class Slot : uint8_t {
+		This, // The opcode, aload_0 or aconst_null
+		HookMethodref,
+		ClassName,
+		MethodName,
+		MethodDescriptor,
+	};
+	struct Patch {
+		uint16_t offset;
+		Slot slot;
+	};
+	// Constant pool indices for one class, found on the first method that
+	// needs them
+	struct ClassState {
+		uint16_t hook_index;
+		uint16_t flag_index;
+		uint16_t class_name_string_index;
+		std::vector<uint8_t> patched;
+		// Methodrefs of the helpers, keyed by their code
+		std::map<std::vector<uint8_t>, uint16_t> helper_indices;
+	};
+
+	Location location;
+	std::string hook_class;
+	std::string hook_method;
+	std::string hook_descriptor;
+	uint8_t arguments;
+	NameMatcher classes;
+	NameMatcher methods;
+	bool guarded;
+	std::string flag_class;
+	std::string flag_field;
+	JitBudget* budget;
+	const Probe* fallback;
+	bool out_of_line;
+
+	std::vector<uint8_t> bytecode;
+	std::vector<Patch> patches;
+	uint16_t max_stack;
+
+	void add_instruction(uint8_t opcode, Slot slot);
+	uint16_t get_flag_index(ClassFile* class_file) const;
+	bool has_helpers(ClassFile* class_file) const;
+	uint16_t get_helper_index(
+		ClassFile* class_file, ClassState* state,
+		std::vector<std::unique_ptr<Method>>* helpers
+	) const;
+	// Helpers are added to the class after every method is done. Returns
+	// false, leaving the method alone, if the constant pool is full.
+	bool apply(ClassFile* class_file, Method* method, ClassState* state,
+	           std::vector<std::unique_ptr<Method>>* helpers) const;
+};
+
+}
+
+#endif
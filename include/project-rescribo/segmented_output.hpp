@@ -0,0 +1,79 @@
+/*
+ * Copyright 2019-2020 Jonathan Eyolfson
+ *
+ * This program is free software: you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License version 3 as published by the
+ * Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE. See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef PROJECT_RESCRIBO_SEGMENTED_OUTPUT_HPP
+#define PROJECT_RESCRIBO_SEGMENTED_OUTPUT_HPP
+
+#include <cstdint>
+#include <vector>
+
+namespace project_rescribo {
+
+// A class file written as a list of segments to copy in order, from
+// ClassFile::write_segments. Parts that haven't changed since parsing point
+// straight into the input, which has to outlive the segments, and only the
+// rest is written out, into bytes owned here. For a large class with a few
+// changed methods most of the output is never touched.
+class SegmentedOutput {
+public:
+	struct Segment {
+		const uint8_t* data;
+		uint32_t size;
+	};
+
+	SegmentedOutput();
+
+	// Adjacent input is merged into one segment, as is adjacent output
+	void add_input(const uint8_t* data, uint32_t size);
+	// Room for size new bytes, only valid until the next call
+	uint8_t* add_output(uint32_t size);
+	// Call once everything is added, before using the segments
+	void finish();
+
+	const std::vector<Segment>& get_segments() const {
+		return segments;
+	}
+	uint32_t get_byte_size() const {
+		return byte_size;
+	}
+	// The part of the size pointing into the input
+	uint32_t get_input_byte_size() const {
+		return byte_size - output.size();
+	}
+
+	// Copies get_byte_size bytes
+	void flatten(uint8_t* buffer) const;
+	// Writes every segment with writev, retrying partial writes. Returns
+	// false with errno set if a write fails.
+	bool write(int fd) const;
+private:
+	// Output segments hold their offset in output until finish, since it
+	// moves as it grows
+	struct Part {
+		const uint8_t* input;
+		uint32_t offset;
+		uint32_t size;
+	};
+
+	std::vector<Part> parts;
+	std::vector<uint8_t> output;
+	std::vector<Segment> segments;
+	uint32_t byte_size;
+};
+
+}
+
+#endif
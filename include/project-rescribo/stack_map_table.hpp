@@ -17,6 +17,7 @@
 #ifndef PROJECT_RESCRIBO_STACK_MAP_TABLE_HPP
 #define PROJECT_RESCRIBO_STACK_MAP_TABLE_HPP
 
+#include "allocation_stats.hpp"
 #include "attribute.hpp"
 
 #include <cstdint>
@@ -25,6 +26,8 @@
 namespace project_rescribo {
 
 class Code;
+class ConstantPool;
+class ConstantPoolIndexVisitor;
 class Instruction;
 class StackMapTable;
 
@@ -43,15 +46,22 @@ public:
 	};
 	VariableInfo(Kind kind) : kind(kind) {}
 	virtual ~VariableInfo() {}
+	PROJECT_RESCRIBO_TRACK_ALLOCATIONS(VariableInfo)
 	Kind get_kind() const {
 		return kind;
 	}
 
 	virtual uint32_t get_byte_size() const = 0;
 	virtual void write_buffer(uint8_t** buffer) const = 0;
+	virtual void visit_constant_pool_indices(ConstantPoolIndexVisitor&) {}
 
 	static std::unique_ptr<VariableInfo> make(const uint8_t** buffer,
 	                                          Code* code);
+	// A value of a single field type, such as I or Ljava/lang/String;
+	static std::unique_ptr<VariableInfo> make(const uint8_t* descriptor,
+	                                          uint16_t length,
+	                                          ConstantPool* constant_pool);
+	std::unique_ptr<VariableInfo> clone() const;
 private:
 	Kind kind;
 };
@@ -176,6 +186,8 @@ public:
 	}
 
 	virtual void write_buffer(uint8_t** buffer) const override;
+	virtual void visit_constant_pool_indices(
+		ConstantPoolIndexVisitor& visitor) override;
 
 	uint16_t get_index() const {
 		return index;
@@ -200,6 +212,9 @@ public:
 	virtual void write_buffer(uint8_t** buffer) const override;
 
 	uint16_t get_offset() const;
+	Instruction* get_instruction() const {
+		return instruction;
+	}
 private:
 	Instruction* instruction;
 };
@@ -218,6 +233,7 @@ public:
 	StackMapFrame(Kind kind, uint8_t type, StackMapTable* stack_map_table)
 	: kind(kind), type(type), stack_map_table(stack_map_table) {}
 	virtual ~StackMapFrame() {}
+	PROJECT_RESCRIBO_TRACK_ALLOCATIONS(StackMapFrame)
 	Kind get_kind() const {
 		return kind;
 	}
@@ -237,6 +253,7 @@ public:
 	virtual void set_offset_delta(uint16_t o) = 0;
 	virtual uint32_t get_byte_size() const = 0;
 	virtual void write_buffer(uint8_t** buffer) const = 0;
+	virtual void visit_constant_pool_indices(ConstantPoolIndexVisitor&) {}
 
 	static std::unique_ptr<StackMapFrame> make(
 		const uint8_t** buffer, StackMapTable* stack_map_table
@@ -298,11 +315,16 @@ public:
 	void set_offset_delta(uint16_t o) override;
 	virtual uint32_t get_byte_size() const override;
 
+	const VariableInfo* get_stack() const {
+		return stack.get();
+	}
 	std::unique_ptr<VariableInfo> move_stack() {
 		return std::move(stack);
 	}
 
 	virtual void write_buffer(uint8_t** buffer) const override;
+	virtual void visit_constant_pool_indices(
+		ConstantPoolIndexVisitor& visitor) override;
 
 private:
 	std::unique_ptr<VariableInfo> stack;
@@ -333,7 +355,13 @@ public:
 	}
 	virtual uint32_t get_byte_size() const override;
 
+	const VariableInfo* get_stack() const {
+		return stack.get();
+	}
+
 	virtual void write_buffer(uint8_t** buffer) const override;
+	virtual void visit_constant_pool_indices(
+		ConstantPoolIndexVisitor& visitor) override;
 
 private:
 	uint16_t offset_delta;
@@ -416,8 +444,13 @@ public:
 	void set_offset_delta(uint16_t o) override {
 		offset_delta = o;
 	}
+	const std::vector<std::unique_ptr<VariableInfo>>& get_locals() const {
+		return locals;
+	}
 	virtual uint32_t get_byte_size() const override;
 	virtual void write_buffer(uint8_t** buffer) const override;
+	virtual void visit_constant_pool_indices(
+		ConstantPoolIndexVisitor& visitor) override;
 private:
 	uint16_t offset_delta;
 	std::vector<std::unique_ptr<VariableInfo>> locals;
@@ -447,8 +480,17 @@ public:
 	void set_offset_delta(uint16_t o) override {
 		offset_delta = o;
 	}
+	const std::vector<std::unique_ptr<VariableInfo>>& get_locals() const {
+		return locals;
+	}
+	const std::vector<std::unique_ptr<VariableInfo>>&
+	get_stack_items() const {
+		return stack_items;
+	}
 	virtual uint32_t get_byte_size() const override;
 	virtual void write_buffer(uint8_t** buffer) const override;
+	virtual void visit_constant_pool_indices(
+		ConstantPoolIndexVisitor& visitor) override;
 private:
 	uint16_t offset_delta;
 	std::vector<std::unique_ptr<VariableInfo>> locals;
@@ -460,6 +502,7 @@ public:
 	StackMapTable(const uint8_t** buffer,
 	              uint16_t attribute_name_index,
 	              Code* code);
+	StackMapTable(uint16_t attribute_name_index, Code* code);
 
 	static bool classof(const Attribute* attribute) {
 		return attribute->get_kind() == Kind::StackMapTable;
@@ -471,13 +514,46 @@ public:
 
 	StackMapFrame* get_stack_frame_at(Instruction* instruction) const;
 
+	// Cached until a frame is added or replaced
 	virtual uint32_t get_byte_size() const override;
 	virtual void write_buffer(uint8_t** buffer) const override;
+	virtual void visit_constant_pool_indices(
+		ConstantPoolIndexVisitor& visitor) override;
 
 	void sync_offset_delta();
+
+	// Copies of the locals a frame ends up with, after the frames before
+	std::vector<std::unique_ptr<VariableInfo>> get_locals(
+		const StackMapFrame* frame
+	) const;
+
+	// Both need the code synced and leave the offsets for the next sync.
+	// A frame matching the method's initial one, before every other frame.
+	void insert_initial_frame(Instruction* instruction);
+	// A full frame, locals past the ones given can't be used. The next
+	// frame is rewritten as a full frame if it was relative to the one
+	// before.
+	void insert_frame(Instruction* instruction,
+	                  std::vector<std::unique_ptr<VariableInfo>> locals,
+	                  std::vector<std::unique_ptr<VariableInfo>> stack_items);
+	// Every frame from begin up to end, or the end of the code if that's
+	// nullptr, has the local at index set to type. They become full frames,
+	// as does the one after them.
+	void declare_local(uint16_t index, const VariableInfo& type,
+	                   Instruction* begin, Instruction* end);
+	// The slots from index on are top, or past the locals, in every frame
+	bool is_top(uint16_t index, uint8_t size) const;
 private:
+	typedef std::vector<std::unique_ptr<VariableInfo>> Locals;
+
 	Code* code;
 	std::vector<std::unique_ptr<StackMapFrame>> entries;
+	mutable uint32_t byte_size;
+	mutable bool is_byte_size_current;
+
+	Locals get_initial_locals() const;
+	// After adding or replacing frames
+	void mark_changed();
 };
 
 }
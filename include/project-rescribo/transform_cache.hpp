@@ -0,0 +1,110 @@
+/*
+ * Copyright 2019-2020 Jonathan Eyolfson
+ *
+ * This program is free software: you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License version 3 as published by the
+ * Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE. See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef PROJECT_RESCRIBO_TRANSFORM_CACHE_HPP
+#define PROJECT_RESCRIBO_TRANSFORM_CACHE_HPP
+
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "name_matcher.hpp"
+
+namespace project_rescribo {
+
+// What a configuration selects, kept so the next one can be compared
+// against it. A rule is known by a key, such as the hook it calls, and rules
+// with the same key in two sets are taken to do the same thing to whatever
+// they select.
+class RuleSet {
+public:
+	struct Rule {
+		std::string key;
+		NameMatcher classes;
+		NameMatcher methods;
+	};
+
+	// Copies the matchers, which should already be compiled
+	void add(const std::string& key,
+	         const NameMatcher& classes,
+	         const NameMatcher& methods);
+
+	const std::vector<Rule>& get_rules() const {
+		return rules;
+	}
+	const Rule* find(const std::string& key) const;
+private:
+	std::vector<Rule> rules;
+};
+
+// The output for every class loaded under the current rules, along with
+// the methods it had before being transformed. When the rules change only
+// the classes with a method selected differently need retransforming, the
+// rest keep being served from here. Safe to use from any number of threads.
+//
+// Retransforming can't add or remove fields or methods, RetransformClasses
+// rejects the change. A class that would gain or lose a Probe's per-class
+// guard flag or out-of-line helpers can't be moved between rules this way,
+// so rules that may change should use a shared flag class and inline calls.
+class TransformCache {
+public:
+	// Call for every class the load hook sees, transformed or not, with the
+	// output equal to the input if nothing changed it. Otherwise a rule
+	// added later can't find the class. False, and the class isn't added,
+	// if the input isn't a well formed class file.
+	bool add(const uint8_t* input, uint32_t input_length,
+	         std::vector<uint8_t> output);
+	// False unless the class was added with this exact input
+	bool find(const std::string& class_name,
+	          const uint8_t* input, uint32_t input_length,
+	          std::vector<uint8_t>* output) const;
+
+	// Drops the classes the two rule sets select differently and returns
+	// their names, sorted, in batches of at most batch_size to pass to
+	// RetransformClasses.
+	std::vector<std::vector<std::string>> invalidate(
+		const RuleSet& previous, const RuleSet& next,
+		uint32_t batch_size
+	);
+
+	uint32_t get_num_classes() const;
+private:
+	struct Entry {
+		// The hash only rules inputs out, the bytes are compared to
+		// match one
+		uint64_t input_hash;
+		std::vector<uint8_t> input;
+		// The input isn't kept twice for classes nothing changed
+		bool is_unchanged;
+		std::vector<uint8_t> output;
+		// Each name then descriptor
+		std::vector<std::string> methods;
+	};
+
+	mutable std::mutex mutex;
+	std::unordered_map<std::string, Entry> entries;
+
+	static bool is_affected(const std::string& class_name,
+	                        const Entry& entry,
+	                        const RuleSet::Rule* previous,
+	                        const RuleSet::Rule* next);
+};
+
+}
+
+#endif
@@ -0,0 +1,218 @@
+/*
+ * Copyright 2019-2020 Jonathan Eyolfson
+ *
+ * This program is free software: you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License version 3 as published by the
+ * Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE. See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef PROJECT_RESCRIBO_TRANSFORM_STATS_HPP
+#define PROJECT_RESCRIBO_TRANSFORM_STATS_HPP
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+
+namespace project_rescribo {
+
+// Statistics for a single ClassFile, filled in as it is parsed, transformed
+// and written. Only the owning thread touches these, so nothing is atomic.
+class TransformStats {
+public:
+	enum class Phase : uint8_t {
+		Parse,
+		Transform, // Includes any Sync done while transforming
+		Sync,
+		Write,
+	};
+	static constexpr size_t NUM_PHASES = 4;
+
+	// Timers may nest, see stop_timer
+	class Timer {
+	public:
+		Timer(TransformStats* stats, Phase phase)
+		: stats(stats), phase(phase),
+		  start(std::chrono::steady_clock::now()) {
+			stats->start_timer(phase);
+		}
+		~Timer() {
+			auto end = std::chrono::steady_clock::now();
+			stats->stop_timer(
+				phase,
+				std::chrono::duration_cast<
+					std::chrono::nanoseconds
+				>(end - start).count()
+			);
+		}
+	private:
+		TransformStats* stats;
+		Phase phase;
+		std::chrono::steady_clock::time_point start;
+	};
+
+	TransformStats();
+
+	uint64_t get_nanoseconds(Phase phase) const {
+		return nanoseconds[static_cast<size_t>(phase)];
+	}
+	// For time measured without a Timer, it's added to the total as well
+	void add_nanoseconds(Phase phase, uint64_t ns) {
+		nanoseconds[static_cast<size_t>(phase)] += ns;
+		total_nanoseconds += ns;
+	}
+	// The time any timer was running, each span counted once
+	uint64_t get_total_nanoseconds() const {
+		return total_nanoseconds;
+	}
+
+	void start_timer(Phase phase) {
+		++num_running[static_cast<size_t>(phase)];
+		++num_running_total;
+	}
+	// Only the outermost timer of a phase adds to it, and only the
+	// outermost of all adds to the total, so Sync within Transform or a
+	// Transform timer around another isn't counted twice
+	void stop_timer(Phase phase, uint64_t ns) {
+		size_t i = static_cast<size_t>(phase);
+		if (--num_running[i] == 0) {
+			nanoseconds[i] += ns;
+		}
+		if (--num_running_total == 0) {
+			total_nanoseconds += ns;
+		}
+	}
+
+	uint32_t get_input_size() const {
+		return input_size;
+	}
+	void set_input_size(uint32_t v) {
+		input_size = v;
+	}
+	uint32_t get_output_size() const {
+		return output_size;
+	}
+	void set_output_size(uint32_t v) {
+		output_size = v;
+	}
+
+	uint32_t get_input_instructions() const {
+		return input_instructions;
+	}
+	void add_input_instructions(uint32_t v) {
+		input_instructions += v;
+	}
+	uint32_t get_output_instructions() const {
+		return output_instructions;
+	}
+	void add_output_instructions(uint32_t v) {
+		output_instructions += v;
+	}
+
+	uint16_t get_input_constant_pool_size() const {
+		return input_constant_pool_size;
+	}
+	void set_input_constant_pool_size(uint16_t v) {
+		input_constant_pool_size = v;
+	}
+	uint16_t get_output_constant_pool_size() const {
+		return output_constant_pool_size;
+	}
+	void set_output_constant_pool_size(uint16_t v) {
+		output_constant_pool_size = v;
+	}
+
+	uint32_t get_num_writes() const {
+		return num_writes;
+	}
+	void start_write() {
+		output_instructions = 0;
+		++num_writes;
+	}
+
+	void print(FILE* file) const;
+private:
+	uint64_t nanoseconds[NUM_PHASES];
+	uint64_t total_nanoseconds;
+	uint32_t num_running[NUM_PHASES];
+	uint32_t num_running_total;
+	uint32_t input_size;
+	uint32_t output_size;
+	uint32_t input_instructions;
+	uint32_t output_instructions;
+	uint16_t input_constant_pool_size;
+	uint16_t output_constant_pool_size;
+	uint32_t num_writes;
+};
+
+// Power of two buckets, cheap enough to update on every class
+class Histogram {
+public:
+	static constexpr size_t NUM_BUCKETS = 65;
+
+	Histogram();
+
+	void add(uint64_t value);
+	void reset();
+
+	uint64_t get_count() const {
+		return count.load(std::memory_order_relaxed);
+	}
+	uint64_t get_sum() const {
+		return sum.load(std::memory_order_relaxed);
+	}
+	// Upper bound of the bucket containing the given fraction of values
+	uint64_t get_percentile(double fraction) const;
+private:
+	std::atomic<uint64_t> buckets[NUM_BUCKETS];
+	std::atomic<uint64_t> count;
+	std::atomic<uint64_t> sum;
+};
+
+// Process-wide totals, every ClassFile adds its TransformStats when destroyed
+class TransformStatsAggregator {
+public:
+	TransformStatsAggregator();
+
+	void add(const TransformStats& stats);
+	void reset();
+
+	uint64_t get_num_classes() const {
+		return num_classes.load(std::memory_order_relaxed);
+	}
+	const Histogram& get_histogram(TransformStats::Phase phase) const {
+		return phase_histograms[static_cast<size_t>(phase)];
+	}
+	const Histogram& get_total_histogram() const {
+		return total_histogram;
+	}
+
+	void print(FILE* file) const;
+
+	static TransformStatsAggregator& get_global();
+	// Prints the global aggregate to stderr when the process exits, which
+	// includes a JVM shutting down normally
+	static void print_global_at_exit();
+private:
+	std::atomic<uint64_t> num_classes;
+	std::atomic<uint64_t> input_bytes;
+	std::atomic<uint64_t> output_bytes;
+	std::atomic<uint64_t> input_instructions;
+	std::atomic<uint64_t> output_instructions;
+	std::atomic<int64_t> constant_pool_growth;
+	Histogram phase_histograms[TransformStats::NUM_PHASES];
+	Histogram total_histogram;
+};
+
+}
+
+#endif
@@ -0,0 +1,60 @@
+/*
+ * Copyright 2019-2020 Jonathan Eyolfson
+ *
+ * This program is free software: you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License version 3 as published by the
+ * Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE. See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef PROJECT_RESCRIBO_UTF8_HPP
+#define PROJECT_RESCRIBO_UTF8_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+namespace project_rescribo {
+
+// Routines over modified UTF-8, the encoding of ConstantPoolUtf8 bytes
+// https://docs.oracle.com/javase/specs/jvms/se11/html/jvms-4.html#jvms-4.4.7
+//
+// The vectorized implementations are picked on first use based on what the
+// CPU supports, and all of them give identical results.
+enum class Utf8Implementation : uint8_t {
+	Scalar,
+	SSE2,
+	AVX2,
+};
+
+Utf8Implementation get_utf8_implementation();
+const char* get_utf8_implementation_name(Utf8Implementation implementation);
+// Returns false, leaving the current one, if the CPU doesn't support it
+bool set_utf8_implementation(Utf8Implementation implementation);
+
+// Compares lengths before any bytes
+bool utf8_equals(const uint8_t* a, size_t a_length,
+                 const uint8_t* b, size_t b_length);
+bool utf8_starts_with(const uint8_t* data, size_t length,
+                      const uint8_t* prefix, size_t prefix_length);
+bool utf8_ends_with(const uint8_t* data, size_t length,
+                    const uint8_t* suffix, size_t suffix_length);
+bool utf8_is_ascii(const uint8_t* data, size_t length);
+
+// Not stable across versions, don't persist it
+uint64_t utf8_hash(const uint8_t* data, size_t length);
+
+std::u16string utf8_to_utf16(const uint8_t* data, size_t length);
+// Standard UTF-8, with surrogate pairs joined and NUL as a single byte
+std::string utf8_to_string(const uint8_t* data, size_t length);
+
+}
+
+#endif
@@ -0,0 +1,157 @@
+/*
+ * Copyright 2019-2020 Jonathan Eyolfson
+ *
+ * This program is free software: you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License version 3 as published by the
+ * Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE. See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "allocation_stats.hpp"
+
+#include "class_file.hpp"
+
+#include <cstdio>
+
+using namespace project_rescribo;
+
+namespace {
+
+const char* PHASE_NAMES[AllocationStats::NUM_PHASES] = {
+	"other",
+	"constant pool decode",
+	"attribute decode",
+	"instruction decode",
+	"sync",
+	"write",
+};
+
+const char* TYPE_NAMES[AllocationStats::NUM_TYPES] = {
+	"Attribute",
+	"Instruction",
+	"StackMapFrame",
+	"VariableInfo",
+	"Field",
+	"Method",
+};
+
+void print_counter(const char* name, const AllocationStats::Counter& counter) {
+	uint64_t count = counter.count.load(std::memory_order_relaxed);
+	if (count == 0) {
+		return;
+	}
+	printf("  %-24s %10lu allocations %12lu bytes\n",
+	       name,
+	       static_cast<unsigned long>(count),
+	       static_cast<unsigned long>(
+	               counter.bytes.load(std::memory_order_relaxed)
+	       ));
+}
+
+void reset_counter(AllocationStats::Counter& counter) {
+	counter.count.store(0, std::memory_order_relaxed);
+	counter.bytes.store(0, std::memory_order_relaxed);
+}
+
+void add_counter(AllocationStats::Counter& counter, size_t size) {
+	counter.count.fetch_add(1, std::memory_order_relaxed);
+	counter.bytes.fetch_add(size, std::memory_order_relaxed);
+}
+
+}
+
+void AllocationStats::reset() {
+	for (auto& counter : phases) {
+		reset_counter(counter);
+	}
+	for (auto& counter : types) {
+		reset_counter(counter);
+	}
+	for (auto& counter : instruction_kinds) {
+		reset_counter(counter);
+	}
+}
+
+void AllocationStats::print() const {
+	printf("Allocations by phase:\n");
+	for (size_t i = 0; i < NUM_PHASES; ++i) {
+		print_counter(PHASE_NAMES[i], phases[i]);
+	}
+	printf("Allocations by type:\n");
+	for (size_t i = 0; i < NUM_TYPES; ++i) {
+		print_counter(TYPE_NAMES[i], types[i]);
+	}
+	printf("Allocations by instruction opcode:\n");
+	for (size_t i = 0; i < NUM_INSTRUCTION_KINDS; ++i) {
+		char name[16];
+		snprintf(name, sizeof(name), "0x%02zX", i);
+		print_counter(name, instruction_kinds[i]);
+	}
+}
+
+AllocationStats& AllocationStats::get_global() {
+	static AllocationStats global;
+	return global;
+}
+
+void AllocationStats::add(Phase phase, Type type, size_t size) {
+	add_counter(phases[static_cast<size_t>(phase)], size);
+	add_counter(types[static_cast<size_t>(type)], size);
+}
+
+void AllocationStats::add_instruction(uint8_t kind, size_t size) {
+	add_counter(instruction_kinds[kind], size);
+}
+
+#ifdef PROJECT_RESCRIBO_ALLOCATION_STATS
+
+namespace {
+
+thread_local AllocationStats* current_stats = nullptr;
+thread_local AllocationStats::Phase current_phase
+	= AllocationStats::Phase::Other;
+
+// Set by operator new and consumed by the Instruction constructor, which
+// runs immediately afterwards and is the only place the opcode is known
+thread_local size_t pending_instruction_size = 0;
+
+}
+
+void AllocationStats::record(Type type, size_t size) {
+	get_global().add(current_phase, type, size);
+	if (current_stats) {
+		current_stats->add(current_phase, type, size);
+	}
+	if (type == Type::Instruction) {
+		pending_instruction_size = size;
+	}
+}
+
+void AllocationStats::record_instruction(uint8_t kind) {
+	size_t size = pending_instruction_size;
+	pending_instruction_size = 0;
+	get_global().add_instruction(kind, size);
+	if (current_stats) {
+		current_stats->add_instruction(kind, size);
+	}
+}
+
+AllocationStats::Scope::Scope(const ClassFile* class_file, Phase phase)
+: previous_stats(current_stats), previous_phase(current_phase) {
+	current_stats = class_file->get_allocation_stats();
+	current_phase = phase;
+}
+
+AllocationStats::Scope::~Scope() {
+	current_stats = previous_stats;
+	current_phase = previous_phase;
+}
+
+#endif
@@ -18,6 +18,7 @@
 
 #include "buffer.hpp"
 #include "code.hpp"
+#include "constant_pool_entry.hpp"
 #include "field.hpp"
 #include "method.hpp"
 
@@ -94,6 +95,11 @@ void AnnotationValue::write_buffer(uint8_t** buffer) const {
 	value->write_buffer(buffer);
 }
 
+void AnnotationValue::visit_constant_pool_indices(
+	ConstantPoolIndexVisitor& visitor) {
+	value->visit_constant_pool_indices(visitor);
+}
+
 uint32_t ArrayValue::get_byte_size() const {
 	uint32_t result = 3;
 	for (const auto& v : value) {
@@ -110,22 +116,45 @@ void ArrayValue::write_buffer(uint8_t** buffer) const {
 	}
 }
 
+void ArrayValue::visit_constant_pool_indices(
+	ConstantPoolIndexVisitor& visitor) {
+	for (auto& v : value) {
+		v->visit_constant_pool_indices(visitor);
+	}
+}
+
 void ConstValueIndex::write_buffer(uint8_t** buffer) const {
 	next_u8(buffer, get_tag());
 	next_u16(buffer, index);
 }
 
+void ConstValueIndex::visit_constant_pool_indices(
+	ConstantPoolIndexVisitor& visitor) {
+	visitor.visit(index);
+}
+
 void ClassInfoIndex::write_buffer(uint8_t** buffer) const {
 	next_u8(buffer, get_tag());
 	next_u16(buffer, index);
 }
 
+void ClassInfoIndex::visit_constant_pool_indices(
+	ConstantPoolIndexVisitor& visitor) {
+	visitor.visit(index);
+}
+
 void EnumConstValue::write_buffer(uint8_t** buffer) const {
 	next_u8(buffer, get_tag());
 	next_u16(buffer, type_name_index);
 	next_u16(buffer, value_name_index);
 }
 
+void EnumConstValue::visit_constant_pool_indices(
+	ConstantPoolIndexVisitor& visitor) {
+	visitor.visit(type_name_index);
+	visitor.visit(value_name_index);
+}
+
 ElementValuePair::ElementValuePair(const uint8_t** buffer,
                                    ConstantPool* constant_pool) {
 	name_index = next_u16(buffer);
@@ -143,6 +172,12 @@ void ElementValuePair::write_buffer(uint8_t** buffer) const {
 	value->write_buffer(buffer);
 }
 
+void ElementValuePair::visit_constant_pool_indices(
+	ConstantPoolIndexVisitor& visitor) {
+	visitor.visit(name_index);
+	value->visit_constant_pool_indices(visitor);
+}
+
 ElementValuePairs::ElementValuePairs(const uint8_t** buffer,
                                      ConstantPool* constant_pool) {
 	uint16_t num_element_value_pairs = next_u16(buffer);
@@ -172,6 +207,13 @@ void ElementValuePairs::write_buffer(uint8_t** buffer) const {
 	}
 }
 
+void ElementValuePairs::visit_constant_pool_indices(
+	ConstantPoolIndexVisitor& visitor) {
+	for (auto& p : element_value_pairs) {
+		p->visit_constant_pool_indices(visitor);
+	}
+}
+
 Annotation::Annotation(const uint8_t** buffer, ConstantPool* constant_pool)
 : constant_pool(constant_pool) {
 	type_index = next_u16(buffer);
@@ -193,6 +235,12 @@ void Annotation::write_buffer(uint8_t** buffer) const {
 	element_value_pairs->write_buffer(buffer);
 }
 
+void Annotation::visit_constant_pool_indices(
+	ConstantPoolIndexVisitor& visitor) {
+	visitor.visit(type_index);
+	element_value_pairs->visit_constant_pool_indices(visitor);
+}
+
 TypePath::TypePath(const uint8_t** buffer) {
 	uint8_t path_length = next_u8(buffer);
 	for (int i = 0; i < path_length; ++i) {
@@ -391,3 +439,9 @@ void TypeAnnotation::write_buffer(uint8_t** buffer) const {
 	next_u16(buffer, get_type_index());
 	get_element_value_pairs()->write_buffer(buffer);
 }
+
+void TypeAnnotation::visit_constant_pool_indices(
+	ConstantPoolIndexVisitor& visitor) {
+	visitor.visit(type_index);
+	element_value_pairs->visit_constant_pool_indices(visitor);
+}
@@ -48,6 +48,13 @@ void Annotations::write_buffer(uint8_t** buffer) const {
 	}
 }
 
+void Annotations::visit_constant_pool_indices(
+	ConstantPoolIndexVisitor& visitor) {
+	for (auto& a : annotations) {
+		a->visit_constant_pool_indices(visitor);
+	}
+}
+
 TypeAnnotations::TypeAnnotations(const uint8_t** buffer,
                                  ConstantPool* constant_pool) {
 	uint16_t num_annotations = next_u16(buffer);
@@ -104,3 +111,10 @@ void TypeAnnotations::write_buffer(uint8_t** buffer) const {
 		a->write_buffer(buffer);
 	}
 }
+
+void TypeAnnotations::visit_constant_pool_indices(
+	ConstantPoolIndexVisitor& visitor) {
+	for (auto& a : annotations) {
+		a->visit_constant_pool_indices(visitor);
+	}
+}
@@ -27,91 +27,205 @@
 #include "method.hpp"
 #include "stack_map_table.hpp"
 
+#include <cstring>
+#include <string>
+
 using namespace project_rescribo;
 
+namespace {
+
+struct AttributeName {
+	const char* name;
+	Attribute::Kind kind;
+};
+
+constexpr AttributeName ATTRIBUTE_NAMES[] = {
+	{"ConstantValue", Attribute::Kind::ConstantValue},
+	{"Code", Attribute::Kind::Code},
+	{"StackMapTable", Attribute::Kind::StackMapTable},
+	{"Exceptions", Attribute::Kind::Exceptions},
+	{"InnerClasses", Attribute::Kind::InnerClasses},
+	{"EnclosingMethod", Attribute::Kind::EnclosingMethod},
+	{"Synthetic", Attribute::Kind::Synthetic},
+	{"Signature", Attribute::Kind::Signature},
+	{"SourceFile", Attribute::Kind::SourceFile},
+	{"SourceDebugExtension", Attribute::Kind::SourceDebugExtension},
+	{"LineNumberTable", Attribute::Kind::LineNumberTable},
+	{"LocalVariableTable", Attribute::Kind::LocalVariableTable},
+	{"LocalVariableTypeTable", Attribute::Kind::LocalVariableTypeTable},
+	{"Deprecated", Attribute::Kind::Deprecated},
+	{"RuntimeVisibleAnnotations", Attribute::Kind::RuntimeVisibleAnnotations},
+	{"RuntimeInvisibleAnnotations",
+	 Attribute::Kind::RuntimeInvisibleAnnotations},
+	{"RuntimeVisibleParameterAnnotations",
+	 Attribute::Kind::RuntimeVisibleParameterAnnotations},
+	{"RuntimeInvisibleParameterAnnotations",
+	 Attribute::Kind::RuntimeInvisibleParameterAnnotations},
+	{"RuntimeVisibleTypeAnnotations",
+	 Attribute::Kind::RuntimeVisibleTypeAnnotations},
+	{"RuntimeInvisibleTypeAnnotations",
+	 Attribute::Kind::RuntimeInvisibleTypeAnnotations},
+	{"AnnotationDefault", Attribute::Kind::AnnotationDefault},
+	{"BootstrapMethods", Attribute::Kind::BootstrapMethods},
+	{"MethodParameters", Attribute::Kind::MethodParameters},
+	{"Module", Attribute::Kind::Module},
+	{"ModulePackages", Attribute::Kind::ModulePackages},
+	{"ModuleMainClass", Attribute::Kind::ModuleMainClass},
+	{"NestHost", Attribute::Kind::NestHost},
+	{"NestMembers", Attribute::Kind::NestMembers},
+	{"Scala", Attribute::Kind::Scala},
+	{"ScalaInlineInfo", Attribute::Kind::ScalaInlineInfo},
+	{"ScalaSig", Attribute::Kind::ScalaSig},
+};
+constexpr size_t NUM_ATTRIBUTE_NAMES
+	= sizeof(ATTRIBUTE_NAMES) / sizeof(ATTRIBUTE_NAMES[0]);
+
+// Perfect hash over ATTRIBUTE_NAMES, found by searching small multipliers
+// of the length, first and last byte
+constexpr size_t ATTRIBUTE_HASH_SIZE = 64;
+// Used on both the literal names and the raw Utf8 bytes
+template <typename T>
+constexpr size_t hash_attribute_name(const T* data, size_t length) {
+	return (2 * length
+	        + static_cast<uint8_t>(data[0])
+	        + 19 * static_cast<uint8_t>(data[length - 1]))
+	       % ATTRIBUTE_HASH_SIZE;
+}
+
+struct AttributeHashTable {
+	int8_t slots[ATTRIBUTE_HASH_SIZE];
+	bool collision;
+};
+
+constexpr AttributeHashTable make_attribute_hash_table() {
+	AttributeHashTable table{};
+	for (size_t i = 0; i < ATTRIBUTE_HASH_SIZE; ++i) {
+		table.slots[i] = -1;
+	}
+	for (size_t i = 0; i < NUM_ATTRIBUTE_NAMES; ++i) {
+		const char* name = ATTRIBUTE_NAMES[i].name;
+		size_t slot = hash_attribute_name(
+			name, std::char_traits<char>::length(name)
+		);
+		if (table.slots[slot] != -1) {
+			table.collision = true;
+		}
+		table.slots[slot] = i;
+	}
+	return table;
+}
+
+constexpr AttributeHashTable ATTRIBUTE_HASH_TABLE
+	= make_attribute_hash_table();
+static_assert(!ATTRIBUTE_HASH_TABLE.collision,
+              "Attribute name hash is no longer perfect");
+
+}
+
+Attribute::Kind Attribute::find_kind(const uint8_t* name, uint16_t length) {
+	if (length == 0) {
+		return Kind::Unknown;
+	}
+	int8_t slot = ATTRIBUTE_HASH_TABLE.slots[
+		hash_attribute_name(name, length)
+	];
+	if (slot == -1) {
+		return Kind::Unknown;
+	}
+	const AttributeName& candidate = ATTRIBUTE_NAMES[slot];
+	if (std::char_traits<char>::length(candidate.name) != length
+	    || memcmp(candidate.name, name, length) != 0) {
+		return Kind::Unknown;
+	}
+	return candidate.kind;
+}
+
 std::unique_ptr<Attribute>
 Attribute::make(const uint8_t** buffer, ClassFile* class_file) {
 	uint16_t attribute_name_index = next_u16(buffer);
 	uint32_t attribute_length = next_u32(buffer);
 
 	ConstantPool* constant_pool = class_file->get_constant_pool();
-	auto name_entry = constant_pool->get_entry(attribute_name_index);
-	ConstantPoolUtf8* name = cast<ConstantPoolUtf8>(name_entry);
+	ConstantPoolUtf8 name = constant_pool->get_utf8(attribute_name_index);
 
+	AllocationStats::Scope allocation_scope(
+		class_file, AllocationStats::Phase::AttributeDecode
+	);
 	const uint8_t* attribute_start = *buffer;
 	std::unique_ptr<Attribute> attribute;
-	if (name->equals("BootstrapMethods")) {
+	switch (constant_pool->get_attribute_kind(attribute_name_index)) {
+	case Kind::BootstrapMethods:
 		attribute = std::make_unique<BootstrapMethods>(
 			buffer, attribute_name_index, class_file
 		);
-	}
-	else if (name->equals("Deprecated")) {
+		break;
+	case Kind::Deprecated:
 		attribute = std::make_unique<Deprecated>(buffer,
 		                                         attribute_name_index);
-	}
-	else if (name->equals("EnclosingMethod")) {
+		break;
+	case Kind::EnclosingMethod:
 		attribute = std::make_unique<EnclosingMethod>(
 			buffer, attribute_name_index, class_file
 		);
-	}
-	else if (name->equals("InnerClasses")) {
+		break;
+	case Kind::InnerClasses:
 		attribute = std::make_unique<InnerClasses>(buffer,
 		                                           attribute_name_index,
 		                                           class_file);
-	}
-	else if (name->equals("NestHost")) {
+		break;
+	case Kind::NestHost:
 		attribute = std::make_unique<NestHost>(
 			buffer, attribute_name_index, class_file
 		);
-	}
-	else if (name->equals("NestMembers")) {
+		break;
+	case Kind::NestMembers:
 		attribute = std::make_unique<NestMembers>(
 			buffer, attribute_name_index, class_file
 		);
-	}
-	else if (name->equals("RuntimeInvisibleAnnotations")) {
+		break;
+	case Kind::RuntimeInvisibleAnnotations:
 		attribute = std::make_unique<RuntimeInvisibleAnnotations>(
 			buffer,
 			attribute_name_index,
 			constant_pool
 		);
-	}
-	else if (name->equals("RuntimeVisibleAnnotations")) {
+		break;
+	case Kind::RuntimeVisibleAnnotations:
 		attribute = std::make_unique<RuntimeVisibleAnnotations>(
 			buffer,
 			attribute_name_index,
 			constant_pool
 		);
-	}
-	else if (name->equals("Signature")) {
+		break;
+	case Kind::Signature:
 		attribute = std::make_unique<Signature>(buffer,
 		                                        attribute_name_index);
-	}
-	else if (name->equals("SourceFile")) {
+		break;
+	case Kind::SourceFile:
 		attribute = std::make_unique<SourceFile>(buffer,
 		                                         attribute_name_index);
-	}
-	else if (name->equals("Synthetic")) {
+		break;
+	case Kind::Synthetic:
 		attribute = std::make_unique<Synthetic>(buffer,
 		                                        attribute_name_index);
-	}
-	else if (name->equals("Scala")) {
+		break;
+	case Kind::Scala:
 		attribute = std::make_unique<Scala>(
 			buffer, attribute_name_index
 		);
-	}
-	else if (name->equals("ScalaInlineInfo")) {
+		break;
+	case Kind::ScalaInlineInfo:
 		attribute = std::make_unique<ScalaInlineInfo>(
 			buffer, attribute_name_index, class_file
 		);
-	}
-	else if (name->equals("ScalaSig")) {
+		break;
+	case Kind::ScalaSig:
 		attribute = std::make_unique<ScalaSig>(
 			buffer, attribute_name_index, class_file
 		);
-	}
-	else {
-		name->print();
+		break;
+	default:
+		name.print();
 		assert(false && "Unexpected class file attribute");
 	}
 
@@ -130,52 +244,55 @@ Attribute::make(const uint8_t** buffer, Field* field) {
 
 	ClassFile* class_file = field->get_class_file();
 	ConstantPool* constant_pool = class_file->get_constant_pool();
-	auto name_entry = constant_pool->get_entry(attribute_name_index);
-	ConstantPoolUtf8* name = cast<ConstantPoolUtf8>(name_entry);
+	ConstantPoolUtf8 name = constant_pool->get_utf8(attribute_name_index);
 
+	AllocationStats::Scope allocation_scope(
+		class_file, AllocationStats::Phase::AttributeDecode
+	);
 	const uint8_t* attribute_start = *buffer;
 	std::unique_ptr<Attribute> attribute;
-	if (name->equals("ConstantValue")) {
+	switch (constant_pool->get_attribute_kind(attribute_name_index)) {
+	case Kind::ConstantValue:
 		attribute = std::make_unique<ConstantValue>(
 			buffer,
 			attribute_name_index
 		);
-	}
-	else if (name->equals("Deprecated")) {
+		break;
+	case Kind::Deprecated:
 		attribute = std::make_unique<Deprecated>(buffer,
 		                                         attribute_name_index);
-	}
-	else if (name->equals("RuntimeInvisibleAnnotations")) {
+		break;
+	case Kind::RuntimeInvisibleAnnotations:
 		attribute = std::make_unique<RuntimeInvisibleAnnotations>(
 			buffer,
 			attribute_name_index,
 			constant_pool
 		);
-	}
-	else if (name->equals("RuntimeVisibleAnnotations")) {
+		break;
+	case Kind::RuntimeVisibleAnnotations:
 		attribute = std::make_unique<RuntimeVisibleAnnotations>(
 			buffer,
 			attribute_name_index,
 			field->get_constant_pool()
 		);
-	}
-	else if (name->equals("RuntimeVisibleTypeAnnotations")) {
+		break;
+	case Kind::RuntimeVisibleTypeAnnotations:
 		attribute = std::make_unique<RuntimeVisibleTypeAnnotations>(
 			buffer,
 			attribute_name_index,
 			field
 		);
-	}
-	else if (name->equals("Signature")) {
+		break;
+	case Kind::Signature:
 		attribute = std::make_unique<Signature>(buffer,
 		                                        attribute_name_index);
-	}
-	else if (name->equals("Synthetic")) {
+		break;
+	case Kind::Synthetic:
 		attribute = std::make_unique<Synthetic>(buffer,
 		                                        attribute_name_index);
-	}
-	else {
-		name->print();
+		break;
+	default:
+		name.print();
 		assert(false && "Unexpected field attribute");
 	}
 
@@ -193,88 +310,90 @@ Attribute::make(const uint8_t** buffer, Method* method) {
 
 	ClassFile* class_file = method->get_class_file();
 	ConstantPool* constant_pool = class_file->get_constant_pool();
-	auto name_entry = constant_pool->get_entry(attribute_name_index);
-	ConstantPoolUtf8* name = cast<ConstantPoolUtf8>(name_entry);
+	ConstantPoolUtf8 name = constant_pool->get_utf8(attribute_name_index);
 
+	AllocationStats::Scope allocation_scope(
+		class_file, AllocationStats::Phase::AttributeDecode
+	);
 	const uint8_t* attribute_start = *buffer;
 	std::unique_ptr<Attribute> attribute;
-	if (name->equals("AnnotationDefault")) {
+	switch (constant_pool->get_attribute_kind(attribute_name_index)) {
+	case Kind::AnnotationDefault:
 		attribute = std::make_unique<AnnotationDefault>(
 			buffer, attribute_name_index, method
 		);
-	}
-	else if (name->equals("Code")) {
+		break;
+	case Kind::Code:
 		attribute = std::make_unique<Code>(buffer,
 		                                   attribute_name_index,
 		                                   method);
-
-	}
-	else if (name->equals("Deprecated")) {
+		break;
+	case Kind::Deprecated:
 		attribute = std::make_unique<Deprecated>(buffer,
 		                                         attribute_name_index);
-	}
-	else if (name->equals("Exceptions")) {
+		break;
+	case Kind::Exceptions:
 		attribute = std::make_unique<Exceptions>(
 			buffer, attribute_name_index, method
 		);
-	}
-	else if (name->equals("MethodParameters")) {
+		break;
+	case Kind::MethodParameters:
 		attribute = std::make_unique<MethodParameters>(
 			buffer, attribute_name_index, method
 		);
-	}
-	else if (name->equals("RuntimeInvisibleAnnotations")) {
+		break;
+	case Kind::RuntimeInvisibleAnnotations:
 		attribute = std::make_unique<RuntimeInvisibleAnnotations>(
 			buffer,
 			attribute_name_index,
 			constant_pool
 		);
-	}
-	else if (name->equals("RuntimeInvisibleParameterAnnotations")) {
+		break;
+	case Kind::RuntimeInvisibleParameterAnnotations:
 		attribute
 		= std::make_unique<RuntimeInvisibleParameterAnnotations>(
 			buffer,
 			attribute_name_index,
 			constant_pool
 		);
-	}
-	else if (name->equals("RuntimeVisibleAnnotations")) {
+		break;
+	case Kind::RuntimeVisibleAnnotations:
 		attribute = std::make_unique<RuntimeVisibleAnnotations>(
 			buffer,
 			attribute_name_index,
 			constant_pool
 		);
-	}
-	else if (name->equals("RuntimeVisibleTypeAnnotations")) {
+		break;
+	case Kind::RuntimeVisibleTypeAnnotations:
 		attribute = std::make_unique<RuntimeVisibleTypeAnnotations>(
 			buffer,
 			attribute_name_index,
 			method
 		);
-	}
-	else if (name->equals("RuntimeVisibleParameterAnnotations")) {
+		break;
+	case Kind::RuntimeVisibleParameterAnnotations:
 		attribute
 		= std::make_unique<RuntimeVisibleParameterAnnotations>(
 			buffer,
 			attribute_name_index,
 			constant_pool
 		);
-	}
-	else if (name->equals("Signature")) {
+		break;
+	case Kind::Signature:
 		attribute = std::make_unique<Signature>(buffer,
 		                                        attribute_name_index);
-	}
-	else if (name->equals("Synthetic")) {
+		break;
+	case Kind::Synthetic:
 		attribute = std::make_unique<Synthetic>(buffer,
 		                                        attribute_name_index);
-	}
-	else {
-		name->print();
+		break;
+	default:
+		name.print();
 		assert(false && "Unexpected method attribute");
 	}
 
 	if (attribute_length != (attribute->get_byte_size() - 6)) {
-		name->print();
+		name.print();
 	}
 
 	assert(attribute_length == (attribute->get_byte_size() - 6));
@@ -292,40 +411,43 @@ Attribute::make(const uint8_t** buffer, Code* code) {
 	Method* method = code->get_method();
 	ClassFile* class_file = method->get_class_file();
 	ConstantPool* constant_pool = class_file->get_constant_pool();
-	auto name_entry = constant_pool->get_entry(attribute_name_index);
-	ConstantPoolUtf8* name = cast<ConstantPoolUtf8>(name_entry);
+	ConstantPoolUtf8 name = constant_pool->get_utf8(attribute_name_index);
 
+	AllocationStats::Scope allocation_scope(
+		class_file, AllocationStats::Phase::AttributeDecode
+	);
 	const uint8_t* attribute_start = *buffer;
 	std::unique_ptr<Attribute> attribute;
-	if (name->equals("LineNumberTable")) {
+	switch (constant_pool->get_attribute_kind(attribute_name_index)) {
+	case Kind::LineNumberTable:
 		attribute = std::make_unique<LineNumberTable>(
 			buffer, attribute_name_index, code
 		);
-	}
-	else if (name->equals("LocalVariableTable")) {
+		break;
+	case Kind::LocalVariableTable:
 		attribute = std::make_unique<LocalVariableTable>(
 			buffer, attribute_name_index, code
 		);
-	}
-	else if (name->equals("LocalVariableTypeTable")) {
+		break;
+	case Kind::LocalVariableTypeTable:
 		attribute = std::make_unique<LocalVariableTypeTable>(
 			buffer, attribute_name_index, code
 		);
-	}
-	else if (name->equals("RuntimeVisibleTypeAnnotations")) {
+		break;
+	case Kind::RuntimeVisibleTypeAnnotations:
 		attribute = std::make_unique<RuntimeVisibleTypeAnnotations>(
 			buffer,
 			attribute_name_index,
 			code
 		);
-	}
-	else if (name->equals("StackMapTable")) {
+		break;
+	case Kind::StackMapTable:
 		attribute = std::make_unique<StackMapTable>(
 			buffer, attribute_name_index, code
 		);
-	}
-	else {
-		name->print();
+		break;
+	default:
+		name.print();
 		assert(false && "Unexpected code attribute");
 	}
 
@@ -338,6 +460,10 @@ Attribute::make(const uint8_t** buffer, Code* code) {
 
 Attribute::~Attribute() = default;
 
+void Attribute::visit_constant_pool_indices(ConstantPoolIndexVisitor& visitor) {
+	visitor.visit(attribute_name_index);
+}
+
 AnnotationDefault::AnnotationDefault(
 	const uint8_t** buffer,
 	uint16_t attribute_name_index,
@@ -358,6 +484,12 @@ void AnnotationDefault::write_buffer(uint8_t** buffer) const {
 	default_value->write_buffer(buffer);
 }
 
+void AnnotationDefault::visit_constant_pool_indices(
+	ConstantPoolIndexVisitor& visitor) {
+	Attribute::visit_constant_pool_indices(visitor);
+	default_value->visit_constant_pool_indices(visitor);
+}
+
 BootstrapMethods::BootstrapMethods(const uint8_t** buffer,
                                    uint16_t attribute_name_index,
                                    ClassFile* class_file)
@@ -391,6 +523,17 @@ void BootstrapMethods::write_buffer(uint8_t** buffer) const {
 	}
 }
 
+void BootstrapMethods::visit_constant_pool_indices(
+	ConstantPoolIndexVisitor& visitor) {
+	Attribute::visit_constant_pool_indices(visitor);
+	for (auto& entry : bootstrap_methods) {
+		visitor.visit(entry.bootstrap_method_ref);
+		for (auto& argument : entry.bootstrap_arguments) {
+			visitor.visit(argument);
+		}
+	}
+}
+
 ConstantValue::ConstantValue(const uint8_t** buffer,
                              uint16_t attribute_name_index)
 : Attribute(Kind::ConstantValue, attribute_name_index) {
@@ -403,6 +546,12 @@ void ConstantValue::write_buffer(uint8_t** buffer) const {
 	next_u16(buffer, index);
 }
 
+void ConstantValue::visit_constant_pool_indices(
+	ConstantPoolIndexVisitor& visitor) {
+	Attribute::visit_constant_pool_indices(visitor);
+	visitor.visit(index);
+}
+
 Deprecated::Deprecated(const uint8_t** buffer,
                        uint16_t attribute_name_index)
 : Attribute(Kind::Deprecated, attribute_name_index) {
@@ -429,6 +578,13 @@ void EnclosingMethod::write_buffer(uint8_t** buffer) const {
 	next_u16(buffer, method_index);
 }
 
+void EnclosingMethod::visit_constant_pool_indices(
+	ConstantPoolIndexVisitor& visitor) {
+	Attribute::visit_constant_pool_indices(visitor);
+	visitor.visit(class_index);
+	visitor.visit(method_index);
+}
+
 InnerClasses::InnerClasses(const uint8_t** buffer,
                            uint16_t attribute_name_index,
                            ClassFile* class_file)
@@ -460,6 +616,16 @@ void InnerClasses::write_buffer(uint8_t** buffer) const {
 	}
 }
 
+void InnerClasses::visit_constant_pool_indices(
+	ConstantPoolIndexVisitor& visitor) {
+	Attribute::visit_constant_pool_indices(visitor);
+	for (auto& entry : classes) {
+		visitor.visit(entry.inner_class_info_index);
+		visitor.visit(entry.outer_class_info_index);
+		visitor.visit(entry.inner_name_index);
+	}
+}
+
 Exceptions::Exceptions(const uint8_t** buffer,
                        uint16_t attribute_name_index,
                        Method* method)
@@ -479,6 +645,14 @@ void Exceptions::write_buffer(uint8_t** buffer) const {
 	}
 }
 
+void Exceptions::visit_constant_pool_indices(
+	ConstantPoolIndexVisitor& visitor) {
+	Attribute::visit_constant_pool_indices(visitor);
+	for (auto& index : exception_index_table) {
+		visitor.visit(index);
+	}
+}
+
 LineNumberTable::LineNumberTable(const uint8_t** buffer,
                                  uint16_t attribute_name_index,
                                  Code* code)
@@ -528,6 +702,18 @@ LocalVariableTable::LocalVariableTable(const uint8_t** buffer,
 	}
 }
 
+void LocalVariableTable::replace_bound(Instruction* old_bound,
+                                       Instruction* new_bound) {
+	for (auto& entry : local_variable_table) {
+		if (entry.start == old_bound) {
+			entry.start = new_bound;
+		}
+		if (entry.end == old_bound) {
+			entry.end = new_bound;
+		}
+	}
+}
+
 void LocalVariableTable::write_buffer(uint8_t** buffer) const {
 	next_u16(buffer, get_attribute_name_index());
 	next_u32(buffer, 2 + 10 * local_variable_table.size());
@@ -548,6 +734,15 @@ void LocalVariableTable::write_buffer(uint8_t** buffer) const {
 	}
 }
 
+void LocalVariableTable::visit_constant_pool_indices(
+	ConstantPoolIndexVisitor& visitor) {
+	Attribute::visit_constant_pool_indices(visitor);
+	for (auto& entry : local_variable_table) {
+		visitor.visit(entry.name_index);
+		visitor.visit(entry.descriptor_index);
+	}
+}
+
 LocalVariableTypeTable::LocalVariableTypeTable(const uint8_t** buffer,
                                                uint16_t attribute_name_index,
                                                Code* code)
@@ -574,6 +769,18 @@ LocalVariableTypeTable::LocalVariableTypeTable(const uint8_t** buffer,
 	}
 }
 
+void LocalVariableTypeTable::replace_bound(Instruction* old_bound,
+                                           Instruction* new_bound) {
+	for (auto& entry : local_variable_type_table) {
+		if (entry.start == old_bound) {
+			entry.start = new_bound;
+		}
+		if (entry.end == old_bound) {
+			entry.end = new_bound;
+		}
+	}
+}
+
 void LocalVariableTypeTable::write_buffer(uint8_t** buffer) const {
 	next_u16(buffer, get_attribute_name_index());
 	next_u32(buffer, 2 + 10 * local_variable_type_table.size());
@@ -594,6 +801,15 @@ void LocalVariableTypeTable::write_buffer(uint8_t** buffer) const {
 	}
 }
 
+void LocalVariableTypeTable::visit_constant_pool_indices(
+	ConstantPoolIndexVisitor& visitor) {
+	Attribute::visit_constant_pool_indices(visitor);
+	for (auto& entry : local_variable_type_table) {
+		visitor.visit(entry.name_index);
+		visitor.visit(entry.signature_index);
+	}
+}
+
 NestHost::NestHost(const uint8_t** buffer,
                    uint16_t attribute_name_index,
                    ClassFile* class_file)
@@ -607,6 +823,12 @@ void NestHost::write_buffer(uint8_t** buffer) const {
 	next_u16(buffer, host_class_index);
 }
 
+void NestHost::visit_constant_pool_indices(
+	ConstantPoolIndexVisitor& visitor) {
+	Attribute::visit_constant_pool_indices(visitor);
+	visitor.visit(host_class_index);
+}
+
 MethodParameters::MethodParameters(const uint8_t** buffer,
                                    uint16_t attribute_name_index,
                                    Method* method)
@@ -628,6 +850,14 @@ void MethodParameters::write_buffer(uint8_t** buffer) const {
 	}
 }
 
+void MethodParameters::visit_constant_pool_indices(
+	ConstantPoolIndexVisitor& visitor) {
+	Attribute::visit_constant_pool_indices(visitor);
+	for (auto& parameter : parameters) {
+		visitor.visit(parameter.name_index);
+	}
+}
+
 NestMembers::NestMembers(const uint8_t** buffer,
                          uint16_t attribute_name_index,
                          ClassFile* class_file)
@@ -647,6 +877,14 @@ void NestMembers::write_buffer(uint8_t** buffer) const {
 	}
 }
 
+void NestMembers::visit_constant_pool_indices(
+	ConstantPoolIndexVisitor& visitor) {
+	Attribute::visit_constant_pool_indices(visitor);
+	for (auto& index : classes) {
+		visitor.visit(index);
+	}
+}
+
 RuntimeInvisibleAnnotations::RuntimeInvisibleAnnotations(
 	const uint8_t** buffer,
 	uint16_t attribute_name_index,
@@ -668,6 +906,12 @@ void RuntimeInvisibleAnnotations::write_buffer(uint8_t** buffer) const {
 	annotations->write_buffer(buffer);
 }
 
+void RuntimeInvisibleAnnotations::visit_constant_pool_indices(
+	ConstantPoolIndexVisitor& visitor) {
+	Attribute::visit_constant_pool_indices(visitor);
+	annotations->visit_constant_pool_indices(visitor);
+}
+
 RuntimeInvisibleParameterAnnotations::RuntimeInvisibleParameterAnnotations(
 	const uint8_t** buffer,
 	uint16_t attribute_name_index,
@@ -699,6 +943,14 @@ RuntimeInvisibleParameterAnnotations::write_buffer(uint8_t** buffer) const {
 	}
 }
 
+void RuntimeInvisibleParameterAnnotations::visit_constant_pool_indices(
+	ConstantPoolIndexVisitor& visitor) {
+	Attribute::visit_constant_pool_indices(visitor);
+	for (auto& annotations : parameter_annotations) {
+		annotations->visit_constant_pool_indices(visitor);
+	}
+}
+
 RuntimeVisibleAnnotations::RuntimeVisibleAnnotations(
 	const uint8_t** buffer,
 	uint16_t attribute_name_index,
@@ -720,6 +972,12 @@ void RuntimeVisibleAnnotations::write_buffer(uint8_t** buffer) const {
 	annotations->write_buffer(buffer);
 }
 
+void RuntimeVisibleAnnotations::visit_constant_pool_indices(
+	ConstantPoolIndexVisitor& visitor) {
+	Attribute::visit_constant_pool_indices(visitor);
+	annotations->visit_constant_pool_indices(visitor);
+}
+
 RuntimeVisibleParameterAnnotations::RuntimeVisibleParameterAnnotations(
 	const uint8_t** buffer,
 	uint16_t attribute_name_index,
@@ -750,6 +1008,14 @@ void RuntimeVisibleParameterAnnotations::write_buffer(uint8_t** buffer) const {
 	}
 }
 
+void RuntimeVisibleParameterAnnotations::visit_constant_pool_indices(
+	ConstantPoolIndexVisitor& visitor) {
+	Attribute::visit_constant_pool_indices(visitor);
+	for (auto& annotations : parameter_annotations) {
+		annotations->visit_constant_pool_indices(visitor);
+	}
+}
+
 RuntimeVisibleTypeAnnotations::RuntimeVisibleTypeAnnotations(
 	const uint8_t** buffer,
 	uint16_t attribute_name_index,
@@ -798,6 +1064,12 @@ void RuntimeVisibleTypeAnnotations::write_buffer(uint8_t** buffer) const {
 	annotations->write_buffer(buffer);
 }
 
+void RuntimeVisibleTypeAnnotations::visit_constant_pool_indices(
+	ConstantPoolIndexVisitor& visitor) {
+	Attribute::visit_constant_pool_indices(visitor);
+	annotations->visit_constant_pool_indices(visitor);
+}
+
 Signature::Signature(const uint8_t** buffer, uint16_t attribute_name_index)
 : Attribute(Kind::Signature, attribute_name_index) {
 	signature_index = next_u16(buffer);
@@ -809,6 +1081,12 @@ void Signature::write_buffer(uint8_t** buffer) const {
 	next_u16(buffer, signature_index);
 }
 
+void Signature::visit_constant_pool_indices(
+	ConstantPoolIndexVisitor& visitor) {
+	Attribute::visit_constant_pool_indices(visitor);
+	visitor.visit(signature_index);
+}
+
 SourceFile::SourceFile(const uint8_t** buffer, uint16_t attribute_name_index)
 : Attribute(Kind::SourceFile, attribute_name_index) {
 	sourcefile_index = next_u16(buffer);
@@ -820,6 +1098,12 @@ void SourceFile::write_buffer(uint8_t** buffer) const {
 	next_u16(buffer, sourcefile_index);
 }
 
+void SourceFile::visit_constant_pool_indices(
+	ConstantPoolIndexVisitor& visitor) {
+	Attribute::visit_constant_pool_indices(visitor);
+	visitor.visit(sourcefile_index);
+}
+
 Synthetic::Synthetic(const uint8_t** buffer, uint16_t attribute_name_index)
 : Attribute(Kind::Synthetic, attribute_name_index) {
 }
@@ -881,6 +1165,19 @@ void ScalaInlineInfo::write_buffer(uint8_t** buffer) const {
 	}
 }
 
+void ScalaInlineInfo::visit_constant_pool_indices(
+	ConstantPoolIndexVisitor& visitor) {
+	Attribute::visit_constant_pool_indices(visitor);
+	if (flags & 0x04) {
+		visitor.visit(sam_name_index);
+		visitor.visit(sam_descriptor_index);
+	}
+	for (auto& entry : entries) {
+		visitor.visit(entry.name_index);
+		visitor.visit(entry.descriptor_index);
+	}
+}
+
 ScalaSig::ScalaSig(const uint8_t** buffer,
                    uint16_t attribute_name_index,
                    ClassFile* class_file)
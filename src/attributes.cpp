@@ -70,3 +70,10 @@ void Attributes::write_buffer(uint8_t** buffer) const {
 		attribute->write_buffer(buffer);
 	}
 }
+
+void Attributes::visit_constant_pool_indices(
+	ConstantPoolIndexVisitor& visitor) {
+	for (auto& attribute : attributes) {
+		attribute->visit_constant_pool_indices(visitor);
+	}
+}
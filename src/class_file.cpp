@@ -25,20 +25,84 @@
 #include "method.hpp"
 #include "methods.hpp"
 #include "interfaces.hpp"
+#include "segmented_output.hpp"
 
 #include <cassert>
 
 using namespace project_rescribo;
 
+namespace {
+
+// Marks an entry the first time it's seen, along with the entries it uses
+class ConstantPoolMarker : public ConstantPoolIndexVisitor {
+public:
+	ConstantPoolMarker(ConstantPool* constant_pool)
+	: constant_pool(constant_pool), used(constant_pool->get_size() + 1) {}
+
+	void visit(uint16_t& index) override {
+		if (index == 0 || used[index]) {
+			return;
+		}
+		used[index] = true;
+		constant_pool->visit_constant_pool_indices(index, *this);
+	}
+
+	const std::vector<bool>& get_used() const {
+		return used;
+	}
+private:
+	ConstantPool* constant_pool;
+	std::vector<bool> used;
+};
+
+class ConstantPoolRemapper : public ConstantPoolIndexVisitor {
+public:
+	ConstantPoolRemapper(std::vector<uint16_t> new_indices)
+	: new_indices(std::move(new_indices)) {}
+
+	void visit(uint16_t& index) override {
+		if (index == 0) {
+			return;
+		}
+		assert(new_indices[index] != 0);
+		index = new_indices[index];
+	}
+private:
+	std::vector<uint16_t> new_indices;
+};
+
+}
+
 // https://docs.oracle.com/javase/specs/jvms/se11/html/jvms-4.html
-ClassFile::ClassFile(const uint8_t** buffer) {
-	assert(next_u32(buffer) == 0xCAFEBABE); // magic
+ClassFile::ClassFile(const uint8_t** buffer, uint32_t num_threads)
+: input(*buffer), remapped(false) {
+	TransformStats::Timer timer(&transform_stats,
+	                            TransformStats::Phase::Parse);
+	const uint8_t* start = *buffer;
+
+	if (AllocationStats::is_enabled()) {
+		allocation_stats = std::make_unique<AllocationStats>();
+	}
+	AllocationStats::Scope allocation_scope(this,
+	                                        AllocationStats::Phase::Other);
+
+	uint32_t magic = next_u32(buffer);
+	assert(magic == 0xCAFEBABE);
+	(void) magic;
 	minor_version = next_u16(buffer);
 	major_version = next_u16(buffer);
 
 	uint16_t constant_pool_count = next_u16(buffer);
-	constant_pool = std::make_unique<ConstantPool>(buffer,
-	                                               constant_pool_count);
+	{
+		AllocationStats::Scope constant_pool_scope(
+			this, AllocationStats::Phase::ConstantPoolDecode
+		);
+		constant_pool = std::make_unique<ConstantPool>(
+			buffer, constant_pool_count
+		);
+	}
+	transform_stats.set_input_constant_pool_size(constant_pool->get_size());
+	constant_pool_input_size = *buffer - start;
 
 	access = Access(next_u16(buffer));
 	this_class = next_u16(buffer);
@@ -47,19 +111,27 @@ ClassFile::ClassFile(const uint8_t** buffer) {
 	interfaces = std::make_unique<Interfaces>(buffer,
 						  this);
 
+	fields_input = *buffer;
 	uint16_t fields_count = next_u16(buffer);
 	fields = std::make_unique<Fields>(buffer, fields_count, this);
+	fields_input_size = *buffer - fields_input;
+	input_fields_count = fields_count;
 
 	uint16_t methods_count = next_u16(buffer);
-	methods = std::make_unique<Methods>(buffer, methods_count, this);
+	methods = std::make_unique<Methods>(buffer, methods_count, this,
+	                                    num_threads);
 
 	uint16_t attributes_count = next_u16(buffer);
 	attributes = std::make_unique<Attributes>(buffer,
 	                                          attributes_count,
 	                                          this);
+
+	transform_stats.set_input_size(*buffer - start);
 }
 
-ClassFile::~ClassFile() = default;
+ClassFile::~ClassFile() {
+	TransformStatsAggregator::get_global().add(transform_stats);
+}
 
 uint32_t ClassFile::get_byte_size() {
 	uint32_t result = 0;
@@ -84,6 +156,11 @@ uint32_t ClassFile::get_byte_size() {
 }
 
 void ClassFile::write_buffer(uint8_t** buffer) {
+	AllocationStats::Scope allocation_scope(this,
+	                                        AllocationStats::Phase::Write);
+	transform_stats.start_write();
+	TransformStats::Timer timer(&transform_stats,
+	                            TransformStats::Phase::Write);
 	uint8_t* start = *buffer;
 
 	uint32_t magic_number = 0xCAFEBABE;
@@ -103,5 +180,96 @@ void ClassFile::write_buffer(uint8_t** buffer) {
 	methods->write_buffer(buffer);
 	attributes->write_buffer(buffer);
 
+	transform_stats.set_output_size(*buffer - start);
+	transform_stats.set_output_constant_pool_size(constant_pool->get_size());
 	*buffer = start;
 }
+
+void ClassFile::write_segments(SegmentedOutput* output) {
+	AllocationStats::Scope allocation_scope(this,
+	                                        AllocationStats::Phase::Write);
+	transform_stats.start_write();
+	TransformStats::Timer timer(&transform_stats,
+	                            TransformStats::Phase::Write);
+	uint32_t start_size = output->get_byte_size();
+
+	if (constant_pool->is_modified()) {
+		uint8_t* buffer = output->add_output(
+			10 + constant_pool->get_byte_size()
+		);
+		next_u32(&buffer, 0xCAFEBABE);
+		next_u16(&buffer, minor_version);
+		next_u16(&buffer, major_version);
+		constant_pool->write_buffer(&buffer);
+	}
+	else {
+		output->add_input(input, constant_pool_input_size);
+	}
+
+	uint8_t* buffer = output->add_output(6 + interfaces->get_byte_size());
+	next_u16(&buffer, access.get_flags());
+	next_u16(&buffer, this_class);
+	next_u16(&buffer, super_class);
+	interfaces->write_buffer(&buffer);
+
+	if (!remapped && fields->get().size() == input_fields_count) {
+		output->add_input(fields_input, fields_input_size);
+	}
+	else {
+		buffer = output->add_output(fields->get_byte_size());
+		fields->write_buffer(&buffer);
+	}
+
+	buffer = output->add_output(2);
+	next_u16(&buffer, methods->get().size());
+	for (const auto& method : methods->get()) {
+		if (remapped || !method->is_unchanged()) {
+			buffer = output->add_output(method->get_byte_size());
+			method->write_buffer(&buffer);
+			continue;
+		}
+		output->add_input(method->get_input(),
+		                  method->get_input_size());
+		if (Code* code = method->get_code()) {
+			transform_stats.add_output_instructions(
+				code->get_instructions().size()
+			);
+		}
+	}
+
+	buffer = output->add_output(2 + attributes->get_byte_size());
+	attributes->write_buffer(&buffer);
+	output->finish();
+
+	transform_stats.set_output_size(output->get_byte_size() - start_size);
+	transform_stats.set_output_constant_pool_size(constant_pool->get_size());
+}
+
+void ClassFile::visit_constant_pool_indices(ConstantPoolIndexVisitor& visitor) {
+	visitor.visit(this_class);
+	visitor.visit(super_class);
+	interfaces->visit_constant_pool_indices(visitor);
+	fields->visit_constant_pool_indices(visitor);
+	methods->visit_constant_pool_indices(visitor);
+	attributes->visit_constant_pool_indices(visitor);
+}
+
+uint32_t ClassFile::compact_constant_pool() {
+	uint32_t original_size = constant_pool->get_byte_size();
+
+	ConstantPoolMarker marker(constant_pool.get());
+	visit_constant_pool_indices(marker);
+
+	std::vector<uint16_t> new_indices
+		= constant_pool->remove_unused(marker.get_used());
+	for (uint32_t index = 0; index < new_indices.size(); ++index) {
+		if (new_indices[index] != 0 && new_indices[index] != index) {
+			remapped = true;
+		}
+	}
+	ConstantPoolRemapper remapper(std::move(new_indices));
+	visit_constant_pool_indices(remapper);
+	constant_pool->visit_constant_pool_indices(remapper);
+
+	return original_size - constant_pool->get_byte_size();
+}
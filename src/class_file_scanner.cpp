@@ -0,0 +1,227 @@
+/*
+ * Copyright 2019-2020 Jonathan Eyolfson
+ *
+ * This program is free software: you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License version 3 as published by the
+ * Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE. See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "class_file_scanner.hpp"
+
+#include "buffer.hpp"
+#include "constant_pool_entry.hpp"
+
+#include <cstring>
+
+using namespace project_rescribo;
+
+namespace {
+
+typedef ConstantPoolEntry::Kind Kind;
+
+// Bytes after the tag, a Utf8 adds its length, 0 for tags that don't exist
+constexpr uint8_t OPERAND_SIZES[] = {
+	0, // None
+	2, // Utf8
+	0,
+	4, // Integer
+	4, // Float
+	8, // Long
+	8, // Double
+	2, // Class
+	2, // String
+	4, // Fieldref
+	4, // Methodref
+	4, // InterfaceMethodref
+	4, // NameAndType
+	0,
+	0,
+	3, // MethodHandle
+	2, // MethodType
+	4, // Dynamic
+	4, // InvokeDynamic
+};
+constexpr size_t NUM_TAGS = sizeof(OPERAND_SIZES);
+
+}
+
+// https://docs.oracle.com/javase/specs/jvms/se11/html/jvms-4.html
+bool ClassFileScanner::scan(const uint8_t* data, uint32_t size) {
+	this->data = data;
+	this->size = size;
+	constant_pool_offsets.clear();
+	fields.clear();
+	methods.clear();
+	attributes.clear();
+
+	if (size < 10
+	    || convert_big_endian_to_host_u32(data) != 0xCAFEBABE) {
+		return false;
+	}
+	uint32_t offset = 8; // magic, minor_version, major_version
+	if (!scan_constant_pool(&offset)) {
+		return false;
+	}
+
+	if (size - offset < 8) {
+		return false;
+	}
+	access_flags = convert_big_endian_to_host_u16(data + offset);
+	this_class = convert_big_endian_to_host_u16(data + offset + 2);
+	super_class = convert_big_endian_to_host_u16(data + offset + 4);
+	uint16_t interfaces_count
+		= convert_big_endian_to_host_u16(data + offset + 6);
+	offset += 8;
+	interfaces = {offset, 2u * interfaces_count};
+	if (size - offset < interfaces.size) {
+		return false;
+	}
+	offset += interfaces.size;
+
+	if (!scan_members(&offset, &fields, false)
+	    || !scan_members(&offset, &methods, true)) {
+		return false;
+	}
+	first_class_attribute = attributes.size();
+	uint16_t num_class_attributes;
+	return scan_attributes(&offset, &num_class_attributes)
+	       && offset == size;
+}
+
+bool ClassFileScanner::is_utf8(uint16_t index, const char* value) const {
+	if (index == 0 || index >= constant_pool_offsets.size()) {
+		return false;
+	}
+	const uint8_t* entry = data + constant_pool_offsets[index];
+	if (Kind(entry[0]) != Kind::Utf8) {
+		return false;
+	}
+	size_t length = strlen(value);
+	return convert_big_endian_to_host_u16(entry + 1) == length
+	       && memcmp(entry + 3, value, length) == 0;
+}
+
+bool ClassFileScanner::scan_constant_pool(uint32_t* offset) {
+	uint32_t start = *offset;
+	uint16_t count = convert_big_endian_to_host_u16(data + start);
+	if (count == 0) {
+		return false;
+	}
+	constant_pool_offsets.resize(count, 0);
+	*offset += 2;
+	for (uint32_t index = 1; index < count; ++index) {
+		if (*offset == size) {
+			return false;
+		}
+		uint8_t tag = data[*offset];
+		if (tag >= NUM_TAGS || OPERAND_SIZES[tag] == 0) {
+			return false;
+		}
+		uint32_t entry_size = 1 + OPERAND_SIZES[tag];
+		if (size - *offset < entry_size) {
+			return false;
+		}
+		if (Kind(tag) == Kind::Utf8) {
+			entry_size += convert_big_endian_to_host_u16(
+				data + *offset + 1
+			);
+			if (size - *offset < entry_size) {
+				return false;
+			}
+		}
+		constant_pool_offsets[index] = *offset;
+		*offset += entry_size;
+		if (Kind(tag) == Kind::Long || Kind(tag) == Kind::Double) {
+			++index;
+		}
+	}
+	constant_pool = {start, *offset - start};
+	return true;
+}
+
+bool ClassFileScanner::scan_members(uint32_t* offset,
+                                    std::vector<Member>* members,
+                                    bool is_method) {
+	if (size - *offset < 2) {
+		return false;
+	}
+	uint16_t count = convert_big_endian_to_host_u16(data + *offset);
+	*offset += 2;
+	members->reserve(count);
+	for (uint32_t i = 0; i < count; ++i) {
+		if (size - *offset < 6) {
+			return false;
+		}
+		Member member;
+		member.range.offset = *offset;
+		member.access_flags = convert_big_endian_to_host_u16(
+			data + *offset
+		);
+		member.name_index = convert_big_endian_to_host_u16(
+			data + *offset + 2
+		);
+		member.descriptor_index = convert_big_endian_to_host_u16(
+			data + *offset + 4
+		);
+		member.first_attribute = attributes.size();
+		member.code = {0, 0};
+		*offset += 6;
+		if (!scan_attributes(offset, &member.num_attributes)) {
+			return false;
+		}
+		member.range.size = *offset - member.range.offset;
+
+		// max_stack, max_locals and code_length come first
+		for (const Attribute& attribute : get_attributes(member)) {
+			if (!is_method || attribute.info.size < 8
+			    || !is_utf8(attribute.name_index, "Code")) {
+				continue;
+			}
+			uint32_t code_length = convert_big_endian_to_host_u32(
+				data + attribute.info.offset + 4
+			);
+			if (code_length > attribute.info.size - 8) {
+				return false;
+			}
+			member.code = {attribute.info.offset + 8, code_length};
+		}
+		members->push_back(member);
+	}
+	return true;
+}
+
+bool ClassFileScanner::scan_attributes(uint32_t* offset, uint16_t* count) {
+	if (size - *offset < 2) {
+		return false;
+	}
+	*count = convert_big_endian_to_host_u16(data + *offset);
+	*offset += 2;
+	for (uint32_t i = 0; i < *count; ++i) {
+		if (size - *offset < 6) {
+			return false;
+		}
+		Attribute attribute;
+		attribute.name_index = convert_big_endian_to_host_u16(
+			data + *offset
+		);
+		uint32_t length = convert_big_endian_to_host_u32(
+			data + *offset + 2
+		);
+		*offset += 6;
+		if (size - *offset < length) {
+			return false;
+		}
+		attribute.info = {*offset, length};
+		attributes.push_back(attribute);
+		*offset += length;
+	}
+	return true;
+}
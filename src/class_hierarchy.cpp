@@ -0,0 +1,377 @@
+/*
+ * Copyright 2019-2020 Jonathan Eyolfson
+ *
+ * This program is free software: you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License version 3 as published by the
+ * Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE. See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "class_hierarchy.hpp"
+
+#include "class_file.hpp"
+#include "constant_pool.hpp"
+#include "interfaces.hpp"
+#include "utf8.hpp"
+
+#include <algorithm>
+#include <cassert>
+
+using namespace project_rescribo;
+
+namespace {
+
+// Ids are packed in pairs or triples into a single cache entry
+constexpr uint32_t ID_BITS = 21;
+constexpr uint32_t MAX_CAPACITY = (1 << ID_BITS) - 1;
+
+constexpr uint32_t CACHE_BITS = 12;
+constexpr uint32_t CACHE_SIZE = 1 << CACHE_BITS;
+
+uint32_t get_cache_slot(uint32_t a, uint32_t b) {
+	uint64_t key = (uint64_t(a) << 32) | b;
+	return (key * UINT64_C(0x9E3779B97F4A7C15)) >> (64 - CACHE_BITS);
+}
+
+uint64_t hash_name(const std::string& name) {
+	return utf8_hash(reinterpret_cast<const uint8_t*>(name.data()),
+	                 name.size());
+}
+
+std::string get_class_name(ConstantPool* constant_pool, uint16_t index) {
+	ConstantPoolUtf8 name = constant_pool->get_utf8(
+		constant_pool->get_class(index).get_name_index()
+	);
+	return std::string(reinterpret_cast<const char*>(name.get_data()),
+	                   name.get_length());
+}
+
+// The type of an array's elements, as a class name if it's a reference
+std::string get_component_name(const std::string& array) {
+	if (array.size() > 2 && array[1] == 'L') {
+		return array.substr(2, array.size() - 3);
+	}
+	return array.substr(1);
+}
+
+}
+
+ClassHierarchy::ClassHierarchy(uint32_t capacity,
+                               ClassHierarchyLoader* loader)
+: capacity(capacity), loader(loader), num_classes(0), num_nodes(0) {
+	assert(capacity > 0 && capacity <= MAX_CAPACITY);
+	uint32_t num_buckets = 1;
+	while (num_buckets < capacity) {
+		num_buckets <<= 1;
+	}
+	bucket_mask = num_buckets - 1;
+	buckets.reset(new std::atomic<Node*>[num_buckets]);
+	for (uint32_t i = 0; i < num_buckets; ++i) {
+		buckets[i].store(nullptr, std::memory_order_relaxed);
+	}
+	nodes.reset(new std::atomic<Node*>[capacity + 1]);
+	for (uint32_t i = 0; i <= capacity; ++i) {
+		nodes[i].store(nullptr, std::memory_order_relaxed);
+	}
+	assignable_cache.reset(new std::atomic<uint64_t>[CACHE_SIZE]);
+	common_super_cache.reset(new std::atomic<uint64_t>[CACHE_SIZE]);
+	for (uint32_t i = 0; i < CACHE_SIZE; ++i) {
+		assignable_cache[i].store(0, std::memory_order_relaxed);
+		common_super_cache[i].store(0, std::memory_order_relaxed);
+	}
+
+	// Always present, it's the answer whenever there isn't a better one
+	add("java/lang/Object", "", {}, false);
+	object = find("java/lang/Object");
+}
+
+ClassHierarchy::~ClassHierarchy() {
+	for (uint32_t id = 1; id <= num_nodes; ++id) {
+		Node* node = get_node(id);
+		delete node->info.load(std::memory_order_relaxed);
+		delete node;
+	}
+}
+
+bool ClassHierarchy::add(ClassFile* class_file) {
+	ConstantPool* constant_pool = class_file->get_constant_pool();
+	std::string super_name;
+	if (class_file->get_super_class() != 0) {
+		super_name = get_class_name(constant_pool,
+		                            class_file->get_super_class());
+	}
+	std::vector<std::string> interface_names;
+	for (uint16_t index : class_file->get_interfaces()->get()) {
+		interface_names.push_back(get_class_name(constant_pool, index));
+	}
+	return add(get_class_name(constant_pool, class_file->get_this_class()),
+	           super_name, interface_names,
+	           class_file->get_access().is_interface());
+}
+
+bool ClassHierarchy::add(const std::string& name,
+                         const std::string& super_name,
+                         const std::vector<std::string>& interface_names,
+                         bool is_interface) {
+	std::lock_guard<std::mutex> lock(add_mutex);
+	Node* node = intern(name);
+	if (node == nullptr) {
+		return false;
+	}
+	if (node->info.load(std::memory_order_relaxed) != nullptr) {
+		return true;
+	}
+	std::unique_ptr<Info> info(new Info);
+	info->super_id = 0;
+	if (!super_name.empty()) {
+		Node* super = intern(super_name);
+		if (super == nullptr) {
+			return false;
+		}
+		info->super_id = super->id;
+	}
+	for (const auto& interface_name : interface_names) {
+		Node* interface = intern(interface_name);
+		if (interface == nullptr) {
+			return false;
+		}
+		info->interface_ids.push_back(interface->id);
+	}
+	info->is_interface = is_interface;
+	node->info.store(info.release(), std::memory_order_release);
+	num_classes.fetch_add(1, std::memory_order_relaxed);
+	return true;
+}
+
+ClassHierarchy::Node* ClassHierarchy::find(const std::string& name) const {
+	uint64_t hash = hash_name(name);
+	Node* node = buckets[hash & bucket_mask].load(std::memory_order_acquire);
+	for (; node != nullptr; node = node->next) {
+		if (node->hash == hash && node->name == name) {
+			return node;
+		}
+	}
+	return nullptr;
+}
+
+// Only called while holding add_mutex, readers may be walking the bucket so
+// the node is complete before it's published
+ClassHierarchy::Node* ClassHierarchy::intern(const std::string& name) {
+	Node* node = find(name);
+	if (node != nullptr) {
+		return node;
+	}
+	if (num_nodes == capacity) {
+		return nullptr;
+	}
+	uint64_t hash = hash_name(name);
+	std::atomic<Node*>& bucket = buckets[hash & bucket_mask];
+	node = new Node(name, hash, ++num_nodes,
+	                bucket.load(std::memory_order_relaxed));
+	nodes[node->id].store(node, std::memory_order_release);
+	bucket.store(node, std::memory_order_release);
+	return node;
+}
+
+const ClassHierarchy::Info* ClassHierarchy::get_info(Node* node) {
+	const Info* info = node->info.load(std::memory_order_acquire);
+	if (info != nullptr || loader == nullptr
+	    || node->missing.load(std::memory_order_relaxed)) {
+		return info;
+	}
+	loader->load(this, node->name);
+	info = node->info.load(std::memory_order_acquire);
+	if (info == nullptr) {
+		node->missing.store(true, std::memory_order_relaxed);
+	}
+	return info;
+}
+
+// The node for a class that has been added, or could be loaded
+ClassHierarchy::Node* ClassHierarchy::resolve(const std::string& name) {
+	Node* node = find(name);
+	if (node == nullptr) {
+		if (loader == nullptr) {
+			return nullptr;
+		}
+		std::lock_guard<std::mutex> lock(add_mutex);
+		node = intern(name);
+		if (node == nullptr) {
+			return nullptr;
+		}
+	}
+	if (get_info(node) == nullptr) {
+		return nullptr;
+	}
+	return node;
+}
+
+bool ClassHierarchy::is_assignable(const std::string& to,
+                                   const std::string& from) {
+	if (to == from) {
+		return true;
+	}
+	if (to.empty() || from.empty()) {
+		return false;
+	}
+	if (to[0] == '[' || from[0] == '[') {
+		return is_array_assignable(to, from);
+	}
+	if (to == object->name) {
+		return true;
+	}
+	Node* from_node = resolve(from);
+	if (from_node == nullptr) {
+		return false;
+	}
+	Node* to_node = resolve(to);
+	if (to_node == nullptr) {
+		return false;
+	}
+	bool complete = true;
+	return is_assignable(to_node, from_node, &complete);
+}
+
+// Sets complete to false, without caching, if the answer could change once
+// more classes are added
+bool ClassHierarchy::is_assignable(Node* to, Node* from, bool* complete) {
+	if (to == from || to == object) {
+		return true;
+	}
+	uint32_t slot = get_cache_slot(to->id, from->id);
+	uint64_t key = (uint64_t(to->id) << (ID_BITS + 2))
+	               | (uint64_t(from->id) << 2) | 1;
+	uint64_t entry = assignable_cache[slot].load(std::memory_order_relaxed);
+	if ((entry & ~uint64_t(2)) == key) {
+		return entry & 2;
+	}
+
+	// A class can only be reached through another class
+	const Info* to_info = get_info(to);
+	bool to_class = to_info != nullptr && !to_info->is_interface;
+
+	bool result = false;
+	bool found_all = true;
+	std::vector<Node*> pending = {from};
+	std::vector<Node*> seen;
+	while (!pending.empty()) {
+		Node* node = pending.back();
+		pending.pop_back();
+		if (node == to) {
+			result = true;
+			break;
+		}
+		if (std::find(seen.begin(), seen.end(), node) != seen.end()) {
+			continue;
+		}
+		seen.push_back(node);
+		const Info* info = get_info(node);
+		if (info == nullptr) {
+			found_all = false;
+			continue;
+		}
+		if (info->super_id != 0) {
+			pending.push_back(get_node(info->super_id));
+		}
+		if (to_class) {
+			continue;
+		}
+		for (uint32_t id : info->interface_ids) {
+			pending.push_back(get_node(id));
+		}
+	}
+
+	if (result || found_all) {
+		assignable_cache[slot].store(key | (result ? 2 : 0),
+		                             std::memory_order_relaxed);
+	}
+	else {
+		*complete = false;
+	}
+	return result;
+}
+
+// https://docs.oracle.com/javase/specs/jvms/se11/html/jvms-6.html (checkcast)
+bool ClassHierarchy::is_array_assignable(const std::string& to,
+                                         const std::string& from) {
+	if (from[0] != '[') {
+		return false;
+	}
+	if (to[0] != '[') {
+		return to == object->name
+		       || to == "java/lang/Cloneable"
+		       || to == "java/io/Serializable";
+	}
+	char to_component = to[1];
+	char from_component = from[1];
+	bool to_reference = to_component == 'L' || to_component == '[';
+	bool from_reference = from_component == 'L' || from_component == '[';
+	if (!to_reference || !from_reference) {
+		return to == from;
+	}
+	return is_assignable(get_component_name(to), get_component_name(from));
+}
+
+std::string ClassHierarchy::get_common_super_class(
+	const std::string& a, const std::string& b) {
+	if (a == b) {
+		return a;
+	}
+	if (a.empty() || b.empty() || a[0] == '[' || b[0] == '[') {
+		return object->name;
+	}
+	Node* a_node = resolve(a);
+	Node* b_node = resolve(b);
+	if (a_node == nullptr || b_node == nullptr) {
+		return object->name;
+	}
+
+	uint32_t slot = get_cache_slot(a_node->id, b_node->id);
+	uint64_t key = (uint64_t(a_node->id) << (2 * ID_BITS))
+	               | (uint64_t(b_node->id) << ID_BITS);
+	uint64_t entry = common_super_cache[slot].load(
+		std::memory_order_relaxed
+	);
+	uint64_t id_mask = (uint64_t(1) << ID_BITS) - 1;
+	if (entry != 0 && (entry & ~id_mask) == key) {
+		return get_node(entry & id_mask)->name;
+	}
+
+	bool complete = true;
+	Node* result = object;
+	if (is_assignable(a_node, b_node, &complete)) {
+		result = a_node;
+	}
+	else if (is_assignable(b_node, a_node, &complete)) {
+		result = b_node;
+	}
+	else if (!get_info(a_node)->is_interface
+	         && !get_info(b_node)->is_interface) {
+		const Info* info = get_info(a_node);
+		while (info->super_id != 0) {
+			Node* super = get_node(info->super_id);
+			if (is_assignable(super, b_node, &complete)) {
+				result = super;
+				break;
+			}
+			info = get_info(super);
+			if (info == nullptr) {
+				complete = false;
+				break;
+			}
+		}
+	}
+
+	if (complete) {
+		common_super_cache[slot].store(key | result->id,
+		                               std::memory_order_relaxed);
+	}
+	return result->name;
+}
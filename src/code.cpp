@@ -22,27 +22,155 @@
 #include "class_file.hpp"
 #include "constant_pool.hpp"
 #include "instruction.hpp"
+#include "liveness.hpp"
 #include "method.hpp"
 #include "stack_map_table.hpp"
 
+#include <algorithm>
 #include <cassert>
+#include <cstring>
 
 using namespace project_rescribo;
 
+namespace {
+
+constexpr uint8_t ILOAD = static_cast<uint8_t>(Instruction::Kind::ILoad);
+constexpr uint8_t ILOAD_0 = static_cast<uint8_t>(Instruction::Kind::ILoad_0);
+constexpr uint8_t ISTORE = static_cast<uint8_t>(Instruction::Kind::IStore);
+constexpr uint8_t ISTORE_0
+	= static_cast<uint8_t>(Instruction::Kind::IStore_0);
+constexpr uint8_t WIDE = static_cast<uint8_t>(Instruction::Kind::Wide);
+
+// Loads and stores come in the order int, long, float, double, reference
+uint8_t get_local_type(const char* descriptor) {
+	switch (descriptor[0]) {
+	case 'J':
+		return 1;
+	case 'F':
+		return 2;
+	case 'D':
+		return 3;
+	case 'L':
+	case '[':
+		return 4;
+	default:
+		return 0;
+	}
+}
+
+uint8_t get_local_size(const char* descriptor) {
+	return (descriptor[0] == 'J' || descriptor[0] == 'D') ? 2 : 1;
+}
+
+// Slots taken by this and the parameters on entry
+uint16_t get_parameter_size(Method* method) {
+	ConstantPoolUtf8 descriptor = method->get_descriptor_utf8();
+	const uint8_t* data = descriptor.get_data();
+	assert(data[0] == '(');
+	uint16_t size = method->is_static() ? 0 : 1;
+	uint32_t i = 1;
+	while (data[i] != ')') {
+		size += get_local_size(reinterpret_cast<const char*>(data + i));
+		while (data[i] == '[') {
+			++i;
+		}
+		if (data[i] == 'L') {
+			while (data[i] != ';') {
+				++i;
+			}
+		}
+		++i;
+	}
+	return size;
+}
+
+bool is_wide(const VariableInfo* type) {
+	return type->get_kind() == VariableInfo::Kind::Long
+	       || type->get_kind() == VariableInfo::Kind::Double;
+}
+
+bool is_same_type(const VariableInfo* a, const VariableInfo* b) {
+	if (a->get_kind() != b->get_kind()) {
+		return false;
+	}
+	if (auto object = dyn_cast<ObjectVariableInfo>(a)) {
+		return object->get_index()
+		       == cast<ObjectVariableInfo>(b)->get_index();
+	}
+	if (auto uninitialized = dyn_cast<UninitializedVariableInfo>(a)) {
+		return uninitialized->get_instruction()
+		       == cast<UninitializedVariableInfo>(b)->get_instruction();
+	}
+	return true;
+}
+
+// Keeps the more specific type where one side is Top or has run out, as
+// long as the entries after it still line up with the same locals
+bool narrow_locals(std::vector<std::unique_ptr<VariableInfo>>* locals,
+                   const std::vector<std::unique_ptr<VariableInfo>>& other) {
+	std::vector<std::unique_ptr<VariableInfo>> narrowed;
+	size_t size = std::max(locals->size(), other.size());
+	for (size_t i = 0; i < size; ++i) {
+		const VariableInfo* a = i < locals->size() ? (*locals)[i].get()
+		                                           : nullptr;
+		const VariableInfo* b = i < other.size() ? other[i].get()
+		                                         : nullptr;
+		if (a && b && is_same_type(a, b)) {
+			narrowed.push_back(a->clone());
+		}
+		else if (b && (!a || (isa<TopVariableInfo>(a) && !is_wide(b)))) {
+			narrowed.push_back(b->clone());
+		}
+		else if (a && (!b || (isa<TopVariableInfo>(b) && !is_wide(a)))) {
+			narrowed.push_back(a->clone());
+		}
+		else {
+			return false;
+		}
+	}
+	*locals = std::move(narrowed);
+	return true;
+}
+
+// The shortest form of a load or store, given its first form
+std::vector<uint8_t> encode_local(uint8_t opcode, uint8_t opcode_0,
+                                  const char* descriptor, uint16_t index) {
+	uint8_t type = get_local_type(descriptor);
+	if (index < 4) {
+		return {static_cast<uint8_t>(opcode_0 + 4 * type + index)};
+	}
+	if (index <= UINT8_MAX) {
+		return {static_cast<uint8_t>(opcode + type),
+		        static_cast<uint8_t>(index)};
+	}
+	return {WIDE, static_cast<uint8_t>(opcode + type),
+	        static_cast<uint8_t>(index >> 8),
+	        static_cast<uint8_t>(index & 0xFF)};
+}
+
+}
+
 Code::Code(const uint8_t** buffer,
            uint16_t attribute_name_index,
            Method* method)
 : Attribute(Kind::Code, attribute_name_index), method(method),
-  line_number_table(nullptr), stack_map_table(nullptr) {
+  line_number_table(nullptr), stack_map_table(nullptr),
+  is_byte_size_current(false), version(0) {
 	max_stack = next_u16(buffer);
 	max_locals = next_u16(buffer);
+	num_own_locals = max_locals;
 
+	// Nested attribute decoding below switches to its own phase
+	AllocationStats::Scope allocation_scope(
+		get_class_file(), AllocationStats::Phase::InstructionDecode
+	);
 	uint32_t bci = 0;
 	uint32_t code_length = next_u32(buffer);
 	const uint8_t* code_start = *buffer;
 	while ((*buffer - code_start) != code_length) {
 		instructions.push_back(Instruction::make(buffer, this));
 		assert(instructions.back() != nullptr);
+		track_instruction(std::prev(instructions.end()));
 		instructions.back()->set_bci(bci);
 		instruction_map.insert({bci, instructions.back().get()});
 		assert(instructions.back()->get_byte_size() != 0);
@@ -50,19 +178,14 @@ Code::Code(const uint8_t** buffer,
 		next_bci = bci; // Needed to calculate lookup / table switch
 	}
 	assert(next_bci <= INT32_MAX);
-	for (const auto& instruction : instructions) {
-		if (BranchInstruction* branch
-		    = dyn_cast<BranchInstruction>(instruction.get())) {
-			set_branch_target(branch);
-		}
-		else if (LookupSwitch* lookup_switch
-		         = dyn_cast<LookupSwitch>(instruction.get())) {
-			set_lookup_switch_targets(lookup_switch);
-		}
-		else if (TableSwitch* table_switch
-		         = dyn_cast<TableSwitch>(instruction.get())) {
-			set_table_switch_targets(table_switch);
-		}
+	for (auto iter : branches) {
+		set_branch_target(cast<BranchInstruction>(iter->get()));
+	}
+	for (LookupSwitch* lookup_switch : lookup_switches) {
+		set_lookup_switch_targets(lookup_switch);
+	}
+	for (TableSwitch* table_switch : table_switches) {
+		set_table_switch_targets(table_switch);
 	}
 
 	uint16_t exception_table_length = next_u16(buffer);
@@ -100,13 +223,15 @@ Code::Code(const uint8_t** buffer,
 
 Code::Code(Method* method)
 : Attribute(Kind::Code, 0), method(method),
-  line_number_table(nullptr), stack_map_table(nullptr) {
+  line_number_table(nullptr), stack_map_table(nullptr),
+  is_byte_size_current(false), version(0) {
 	ConstantPool* constant_pool = get_constant_pool();
 	set_attribute_name_index(
 		constant_pool->get_or_create_utf8_index("Code")
 	);
 	max_stack = 0;
 	max_locals = 0;
+	num_own_locals = 0;
 	attributes = std::make_unique<Attributes>();
 
 	InstructionInserter inserter(this, instructions.end());
@@ -114,6 +239,16 @@ Code::Code(Method* method)
 	sync();
 }
 
+Code::~Code() = default;
+
+const Liveness& Code::get_liveness() {
+	if (!liveness || liveness_version != version) {
+		liveness = std::make_unique<Liveness>(this);
+		liveness_version = version;
+	}
+	return *liveness;
+}
+
 void Code::set_branch_target(BranchInstruction* branch) {
 	Instruction* target = get_instruction(branch->get_bci()
 	                                      + branch->get_offset());
@@ -152,6 +287,56 @@ ConstantPool* Code::get_constant_pool() const {
 	return get_class_file()->get_constant_pool();
 }
 
+Code::Instructions::iterator Code::insert_instruction(
+	Instructions::iterator insertion_point,
+	std::unique_ptr<Instruction> instruction
+) {
+	auto iter = instructions.insert(insertion_point, std::move(instruction));
+	track_instruction(iter);
+	++version;
+	return iter;
+}
+
+Code::Instructions::iterator Code::erase_instruction(
+	Instructions::iterator iter
+) {
+	untrack_instruction(iter);
+	++version;
+	return instructions.erase(iter);
+}
+
+void Code::track_instruction(Instructions::iterator iter) {
+	Instruction* instruction = iter->get();
+	if (isa<BranchInstruction>(instruction)) {
+		branches.push_back(iter);
+	}
+	else if (LookupSwitch* lookup_switch
+	         = dyn_cast<LookupSwitch>(instruction)) {
+		lookup_switches.push_back(lookup_switch);
+	}
+	else if (TableSwitch* table_switch
+	         = dyn_cast<TableSwitch>(instruction)) {
+		table_switches.push_back(table_switch);
+	}
+}
+
+void Code::untrack_instruction(Instructions::iterator iter) {
+	Instruction* instruction = iter->get();
+	if (isa<BranchInstruction>(instruction)) {
+		branches.erase(std::find(branches.begin(), branches.end(), iter));
+	}
+	else if (isa<LookupSwitch>(instruction)) {
+		lookup_switches.erase(std::find(lookup_switches.begin(),
+		                                lookup_switches.end(),
+		                                instruction));
+	}
+	else if (isa<TableSwitch>(instruction)) {
+		table_switches.erase(std::find(table_switches.begin(),
+		                               table_switches.end(),
+		                               instruction));
+	}
+}
+
 Instruction* Code::get_instruction(uint32_t bci) const {
 	assert(instruction_map.count(bci));
 	return instruction_map.at(bci);
@@ -175,6 +360,9 @@ void Code::sync_instruction_bcis() {
 		}
 		bci += instruction->get_byte_size();
 	}
+	if (bci != next_bci) {
+		invalidate_byte_size();
+	}
 	next_bci = bci;
 }
 
@@ -208,19 +396,14 @@ void Code::sync_table_switch_offsets(TableSwitch* table_switch) {
 }
 
 void Code::sync_instruction_offsets() {
-	for (const auto& instruction : instructions) {
-		if (BranchInstruction* branch
-		    = dyn_cast<BranchInstruction>(instruction.get())) {
-			sync_branch_offset(branch);
-		}
-		else if (LookupSwitch* lookup_switch
-		         = dyn_cast<LookupSwitch>(instruction.get())) {
-			sync_lookup_switch_offsets(lookup_switch);
-		}
-		else if (TableSwitch* table_switch
-		         = dyn_cast<TableSwitch>(instruction.get())) {
-			sync_table_switch_offsets(table_switch);
-		}
+	for (auto iter : branches) {
+		sync_branch_offset(cast<BranchInstruction>(iter->get()));
+	}
+	for (LookupSwitch* lookup_switch : lookup_switches) {
+		sync_lookup_switch_offsets(lookup_switch);
+	}
+	for (TableSwitch* table_switch : table_switches) {
+		sync_table_switch_offsets(table_switch);
 	}
 }
 
@@ -259,29 +442,27 @@ void Code::replace_table_switch_targets(TableSwitch* table_switch,
 }
 
 void Code::replace_targets(Instruction* old_target, Instruction* new_target) {
+	++version;
 	for (auto& entry : exception_table) {
 		if (entry.handler == old_target) {
 			entry.handler = new_target;
 		}
 	}
 
-	for (const auto& instruction : instructions) {
-		if (BranchInstruction* branch
-		    = dyn_cast<BranchInstruction>(instruction.get())) {
-			replace_branch_targets(branch, old_target, new_target);
-		}
-		else if (LookupSwitch* lookup_switch
-		         = dyn_cast<LookupSwitch>(instruction.get())) {
-			replace_lookup_switch_targets(lookup_switch,
-			                              old_target,
-			                              new_target);
-		}
-		else if (TableSwitch* table_switch
-		         = dyn_cast<TableSwitch>(instruction.get())) {
-			replace_table_switch_targets(table_switch,
-			                             old_target,
-			                             new_target);
-		}
+	for (auto iter : branches) {
+		replace_branch_targets(cast<BranchInstruction>(iter->get()),
+		                       old_target,
+		                       new_target);
+	}
+	for (LookupSwitch* lookup_switch : lookup_switches) {
+		replace_lookup_switch_targets(lookup_switch,
+		                              old_target,
+		                              new_target);
+	}
+	for (TableSwitch* table_switch : table_switches) {
+		replace_table_switch_targets(table_switch,
+		                             old_target,
+		                             new_target);
 	}
 
 	if (stack_map_table) {
@@ -339,237 +520,269 @@ Code::Instructions::iterator Code::get_objectref_top(
 
 void Code::InstructionInserter::insert_aaload() {
 	auto instruction = std::make_unique<AALoad>(code);
-	code->instructions.insert(insertion_point, std::move(instruction));
+	code->insert_instruction(insertion_point, std::move(instruction));
 }
 
 void Code::InstructionInserter::insert_aastore() {
 	auto instruction = std::make_unique<AAStore>(code);
-	code->instructions.insert(insertion_point, std::move(instruction));
+	code->insert_instruction(insertion_point, std::move(instruction));
 }
 
 void Code::InstructionInserter::insert_aconst_null() {
 	auto instruction = std::make_unique<AConst_Null>(code);
-	code->instructions.insert(insertion_point, std::move(instruction));
+	code->insert_instruction(insertion_point, std::move(instruction));
 }
 
 void Code::InstructionInserter::insert_aload(uint8_t index) {
 	auto instruction = std::make_unique<ALoad>(code, index);
-	code->instructions.insert(insertion_point, std::move(instruction));
+	code->insert_instruction(insertion_point, std::move(instruction));
 }
 
 void Code::InstructionInserter::insert_aload_0() {
 	auto instruction = std::make_unique<ALoad_0>(code);
-	code->instructions.insert(insertion_point, std::move(instruction));
+	code->insert_instruction(insertion_point, std::move(instruction));
 }
 
 void Code::InstructionInserter::insert_aload_1() {
 	auto instruction = std::make_unique<ALoad_1>(code);
-	code->instructions.insert(insertion_point, std::move(instruction));
+	code->insert_instruction(insertion_point, std::move(instruction));
 }
 
 void Code::InstructionInserter::insert_aload_2() {
 	auto instruction = std::make_unique<ALoad_2>(code);
-	code->instructions.insert(insertion_point, std::move(instruction));
+	code->insert_instruction(insertion_point, std::move(instruction));
 }
 
 void Code::InstructionInserter::insert_aload_3() {
 	auto instruction = std::make_unique<ALoad_3>(code);
-	code->instructions.insert(insertion_point, std::move(instruction));
+	code->insert_instruction(insertion_point, std::move(instruction));
 }
 
 void Code::InstructionInserter::insert_anewarray(uint16_t index) {
 	auto instruction = std::make_unique<ANewArray>(code, index);
-	code->instructions.insert(insertion_point, std::move(instruction));
+	code->insert_instruction(insertion_point, std::move(instruction));
 }
 
 void Code::InstructionInserter::insert_areturn() {
 	auto instruction = std::make_unique<AReturn>(code);
-	code->instructions.insert(insertion_point, std::move(instruction));
+	code->insert_instruction(insertion_point, std::move(instruction));
 }
 
 void Code::InstructionInserter::insert_arraylength() {
 	auto instruction = std::make_unique<ArrayLength>(code);
-	code->instructions.insert(insertion_point, std::move(instruction));
+	code->insert_instruction(insertion_point, std::move(instruction));
 }
 
 void Code::InstructionInserter::insert_astore(uint8_t index) {
 	auto instruction = std::make_unique<AStore>(code, index);
-	code->instructions.insert(insertion_point, std::move(instruction));
+	code->insert_instruction(insertion_point, std::move(instruction));
 }
 
 void Code::InstructionInserter::insert_astore_0() {
 	auto instruction = std::make_unique<AStore_0>(code);
-	code->instructions.insert(insertion_point, std::move(instruction));
+	code->insert_instruction(insertion_point, std::move(instruction));
 }
 
 void Code::InstructionInserter::insert_astore_1() {
 	auto instruction = std::make_unique<AStore_1>(code);
-	code->instructions.insert(insertion_point, std::move(instruction));
+	code->insert_instruction(insertion_point, std::move(instruction));
 }
 
 void Code::InstructionInserter::insert_astore_2() {
 	auto instruction = std::make_unique<AStore_2>(code);
-	code->instructions.insert(insertion_point, std::move(instruction));
+	code->insert_instruction(insertion_point, std::move(instruction));
 }
 
 void Code::InstructionInserter::insert_astore_3() {
 	auto instruction = std::make_unique<AStore_3>(code);
-	code->instructions.insert(insertion_point, std::move(instruction));
+	code->insert_instruction(insertion_point, std::move(instruction));
 }
 
 void Code::InstructionInserter::insert_athrow() {
 	auto instruction = std::make_unique<AThrow>(code);
-	code->instructions.insert(insertion_point, std::move(instruction));
+	code->insert_instruction(insertion_point, std::move(instruction));
 }
 
 void Code::InstructionInserter::insert_baload() {
 	auto instruction = std::make_unique<BALoad>(code);
-	code->instructions.insert(insertion_point, std::move(instruction));
+	code->insert_instruction(insertion_point, std::move(instruction));
 }
 
 void Code::InstructionInserter::insert_bastore() {
 	auto instruction = std::make_unique<BAStore>(code);
-	code->instructions.insert(insertion_point, std::move(instruction));
+	code->insert_instruction(insertion_point, std::move(instruction));
 }
 
 void Code::InstructionInserter::insert_bipush(uint8_t value) {
 	auto instruction = std::make_unique<BIPush>(code, value);
-	code->instructions.insert(insertion_point, std::move(instruction));
+	code->insert_instruction(insertion_point, std::move(instruction));
 }
 
 void Code::InstructionInserter::insert_caload() {
 	auto instruction = std::make_unique<CALoad>(code);
-	code->instructions.insert(insertion_point, std::move(instruction));
+	code->insert_instruction(insertion_point, std::move(instruction));
 }
 
 void Code::InstructionInserter::insert_castore() {
 	auto instruction = std::make_unique<CAStore>(code);
-	code->instructions.insert(insertion_point, std::move(instruction));
+	code->insert_instruction(insertion_point, std::move(instruction));
 }
 
 void Code::InstructionInserter::insert_checkcast(uint16_t index) {
 	auto instruction = std::make_unique<CheckCast>(code, index);
-	code->instructions.insert(insertion_point, std::move(instruction));
+	code->insert_instruction(insertion_point, std::move(instruction));
 }
 
 void Code::InstructionInserter::insert_d2f() {
 	auto instruction = std::make_unique<D2F>(code);
-	code->instructions.insert(insertion_point, std::move(instruction));
+	code->insert_instruction(insertion_point, std::move(instruction));
 }
 
 void Code::InstructionInserter::insert_d2i() {
 	auto instruction = std::make_unique<D2I>(code);
-	code->instructions.insert(insertion_point, std::move(instruction));
+	code->insert_instruction(insertion_point, std::move(instruction));
 }
 
 void Code::InstructionInserter::insert_d2l() {
 	auto instruction = std::make_unique<D2L>(code);
-	code->instructions.insert(insertion_point, std::move(instruction));
+	code->insert_instruction(insertion_point, std::move(instruction));
 }
 
 void Code::InstructionInserter::insert_dadd() {
 	auto instruction = std::make_unique<DAdd>(code);
-	code->instructions.insert(insertion_point, std::move(instruction));
+	code->insert_instruction(insertion_point, std::move(instruction));
 }
 
 void Code::InstructionInserter::insert_daload() {
 	auto instruction = std::make_unique<DALoad>(code);
-	code->instructions.insert(insertion_point, std::move(instruction));
+	code->insert_instruction(insertion_point, std::move(instruction));
 }
 
 void Code::InstructionInserter::insert_dastore() {
 	auto instruction = std::make_unique<DAStore>(code);
-	code->instructions.insert(insertion_point, std::move(instruction));
+	code->insert_instruction(insertion_point, std::move(instruction));
 }
 
 void Code::InstructionInserter::insert_dup() {
 	auto instruction = std::make_unique<Dup>(code);
-	code->instructions.insert(insertion_point, std::move(instruction));
+	code->insert_instruction(insertion_point, std::move(instruction));
 }
 
 void Code::InstructionInserter::insert_dup_x1() {
 	auto instruction = std::make_unique<Dup_X1>(code);
-	code->instructions.insert(insertion_point, std::move(instruction));
+	code->insert_instruction(insertion_point, std::move(instruction));
 }
 
 void Code::InstructionInserter::insert_dup_x2() {
 	auto instruction = std::make_unique<Dup_X2>(code);
-	code->instructions.insert(insertion_point, std::move(instruction));
+	code->insert_instruction(insertion_point, std::move(instruction));
 }
 
 void Code::InstructionInserter::insert_dup2() {
 	auto instruction = std::make_unique<Dup2>(code);
-	code->instructions.insert(insertion_point, std::move(instruction));
+	code->insert_instruction(insertion_point, std::move(instruction));
 }
 
 void Code::InstructionInserter::insert_dup2_x1() {
 	auto instruction = std::make_unique<Dup2_X1>(code);
-	code->instructions.insert(insertion_point, std::move(instruction));
+	code->insert_instruction(insertion_point, std::move(instruction));
 }
 
 void Code::InstructionInserter::insert_dup2_x2() {
 	auto instruction = std::make_unique<Dup2_X2>(code);
-	code->instructions.insert(insertion_point, std::move(instruction));
+	code->insert_instruction(insertion_point, std::move(instruction));
 }
 
 void Code::InstructionInserter::insert_getstatic(uint16_t index) {
 	auto instruction = std::make_unique<GetStatic>(code, index);
-	code->instructions.insert(insertion_point, std::move(instruction));
+	code->insert_instruction(insertion_point, std::move(instruction));
 }
 
 void Code::InstructionInserter::insert_goto_w(Instruction* target) {
 	auto instruction = std::make_unique<Goto_W>(code, target);
-	code->instructions.insert(insertion_point, std::move(instruction));
+	code->insert_instruction(insertion_point, std::move(instruction));
 }
 
 void Code::InstructionInserter::insert_iconst_0() {
 	auto instruction = std::make_unique<IConst_0>(code);
-	code->instructions.insert(insertion_point, std::move(instruction));
+	code->insert_instruction(insertion_point, std::move(instruction));
 }
 
 void Code::InstructionInserter::insert_iconst_1() {
 	auto instruction = std::make_unique<IConst_1>(code);
-	code->instructions.insert(insertion_point, std::move(instruction));
+	code->insert_instruction(insertion_point, std::move(instruction));
 }
 
 void Code::InstructionInserter::insert_ifeq(Instruction* target) {
 	auto instruction = std::make_unique<IfEq>(code, target);
-	code->instructions.insert(insertion_point, std::move(instruction));
+	code->insert_instruction(insertion_point, std::move(instruction));
 }
 
 void Code::InstructionInserter::insert_invokestatic(uint16_t index) {
 	auto instruction = std::make_unique<InvokeStatic>(code, index);
-	code->instructions.insert(insertion_point, std::move(instruction));
+	code->insert_instruction(insertion_point, std::move(instruction));
 }
 
 void Code::InstructionInserter::insert_ldc(uint16_t index) {
 	auto instruction = std::make_unique<Ldc_W>(code, index);
-	code->instructions.insert(insertion_point, std::move(instruction));
+	code->insert_instruction(insertion_point, std::move(instruction));
 }
 
 void Code::InstructionInserter::insert_nop() {
 	auto instruction = std::make_unique<Nop>(code);
-	code->instructions.insert(insertion_point, std::move(instruction));
+	code->insert_instruction(insertion_point, std::move(instruction));
 }
 
 void Code::InstructionInserter::insert_pop() {
 	auto instruction = std::make_unique<Pop>(code);
-	code->instructions.insert(insertion_point, std::move(instruction));
+	code->insert_instruction(insertion_point, std::move(instruction));
 }
 
 void Code::InstructionInserter::insert_putstatic(uint16_t index) {
 	auto instruction = std::make_unique<PutStatic>(code, index);
-	code->instructions.insert(insertion_point, std::move(instruction));
+	code->insert_instruction(insertion_point, std::move(instruction));
 }
 
 void Code::InstructionInserter::insert_return() {
 	auto instruction = std::make_unique<Return>(code);
-	code->instructions.insert(insertion_point, std::move(instruction));
+	code->insert_instruction(insertion_point, std::move(instruction));
 }
 
 void Code::InstructionInserter::insert_sipush(uint16_t value) {
 	auto instruction = std::make_unique<SIPush>(code, value);
-	code->instructions.insert(insertion_point, std::move(instruction));
+	code->insert_instruction(insertion_point, std::move(instruction));
+}
+
+Instruction* Code::InstructionInserter::insert_bytecode(
+	const uint8_t* bytecode, uint32_t length
+) {
+	Instruction* first = nullptr;
+	const uint8_t* end = bytecode + length;
+	while (bytecode != end) {
+		auto iter = code->insert_instruction(
+			insertion_point, Instruction::make(&bytecode, code)
+		);
+		assert(!(*iter)->get_opcode_info().is(OpcodeInfo::Branch
+		                                      | OpcodeInfo::Switch));
+		if (first == nullptr) {
+			first = iter->get();
+		}
+	}
+	return first;
+}
+
+void Code::InstructionInserter::insert_load(const char* descriptor,
+                                            uint16_t index) {
+	std::vector<uint8_t> bytecode = encode_local(ILOAD, ILOAD_0,
+	                                             descriptor, index);
+	insert_bytecode(bytecode.data(), bytecode.size());
+}
+
+void Code::InstructionInserter::insert_store(const char* descriptor,
+                                             uint16_t index) {
+	std::vector<uint8_t> bytecode = encode_local(ISTORE, ISTORE_0,
+	                                             descriptor, index);
+	insert_bytecode(bytecode.data(), bytecode.size());
 }
 
 void Code::InstructionInserter::insert_method_name_and_descriptor_ldc(
@@ -578,16 +791,14 @@ void Code::InstructionInserter::insert_method_name_and_descriptor_ldc(
 	ConstantPool* constant_pool = code->get_constant_pool();
 
 	uint16_t ref_index = invoke_instruction->get_index();
-	auto ref = cast<ConstantPoolRef>(constant_pool->get_entry(ref_index));
-	uint16_t name_and_type_index = ref->get_name_and_type_index();
-	auto name_and_type = cast<ConstantPoolNameAndType>(
-		constant_pool->get_entry(name_and_type_index)
-	);
+	ConstantPoolRef ref = constant_pool->get_ref(ref_index);
+	ConstantPoolNameAndType name_and_type
+		= constant_pool->get_name_and_type(ref.get_name_and_type_index());
 	uint16_t name_index = constant_pool->get_or_create_string_index(
-		name_and_type->get_name_index()
+		name_and_type.get_name_index()
 	);
 	uint16_t descriptor_index = constant_pool->get_or_create_string_index(
-		name_and_type->get_descriptor_index()
+		name_and_type.get_descriptor_index()
 	);
 
 	insert_ldc(name_index);
@@ -600,12 +811,268 @@ void Code::InstructionInserter::insert_original_type_checkcast(
 	ConstantPool* constant_pool = code->get_constant_pool();
 
 	uint16_t ref_index = invoke_instruction->get_index();
-	auto ref = cast<ConstantPoolRef>(constant_pool->get_entry(ref_index));
+	ConstantPoolRef ref = constant_pool->get_ref(ref_index);
+
+	insert_checkcast(ref.get_class_index());
+}
 
-	insert_checkcast(ref->get_class_index());
+StackMapTable* Code::get_or_create_stack_map_table() {
+	if (stack_map_table) {
+		return stack_map_table;
+	}
+	uint16_t name_index = get_constant_pool()->get_or_create_utf8_index(
+		"StackMapTable"
+	);
+	auto table = std::make_unique<StackMapTable>(name_index, this);
+	stack_map_table = table.get();
+	attributes->add(std::move(table));
+	invalidate_byte_size();
+	return stack_map_table;
+}
+
+void Code::retarget(Instruction* old_target, Instruction* new_target) {
+	replace_targets(old_target, new_target);
+	for (auto& entry : exception_table) {
+		if (entry.end == old_target) {
+			entry.end = new_target;
+		}
+	}
+}
+
+void Code::replace_range_bounds(Instruction* old_bound,
+                                Instruction* new_bound) {
+	++version;
+	for (auto& entry : exception_table) {
+		if (entry.start == old_bound) {
+			entry.start = new_bound;
+		}
+		if (entry.end == old_bound) {
+			entry.end = new_bound;
+		}
+	}
+	for (auto& attribute : attributes->get()) {
+		if (LocalVariableTable* table
+		    = dyn_cast<LocalVariableTable>(attribute.get())) {
+			table->replace_bound(old_bound, new_bound);
+		}
+		else if (LocalVariableTypeTable* table
+		         = dyn_cast<LocalVariableTypeTable>(attribute.get())) {
+			table->replace_bound(old_bound, new_bound);
+		}
+	}
+}
+
+Code::Instructions::iterator Code::replace(
+	Instructions::iterator iter,
+	std::unique_ptr<Instruction> instruction
+) {
+	Instruction* old_instruction = iter->get();
+	auto new_iter = insert_instruction(iter, std::move(instruction));
+	replace_targets(old_instruction, new_iter->get());
+	replace_range_bounds(old_instruction, new_iter->get());
+	erase_instruction(iter);
+	return new_iter;
+}
+
+Code::Instructions::iterator Code::erase(Instructions::iterator iter) {
+	assert(std::next(iter) != instructions.end());
+	replace_range_bounds(iter->get(), std::next(iter)->get());
+	exception_table.erase(
+		std::remove_if(exception_table.begin(), exception_table.end(),
+		               [](const ExceptionTableEntry& entry) {
+		                       return entry.start == entry.end;
+		               }),
+		exception_table.end()
+	);
+	invalidate_byte_size();
+	return erase_instruction(iter);
+}
+
+uint16_t Code::allocate_local(const char* descriptor) {
+	uint8_t size = get_local_size(descriptor);
+	std::vector<uint16_t>& released = released_locals[size - 1];
+	if (!released.empty()) {
+		uint16_t index = released.back();
+		released.pop_back();
+		return index;
+	}
+	assert(max_locals + size <= UINT16_MAX && "Out of locals");
+	uint16_t index = max_locals;
+	max_locals += size;
+	++version;
+	return index;
+}
+
+uint16_t Code::allocate_local(const char* descriptor,
+                              Instruction* begin, Instruction* end) {
+	uint8_t size = get_local_size(descriptor);
+	uint16_t first = get_parameter_size(method);
+	if (num_own_locals < first + size) {
+		return allocate_local(descriptor);
+	}
+	Liveness::Bits used = get_liveness().get_used_between(begin, end);
+	for (uint16_t index = first; index + size <= num_own_locals; ++index) {
+		bool is_free = true;
+		for (uint8_t i = 0; i < size; ++i) {
+			if ((used[(index + i) / 64] >> ((index + i) % 64)) & 1) {
+				is_free = false;
+			}
+		}
+		if (is_free && (!stack_map_table
+		                || stack_map_table->is_top(index, size))) {
+			return index;
+		}
+	}
+	return allocate_local(descriptor);
+}
+
+// The method's own locals aren't pooled, they may be live elsewhere
+void Code::release_local(uint16_t index, const char* descriptor) {
+	if (index < num_own_locals) {
+		return;
+	}
+	released_locals[get_local_size(descriptor) - 1].push_back(index);
+}
+
+void Code::declare_local(uint16_t index, const char* descriptor,
+                         Instruction* begin, Instruction* end) {
+	if (!stack_map_table) {
+		return;
+	}
+	std::unique_ptr<VariableInfo> type = VariableInfo::make(
+		reinterpret_cast<const uint8_t*>(descriptor), strlen(descriptor),
+		get_constant_pool()
+	);
+	stack_map_table->declare_local(index, *type, begin, end);
+}
+
+bool Code::has_type_annotations() const {
+	for (const auto& attribute : attributes->get()) {
+		if (isa<RuntimeVisibleTypeAnnotations>(attribute.get())) {
+			return true;
+		}
+	}
+	return false;
+}
+
+uint32_t Code::insert_before_returns(const uint8_t* bytecode,
+                                     uint32_t length) {
+	uint32_t num_returns = 0;
+	for (auto iter = instructions.begin(); iter != instructions.end();
+	     ++iter) {
+		Instruction* instruction = iter->get();
+		if (!instruction->get_opcode_info().is(OpcodeInfo::Return)) {
+			continue;
+		}
+		InstructionInserter inserter(this, iter);
+		retarget(instruction, inserter.insert_bytecode(bytecode, length));
+		++num_returns;
+	}
+	return num_returns;
+}
+
+bool Code::get_handler_locals(
+	Instruction* instruction,
+	std::vector<std::unique_ptr<VariableInfo>>* locals
+) const {
+	locals->clear();
+	uint32_t bci = instruction->get_bci();
+	for (const auto& entry : exception_table) {
+		uint32_t end_bci = entry.end ? entry.end->get_bci() : next_bci;
+		if (bci < entry.start->get_bci() || bci >= end_bci) {
+			continue;
+		}
+		StackMapFrame* handler_frame = nullptr;
+		if (stack_map_table) {
+			handler_frame = stack_map_table->get_stack_frame_at(
+				entry.handler
+			);
+		}
+		if (!handler_frame || !narrow_locals(
+			locals, stack_map_table->get_locals(handler_frame)
+		)) {
+			return false;
+		}
+	}
+	return true;
+}
+
+uint32_t Code::insert_guarded_before_returns(const uint8_t* bytecode,
+                                             uint32_t length,
+                                             uint16_t flag_index) {
+	bool has_frames = get_class_file()->get_major_version() >= 50;
+	if (has_frames) {
+		// For the bcis of the exception ranges
+		sync();
+	}
+	// Every return's locals are found before inserting moves any bounds
+	std::vector<Instructions::iterator> all_returns;
+	std::vector<bool> can_guard;
+	std::vector<std::vector<std::unique_ptr<VariableInfo>>> returns_locals;
+	for (auto iter = instructions.begin(); iter != instructions.end();
+	     ++iter) {
+		Instruction* instruction = iter->get();
+		if (!instruction->get_opcode_info().is(OpcodeInfo::Return)) {
+			continue;
+		}
+		std::vector<std::unique_ptr<VariableInfo>> locals;
+		all_returns.push_back(iter);
+		can_guard.push_back(!has_frames
+		                    || get_handler_locals(instruction, &locals));
+		if (can_guard.back()) {
+			returns_locals.push_back(std::move(locals));
+		}
+	}
+
+	std::vector<Instruction*> returns;
+	for (size_t i = 0; i < all_returns.size(); ++i) {
+		auto iter = all_returns[i];
+		Instruction* instruction = iter->get();
+		InstructionInserter inserter(this, iter);
+		if (!can_guard[i]) {
+			retarget(instruction,
+			         inserter.insert_bytecode(bytecode, length));
+			continue;
+		}
+		inserter.insert_getstatic(flag_index);
+		// Before adding the ifeq, which has to keep the return as its
+		// target
+		retarget(instruction, std::prev(iter)->get());
+		inserter.insert_ifeq(instruction);
+		inserter.insert_bytecode(bytecode, length);
+		returns.push_back(instruction);
+	}
+	if (returns.empty() || !has_frames) {
+		return all_returns.size();
+	}
+
+	sync();
+	StackMapTable* table = get_or_create_stack_map_table();
+	// Copied, making a VariableInfo can add a Utf8 and move the descriptor
+	ConstantPoolUtf8 descriptor = method->get_descriptor_utf8();
+	const uint8_t* data = descriptor.get_data();
+	const uint8_t* end = data + descriptor.get_length();
+	std::vector<uint8_t> return_type(std::find(data, end, ')') + 1, end);
+	for (size_t i = 0; i < returns.size(); ++i) {
+		Instruction* instruction = returns[i];
+		std::vector<std::unique_ptr<VariableInfo>> stack_items;
+		if (instruction->get_kind() != Instruction::Kind::Return) {
+			stack_items.push_back(VariableInfo::make(
+				return_type.data(), return_type.size(),
+				get_constant_pool()
+			));
+		}
+		table->insert_frame(instruction, std::move(returns_locals[i]),
+		                    std::move(stack_items));
+	}
+	return all_returns.size();
 }
 
 void Code::sync() {
+	AllocationStats::Scope allocation_scope(get_class_file(),
+	                                        AllocationStats::Phase::Sync);
+	TransformStats::Timer timer(get_class_file()->get_transform_stats(),
+	                            TransformStats::Phase::Sync);
 	sync_instruction_bcis();
 	sync_instruction_offsets();
 	if (stack_map_table) {
@@ -614,24 +1081,22 @@ void Code::sync() {
 }
 
 bool Code::fix_offsets() {
+	AllocationStats::Scope allocation_scope(get_class_file(),
+	                                        AllocationStats::Phase::Sync);
+	TransformStats::Timer timer(get_class_file()->get_transform_stats(),
+	                            TransformStats::Phase::Sync);
 	bool fixed = false;
-	for (auto iter = instructions.begin();
-	     iter != instructions.end();
-	     ++iter) {
-		Instruction* instruction = iter->get();
-		if (BranchInstruction* branch
-		    = dyn_cast<BranchInstruction>(instruction)) {
-		  fixed = fixed || fix_branch_offsets(branch, iter);
-		}
-		else if (LookupSwitch* lookup_switch
-		         = dyn_cast<LookupSwitch>(instruction)) {
-			fixed = fixed
-			        || fix_lookup_switch_offsets(lookup_switch);
-		}
-		else if (TableSwitch* table_switch
-		         = dyn_cast<TableSwitch>(instruction)) {
-			fixed = fixed || fix_table_switch_offsets(table_switch);
-		}
+	// Fixing a branch may insert a new one, index so the loop sees it
+	for (size_t i = 0; i < branches.size(); ++i) {
+		auto iter = branches[i];
+		BranchInstruction* branch = cast<BranchInstruction>(iter->get());
+		fixed = fixed || fix_branch_offsets(branch, iter);
+	}
+	for (LookupSwitch* lookup_switch : lookup_switches) {
+		fixed = fixed || fix_lookup_switch_offsets(lookup_switch);
+	}
+	for (TableSwitch* table_switch : table_switches) {
+		fixed = fixed || fix_table_switch_offsets(table_switch);
 	}
 	return fixed;
 }
@@ -673,13 +1138,28 @@ bool Code::fix_table_switch_offsets(TableSwitch* table_switch) {
 	return false;
 }
 
+uint32_t Code::get_byte_size() const {
+	if (!is_byte_size_current) {
+		byte_size = 18 + next_bci + attributes->get_byte_size()
+		            + 8 * exception_table.size();
+		is_byte_size_current = true;
+	}
+	return byte_size;
+}
+
+void Code::invalidate_byte_size() {
+	if (!is_byte_size_current) {
+		return;
+	}
+	is_byte_size_current = false;
+	method->invalidate_byte_size();
+}
+
 void Code::write_buffer(uint8_t** buffer) const {
 	next_u16(buffer, get_attribute_name_index());
 
 	// attribute len not including first 6 bytes
-	uint32_t len = 12 + next_bci + 8 * exception_table.size()
-		       + attributes->get_byte_size();
-	next_u32(buffer, len);
+	next_u32(buffer, get_byte_size() - 6);
 	next_u16(buffer, max_stack);
 	next_u16(buffer, max_locals);
 
@@ -687,6 +1167,9 @@ void Code::write_buffer(uint8_t** buffer) const {
 	for (const auto& insn : instructions) {
 		insn->write_buffer(buffer);
 	}
+	get_class_file()->get_transform_stats()->add_output_instructions(
+		instructions.size()
+	);
 
 	next_u16(buffer, exception_table.size());
 	for (const auto& entry : exception_table) {
@@ -703,3 +1186,17 @@ void Code::write_buffer(uint8_t** buffer) const {
 
 	attributes->write_buffer(buffer);
 }
+
+void Code::visit_constant_pool_indices(ConstantPoolIndexVisitor& visitor) {
+	Attribute::visit_constant_pool_indices(visitor);
+	for (auto& instruction : instructions) {
+		const OpcodeInfo& info = instruction->get_opcode_info();
+		if (info.is(OpcodeInfo::ConstantPoolIndex)) {
+			instruction->visit_constant_pool_indices(visitor);
+		}
+	}
+	for (auto& entry : exception_table) {
+		visitor.visit(entry.catch_type);
+	}
+	attributes->visit_constant_pool_indices(visitor);
+}
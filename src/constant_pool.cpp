@@ -17,169 +17,456 @@
 #include "constant_pool.hpp"
 
 #include "buffer.hpp"
-#include "casting.hpp"
+#include "utf8.hpp"
 
 #include <classfile_constants.h>
 
-#include <cassert>
 #include <cstring>
 
 using namespace project_rescribo;
 
-ConstantPool::ConstantPool(const uint8_t** buffer, uint16_t count) {
+namespace {
+
+typedef ConstantPoolEntry::Kind Kind;
+
+// tag(1) and the operands, a Utf8 adds its length and bytes from utf8_bytes
+constexpr uint8_t ENTRY_SIZES[] = {
+	0, // None
+	1, // Utf8
+	0,
+	5, // Integer
+	5, // Float
+	9, // Long
+	9, // Double
+	3, // Class
+	3, // String
+	5, // Fieldref
+	5, // Methodref
+	5, // InterfaceMethodref
+	5, // NameAndType
+	0,
+	0,
+	4, // MethodHandle
+	3, // MethodType
+	5, // Dynamic
+	5, // InvokeDynamic
+};
+constexpr size_t NUM_TAGS = sizeof(ENTRY_SIZES);
+
+uint32_t pack(uint16_t high, uint16_t low) {
+	return (static_cast<uint32_t>(high) << 16) | low;
+}
+
+uint16_t get_high(uint32_t operand) {
+	return operand >> 16;
+}
+
+uint16_t get_low(uint32_t operand) {
+	return operand & 0xFFFF;
+}
+
+// Not yet looked up in attribute_kinds
+constexpr uint8_t UNRESOLVED_ATTRIBUTE_KIND = UINT8_MAX;
+
+uint32_t get_entries_byte_size(const std::vector<uint8_t>& tags) {
+	uint32_t result = 0;
+	for (uint8_t tag : tags) {
+		assert(tag < NUM_TAGS);
+		result += ENTRY_SIZES[tag];
+	}
+	return result;
+}
+
+}
+
+ConstantPool::ConstantPool(const uint8_t** buffer, uint16_t count)
+: tags(count, 0), operands(count, 0), modified(false), generation(0) {
+	assert(count > 0);
 	for (uint32_t index = 1; index < count; ++index) {
-		entries.push_back(ConstantPoolEntry::make(buffer));
-		if (entries.back()->is_8_byte()) {
-			entries.emplace_back();
+		uint8_t tag = next_u8(buffer);
+		tags[index] = tag;
+		switch (Kind(tag)) {
+		case Kind::Utf8: {
+			uint16_t length = convert_big_endian_to_host_u16(*buffer);
+			operands[index] = utf8_bytes.size();
+			utf8_bytes.insert(utf8_bytes.end(),
+			                  *buffer, *buffer + 2 + length);
+			*buffer += 2 + length;
+			break;
+		}
+		case Kind::Integer:
+		case Kind::Float:
+		case Kind::Fieldref:
+		case Kind::Methodref:
+		case Kind::InterfaceMethodref:
+		case Kind::NameAndType:
+		case Kind::Dynamic:
+		case Kind::InvokeDynamic:
+			// Two u16s read as one u32 are already packed high to low
+			operands[index] = next_u32(buffer);
+			break;
+		case Kind::Long:
+		case Kind::Double:
+			assert(index + 1 < count);
+			operands[index] = next_u32(buffer);
+			operands[index + 1] = next_u32(buffer);
 			++index;
+			break;
+		case Kind::Class:
+		case Kind::String:
+		case Kind::MethodType:
+			operands[index] = next_u16(buffer);
+			break;
+		case Kind::MethodHandle: {
+			uint8_t reference_kind = next_u8(buffer);
+			operands[index] = pack(reference_kind, next_u16(buffer));
+			break;
+		}
+		default:
+			assert(false && "Unknown constant pool tag");
 		}
 	}
+	entries_byte_size = get_entries_byte_size(tags);
 }
 
 ConstantPool::~ConstantPool() = default;
 
-ConstantPoolEntry* ConstantPool::get_entry(uint16_t index) const {
-	assert(index > 0 && index <= entries.size());
-	return entries[index - 1].get();
+ConstantPoolUtf8 ConstantPool::get_utf8(uint16_t index) const {
+	assert(get_kind(index) == Kind::Utf8);
+	const uint8_t* data = &utf8_bytes[operands[index]];
+#ifndef NDEBUG
+	return ConstantPoolUtf8(data + 2, convert_big_endian_to_host_u16(data),
+	                        &generation);
+#else
+	return ConstantPoolUtf8(data + 2, convert_big_endian_to_host_u16(data));
+#endif
 }
 
-uint32_t ConstantPool::get_byte_size() const {
-	uint32_t result = 0;
-	for (const auto& entry : entries) {
-		if (entry != nullptr)
-			result += entry->get_byte_size();
+ConstantPoolInteger ConstantPool::get_integer(uint16_t index) const {
+	assert(get_kind(index) == Kind::Integer);
+	return ConstantPoolInteger(operands[index]);
+}
+
+ConstantPoolFloat ConstantPool::get_float(uint16_t index) const {
+	assert(get_kind(index) == Kind::Float);
+	return ConstantPoolFloat(operands[index]);
+}
+
+ConstantPoolLong ConstantPool::get_long(uint16_t index) const {
+	assert(get_kind(index) == Kind::Long);
+	return ConstantPoolLong(
+		(static_cast<uint64_t>(operands[index]) << 32)
+		| operands[index + 1]
+	);
+}
+
+ConstantPoolDouble ConstantPool::get_double(uint16_t index) const {
+	assert(get_kind(index) == Kind::Double);
+	return ConstantPoolDouble(
+		(static_cast<uint64_t>(operands[index]) << 32)
+		| operands[index + 1]
+	);
+}
+
+ConstantPoolClass ConstantPool::get_class(uint16_t index) const {
+	assert(get_kind(index) == Kind::Class);
+	return ConstantPoolClass(operands[index]);
+}
+
+ConstantPoolString ConstantPool::get_string(uint16_t index) const {
+	assert(get_kind(index) == Kind::String);
+	return ConstantPoolString(operands[index]);
+}
+
+ConstantPoolRef ConstantPool::get_ref(uint16_t index) const {
+	Kind kind = get_kind(index);
+	assert(kind == Kind::Fieldref
+	       || kind == Kind::Methodref
+	       || kind == Kind::InterfaceMethodref);
+	uint32_t operand = operands[index];
+	return ConstantPoolRef(kind, get_high(operand), get_low(operand));
+}
+
+ConstantPoolNameAndType ConstantPool::get_name_and_type(uint16_t index) const {
+	assert(get_kind(index) == Kind::NameAndType);
+	uint32_t operand = operands[index];
+	return ConstantPoolNameAndType(get_high(operand), get_low(operand));
+}
+
+ConstantPoolMethodHandle ConstantPool::get_method_handle(uint16_t index) const {
+	assert(get_kind(index) == Kind::MethodHandle);
+	uint32_t operand = operands[index];
+	return ConstantPoolMethodHandle(get_high(operand), get_low(operand));
+}
+
+ConstantPoolMethodType ConstantPool::get_method_type(uint16_t index) const {
+	assert(get_kind(index) == Kind::MethodType);
+	return ConstantPoolMethodType(operands[index]);
+}
+
+ConstantPoolDynamic ConstantPool::get_dynamic(uint16_t index) const {
+	Kind kind = get_kind(index);
+	assert(kind == Kind::Dynamic || kind == Kind::InvokeDynamic);
+	uint32_t operand = operands[index];
+	return ConstantPoolDynamic(kind, get_high(operand), get_low(operand));
+}
+
+Attribute::Kind ConstantPool::get_attribute_kind(uint16_t name_index) {
+	if (attribute_kinds.size() <= name_index) {
+		attribute_kinds.resize(tags.size(), UNRESOLVED_ATTRIBUTE_KIND);
 	}
-	return result;
+	uint8_t& kind = attribute_kinds[name_index];
+	if (kind == UNRESOLVED_ATTRIBUTE_KIND) {
+		ConstantPoolUtf8 name = get_utf8(name_index);
+		kind = static_cast<uint8_t>(
+			Attribute::find_kind(name.get_data(), name.get_length())
+		);
+	}
+	return static_cast<Attribute::Kind>(kind);
 }
 
-void ConstantPool::write_buffer(uint8_t** buffer) const {
-	next_u16(buffer, entries.size() + 1); // CP starts at 1
-	for (const auto& entry : entries) {
-		if (!entry) {
-			continue;
+void ConstantPool::resolve_attribute_kinds() {
+	attribute_kinds.resize(tags.size(), UNRESOLVED_ATTRIBUTE_KIND);
+	for (uint32_t index = 1; index < tags.size(); ++index) {
+		if (Kind(tags[index]) == Kind::Utf8
+		    && attribute_kinds[index] == UNRESOLVED_ATTRIBUTE_KIND) {
+			get_attribute_kind(index);
 		}
-		entry->write_buffer(buffer);
 	}
 }
 
-uint16_t ConstantPool::get_or_create_utf8_index(const char* str) {
-	for (uint16_t i = 1; i <= entries.size(); ++i) {
-		auto entry = get_entry(i);
-		if (!entry) {
-			continue;
-		}
-		ConstantPoolUtf8* utf8_entry
-			= dyn_cast<ConstantPoolUtf8>(entry);
-		if (!utf8_entry) {
+void ConstantPool::write_buffer(uint8_t** buffer) const {
+	next_u16(buffer, tags.size());
+	for (uint32_t index = 1; index < tags.size(); ++index) {
+		uint8_t tag = tags[index];
+		uint32_t operand = operands[index];
+		switch (Kind(tag)) {
+		case Kind::None:
 			continue;
+		case Kind::Utf8: {
+			next_u8(buffer, tag);
+			const uint8_t* data = &utf8_bytes[operand];
+			size_t size = 2 + convert_big_endian_to_host_u16(data);
+			memcpy(*buffer, data, size);
+			*buffer += size;
+			break;
 		}
-		if (utf8_entry->equals(str)) {
-			return i;
+		case Kind::Integer:
+		case Kind::Float:
+		case Kind::Fieldref:
+		case Kind::Methodref:
+		case Kind::InterfaceMethodref:
+		case Kind::NameAndType:
+		case Kind::Dynamic:
+		case Kind::InvokeDynamic:
+			next_u8(buffer, tag);
+			next_u32(buffer, operand);
+			break;
+		case Kind::Long:
+		case Kind::Double:
+			next_u8(buffer, tag);
+			next_u32(buffer, operand);
+			next_u32(buffer, operands[index + 1]);
+			break;
+		case Kind::Class:
+		case Kind::String:
+		case Kind::MethodType:
+			next_u8(buffer, tag);
+			next_u16(buffer, operand);
+			break;
+		case Kind::MethodHandle:
+			next_u8(buffer, tag);
+			next_u8(buffer, get_high(operand));
+			next_u16(buffer, get_low(operand));
+			break;
 		}
 	}
-	std::vector<uint8_t> bytes;
-	size_t length = strlen(str);
-	assert(length <= UINT16_MAX);
-	for (size_t i = 0; i < length; ++i) {
-		bytes.push_back(str[i]);
+}
+
+void ConstantPool::visit_constant_pool_indices(
+	ConstantPoolIndexVisitor& visitor) {
+	for (uint32_t index = 1; index < tags.size(); ++index) {
+		visit_constant_pool_indices(index, visitor);
 	}
-	entries.push_back(
-		std::make_unique<ConstantPoolUtf8>(std::move(bytes))
-	);
-	return entries.size();
 }
 
-uint16_t ConstantPool::get_or_create_name_and_type_index(uint16_t name_index,
-	                                                 uint16_t type_index) {
-	for (uint16_t i = 1; i <= entries.size(); ++i) {
-		auto entry = get_entry(i);
-		if (!entry) {
+void ConstantPool::visit_constant_pool_indices(
+	uint16_t index, ConstantPoolIndexVisitor& visitor) {
+	uint32_t& operand = operands[index];
+	switch (get_kind(index)) {
+	case Kind::Class:
+	case Kind::String:
+	case Kind::MethodType: {
+		uint16_t other_index = operand;
+		visitor.visit(other_index);
+		operand = other_index;
+		break;
+	}
+	case Kind::Fieldref:
+	case Kind::Methodref:
+	case Kind::InterfaceMethodref:
+	case Kind::NameAndType: {
+		uint16_t high = get_high(operand);
+		uint16_t low = get_low(operand);
+		visitor.visit(high);
+		visitor.visit(low);
+		operand = pack(high, low);
+		break;
+	}
+	case Kind::MethodHandle:
+	case Kind::Dynamic:
+	case Kind::InvokeDynamic: {
+		// The reference kind and bootstrap method aren't indices
+		uint16_t low = get_low(operand);
+		visitor.visit(low);
+		operand = pack(get_high(operand), low);
+		break;
+	}
+	default:
+		break;
+	}
+}
+
+std::vector<uint16_t>
+ConstantPool::remove_unused(const std::vector<bool>& used) {
+	assert(used.size() == tags.size());
+	std::vector<uint16_t> new_indices(tags.size(), 0);
+	std::vector<uint8_t> new_tags(1, 0);
+	std::vector<uint32_t> new_operands(1, 0);
+	std::vector<uint8_t> new_utf8_bytes;
+	for (uint32_t index = 1; index < tags.size(); ++index) {
+		Kind kind = Kind(tags[index]);
+		// The unusable index after an 8 byte entry goes with it
+		if (kind == Kind::None || !used[index]) {
 			continue;
 		}
-		ConstantPoolNameAndType* name_and_type_entry
-			= dyn_cast<ConstantPoolNameAndType>(entry);
-		if (!name_and_type_entry) {
-			continue;
+		new_indices[index] = new_tags.size();
+		uint32_t operand = operands[index];
+		if (kind == Kind::Utf8) {
+			const uint8_t* data = &utf8_bytes[operand];
+			operand = new_utf8_bytes.size();
+			new_utf8_bytes.insert(
+				new_utf8_bytes.end(), data,
+				data + 2 + convert_big_endian_to_host_u16(data)
+			);
 		}
-		if (name_and_type_entry->get_name_index() == name_index
-		    && name_and_type_entry->get_descriptor_index()
-		       == type_index) {
-			return i;
+		new_tags.push_back(tags[index]);
+		new_operands.push_back(operand);
+		if (ConstantPoolEntry::is_8_byte(kind)) {
+			new_tags.push_back(0);
+			new_operands.push_back(operands[index + 1]);
 		}
 	}
-	entries.push_back(
-		std::make_unique<ConstantPoolNameAndType>(name_index,
-		                                          type_index)
-	);
-	return entries.size();
+	modified |= new_tags.size() != tags.size();
+	tags = std::move(new_tags);
+	operands = std::move(new_operands);
+	utf8_bytes = std::move(new_utf8_bytes);
+	entries_byte_size = get_entries_byte_size(tags);
+	++generation;
+	attribute_kinds.clear();
+	return new_indices;
 }
 
-uint16_t ConstantPool::get_or_create_class_index(uint16_t name_index) {
-	for (uint16_t i = 1; i <= entries.size(); ++i) {
-		auto entry = get_entry(i);
-		if (!entry) {
-			continue;
+// The count is written as a u16, so it stays below 65536 including the
+// second slot of a Long or Double
+uint16_t ConstantPool::add_entry(Kind kind, uint32_t operand) {
+	uint32_t num_slots = ConstantPoolEntry::is_8_byte(kind) ? 2 : 1;
+	if (tags.size() + num_slots > UINT16_MAX) {
+		return 0;
+	}
+	uint16_t index = tags.size();
+	tags.push_back(static_cast<uint8_t>(kind));
+	operands.push_back(operand);
+	if (num_slots == 2) {
+		tags.push_back(0);
+		operands.push_back(0);
+	}
+	entries_byte_size += ENTRY_SIZES[tags[index]];
+	modified = true;
+	++generation;
+	return index;
+}
+
+uint16_t ConstantPool::find_entry(Kind kind, uint32_t operand) const {
+	uint8_t tag = static_cast<uint8_t>(kind);
+	for (uint32_t index = 1; index < tags.size(); ++index) {
+		if (tags[index] == tag && operands[index] == operand) {
+			return index;
 		}
-		ConstantPoolClass* class_entry
-			= dyn_cast<ConstantPoolClass>(entry);
-		if (!class_entry) {
+	}
+	return 0;
+}
+
+uint16_t ConstantPool::get_or_create_entry(Kind kind, uint32_t operand) {
+	uint16_t index = find_entry(kind, operand);
+	if (index != 0) {
+		return index;
+	}
+	return add_entry(kind, operand);
+}
+
+uint16_t ConstantPool::get_or_create_utf8_index(const char* str) {
+	size_t length = strlen(str);
+	assert(length <= UINT16_MAX);
+	const uint8_t* bytes = reinterpret_cast<const uint8_t*>(str);
+	for (uint32_t index = 1; index < tags.size(); ++index) {
+		if (Kind(tags[index]) != Kind::Utf8) {
 			continue;
 		}
-		if (class_entry->get_name_index() == name_index) {
-			return i;
+		const uint8_t* data = &utf8_bytes[operands[index]];
+		if (utf8_equals(data + 2, convert_big_endian_to_host_u16(data),
+		                bytes, length)) {
+			return index;
 		}
 	}
-	entries.push_back(
-		std::make_unique<ConstantPoolClass>(name_index)
-	);
-	return entries.size();
+	uint32_t offset = utf8_bytes.size();
+	utf8_bytes.push_back(length >> 8);
+	utf8_bytes.push_back(length & 0xFF);
+	utf8_bytes.insert(utf8_bytes.end(), bytes, bytes + length);
+	uint16_t index = add_entry(Kind::Utf8, offset);
+	if (index == 0) {
+		// Appending may have moved the bytes anyway
+		utf8_bytes.resize(offset);
+		++generation;
+	}
+	return index;
+}
+
+uint16_t ConstantPool::get_or_create_name_and_type_index(uint16_t name_index,
+	                                                 uint16_t type_index) {
+	if (name_index == 0 || type_index == 0) {
+		return 0;
+	}
+	return get_or_create_entry(Kind::NameAndType,
+	                           pack(name_index, type_index));
+}
+
+uint16_t ConstantPool::get_or_create_class_index(uint16_t name_index) {
+	if (name_index == 0) {
+		return 0;
+	}
+	return get_or_create_entry(Kind::Class, name_index);
 }
 
 uint16_t ConstantPool::get_or_create_string_index(uint16_t index) {
-	for (uint16_t i = 1; i <= entries.size(); ++i) {
-		auto entry = get_entry(i);
-		if (!entry) {
-			continue;
-		}
-		ConstantPoolString* string_entry
-			= dyn_cast<ConstantPoolString>(entry);
-		if (!string_entry) {
-			continue;
-		}
-		if (string_entry->get_string_index() == index) {
-			return i;
-		}
+	if (index == 0) {
+		return 0;
 	}
-	entries.push_back(
-		std::make_unique<ConstantPoolString>(index)
-	);
-	return entries.size();
+	return get_or_create_entry(Kind::String, index);
+}
+
+uint16_t ConstantPool::get_or_create_integer_index(int32_t value) {
+	return get_or_create_entry(Kind::Integer, static_cast<uint32_t>(value));
 }
 
 uint16_t ConstantPool::get_or_create_fieldref_index(
 	uint16_t class_index,
 	uint16_t name_and_type_index) {
-	for (uint16_t i = 1; i <= entries.size(); ++i) {
-		auto entry = get_entry(i);
-		if (!entry) {
-			continue;
-		}
-		ConstantPoolFieldref* fieldref_entry
-			= dyn_cast<ConstantPoolFieldref>(entry);
-		if (!fieldref_entry) {
-			continue;
-		}
-		if (fieldref_entry->get_class_index() == class_index
-		    && fieldref_entry->get_name_and_type_index()
-		       == name_and_type_index) {
-			return i;
-		}
+	if (class_index == 0 || name_and_type_index == 0) {
+		return 0;
 	}
-	entries.push_back(
-		std::make_unique<ConstantPoolFieldref>(class_index,
-		                                        name_and_type_index)
-	);
-	return entries.size();
+	return get_or_create_entry(Kind::Fieldref,
+	                           pack(class_index, name_and_type_index));
 }
 
 uint16_t ConstantPool::get_or_create_fieldref_index(
@@ -202,27 +489,11 @@ uint16_t ConstantPool::get_or_create_fieldref_index(
 uint16_t ConstantPool::get_or_create_methodref_index(
 	uint16_t class_index,
 	uint16_t name_and_type_index) {
-	for (uint16_t i = 1; i <= entries.size(); ++i) {
-		auto entry = get_entry(i);
-		if (!entry) {
-			continue;
-		}
-		ConstantPoolMethodref* methodref_entry
-			= dyn_cast<ConstantPoolMethodref>(entry);
-		if (!methodref_entry) {
-			continue;
-		}
-		if (methodref_entry->get_class_index() == class_index
-		    && methodref_entry->get_name_and_type_index()
-		       == name_and_type_index) {
-			return i;
-		}
+	if (class_index == 0 || name_and_type_index == 0) {
+		return 0;
 	}
-	entries.push_back(
-		std::make_unique<ConstantPoolMethodref>(class_index,
-		                                        name_and_type_index)
-	);
-	return entries.size();
+	return get_or_create_entry(Kind::Methodref,
+	                           pack(class_index, name_and_type_index));
 }
 
 uint16_t ConstantPool::get_or_create_methodref_index(
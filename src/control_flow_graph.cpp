@@ -0,0 +1,189 @@
+/*
+ * Copyright 2019-2020 Jonathan Eyolfson
+ *
+ * This program is free software: you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License version 3 as published by the
+ * Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE. See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "control_flow_graph.hpp"
+
+#include "casting.hpp"
+#include "instruction.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <unordered_set>
+
+using namespace project_rescribo;
+
+namespace {
+
+bool ends_block(Instruction* instruction) {
+	const OpcodeInfo& info = instruction->get_opcode_info();
+	if (info.is(OpcodeInfo::Branch | OpcodeInfo::Switch
+	            | OpcodeInfo::Return)) {
+		return true;
+	}
+	Instruction::Kind kind = instruction->get_kind();
+	return kind == Instruction::Kind::AThrow
+	       || kind == Instruction::Kind::Ret;
+}
+
+bool is_unconditional(Instruction* instruction) {
+	Instruction::Kind kind = instruction->get_kind();
+	return kind == Instruction::Kind::Goto
+	       || kind == Instruction::Kind::Goto_W;
+}
+
+bool is_subroutine(Instruction* instruction) {
+	Instruction::Kind kind = instruction->get_kind();
+	return kind == Instruction::Kind::Jsr
+	       || kind == Instruction::Kind::Jsr_W
+	       || kind == Instruction::Kind::Ret;
+}
+
+}
+
+ControlFlowGraph::ControlFlowGraph(Code* code)
+: code(code), subroutines(false) {
+	Code::Instructions& instructions = code->get_instructions();
+	if (instructions.empty()) {
+		return;
+	}
+
+	std::unordered_set<const Instruction*> leaders;
+	leaders.insert(instructions.front().get());
+	for (const auto& entry : code->get_exception_table()) {
+		leaders.insert(entry.start);
+		if (entry.end) {
+			leaders.insert(entry.end);
+		}
+		leaders.insert(entry.handler);
+	}
+	for (auto iter = instructions.begin(); iter != instructions.end();
+	     ++iter) {
+		Instruction* instruction = iter->get();
+		if (!ends_block(instruction)) {
+			continue;
+		}
+		subroutines |= is_subroutine(instruction);
+		if (auto branch = dyn_cast<BranchInstruction>(instruction)) {
+			leaders.insert(branch->get_target());
+		}
+		else if (auto lookup_switch = dyn_cast<LookupSwitch>(instruction)) {
+			leaders.insert(lookup_switch->get_default_target());
+			for (Instruction* target : lookup_switch->get_targets()) {
+				leaders.insert(target);
+			}
+		}
+		else if (auto table_switch = dyn_cast<TableSwitch>(instruction)) {
+			leaders.insert(table_switch->get_default_target());
+			for (Instruction* target : table_switch->get_targets()) {
+				leaders.insert(target);
+			}
+		}
+		auto next = std::next(iter);
+		if (next != instructions.end()) {
+			leaders.insert(next->get());
+		}
+	}
+
+	for (auto iter = instructions.begin(); iter != instructions.end();
+	     ++iter) {
+		Instruction* instruction = iter->get();
+		if (leaders.count(instruction) == 0) {
+			continue;
+		}
+		if (!blocks.empty()) {
+			blocks.back().end = iter;
+			blocks.back().end_bci = instruction->get_bci();
+		}
+		block_indices.emplace(instruction, blocks.size());
+		blocks.push_back({iter, instructions.end(), instruction->get_bci(),
+		                  code->get_next_bci(), {}, {}, {}, false, false});
+	}
+
+	for (uint32_t index = 0; index < blocks.size(); ++index) {
+		Instruction* last = blocks[index].get_last();
+		if (auto branch = dyn_cast<BranchInstruction>(last)) {
+			add_edge(index, branch->get_target());
+		}
+		else if (auto lookup_switch = dyn_cast<LookupSwitch>(last)) {
+			add_edge(index, lookup_switch->get_default_target());
+			for (Instruction* target : lookup_switch->get_targets()) {
+				add_edge(index, target);
+			}
+		}
+		else if (auto table_switch = dyn_cast<TableSwitch>(last)) {
+			add_edge(index, table_switch->get_default_target());
+			for (Instruction* target : table_switch->get_targets()) {
+				add_edge(index, target);
+			}
+		}
+		Instruction::Kind kind = last->get_kind();
+		if (last->get_opcode_info().is(OpcodeInfo::Return)
+		    || kind == Instruction::Kind::AThrow) {
+			blocks[index].is_exit = true;
+			continue;
+		}
+		if (last->get_opcode_info().is(OpcodeInfo::Switch)
+		    || is_unconditional(last)
+		    || kind == Instruction::Kind::Ret) {
+			continue;
+		}
+		// Includes a jsr, which continues here once the subroutine
+		// returns
+		if (blocks[index].end != instructions.end()) {
+			add_edge(index, blocks[index].end->get());
+		}
+	}
+
+	// Ranges start and end on block boundaries, so each block is either
+	// entirely inside one or not at all
+	for (const auto& entry : code->get_exception_table()) {
+		uint32_t start_bci = entry.start->get_bci();
+		uint32_t end_bci = entry.end ? entry.end->get_bci()
+		                             : code->get_next_bci();
+		uint32_t handler = get_block_index(entry.handler);
+		blocks[handler].is_handler = true;
+		for (auto& block : blocks) {
+			if (block.start_bci < start_bci
+			    || block.start_bci >= end_bci) {
+				continue;
+			}
+			if (std::find(block.handlers.begin(), block.handlers.end(),
+			              handler) == block.handlers.end()) {
+				block.handlers.push_back(handler);
+			}
+		}
+	}
+}
+
+uint32_t ControlFlowGraph::get_block_index(const Instruction* leader) const {
+	auto it = block_indices.find(leader);
+	if (it == block_indices.end()) {
+		return UINT32_MAX;
+	}
+	return it->second;
+}
+
+void ControlFlowGraph::add_edge(uint32_t from, const Instruction* to) {
+	uint32_t index = get_block_index(to);
+	assert(index != UINT32_MAX && "jump target isn't a leader");
+	auto& successors = blocks[from].successors;
+	if (std::find(successors.begin(), successors.end(), index)
+	    != successors.end()) {
+		return;
+	}
+	successors.push_back(index);
+	blocks[index].predecessors.push_back(from);
+}
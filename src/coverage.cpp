@@ -0,0 +1,456 @@
+/*
+ * Copyright 2019-2020 Jonathan Eyolfson
+ *
+ * This program is free software: you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License version 3 as published by the
+ * Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE. See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "coverage.hpp"
+
+#include "buffer.hpp"
+#include "class_file.hpp"
+#include "code.hpp"
+#include "constant_pool.hpp"
+#include "control_flow_graph.hpp"
+#include "instruction.hpp"
+#include "method.hpp"
+#include "methods.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <cctype>
+
+using namespace project_rescribo;
+
+namespace {
+
+constexpr uint8_t SIPUSH = static_cast<uint8_t>(Instruction::Kind::SIPush);
+constexpr uint8_t LDC_W = static_cast<uint8_t>(Instruction::Kind::Ldc_W);
+constexpr uint8_t INVOKESTATIC
+	= static_cast<uint8_t>(Instruction::Kind::InvokeStatic);
+
+// Pushing the id then calling the hook
+constexpr uint32_t COUNTER_LENGTH = 6;
+
+constexpr uint32_t ENTRY = 0;
+constexpr uint32_t EXIT = 1;
+
+uint32_t get_block_in(uint32_t block) {
+	return 2 + 2 * block;
+}
+
+uint32_t get_block_out(uint32_t block) {
+	return 3 + 2 * block;
+}
+
+std::string to_string(const ConstantPoolUtf8& utf8) {
+	return std::string(reinterpret_cast<const char*>(utf8.get_data()),
+	                   utf8.get_length());
+}
+
+class DisjointSets {
+public:
+	DisjointSets(uint32_t size) : parents(size) {
+		for (uint32_t i = 0; i < size; ++i) {
+			parents[i] = i;
+		}
+	}
+
+	// False if they were already joined
+	bool join(uint32_t a, uint32_t b) {
+		a = find(a);
+		b = find(b);
+		if (a == b) {
+			return false;
+		}
+		parents[a] = b;
+		return true;
+	}
+private:
+	std::vector<uint32_t> parents;
+
+	uint32_t find(uint32_t i) {
+		while (parents[i] != i) {
+			parents[i] = parents[parents[i]];
+			i = parents[i];
+		}
+		return i;
+	}
+};
+
+// How many loops each block is in, taking every jump back to an earlier
+// block as the end of a loop over the blocks between
+std::vector<uint32_t> get_loop_depths(const ControlFlowGraph& graph) {
+	const auto& blocks = graph.get_blocks();
+	std::vector<uint32_t> depths(blocks.size(), 0);
+	for (uint32_t from = 0; from < blocks.size(); ++from) {
+		for (uint32_t to : blocks[from].successors) {
+			if (to > from) {
+				continue;
+			}
+			for (uint32_t block = to; block <= from; ++block) {
+				++depths[block];
+			}
+		}
+	}
+	return depths;
+}
+
+bool read_token(FILE* file, std::string* token) {
+	token->clear();
+	int c;
+	do {
+		c = fgetc(file);
+	} while (c != EOF && isspace(c));
+	while (c != EOF && !isspace(c)) {
+		token->push_back(c);
+		c = fgetc(file);
+	}
+	return !token->empty();
+}
+
+bool read_u32(FILE* file, uint32_t* value) {
+	std::string token;
+	if (!read_token(file, &token)) {
+		return false;
+	}
+	char* end;
+	unsigned long parsed = strtoul(token.c_str(), &end, 10);
+	if (*end != '\0' || parsed > UINT32_MAX) {
+		return false;
+	}
+	*value = parsed;
+	return true;
+}
+
+}
+
+CoverageMap::CoverageMap() : num_counters(0), num_blocks(0), num_skipped(0) {}
+
+void CoverageMap::add(Method&& method) {
+	std::lock_guard<std::mutex> lock(mutex);
+	num_counters += method.num_counters;
+	num_blocks += method.block_bcis.size();
+	methods.push_back(std::move(method));
+}
+
+void CoverageMap::add_skipped() {
+	std::lock_guard<std::mutex> lock(mutex);
+	++num_skipped;
+}
+
+std::vector<uint64_t> CoverageMap::get_block_counts(const Method& method,
+                                                    const uint64_t* counters) {
+	uint32_t num_vertices = 2 + 2 * method.block_bcis.size();
+	const auto& edges = method.edges;
+	std::vector<int64_t> flows(edges.size(), 0);
+	std::vector<bool> known(edges.size(), false);
+	std::vector<std::vector<uint32_t>> incident(num_vertices);
+	std::vector<uint32_t> num_unknown(num_vertices, 0);
+	for (uint32_t i = 0; i < edges.size(); ++i) {
+		incident[edges[i].from].push_back(i);
+		incident[edges[i].to].push_back(i);
+		if (edges[i].counter != NO_COUNTER) {
+			flows[i] = counters[edges[i].counter];
+			known[i] = true;
+			continue;
+		}
+		++num_unknown[edges[i].from];
+		++num_unknown[edges[i].to];
+	}
+
+	// The edges without counters form a tree, so there's always a vertex
+	// with only one left until they're all known
+	std::vector<uint32_t> pending;
+	for (uint32_t vertex = 0; vertex < num_vertices; ++vertex) {
+		if (num_unknown[vertex] == 1) {
+			pending.push_back(vertex);
+		}
+	}
+	while (!pending.empty()) {
+		uint32_t vertex = pending.back();
+		pending.pop_back();
+		if (num_unknown[vertex] != 1) {
+			continue;
+		}
+		int64_t net = 0;
+		uint32_t unknown = 0;
+		for (uint32_t i : incident[vertex]) {
+			if (!known[i]) {
+				unknown = i;
+				continue;
+			}
+			net += edges[i].to == vertex ? flows[i] : -flows[i];
+		}
+		const Edge& edge = edges[unknown];
+		flows[unknown] = edge.to == vertex ? -net : net;
+		known[unknown] = true;
+		for (uint32_t end : {edge.from, edge.to}) {
+			if (--num_unknown[end] == 1) {
+				pending.push_back(end);
+			}
+		}
+	}
+
+	// Counts that don't add up, from an exception, can go negative
+	std::vector<uint64_t> counts;
+	for (uint32_t block = 0; block < method.block_bcis.size(); ++block) {
+		counts.push_back(flows[block] > 0 ? flows[block] : 0);
+	}
+	return counts;
+}
+
+void CoverageMap::print(FILE* file) const {
+	fprintf(file, "Coverage: %lu methods, %u skipped\n",
+	        static_cast<unsigned long>(methods.size()), num_skipped);
+	uint32_t saved = num_blocks - num_counters;
+	fprintf(file, "  counters: %u for %u blocks, %u saved (%.1f%%)\n",
+	        num_counters, num_blocks, saved,
+	        num_blocks == 0 ? 0.0 : 100.0 * saved / num_blocks);
+}
+
+void CoverageMap::write(FILE* file) const {
+	for (const Method& method : methods) {
+		fprintf(file, "%s %s %s %u %lu", method.class_name.c_str(),
+		        method.name.c_str(), method.descriptor.c_str(),
+		        method.num_counters,
+		        static_cast<unsigned long>(method.block_bcis.size()));
+		for (uint32_t bci : method.block_bcis) {
+			fprintf(file, " %u", bci);
+		}
+		fprintf(file, " %lu", static_cast<unsigned long>(method.edges.size()));
+		for (const Edge& edge : method.edges) {
+			fprintf(file, " %u %u %u", edge.from, edge.to, edge.counter);
+		}
+		fprintf(file, "\n");
+	}
+}
+
+bool CoverageMap::read(FILE* file) {
+	Method method;
+	while (read_token(file, &method.class_name)) {
+		uint32_t size;
+		if (!read_token(file, &method.name)
+		    || !read_token(file, &method.descriptor)
+		    || !read_u32(file, &method.num_counters)
+		    || !read_u32(file, &size)) {
+			return false;
+		}
+		method.block_bcis.resize(size);
+		for (uint32_t& bci : method.block_bcis) {
+			if (!read_u32(file, &bci)) {
+				return false;
+			}
+		}
+		if (!read_u32(file, &size)) {
+			return false;
+		}
+		method.edges.resize(size);
+		for (Edge& edge : method.edges) {
+			if (!read_u32(file, &edge.from)
+			    || !read_u32(file, &edge.to)
+			    || !read_u32(file, &edge.counter)) {
+				return false;
+			}
+		}
+		add(std::move(method));
+		method = Method();
+	}
+	return true;
+}
+
+Coverage::Coverage(const std::string& hook_class,
+                   const std::string& hook_method)
+: hook_class(hook_class), hook_method(hook_method),
+  classes(NameMatcher::Kind::Class), methods(NameMatcher::Kind::Method) {}
+
+void Coverage::compile() {
+	classes.compile();
+	methods.compile();
+}
+
+uint32_t Coverage::apply(ClassFile* class_file, uint32_t first_counter,
+                         CoverageMap* map) const {
+	TransformStats::Timer timer(class_file->get_transform_stats(),
+	                            TransformStats::Phase::Transform);
+	ConstantPool* constant_pool = class_file->get_constant_pool();
+	ConstantPoolUtf8 class_name = constant_pool->get_utf8(
+		constant_pool->get_class(
+			class_file->get_this_class()
+		).get_name_index()
+	);
+	if (!classes.matches(class_name)) {
+		return 0;
+	}
+	// The name's bytes move once the constant pool grows
+	std::string class_name_copy = to_string(class_name);
+
+	uint16_t hook_index = 0;
+	uint32_t num_counters = 0;
+	for (auto& method : class_file->get_methods()->get()) {
+		Code* code = method->get_code();
+		if (!code || !methods.matches(method->get_name_utf8(),
+		                              method->get_descriptor_utf8())) {
+			continue;
+		}
+		ControlFlowGraph graph(code);
+		auto& blocks = graph.get_blocks();
+		if (blocks.empty()) {
+			continue;
+		}
+		if (graph.has_subroutines()) {
+			map->add_skipped();
+			continue;
+		}
+
+		CoverageMap::Method entry;
+		entry.class_name = class_name_copy;
+		entry.name = to_string(method->get_name_utf8());
+		entry.descriptor = to_string(method->get_descriptor_utf8());
+		uint32_t num_blocks = blocks.size();
+		auto& edges = entry.edges;
+		for (uint32_t block = 0; block < num_blocks; ++block) {
+			entry.block_bcis.push_back(blocks[block].start_bci);
+			edges.push_back({get_block_in(block), get_block_out(block),
+			                 CoverageMap::NO_COUNTER});
+		}
+		// Only these can have a counter
+		uint32_t num_countable = edges.size() + 1;
+		edges.push_back({ENTRY, get_block_in(0), CoverageMap::NO_COUNTER});
+		edges.push_back({EXIT, ENTRY, CoverageMap::NO_COUNTER});
+		for (uint32_t block = 0; block < num_blocks; ++block) {
+			for (uint32_t successor : blocks[block].successors) {
+				edges.push_back({get_block_out(block),
+				                 get_block_in(successor),
+				                 CoverageMap::NO_COUNTER});
+			}
+			if (blocks[block].is_exit) {
+				edges.push_back({get_block_out(block), EXIT,
+				                 CoverageMap::NO_COUNTER});
+			}
+			if (blocks[block].is_handler) {
+				edges.push_back({ENTRY, get_block_in(block),
+				                 CoverageMap::NO_COUNTER});
+			}
+		}
+
+		// The edges that can't have a counter go in the tree first, then
+		// the rest from the most to least likely to run often
+		DisjointSets sets(2 + 2 * num_blocks);
+		bool per_block = false;
+		for (uint32_t i = num_countable; i < edges.size(); ++i) {
+			per_block |= !sets.join(edges[i].from, edges[i].to);
+		}
+		std::vector<uint32_t> depths = get_loop_depths(graph);
+		depths.push_back(0);
+		std::vector<uint32_t> order;
+		for (uint32_t i = 0; i < num_countable; ++i) {
+			order.push_back(i);
+		}
+		std::stable_sort(order.begin(), order.end(),
+		                 [&depths](uint32_t a, uint32_t b) {
+			return depths[a] > depths[b];
+		});
+		std::vector<bool> counted(num_countable, false);
+		for (uint32_t i : order) {
+			counted[i] = !sets.join(edges[i].from, edges[i].to);
+		}
+		if (per_block) {
+			std::fill(counted.begin(), counted.end(), true);
+			counted[num_countable - 1] = false;
+		}
+
+		if (hook_index == 0) {
+			hook_index = constant_pool->get_or_create_methodref_index(
+				hook_class.c_str(), hook_method.c_str(), "(I)V"
+			);
+		}
+		// False if the constant pool is full
+		auto encode = [constant_pool, hook_index](uint32_t counter,
+		                                          uint8_t* bytecode) {
+			assert(counter <= INT32_MAX);
+			if (counter <= INT16_MAX) {
+				next_u8(&bytecode, SIPUSH);
+				next_u16(&bytecode, counter);
+			}
+			else {
+				uint16_t index = constant_pool->get_or_create_integer_index(
+					counter
+				);
+				if (index == 0) {
+					return false;
+				}
+				next_u8(&bytecode, LDC_W);
+				next_u16(&bytecode, index);
+			}
+			next_u8(&bytecode, INVOKESTATIC);
+			next_u16(&bytecode, hook_index);
+			return true;
+		};
+
+		// All encoded before any are inserted, so a method is left as it
+		// was if the constant pool fills up
+		std::vector<uint8_t> bytecodes(num_countable * COUNTER_LENGTH);
+		bool encoded = hook_index != 0;
+		uint32_t next_counter = first_counter + num_counters;
+		for (uint32_t i = 0; i < num_countable && encoded; ++i) {
+			if (counted[i]) {
+				encoded = encode(next_counter++,
+				                 &bytecodes[i * COUNTER_LENGTH]);
+			}
+		}
+		if (!encoded) {
+			map->add_skipped();
+			continue;
+		}
+
+		bool has_block_counter = false;
+		entry.num_counters = 0;
+		for (uint32_t i = 0; i < num_countable; ++i) {
+			if (!counted[i]) {
+				continue;
+			}
+			edges[i].counter = first_counter + num_counters;
+			++entry.num_counters;
+			++num_counters;
+			const uint8_t* bytecode = &bytecodes[i * COUNTER_LENGTH];
+			if (i == num_countable - 1) {
+				// Before any block counter at the front, and not run
+				// by jumps back to the first block
+				auto inserter = code->create_front_inserter();
+				inserter.insert_bytecode(bytecode, COUNTER_LENGTH);
+				continue;
+			}
+			Instruction* leader = blocks[i].get_first();
+			Code::InstructionInserter inserter(code, blocks[i].begin);
+			code->retarget(leader,
+			               inserter.insert_bytecode(bytecode,
+			                                        COUNTER_LENGTH));
+			has_block_counter = true;
+		}
+
+		// A block may start with values on the stack, a handler always does
+		if (has_block_counter) {
+			code->set_max_stack(code->get_max_stack() + 1);
+		}
+		else {
+			code->set_max_stack(std::max<uint16_t>(code->get_max_stack(),
+			                                       1));
+		}
+		code->sync();
+		if (code->fix_offsets()) {
+			code->sync();
+		}
+		map->add(std::move(entry));
+	}
+	return num_counters;
+}
@@ -47,6 +47,18 @@ Field::Field(ClassFile* class_file,
 
 Field::~Field() = default;
 
+ConstantPoolUtf8 Field::get_name_utf8() const {
+	return get_constant_pool()->get_utf8(name_index);
+}
+
+ConstantPoolUtf8 Field::get_descriptor_utf8() const {
+	return get_constant_pool()->get_utf8(descriptor_index);
+}
+
+bool Field::is_name(const char* str) const {
+	return get_name_utf8().equals(str);
+}
+
 uint32_t Field::get_byte_size() const {
 	uint32_t result = 0;
 	result += 2; // access
@@ -64,6 +76,13 @@ void Field::write_buffer(uint8_t** buffer) const {
 	attributes->write_buffer(buffer);
 }
 
+void Field::visit_constant_pool_indices(
+	ConstantPoolIndexVisitor& visitor) {
+	visitor.visit(name_index);
+	visitor.visit(descriptor_index);
+	attributes->visit_constant_pool_indices(visitor);
+}
+
 ConstantPool* Field::get_constant_pool() const {
 	return class_file->get_constant_pool();
 }
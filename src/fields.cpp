@@ -23,20 +23,27 @@
 
 using namespace project_rescribo;
 
-Fields::Fields(const uint8_t** buffer, uint16_t count, ClassFile* class_file) {
+Fields::Fields(const uint8_t** buffer, uint16_t count, ClassFile* class_file)
+: byte_size(2) {
 	for (uint32_t i = 0; i < count; ++i) {
-		fields.push_back(std::make_unique<Field>(buffer, class_file));
+		add(std::make_unique<Field>(buffer, class_file));
 	}
 }
 
 Fields::~Fields() = default;
 
-uint32_t Fields::get_byte_size() const {
-	uint32_t result = 2;
-	for (const auto& f : fields) {
-		result += f->get_byte_size();
-	}
-	return result;
+void Fields::add(std::unique_ptr<Field> field) {
+	byte_size += field->get_byte_size();
+	index.add(field.get());
+	fields.push_back(std::move(field));
+}
+
+Field* Fields::find(uint16_t name_index, uint16_t descriptor_index) {
+	return index.find(fields, name_index, descriptor_index);
+}
+
+Field* Fields::find(const char* name, const char* descriptor) {
+	return index.find(fields, name, descriptor);
 }
 
 void Fields::write_buffer(uint8_t** buffer) const {
@@ -45,3 +52,11 @@ void Fields::write_buffer(uint8_t** buffer) const {
 		f->write_buffer(buffer);
 	}
 }
+
+void Fields::visit_constant_pool_indices(
+	ConstantPoolIndexVisitor& visitor) {
+	index.clear();
+	for (auto& f : fields) {
+		f->visit_constant_pool_indices(visitor);
+	}
+}
@@ -803,44 +803,47 @@ ConstantPool* Instruction::get_constant_pool() const {
 	return get_class_file()->get_constant_pool();
 }
 
-int8_t Instruction::get_stack_delta() const {
+uint16_t Instruction::get_variable_byte_size() const {
 	assert(false && "Unimplemented");
 	return 0;
 }
 
-ConstantPoolUtf8* InvokeInstruction::get_descriptor() const {
+int8_t Instruction::get_variable_stack_delta() const {
+	assert(false && "Unimplemented");
+	return 0;
+}
+
+void Instruction::visit_constant_pool_indices(ConstantPoolIndexVisitor&) {
+	assert(false && "Unimplemented");
+}
+
+ConstantPoolUtf8 InvokeInstruction::get_descriptor() const {
 	ConstantPool* constant_pool = get_constant_pool();
-	ConstantPoolEntry* entry = constant_pool->get_entry(get_index());
 	uint16_t name_and_type_index;
-	if (ConstantPoolInterfaceMethodref* interface_methodref
-	    = dyn_cast<ConstantPoolInterfaceMethodref>(entry)) {
-		name_and_type_index
-			= interface_methodref->get_name_and_type_index();
-	}
-	else if (ConstantPoolInvokeDynamic* invoke_dynamic
-	         = dyn_cast<ConstantPoolInvokeDynamic>(entry)) {
-		name_and_type_index = invoke_dynamic->get_name_and_type_index();
-	}
-	else if (ConstantPoolMethodref* methodref
-	         = dyn_cast<ConstantPoolMethodref>(entry)) {
-		name_and_type_index = methodref->get_name_and_type_index();
-	}
-	else {
+	switch (constant_pool->get_kind(get_index())) {
+	case ConstantPoolEntry::Kind::Methodref:
+	case ConstantPoolEntry::Kind::InterfaceMethodref:
+		name_and_type_index = constant_pool->get_ref(
+			get_index()
+		).get_name_and_type_index();
+		break;
+	case ConstantPoolEntry::Kind::InvokeDynamic:
+		name_and_type_index = constant_pool->get_dynamic(
+			get_index()
+		).get_name_and_type_index();
+		break;
+	default:
 		assert(false && "Unexpected constant pool entry");
 	}
-	ConstantPoolNameAndType* name_and_type = cast<ConstantPoolNameAndType>(
-		constant_pool->get_entry(name_and_type_index)
-	);
-	ConstantPoolUtf8* descriptor = cast<ConstantPoolUtf8>(
-		constant_pool->get_entry(name_and_type->get_descriptor_index())
-	);
-	return descriptor;
+	ConstantPoolNameAndType name_and_type
+		= constant_pool->get_name_and_type(name_and_type_index);
+	return constant_pool->get_utf8(name_and_type.get_descriptor_index());
 }
 
 uint16_t InvokeInstruction::get_num_args() const {
-	ConstantPoolUtf8* descriptor = get_descriptor();
-	const uint8_t* data = descriptor->get_data();
-	uint16_t length = descriptor->get_length();
+	ConstantPoolUtf8 descriptor = get_descriptor();
+	const uint8_t* data = descriptor.get_data();
+	uint16_t length = descriptor.get_length();
 	uint16_t num_args = 0;
 	bool is_class = false;
 	assert(data[0] == '(');
@@ -894,13 +897,13 @@ uint16_t InvokeInstruction::get_num_args() const {
 }
 
 bool InvokeInstruction::is_void() const {
-	ConstantPoolUtf8* descriptor = get_descriptor();
-	const uint8_t* data = descriptor->get_data();
-	uint16_t length = descriptor->get_length();
+	ConstantPoolUtf8 descriptor = get_descriptor();
+	const uint8_t* data = descriptor.get_data();
+	uint16_t length = descriptor.get_length();
 	return data[length - 1] == 'V';
 }
 
-int8_t InvokeInstruction::get_stack_delta() const {
+int8_t InvokeInstruction::get_variable_stack_delta() const {
 	uint16_t num_args = get_num_args();
 	assert(num_args < INT8_MAX);
 	int8_t stack_delta = -num_args;
@@ -933,7 +936,7 @@ bool BranchInstruction::is_invalid_offset() const {
 	}
 }
 
-uint16_t Goto::get_byte_size() const {
+uint16_t Goto::get_variable_byte_size() const {
 	if (!extended) {
 		return 3;
 	}
@@ -960,13 +963,13 @@ const char* If_ICmpNe::get_mnemonic() const {
 	}
 }
 
-uint16_t LookupSwitch::get_byte_size() const {
+uint16_t LookupSwitch::get_variable_byte_size() const {
 	uint32_t result = 1 + padding + 8 + matches.size() * 8;
 	assert(result <= UINT16_MAX);
 	return result;
 }
 
-uint16_t TableSwitch::get_byte_size() const {
+uint16_t TableSwitch::get_variable_byte_size() const {
 	uint32_t result = 1 + padding + 12 + (high - low + 1) * 4;
 	assert(result <= UINT16_MAX);
 	return result;
@@ -1867,72 +1870,141 @@ void TableSwitch::write_buffer(uint8_t** buffer) const {
 void WideALoad::write_buffer(uint8_t** buffer) const {
 	next_u8(buffer, static_cast<uint8_t>(get_kind()));
 	next_u8(buffer, static_cast<uint8_t>(Kind::ALoad));
-	next_u16(buffer, index);
+	next_u16(buffer, get_index());
 }
 
 void WideAStore::write_buffer(uint8_t** buffer) const {
 	next_u8(buffer, static_cast<uint8_t>(get_kind()));
 	next_u8(buffer, static_cast<uint8_t>(Kind::AStore));
-	next_u16(buffer, index);
+	next_u16(buffer, get_index());
 }
 
 void WideDLoad::write_buffer(uint8_t** buffer) const {
 	next_u8(buffer, static_cast<uint8_t>(get_kind()));
 	next_u8(buffer, static_cast<uint8_t>(Kind::DLoad));
-	next_u16(buffer, index);
+	next_u16(buffer, get_index());
 }
 
 void WideDStore::write_buffer(uint8_t** buffer) const {
 	next_u8(buffer, static_cast<uint8_t>(get_kind()));
 	next_u8(buffer, static_cast<uint8_t>(Kind::DStore));
-	next_u16(buffer, index);
+	next_u16(buffer, get_index());
 }
 
 void WideFLoad::write_buffer(uint8_t** buffer) const {
 	next_u8(buffer, static_cast<uint8_t>(get_kind()));
 	next_u8(buffer, static_cast<uint8_t>(Kind::FLoad));
-	next_u16(buffer, index);
+	next_u16(buffer, get_index());
 }
 
 void WideFStore::write_buffer(uint8_t** buffer) const {
 	next_u8(buffer, static_cast<uint8_t>(get_kind()));
 	next_u8(buffer, static_cast<uint8_t>(Kind::FStore));
-	next_u16(buffer, index);
+	next_u16(buffer, get_index());
 }
 
 void WideIInc::write_buffer(uint8_t** buffer) const {
 	next_u8(buffer, static_cast<uint8_t>(get_kind()));
 	next_u8(buffer, static_cast<uint8_t>(Kind::IInc));
-	next_u16(buffer, index);
+	next_u16(buffer, get_index());
 	next_u16(buffer, value);
 }
 
 void WideILoad::write_buffer(uint8_t** buffer) const {
 	next_u8(buffer, static_cast<uint8_t>(get_kind()));
 	next_u8(buffer, static_cast<uint8_t>(Kind::ILoad));
-	next_u16(buffer, index);
+	next_u16(buffer, get_index());
 }
 
 void WideIStore::write_buffer(uint8_t** buffer) const {
 	next_u8(buffer, static_cast<uint8_t>(get_kind()));
 	next_u8(buffer, static_cast<uint8_t>(Kind::IStore));
-	next_u16(buffer, index);
+	next_u16(buffer, get_index());
 }
 
 void WideLLoad::write_buffer(uint8_t** buffer) const {
 	next_u8(buffer, static_cast<uint8_t>(get_kind()));
 	next_u8(buffer, static_cast<uint8_t>(Kind::LLoad));
-	next_u16(buffer, index);
+	next_u16(buffer, get_index());
 }
 
 void WideLStore::write_buffer(uint8_t** buffer) const {
 	next_u8(buffer, static_cast<uint8_t>(get_kind()));
 	next_u8(buffer, static_cast<uint8_t>(Kind::LStore));
-	next_u16(buffer, index);
+	next_u16(buffer, get_index());
 }
 
 void WideRet::write_buffer(uint8_t** buffer) const {
 	next_u8(buffer, static_cast<uint8_t>(get_kind()));
 	next_u8(buffer, static_cast<uint8_t>(Kind::Ret));
-	next_u16(buffer, index);
+	next_u16(buffer, get_index());
+}
+
+void InvokeInstruction::visit_constant_pool_indices(
+	ConstantPoolIndexVisitor& visitor) {
+	visitor.visit(index);
+}
+
+void ANewArray::visit_constant_pool_indices(
+	ConstantPoolIndexVisitor& visitor) {
+	visitor.visit(index);
+}
+
+void CheckCast::visit_constant_pool_indices(
+	ConstantPoolIndexVisitor& visitor) {
+	visitor.visit(index);
+}
+
+void GetField::visit_constant_pool_indices(
+	ConstantPoolIndexVisitor& visitor) {
+	visitor.visit(index);
+}
+
+void GetStatic::visit_constant_pool_indices(
+	ConstantPoolIndexVisitor& visitor) {
+	visitor.visit(index);
+}
+
+void InstanceOf::visit_constant_pool_indices(
+	ConstantPoolIndexVisitor& visitor) {
+	visitor.visit(index);
+}
+
+void Ldc::visit_constant_pool_indices(
+	ConstantPoolIndexVisitor& visitor) {
+	uint16_t wide_index = index;
+	visitor.visit(wide_index);
+	// Compaction only moves entries down, so this still fits
+	assert(wide_index <= UINT8_MAX);
+	index = wide_index;
+}
+
+void Ldc2_W::visit_constant_pool_indices(
+	ConstantPoolIndexVisitor& visitor) {
+	visitor.visit(index);
+}
+
+void Ldc_W::visit_constant_pool_indices(
+	ConstantPoolIndexVisitor& visitor) {
+	visitor.visit(index);
+}
+
+void MultiANewArray::visit_constant_pool_indices(
+	ConstantPoolIndexVisitor& visitor) {
+	visitor.visit(index);
+}
+
+void New::visit_constant_pool_indices(
+	ConstantPoolIndexVisitor& visitor) {
+	visitor.visit(index);
+}
+
+void PutField::visit_constant_pool_indices(
+	ConstantPoolIndexVisitor& visitor) {
+	visitor.visit(index);
+}
+
+void PutStatic::visit_constant_pool_indices(
+	ConstantPoolIndexVisitor& visitor) {
+	visitor.visit(index);
 }
@@ -17,6 +17,7 @@
 #include "interfaces.hpp"
 
 #include "buffer.hpp"
+#include "constant_pool_entry.hpp"
 
 using namespace project_rescribo;
 
@@ -40,3 +41,10 @@ void Interfaces::write_buffer(uint8_t** buffer) const {
 		next_u16(buffer, interface);
 	}
 }
+
+void Interfaces::visit_constant_pool_indices(
+	ConstantPoolIndexVisitor& visitor) {
+	for (auto& interface : interfaces) {
+		visitor.visit(interface);
+	}
+}
@@ -0,0 +1,88 @@
+/*
+ * Copyright 2019-2020 Jonathan Eyolfson
+ *
+ * This program is free software: you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License version 3 as published by the
+ * Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE. See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "jit_budget.hpp"
+
+using namespace project_rescribo;
+
+namespace {
+
+const char* LIMIT_NAMES[JitBudget::NUM_LIMITS] = {
+	"MaxInlineSize",
+	"FreqInlineSize",
+	"HugeMethodLimit",
+};
+
+}
+
+JitBudget::JitBudget() : limits{35, 325, 8000}, num_checked(0) {}
+
+bool JitBudget::crosses(uint32_t old_size, uint32_t new_size,
+                        Limit* limit) const {
+	for (size_t i = 0; i < NUM_LIMITS; ++i) {
+		if (old_size <= limits[i] && new_size > limits[i]) {
+			*limit = static_cast<Limit>(i);
+			return true;
+		}
+	}
+	return false;
+}
+
+void JitBudget::add(Method&& method) {
+	std::lock_guard<std::mutex> lock(mutex);
+	methods.push_back(std::move(method));
+}
+
+void JitBudget::add_checked() {
+	std::lock_guard<std::mutex> lock(mutex);
+	++num_checked;
+}
+
+std::vector<JitBudget::Method> JitBudget::get_methods() const {
+	std::lock_guard<std::mutex> lock(mutex);
+	return methods;
+}
+
+uint32_t JitBudget::get_num_checked() const {
+	std::lock_guard<std::mutex> lock(mutex);
+	return num_checked;
+}
+
+void JitBudget::print(FILE* file) const {
+	std::lock_guard<std::mutex> lock(mutex);
+	uint32_t num_crossed[NUM_LIMITS] = {};
+	uint32_t num_fell_back = 0;
+	for (const Method& method : methods) {
+		++num_crossed[static_cast<size_t>(method.limit)];
+		num_fell_back += method.fell_back;
+	}
+	fprintf(file, "JIT budget: %u methods, %lu crossed a limit, "
+	              "%u fell back\n",
+	        num_checked, static_cast<unsigned long>(methods.size()),
+	        num_fell_back);
+	for (size_t i = 0; i < NUM_LIMITS; ++i) {
+		fprintf(file, "  %-15s %5u bytes: %u\n", LIMIT_NAMES[i],
+		        limits[i], num_crossed[i]);
+	}
+	for (const Method& method : methods) {
+		fprintf(file, "  %s.%s%s %u -> %u, over %s%s\n",
+		        method.class_name.c_str(), method.name.c_str(),
+		        method.descriptor.c_str(), method.old_size,
+		        method.new_size,
+		        LIMIT_NAMES[static_cast<size_t>(method.limit)],
+		        method.fell_back ? ", fell back" : "");
+	}
+}
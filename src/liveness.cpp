@@ -0,0 +1,328 @@
+/*
+ * Copyright 2019-2020 Jonathan Eyolfson
+ *
+ * This program is free software: you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License version 3 as published by the
+ * Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE. See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "liveness.hpp"
+
+#include "casting.hpp"
+#include "instruction.hpp"
+
+#include <algorithm>
+#include <cassert>
+
+using namespace project_rescribo;
+
+namespace {
+
+constexpr uint8_t ILOAD = static_cast<uint8_t>(Instruction::Kind::ILoad);
+constexpr uint8_t ILOAD_0 = static_cast<uint8_t>(Instruction::Kind::ILoad_0);
+constexpr uint8_t ALOAD_3 = static_cast<uint8_t>(Instruction::Kind::ALoad_3);
+constexpr uint8_t ISTORE = static_cast<uint8_t>(Instruction::Kind::IStore);
+constexpr uint8_t ISTORE_0
+	= static_cast<uint8_t>(Instruction::Kind::IStore_0);
+constexpr uint8_t ASTORE_3
+	= static_cast<uint8_t>(Instruction::Kind::AStore_3);
+
+struct LocalAccess {
+	uint16_t index;
+	uint8_t size;
+	bool is_use;
+	bool is_def;
+};
+
+// Loads and stores come in the order int, long, float, double, reference
+uint8_t get_size(uint8_t type) {
+	return (type == 1 || type == 3) ? 2 : 1;
+}
+
+uint16_t get_index(const Instruction* instruction) {
+	switch (instruction->get_kind()) {
+	case Instruction::Kind::ILoad:
+		return cast<ILoad>(instruction)->get_index();
+	case Instruction::Kind::LLoad:
+		return cast<LLoad>(instruction)->get_index();
+	case Instruction::Kind::FLoad:
+		return cast<FLoad>(instruction)->get_index();
+	case Instruction::Kind::DLoad:
+		return cast<DLoad>(instruction)->get_index();
+	case Instruction::Kind::ALoad:
+		return cast<ALoad>(instruction)->get_index();
+	case Instruction::Kind::IStore:
+		return cast<IStore>(instruction)->get_index();
+	case Instruction::Kind::LStore:
+		return cast<LStore>(instruction)->get_index();
+	case Instruction::Kind::FStore:
+		return cast<FStore>(instruction)->get_index();
+	case Instruction::Kind::DStore:
+		return cast<DStore>(instruction)->get_index();
+	case Instruction::Kind::AStore:
+		return cast<AStore>(instruction)->get_index();
+	case Instruction::Kind::IInc:
+		return cast<IInc>(instruction)->get_index();
+	case Instruction::Kind::Ret:
+		return cast<Ret>(instruction)->get_index();
+	case Instruction::Kind::Wide:
+		return cast<WideInstruction>(instruction)->get_index();
+	default:
+		assert(false && "Not a local variable instruction");
+		return 0;
+	}
+}
+
+bool get_local_access(const Instruction* instruction, LocalAccess* access) {
+	uint8_t opcode = static_cast<uint8_t>(instruction->get_kind());
+	if (const WideInstruction* wide
+	    = dyn_cast<WideInstruction>(instruction)) {
+		opcode = static_cast<uint8_t>(wide->get_modified_kind());
+	}
+	if (opcode >= ILOAD && opcode < ILOAD_0) {
+		*access = {get_index(instruction), get_size(opcode - ILOAD),
+		           true, false};
+	}
+	else if (opcode >= ILOAD_0 && opcode <= ALOAD_3) {
+		uint8_t offset = opcode - ILOAD_0;
+		*access = {static_cast<uint16_t>(offset % 4),
+		           get_size(offset / 4), true, false};
+	}
+	else if (opcode >= ISTORE && opcode < ISTORE_0) {
+		*access = {get_index(instruction), get_size(opcode - ISTORE),
+		           false, true};
+	}
+	else if (opcode >= ISTORE_0 && opcode <= ASTORE_3) {
+		uint8_t offset = opcode - ISTORE_0;
+		*access = {static_cast<uint16_t>(offset % 4),
+		           get_size(offset / 4), false, true};
+	}
+	else if (opcode == static_cast<uint8_t>(Instruction::Kind::IInc)) {
+		*access = {get_index(instruction), 1, true, true};
+	}
+	else if (opcode == static_cast<uint8_t>(Instruction::Kind::Ret)) {
+		*access = {get_index(instruction), 1, true, false};
+	}
+	else {
+		return false;
+	}
+	return true;
+}
+
+void set_bit(uint64_t* bits, uint32_t index) {
+	bits[index / 64] |= uint64_t(1) << (index % 64);
+}
+
+void clear_bit(uint64_t* bits, uint32_t index) {
+	bits[index / 64] &= ~(uint64_t(1) << (index % 64));
+}
+
+bool test_bit(const uint64_t* bits, uint32_t index) {
+	return (bits[index / 64] >> (index % 64)) & 1;
+}
+
+void add_accessed(const Instruction* instruction, uint64_t* used) {
+	LocalAccess access;
+	if (!get_local_access(instruction, &access)) {
+		return;
+	}
+	for (uint32_t i = 0; i < access.size; ++i) {
+		set_bit(used, access.index + i);
+	}
+}
+
+// Steps back over the instruction, from what's live after it to before
+void transfer(const Instruction* instruction, uint64_t* live) {
+	LocalAccess access;
+	if (!get_local_access(instruction, &access)) {
+		return;
+	}
+	for (uint32_t i = 0; i < access.size; ++i) {
+		if (access.is_def) {
+			clear_bit(live, access.index + i);
+		}
+		if (access.is_use) {
+			set_bit(live, access.index + i);
+		}
+	}
+}
+
+}
+
+Liveness::Liveness(Code* code)
+: graph(code), num_locals(code->get_max_locals()),
+  num_words((num_locals + 63) / 64) {
+	const auto& blocks = graph.get_blocks();
+	size_t size = blocks.size() * num_words;
+	uses.assign(size, 0);
+	defs.assign(size, 0);
+	live_in.assign(size, 0);
+	live_out.assign(size, 0);
+	if (graph.has_subroutines()) {
+		std::fill(live_in.begin(), live_in.end(), ~uint64_t(0));
+		std::fill(live_out.begin(), live_out.end(), ~uint64_t(0));
+		return;
+	}
+
+	// What a block reads before writing, and what it writes
+	std::vector<std::vector<uint32_t>> covered(blocks.size());
+	for (uint32_t b = 0; b < blocks.size(); ++b) {
+		uint64_t* block_uses = &uses[b * num_words];
+		uint64_t* block_defs = &defs[b * num_words];
+		for (auto iter = blocks[b].begin; iter != blocks[b].end;
+		     ++iter) {
+			LocalAccess access;
+			if (!get_local_access(iter->get(), &access)) {
+				continue;
+			}
+			for (uint32_t i = 0; i < access.size; ++i) {
+				uint32_t index = access.index + i;
+				if (access.is_use && !test_bit(block_defs, index)) {
+					set_bit(block_uses, index);
+				}
+				if (access.is_def) {
+					set_bit(block_defs, index);
+				}
+			}
+		}
+		for (uint32_t handler : blocks[b].handlers) {
+			covered[handler].push_back(b);
+		}
+	}
+
+	// Blocks are mostly in order, so going backwards settles most of
+	// them in one pass
+	std::vector<uint32_t> pending;
+	std::vector<bool> is_pending(blocks.size(), true);
+	for (uint32_t b = 0; b < blocks.size(); ++b) {
+		pending.push_back(b);
+	}
+	Bits in(num_words);
+	while (!pending.empty()) {
+		uint32_t b = pending.back();
+		pending.pop_back();
+		is_pending[b] = false;
+
+		uint64_t* out = &live_out[b * num_words];
+		for (uint32_t successor : blocks[b].successors) {
+			const uint64_t* successor_in = &live_in[successor
+			                                        * num_words];
+			for (uint32_t w = 0; w < num_words; ++w) {
+				out[w] |= successor_in[w];
+			}
+		}
+		for (uint32_t w = 0; w < num_words; ++w) {
+			in[w] = uses[b * num_words + w]
+			        | (out[w] & ~defs[b * num_words + w]);
+		}
+		add_handlers(b, in.data());
+
+		uint64_t* block_in = &live_in[b * num_words];
+		if (std::equal(in.begin(), in.end(), block_in)) {
+			continue;
+		}
+		std::copy(in.begin(), in.end(), block_in);
+		for (uint32_t predecessor : blocks[b].predecessors) {
+			if (!is_pending[predecessor]) {
+				is_pending[predecessor] = true;
+				pending.push_back(predecessor);
+			}
+		}
+		for (uint32_t block : covered[b]) {
+			if (!is_pending[block]) {
+				is_pending[block] = true;
+				pending.push_back(block);
+			}
+		}
+	}
+}
+
+void Liveness::add_handlers(uint32_t block, uint64_t* live) const {
+	for (uint32_t handler : graph.get_blocks()[block].handlers) {
+		const uint64_t* handler_in = &live_in[handler * num_words];
+		for (uint32_t w = 0; w < num_words; ++w) {
+			live[w] |= handler_in[w];
+		}
+	}
+}
+
+// Blocks are in bytecode order
+uint32_t Liveness::find_block(const Instruction* instruction) const {
+	const auto& blocks = graph.get_blocks();
+	uint32_t bci = instruction->get_bci();
+	auto it = std::upper_bound(
+		blocks.begin(), blocks.end(), bci,
+		[](uint32_t bci, const ControlFlowGraph::Block& block) {
+			return bci < block.start_bci;
+		}
+	);
+	assert(it != blocks.begin());
+	return std::prev(it) - blocks.begin();
+}
+
+Liveness::Bits Liveness::get_live_before(
+	const Instruction* instruction
+) const {
+	uint32_t b = find_block(instruction);
+	Bits live(live_out.begin() + b * num_words,
+	          live_out.begin() + (b + 1) * num_words);
+	if (graph.has_subroutines()) {
+		return live;
+	}
+	const auto& block = graph.get_blocks()[b];
+	auto iter = block.end;
+	do {
+		--iter;
+		transfer(iter->get(), live.data());
+		add_handlers(b, live.data());
+	} while (iter->get() != instruction);
+	return live;
+}
+
+bool Liveness::is_live_before(const Instruction* instruction,
+                              uint16_t index) const {
+	Bits live = get_live_before(instruction);
+	return test_bit(live.data(), index);
+}
+
+Liveness::Bits Liveness::get_used_between(const Instruction* begin,
+                                          const Instruction* end) const {
+	const auto& blocks = graph.get_blocks();
+	uint32_t begin_bci = begin->get_bci();
+	uint32_t end_bci = end ? end->get_bci() : blocks.back().end_bci;
+	Bits used(num_words);
+	if (graph.has_subroutines()) {
+		std::fill(used.begin(), used.end(), ~uint64_t(0));
+		return used;
+	}
+	Bits live(num_words);
+	for (uint32_t b = find_block(begin);
+	     b < blocks.size() && blocks[b].start_bci < end_bci; ++b) {
+		std::copy(live_out.begin() + b * num_words,
+		          live_out.begin() + (b + 1) * num_words, live.begin());
+		auto iter = blocks[b].end;
+		while (iter != blocks[b].begin) {
+			--iter;
+			const Instruction* instruction = iter->get();
+			transfer(instruction, live.data());
+			add_handlers(b, live.data());
+			uint32_t bci = instruction->get_bci();
+			if (bci < begin_bci || bci >= end_bci) {
+				continue;
+			}
+			add_accessed(instruction, used.data());
+			for (uint32_t w = 0; w < num_words; ++w) {
+				used[w] |= live[w];
+			}
+		}
+	}
+	return used;
+}
@@ -22,13 +22,15 @@
 #include "class_file.hpp"
 #include "code.hpp"
 #include "constant_pool.hpp"
+#include "methods.hpp"
 
 #include <cassert>
 
 using namespace project_rescribo;
 
 Method::Method(const uint8_t** buffer, ClassFile* class_file)
-: class_file(class_file), code(nullptr) {
+: class_file(class_file), is_byte_size_current(false), input(*buffer),
+  code(nullptr) {
 	access = Access(next_u16(buffer));
 	name_index = next_u16(buffer);
 	descriptor_index = next_u16(buffer);
@@ -43,13 +45,15 @@ Method::Method(const uint8_t** buffer, ClassFile* class_file)
 			code = c;
 		}
 	}
+	input_size = *buffer - input;
 }
 
 Method::Method(ClassFile* class_file,
                Access access,
                const char *name,
 	       const char* descriptor)
-: class_file(class_file), access(access), code(nullptr) {
+: class_file(class_file), access(access), is_byte_size_current(false),
+  input(nullptr), input_size(0), code(nullptr) {
 	ConstantPool* constant_pool = class_file->get_constant_pool();
 	name_index = constant_pool->get_or_create_utf8_index(name);
 	descriptor_index = constant_pool->get_or_create_utf8_index(descriptor);
@@ -66,13 +70,30 @@ ConstantPool* Method::get_constant_pool() const {
 }
 
 uint32_t Method::get_byte_size() const {
-	uint32_t result = 0;
-	result += 2; // access
-	result += 2; // name_index
-	result += 2; // descriptor_index
-	result += 2; // attributes_count
-	result += attributes->get_byte_size();
-	return result;
+	if (is_byte_size_current) {
+		return byte_size;
+	}
+	byte_size = 0;
+	byte_size += 2; // access
+	byte_size += 2; // name_index
+	byte_size += 2; // descriptor_index
+	byte_size += 2; // attributes_count
+	byte_size += attributes->get_byte_size();
+	is_byte_size_current = true;
+	return byte_size;
+}
+
+bool Method::is_unchanged() const {
+	return input != nullptr && (code == nullptr || code->is_unchanged());
+}
+
+// A method that was never computed isn't counted by Methods yet
+void Method::invalidate_byte_size() {
+	if (!is_byte_size_current) {
+		return;
+	}
+	is_byte_size_current = false;
+	class_file->get_methods()->invalidate_byte_size(this, byte_size);
 }
 
 void Method::write_buffer(uint8_t** buffer) const {
@@ -82,22 +103,25 @@ void Method::write_buffer(uint8_t** buffer) const {
 	attributes->write_buffer(buffer);
 }
 
-ConstantPoolUtf8* Method::get_name_utf8() const {
-	return cast<ConstantPoolUtf8>(
-		get_constant_pool()->get_entry(name_index)
-	);
+void Method::visit_constant_pool_indices(
+	ConstantPoolIndexVisitor& visitor) {
+	visitor.visit(name_index);
+	visitor.visit(descriptor_index);
+	attributes->visit_constant_pool_indices(visitor);
+}
+
+ConstantPoolUtf8 Method::get_name_utf8() const {
+	return get_constant_pool()->get_utf8(name_index);
 }
 
-ConstantPoolUtf8* Method::get_descriptor_utf8() const {
-	return cast<ConstantPoolUtf8>(
-		get_constant_pool()->get_entry(descriptor_index)
-	);
+ConstantPoolUtf8 Method::get_descriptor_utf8() const {
+	return get_constant_pool()->get_utf8(descriptor_index);
 }
 
 bool Method::is_name(const char* str) const {
-	return get_name_utf8()->equals(str);
+	return get_name_utf8().equals(str);
 }
 
 void Method::print() const {
-	get_name_utf8()->print();
+	get_name_utf8().print();
 }
@@ -17,28 +17,167 @@
 #include "methods.hpp"
 
 #include "buffer.hpp"
+#include "class_file.hpp"
+#include "code.hpp"
+#include "constant_pool.hpp"
 #include "method.hpp"
 
+#include <algorithm>
+#include <atomic>
 #include <cassert>
+#include <thread>
 
 using namespace project_rescribo;
 
+namespace {
+
+// Fewer than this per thread and starting the threads costs more than it saves
+constexpr uint32_t MIN_METHODS_PER_THREAD = 64;
+// Taken by a thread at a time, so a few large methods don't leave the others
+// waiting
+constexpr uint32_t METHODS_PER_BATCH = 16;
+
+// Past a method_info, only reading the lengths of its attributes
+const uint8_t* skip_method(const uint8_t* buffer) {
+	buffer += 6; // access, name_index, descriptor_index
+	uint16_t attributes_count = next_u16(&buffer);
+	for (uint32_t i = 0; i < attributes_count; ++i) {
+		buffer += 2; // attribute_name_index
+		uint32_t attribute_length = next_u32(&buffer);
+		buffer += attribute_length;
+	}
+	return buffer;
+}
+
+}
+
 Methods::Methods(const uint8_t** buffer,
                  uint16_t count,
-                 ClassFile* class_file) {
-	for (uint32_t i = 0; i < count; ++i) {
-		methods.push_back(std::make_unique<Method>(buffer, class_file));
+                 ClassFile* class_file,
+                 uint32_t num_threads)
+: byte_size(2) {
+	num_threads = std::min<uint32_t>(num_threads,
+	                                 count / MIN_METHODS_PER_THREAD);
+	if (num_threads > 1) {
+		decode(buffer, count, class_file, num_threads);
 	}
+	else {
+		for (uint32_t i = 0; i < count; ++i) {
+			add(std::make_unique<Method>(buffer, class_file));
+		}
+	}
+
+	uint32_t num_instructions = 0;
+	for (const auto& method : methods) {
+		if (Code* code = method->get_code()) {
+			num_instructions += code->get_instructions().size();
+		}
+	}
+	class_file->get_transform_stats()->add_input_instructions(
+		num_instructions
+	);
 }
 
 Methods::~Methods() = default;
 
+// It may have changed before it was added, but that's counted here
+void Methods::add(std::unique_ptr<Method> method) {
+	Method* added = method.get();
+	changed.erase(
+		std::remove_if(changed.begin(), changed.end(),
+		               [added](const std::pair<Method*, uint32_t>& entry) {
+		                       return entry.first == added;
+		               }),
+		changed.end()
+	);
+	byte_size += added->get_byte_size();
+	index.add(added);
+	methods.push_back(std::move(method));
+}
+
+// A method computed in between changes is listed again, only its first
+// old size is the one that was counted
 uint32_t Methods::get_byte_size() const {
-	uint32_t result = 2;
-	for (const auto& m : methods) {
-		result += m->get_byte_size();
+	std::stable_sort(changed.begin(), changed.end(),
+	                 [](const std::pair<Method*, uint32_t>& a,
+	                    const std::pair<Method*, uint32_t>& b) {
+	                         return a.first < b.first;
+	                 });
+	Method* previous = nullptr;
+	for (const auto& entry : changed) {
+		if (entry.first == previous) {
+			continue;
+		}
+		previous = entry.first;
+		byte_size += entry.first->get_byte_size() - entry.second;
+	}
+	changed.clear();
+	return byte_size;
+}
+
+// Once the constant pool is decoded each method only reads it, so after
+// finding where every method starts they're decoded independently, then
+// added in order as a serial parse would
+void Methods::decode(const uint8_t** buffer, uint16_t count,
+                     ClassFile* class_file, uint32_t num_threads) {
+	std::vector<const uint8_t*> starts(count + 1);
+	starts[0] = *buffer;
+	for (uint32_t i = 0; i < count; ++i) {
+		starts[i + 1] = skip_method(starts[i]);
+	}
+	class_file->get_constant_pool()->resolve_attribute_kinds();
+
+	std::vector<std::unique_ptr<Method>> decoded(count);
+	std::atomic<uint32_t> next_batch(0);
+	auto decode_batches = [&]() {
+		AllocationStats::Scope allocation_scope(
+			class_file, AllocationStats::Phase::Other
+		);
+		while (true) {
+			uint32_t begin = next_batch.fetch_add(
+				METHODS_PER_BATCH, std::memory_order_relaxed
+			);
+			if (begin >= count) {
+				break;
+			}
+			uint32_t end = std::min<uint32_t>(begin + METHODS_PER_BATCH,
+			                                  count);
+			for (uint32_t i = begin; i < end; ++i) {
+				const uint8_t* method_buffer = starts[i];
+				decoded[i] = std::make_unique<Method>(&method_buffer,
+				                                      class_file);
+				assert(method_buffer == starts[i + 1]);
+				decoded[i]->get_byte_size();
+			}
+		}
+	};
+	// This thread is one of them
+	std::vector<std::thread> threads;
+	for (uint32_t i = 1; i < num_threads; ++i) {
+		threads.emplace_back(decode_batches);
 	}
-	return result;
+	decode_batches();
+	for (auto& thread : threads) {
+		thread.join();
+	}
+
+	methods.reserve(count);
+	for (auto& method : decoded) {
+		add(std::move(method));
+	}
+	*buffer = starts[count];
+}
+
+void Methods::invalidate_byte_size(Method* method, uint32_t old_byte_size) {
+	changed.emplace_back(method, old_byte_size);
+}
+
+Method* Methods::find(uint16_t name_index, uint16_t descriptor_index) {
+	return index.find(methods, name_index, descriptor_index);
+}
+
+Method* Methods::find(const char* name, const char* descriptor) {
+	return index.find(methods, name, descriptor);
 }
 
 void Methods::write_buffer(uint8_t** buffer) const {
@@ -47,3 +186,11 @@ void Methods::write_buffer(uint8_t** buffer) const {
 		m->write_buffer(buffer);
 	}
 }
+
+void Methods::visit_constant_pool_indices(
+	ConstantPoolIndexVisitor& visitor) {
+	index.clear();
+	for (auto& m : methods) {
+		m->visit_constant_pool_indices(visitor);
+	}
+}
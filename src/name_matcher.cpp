@@ -0,0 +1,279 @@
+/*
+ * Copyright 2019-2020 Jonathan Eyolfson
+ *
+ * This program is free software: you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License version 3 as published by the
+ * Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE. See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "name_matcher.hpp"
+
+#include "constant_pool_entry.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <map>
+
+using namespace project_rescribo;
+
+namespace {
+
+// Tokens below 256 are a literal byte
+constexpr uint16_t ANY_BYTE = 256;
+constexpr uint16_t ANY_SEGMENT = 257;
+constexpr uint16_t ANY_RUN = 258;
+
+constexpr uint8_t ACCEPT = 1 << 0;
+// Every byte leads back to the same state, so the answer can't change
+constexpr uint8_t DECIDED = 1 << 1;
+
+constexpr uint32_t DEAD_STATE = 0;
+constexpr uint32_t START_STATE = 1;
+
+// An NFA state is a rule and a position in its tokens, packed together
+typedef std::vector<uint32_t> PositionSet;
+
+uint32_t pack_position(uint32_t rule, uint32_t position) {
+	assert(rule < (1 << 16) && position < (1 << 16));
+	return (rule << 16) | position;
+}
+
+bool is_repeat(uint16_t token) {
+	return token == ANY_SEGMENT || token == ANY_RUN;
+}
+
+}
+
+NameMatcher::NameMatcher(Kind kind) : kind(kind) {}
+
+void NameMatcher::include(const std::string& pattern) {
+	include_rules.push_back(parse(pattern));
+}
+
+void NameMatcher::exclude(const std::string& pattern) {
+	exclude_rules.push_back(parse(pattern));
+}
+
+NameMatcher::Rule NameMatcher::parse(const std::string& pattern) const {
+	Rule rule;
+	bool has_descriptor = false;
+	for (size_t i = 0; i < pattern.size(); ++i) {
+		uint8_t byte = pattern[i];
+		if (byte == '*') {
+			if (i + 1 < pattern.size() && pattern[i + 1] == '*') {
+				rule.push_back(ANY_RUN);
+				++i;
+			}
+			else {
+				rule.push_back(ANY_SEGMENT);
+			}
+			// Consecutive repeats are the same as the widest one
+			while (rule.size() > 1 && is_repeat(rule[rule.size() - 2])) {
+				uint16_t last = rule.back();
+				rule.pop_back();
+				if (last == ANY_RUN) {
+					rule.back() = ANY_RUN;
+				}
+			}
+		}
+		else if (byte == '?') {
+			rule.push_back(ANY_BYTE);
+		}
+		else if (byte == '.' && kind == Kind::Class) {
+			rule.push_back('/');
+		}
+		else {
+			if (byte == '(') {
+				has_descriptor = true;
+			}
+			rule.push_back(byte);
+		}
+	}
+	if (kind == Kind::Method && !has_descriptor) {
+		rule.push_back('(');
+		rule.push_back(ANY_RUN);
+	}
+	return rule;
+}
+
+// Bytes no rule tells apart share a column in the transition tables
+void NameMatcher::compile() {
+	if (include_rules.empty()) {
+		include_rules.push_back(parse("**"));
+	}
+
+	bool is_literal[256] = {};
+	is_literal['/'] = true;
+	for (const auto* rules : {&include_rules, &exclude_rules}) {
+		for (const auto& rule : *rules) {
+			for (uint16_t token : rule) {
+				if (token < 256) {
+					is_literal[token] = true;
+				}
+			}
+		}
+	}
+	representatives.clear();
+	int16_t other_class = -1;
+	for (uint32_t byte = 0; byte < 256; ++byte) {
+		if (is_literal[byte]) {
+			byte_classes[byte] = representatives.size();
+			representatives.push_back(byte);
+			continue;
+		}
+		if (other_class < 0) {
+			other_class = representatives.size();
+			representatives.push_back(byte);
+		}
+		byte_classes[byte] = other_class;
+	}
+
+	compile(include_rules, &includes);
+	compile(exclude_rules, &excludes);
+}
+
+// Subset construction, leaving the DFA empty if there aren't any rules
+void NameMatcher::compile(const std::vector<Rule>& rules, Dfa* dfa) {
+	dfa->flags.clear();
+	dfa->transitions.clear();
+	if (rules.empty()) {
+		return;
+	}
+
+	auto close = [&rules](PositionSet& set) {
+		size_t size = set.size();
+		for (size_t i = 0; i < size; ++i) {
+			uint32_t rule = set[i] >> 16;
+			uint32_t position = set[i] & 0xFFFF;
+			while (position < rules[rule].size()
+			       && is_repeat(rules[rule][position])) {
+				++position;
+				set.push_back(pack_position(rule, position));
+			}
+		}
+		std::sort(set.begin(), set.end());
+		set.erase(std::unique(set.begin(), set.end()), set.end());
+	};
+
+	std::map<PositionSet, uint32_t> state_ids;
+	std::vector<PositionSet> states;
+	auto get_state = [&state_ids, &states](PositionSet&& set) {
+		auto it = state_ids.find(set);
+		if (it != state_ids.end()) {
+			return it->second;
+		}
+		uint32_t id = states.size();
+		state_ids.emplace(set, id);
+		states.push_back(std::move(set));
+		return id;
+	};
+
+	get_state(PositionSet());
+	PositionSet start;
+	for (uint32_t i = 0; i < rules.size(); ++i) {
+		start.push_back(pack_position(i, 0));
+	}
+	close(start);
+	get_state(std::move(start));
+
+	for (uint32_t id = 0; id < states.size(); ++id) {
+		uint8_t state_flags = 0;
+		for (uint32_t packed : states[id]) {
+			if ((packed & 0xFFFF) == rules[packed >> 16].size()) {
+				state_flags |= ACCEPT;
+			}
+		}
+
+		bool decided = true;
+		for (uint8_t byte : representatives) {
+			PositionSet next;
+			for (uint32_t packed : states[id]) {
+				uint32_t rule = packed >> 16;
+				uint32_t position = packed & 0xFFFF;
+				if (position == rules[rule].size()) {
+					continue;
+				}
+				uint16_t token = rules[rule][position];
+				if (token == byte
+				    || (token == ANY_BYTE && byte != '/')) {
+					next.push_back(pack_position(rule,
+					                             position + 1));
+				}
+				else if (token == ANY_RUN
+				         || (token == ANY_SEGMENT && byte != '/')) {
+					next.push_back(packed);
+				}
+			}
+			close(next);
+			// This adds to states, so states[id] is looked up again
+			// for every byte
+			uint32_t next_id = get_state(std::move(next));
+			dfa->transitions.push_back(next_id);
+			decided &= next_id == id;
+		}
+		if (decided) {
+			state_flags |= DECIDED;
+		}
+		dfa->flags.push_back(state_flags);
+	}
+	assert(dfa->flags[DEAD_STATE] == DECIDED);
+}
+
+uint32_t NameMatcher::run(const Dfa& dfa, uint32_t state,
+                          const uint8_t* data, size_t length) const {
+	uint32_t num_columns = representatives.size();
+	for (size_t i = 0; i < length; ++i) {
+		if (dfa.flags[state] & DECIDED) {
+			break;
+		}
+		state = dfa.transitions[state * num_columns
+		                        + byte_classes[data[i]]];
+	}
+	return state;
+}
+
+bool NameMatcher::accepts(const Dfa& dfa,
+                          const uint8_t* name, size_t name_length,
+                          const uint8_t* descriptor,
+                          size_t descriptor_length) const {
+	if (dfa.flags.empty()) {
+		return false;
+	}
+	uint32_t state = run(dfa, START_STATE, name, name_length);
+	state = run(dfa, state, descriptor, descriptor_length);
+	return dfa.flags[state] & ACCEPT;
+}
+
+bool NameMatcher::matches(const uint8_t* data, size_t length) const {
+	assert(!includes.flags.empty() && "NameMatcher used before compile");
+	return accepts(includes, data, length, nullptr, 0)
+	       && !accepts(excludes, data, length, nullptr, 0);
+}
+
+bool NameMatcher::matches(const ConstantPoolUtf8& name) const {
+	return matches(name.get_data(), name.get_length());
+}
+
+bool NameMatcher::matches(const ConstantPoolUtf8& name,
+                          const ConstantPoolUtf8& descriptor) const {
+	return matches(name.get_data(), name.get_length(),
+	               descriptor.get_data(), descriptor.get_length());
+}
+
+bool NameMatcher::matches(const uint8_t* name, size_t name_length,
+                          const uint8_t* descriptor,
+                          size_t descriptor_length) const {
+	assert(!includes.flags.empty() && "NameMatcher used before compile");
+	return accepts(includes, name, name_length,
+	               descriptor, descriptor_length)
+	       && !accepts(excludes, name, name_length,
+	                   descriptor, descriptor_length);
+}
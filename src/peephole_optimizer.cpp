@@ -0,0 +1,253 @@
+/*
+ * Copyright 2019-2020 Jonathan Eyolfson
+ *
+ * This program is free software: you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License version 3 as published by the
+ * Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE. See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "peephole_optimizer.hpp"
+
+#include "casting.hpp"
+#include "class_file.hpp"
+#include "code.hpp"
+#include "constant_pool.hpp"
+#include "instruction.hpp"
+#include "method.hpp"
+#include "methods.hpp"
+#include "stack_map_table.hpp"
+
+#include <unordered_set>
+
+using namespace project_rescribo;
+
+namespace {
+
+typedef std::unordered_set<const Instruction*> Targets;
+
+// The slots taken by the single value it pushes, or 0 if it does anything
+// else, like reading memory that could throw
+uint8_t get_pushed_slots(const Instruction* instruction) {
+	switch (instruction->get_kind()) {
+	case Instruction::Kind::AConst_Null:
+	case Instruction::Kind::IConst_M1:
+	case Instruction::Kind::IConst_0:
+	case Instruction::Kind::IConst_1:
+	case Instruction::Kind::IConst_2:
+	case Instruction::Kind::IConst_3:
+	case Instruction::Kind::IConst_4:
+	case Instruction::Kind::IConst_5:
+	case Instruction::Kind::FConst_0:
+	case Instruction::Kind::FConst_1:
+	case Instruction::Kind::FConst_2:
+	case Instruction::Kind::BIPush:
+	case Instruction::Kind::SIPush:
+	case Instruction::Kind::ILoad:
+	case Instruction::Kind::FLoad:
+	case Instruction::Kind::ALoad:
+	case Instruction::Kind::ILoad_0:
+	case Instruction::Kind::ILoad_1:
+	case Instruction::Kind::ILoad_2:
+	case Instruction::Kind::ILoad_3:
+	case Instruction::Kind::FLoad_0:
+	case Instruction::Kind::FLoad_1:
+	case Instruction::Kind::FLoad_2:
+	case Instruction::Kind::FLoad_3:
+	case Instruction::Kind::ALoad_0:
+	case Instruction::Kind::ALoad_1:
+	case Instruction::Kind::ALoad_2:
+	case Instruction::Kind::ALoad_3:
+	case Instruction::Kind::Dup:
+		return 1;
+	// Dup2 may push two values, pop2 takes both either way
+	case Instruction::Kind::LConst_0:
+	case Instruction::Kind::LConst_1:
+	case Instruction::Kind::DConst_0:
+	case Instruction::Kind::DConst_1:
+	case Instruction::Kind::LLoad:
+	case Instruction::Kind::DLoad:
+	case Instruction::Kind::LLoad_0:
+	case Instruction::Kind::LLoad_1:
+	case Instruction::Kind::LLoad_2:
+	case Instruction::Kind::LLoad_3:
+	case Instruction::Kind::DLoad_0:
+	case Instruction::Kind::DLoad_1:
+	case Instruction::Kind::DLoad_2:
+	case Instruction::Kind::DLoad_3:
+	case Instruction::Kind::Dup2:
+		return 2;
+	default:
+		return 0;
+	}
+}
+
+uint8_t get_popped_slots(const Instruction* instruction) {
+	switch (instruction->get_kind()) {
+	case Instruction::Kind::Pop:
+		return 1;
+	case Instruction::Kind::Pop2:
+		return 2;
+	default:
+		return 0;
+	}
+}
+
+bool is_goto(const Instruction* instruction) {
+	Instruction::Kind kind = instruction->get_kind();
+	return kind == Instruction::Kind::Goto
+	       || kind == Instruction::Kind::Goto_W;
+}
+
+// A long or double takes two slots
+bool is_wide_field(ConstantPool* constant_pool, uint16_t fieldref_index) {
+	uint16_t name_and_type_index = constant_pool->get_ref(fieldref_index)
+	                               .get_name_and_type_index();
+	ConstantPoolUtf8 descriptor = constant_pool->get_utf8(
+		constant_pool->get_name_and_type(name_and_type_index)
+		.get_descriptor_index()
+	);
+	uint8_t type = descriptor.get_data()[0];
+	return type == 'J' || type == 'D';
+}
+
+Targets get_targets(Code* code) {
+	Targets targets;
+	for (auto& instruction : code->get_instructions()) {
+		if (BranchInstruction* branch
+		    = dyn_cast<BranchInstruction>(instruction.get())) {
+			targets.insert(branch->get_target());
+		}
+		else if (LookupSwitch* lookup_switch
+		         = dyn_cast<LookupSwitch>(instruction.get())) {
+			targets.insert(lookup_switch->get_default_target());
+			targets.insert(lookup_switch->get_targets().begin(),
+			               lookup_switch->get_targets().end());
+		}
+		else if (TableSwitch* table_switch
+		         = dyn_cast<TableSwitch>(instruction.get())) {
+			targets.insert(table_switch->get_default_target());
+			targets.insert(table_switch->get_targets().begin(),
+			               table_switch->get_targets().end());
+		}
+	}
+	for (const auto& entry : code->get_exception_table()) {
+		targets.insert(entry.handler);
+	}
+	return targets;
+}
+
+}
+
+uint32_t PeepholeOptimizer::apply(Code* code) const {
+	if (code->has_type_annotations()) {
+		return 0;
+	}
+	ConstantPool* constant_pool = code->get_constant_pool();
+	StackMapTable* table = code->get_stack_map_table();
+	Targets targets = get_targets(code);
+	auto is_target = [&targets, table](Instruction* instruction) {
+		return targets.count(instruction) > 0
+		       || (table && table->get_stack_frame_at(instruction));
+	};
+
+	uint32_t old_size = code->get_next_bci();
+	bool changed = false;
+	Code::Instructions& instructions = code->get_instructions();
+	auto iter = instructions.begin();
+	while (iter != instructions.end()) {
+		Instruction* instruction = iter->get();
+		if (Ldc_W* ldc_w = dyn_cast<Ldc_W>(instruction)) {
+			if (ldc_w->get_index() <= UINT8_MAX) {
+				iter = code->replace(iter, std::make_unique<Ldc>(
+					code, ldc_w->get_index()
+				));
+				if (targets.count(instruction) > 0) {
+					targets.insert(iter->get());
+				}
+				changed = true;
+			}
+			++iter;
+			continue;
+		}
+
+		auto next = std::next(iter);
+		if (next == instructions.end()) {
+			break;
+		}
+		Instruction* next_instruction = next->get();
+		bool removed = false;
+		if (is_goto(instruction) && !is_target(instruction)
+		    && cast<BranchInstruction>(instruction)->get_target()
+		       == next_instruction) {
+			iter = code->erase(iter);
+			removed = true;
+		}
+		else if (get_pushed_slots(instruction) != 0
+		         && get_pushed_slots(instruction)
+		            == get_popped_slots(next_instruction)
+		         && !is_target(instruction)
+		         && !is_target(next_instruction)) {
+			code->erase(next);
+			iter = code->erase(iter);
+			removed = true;
+		}
+		else if (GetStatic* first = dyn_cast<GetStatic>(instruction)) {
+			GetStatic* second = dyn_cast<GetStatic>(next_instruction);
+			if (second && second->get_index() == first->get_index()
+			    && !is_target(second)) {
+				if (is_wide_field(constant_pool, first->get_index())) {
+					code->replace(next, std::make_unique<Dup2>(code));
+				}
+				else {
+					code->replace(next, std::make_unique<Dup>(code));
+				}
+				changed = true;
+			}
+		}
+		if (!removed) {
+			++iter;
+			continue;
+		}
+		// What came before may pair up with what comes after now
+		if (iter != instructions.begin()) {
+			--iter;
+		}
+		changed = true;
+	}
+	if (!changed) {
+		return 0;
+	}
+
+	code->sync();
+	if (code->fix_offsets()) {
+		code->sync();
+	}
+	uint32_t new_size = code->get_next_bci();
+	return old_size > new_size ? old_size - new_size : 0;
+}
+
+std::vector<PeepholeOptimizer::Result>
+PeepholeOptimizer::apply(ClassFile* class_file) const {
+	TransformStats::Timer timer(class_file->get_transform_stats(),
+	                            TransformStats::Phase::Transform);
+	std::vector<Result> results;
+	for (auto& method : class_file->get_methods()->get()) {
+		Code* code = method->get_code();
+		if (!code) {
+			continue;
+		}
+		uint32_t bytes_removed = apply(code);
+		if (bytes_removed > 0) {
+			results.push_back({method.get(), bytes_removed});
+		}
+	}
+	return results;
+}
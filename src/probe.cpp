@@ -0,0 +1,444 @@
+/*
+ * Copyright 2019-2020 Jonathan Eyolfson
+ *
+ * This program is free software: you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License version 3 as published by the
+ * Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE. See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "probe.hpp"
+
+#include "buffer.hpp"
+#include "class_file.hpp"
+#include "code.hpp"
+#include "constant_pool.hpp"
+#include "field.hpp"
+#include "fields.hpp"
+#include "instruction.hpp"
+#include "jit_budget.hpp"
+#include "method.hpp"
+#include "methods.hpp"
+#include "stack_map_table.hpp"
+
+#include <algorithm>
+
+using namespace project_rescribo;
+
+namespace {
+
+constexpr uint8_t ACONST_NULL
+	= static_cast<uint8_t>(Instruction::Kind::AConst_Null);
+constexpr uint8_t ALOAD_0 = static_cast<uint8_t>(Instruction::Kind::ALoad_0);
+constexpr uint8_t LDC_W = static_cast<uint8_t>(Instruction::Kind::Ldc_W);
+constexpr uint8_t INVOKESTATIC
+	= static_cast<uint8_t>(Instruction::Kind::InvokeStatic);
+
+// Every probe's helpers start with it, so probes never instrument them
+constexpr char HELPER_PREFIX[] = "rescribo$";
+
+bool is_helper(Method* method) {
+	ConstantPoolUtf8 name = method->get_name_utf8();
+	size_t length = sizeof(HELPER_PREFIX) - 1;
+	return name.get_length() >= length
+	       && std::equal(name.get_data(), name.get_data() + length,
+	                     HELPER_PREFIX);
+}
+
+std::string get_string(const ConstantPoolUtf8& utf8) {
+	return std::string(reinterpret_cast<const char*>(utf8.get_data()),
+	                   utf8.get_length());
+}
+
+}
+
+Probe::Probe(Location location,
+             const std::string& hook_class,
+             const std::string& hook_method,
+             uint8_t arguments)
+: location(location), hook_class(hook_class), hook_method(hook_method),
+  arguments(arguments), classes(NameMatcher::Kind::Class),
+  methods(NameMatcher::Kind::Method),
+  guarded(false), budget(nullptr), fallback(nullptr), out_of_line(false),
+  max_stack(0) {
+	hook_descriptor = "(";
+	if (arguments & This) {
+		add_instruction(ALOAD_0, Slot::This);
+		hook_descriptor += "Ljava/lang/Object;";
+	}
+	if (arguments & ClassName) {
+		add_instruction(LDC_W, Slot::ClassName);
+		hook_descriptor += "Ljava/lang/String;";
+	}
+	if (arguments & MethodName) {
+		add_instruction(LDC_W, Slot::MethodName);
+		hook_descriptor += "Ljava/lang/String;";
+	}
+	if (arguments & MethodDescriptor) {
+		add_instruction(LDC_W, Slot::MethodDescriptor);
+		hook_descriptor += "Ljava/lang/String;";
+	}
+	hook_descriptor += ")V";
+	// Every argument is a single value
+	max_stack = patches.size();
+	add_instruction(INVOKESTATIC, Slot::HookMethodref);
+}
+
+// Only This patches the opcode itself, the rest patch a u16 operand
+void Probe::add_instruction(uint8_t opcode, Slot slot) {
+	uint16_t offset = bytecode.size();
+	if (slot == Slot::This) {
+		patches.push_back({offset, slot});
+		bytecode.push_back(opcode);
+		return;
+	}
+	bytecode.push_back(opcode);
+	patches.push_back({static_cast<uint16_t>(offset + 1), slot});
+	bytecode.push_back(0);
+	bytecode.push_back(0);
+}
+
+void Probe::compile() {
+	classes.compile();
+	methods.compile();
+}
+
+void Probe::set_guard(const std::string& flag_class,
+                      const std::string& flag_field) {
+	guarded = true;
+	this->flag_class = flag_class;
+	this->flag_field = flag_field;
+}
+
+void Probe::set_budget(JitBudget* budget, const Probe* fallback) {
+	this->budget = budget;
+	this->fallback = fallback;
+}
+
+void Probe::set_out_of_line(bool out_of_line) {
+	this->out_of_line = out_of_line;
+}
+
+uint16_t Probe::get_flag_index(ClassFile* class_file) const {
+	ConstantPool* constant_pool = class_file->get_constant_pool();
+	if (!flag_class.empty()) {
+		uint16_t class_index = constant_pool->get_or_create_class_index(
+			constant_pool->get_or_create_utf8_index(flag_class.c_str())
+		);
+		return constant_pool->get_or_create_fieldref_index(
+			class_index, flag_field.c_str(), "Z"
+		);
+	}
+
+	// Another probe may have added it already, and it's only added once
+	// the constant pool has room for its fieldref
+	uint16_t index = constant_pool->get_or_create_fieldref_index(
+		class_file->get_this_class(), flag_field.c_str(), "Z"
+	);
+	Fields* fields = class_file->get_fields();
+	if (index != 0 && fields->find(flag_field.c_str()) == nullptr) {
+		uint16_t flags = static_cast<uint16_t>(Access::Flag::Public)
+		                 | static_cast<uint16_t>(Access::Flag::Static)
+		                 | static_cast<uint16_t>(Access::Flag::Volatile)
+		                 | static_cast<uint16_t>(Access::Flag::Synthetic);
+		fields->add(std::make_unique<Field>(class_file, Access(flags),
+		                                    flag_field.c_str(), "Z"));
+	}
+	return index;
+}
+
+bool Probe::has_helpers(ClassFile* class_file) const {
+	return out_of_line && !class_file->get_access().is_interface();
+}
+
+// The helper takes This as its only parameter, if it's passed. 0 if the
+// constant pool is full.
+uint16_t Probe::get_helper_index(
+	ClassFile* class_file, ClassState* state,
+	std::vector<std::unique_ptr<Method>>* helpers
+) const {
+	std::vector<uint8_t> helper_bytecode(state->patched);
+	if (arguments & This) {
+		helper_bytecode[0] = ALOAD_0;
+	}
+	auto it = state->helper_indices.find(helper_bytecode);
+	if (it != state->helper_indices.end()) {
+		return it->second;
+	}
+
+	auto is_taken = [class_file, helpers](const std::string& name) {
+		if (class_file->get_methods()->find(name.c_str()) != nullptr) {
+			return true;
+		}
+		for (const auto& method : *helpers) {
+			if (method->is_name(name.c_str())) {
+				return true;
+			}
+		}
+		return false;
+	};
+	std::string name;
+	uint32_t id = helpers->size();
+	do {
+		name = HELPER_PREFIX + hook_method + "$"
+		       + std::to_string(id++);
+	} while (is_taken(name));
+
+	uint16_t flags = static_cast<uint16_t>(Access::Flag::Private)
+	                 | static_cast<uint16_t>(Access::Flag::Static)
+	                 | static_cast<uint16_t>(Access::Flag::Synthetic);
+	const char* descriptor = (arguments & This) ? "(Ljava/lang/Object;)V"
+	                                            : "()V";
+	auto helper = std::make_unique<Method>(class_file, Access(flags),
+	                                       name.c_str(), descriptor);
+	Code* code = helper->get_code();
+	code->insert_before_returns(helper_bytecode.data(),
+	                            helper_bytecode.size());
+	code->set_max_stack(max_stack);
+	code->set_max_locals((arguments & This) ? 1 : 0);
+	code->sync();
+
+	ConstantPool* constant_pool = class_file->get_constant_pool();
+	uint16_t index = constant_pool->get_or_create_methodref_index(
+		class_file->get_this_class(),
+		constant_pool->get_or_create_name_and_type_index(
+			helper->get_name_index(), helper->get_descriptor_index()
+		)
+	);
+	if (index == 0) {
+		return 0;
+	}
+	state->helper_indices.emplace(std::move(helper_bytecode), index);
+	helpers->push_back(std::move(helper));
+	return index;
+}
+
+uint32_t Probe::get_inserted_size(Code* code) const {
+	// An invokestatic, after aload_0 or aconst_null
+	uint32_t call_size = has_helpers(code->get_method()->get_class_file())
+	                     ? 3 + ((arguments & This) ? 1 : 0)
+	                     : bytecode.size();
+	// A getstatic and an ifeq
+	uint32_t size = call_size + (guarded ? 6 : 0);
+	if (location == Location::Entry) {
+		return size;
+	}
+	uint32_t num_returns = 0;
+	for (const auto& instruction : code->get_instructions()) {
+		num_returns += instruction->get_opcode_info()
+		               .is(OpcodeInfo::Return);
+	}
+	return size * num_returns;
+}
+
+uint32_t Probe::apply(ClassFile* class_file) const {
+	TransformStats::Timer timer(class_file->get_transform_stats(),
+	                            TransformStats::Phase::Transform);
+	ConstantPool* constant_pool = class_file->get_constant_pool();
+	ConstantPoolUtf8 class_name = constant_pool->get_utf8(
+		constant_pool->get_class(class_file->get_this_class())
+		.get_name_index()
+	);
+	if (!classes.matches(class_name)) {
+		return 0;
+	}
+	if (guarded && flag_class.empty()
+	    && class_file->get_access().is_interface()) {
+		return 0;
+	}
+
+	// The name's bytes move once the constant pool grows
+	std::string class_name_copy;
+	if (budget) {
+		class_name_copy = get_string(class_name);
+	}
+
+	ClassState state = {0, 0, 0, bytecode, {}};
+	ClassState fallback_state = {0, 0, 0, {}, {}};
+	bool can_fall_back = fallback
+	                     && !(fallback->guarded
+	                          && fallback->flag_class.empty()
+	                          && class_file->get_access().is_interface());
+	if (can_fall_back) {
+		fallback_state.patched = fallback->bytecode;
+	}
+	std::vector<std::unique_ptr<Method>> helpers;
+	uint32_t num_methods = 0;
+	for (auto& method : class_file->get_methods()->get()) {
+		Code* code = method->get_code();
+		if (!code || is_helper(method.get())
+		    || !methods.matches(method->get_name_utf8(),
+		                        method->get_descriptor_utf8())) {
+			continue;
+		}
+		if (!budget) {
+			num_methods += apply(class_file, method.get(), &state,
+			                     &helpers);
+			continue;
+		}
+
+		uint32_t old_size = code->get_next_bci();
+		JitBudget::Limit limit;
+		bool fell_back = can_fall_back
+		                 && budget->crosses(old_size,
+		                                    old_size
+		                                    + get_inserted_size(code),
+		                                    &limit);
+		bool applied;
+		if (fell_back) {
+			applied = fallback->apply(class_file, method.get(),
+			                          &fallback_state, &helpers);
+		}
+		else {
+			applied = apply(class_file, method.get(), &state,
+			                &helpers);
+		}
+		if (!applied) {
+			continue;
+		}
+		++num_methods;
+		budget->add_checked();
+		uint32_t new_size = code->get_next_bci();
+		if (budget->crosses(old_size, new_size, &limit) || fell_back) {
+			budget->add({class_name_copy,
+			             get_string(method->get_name_utf8()),
+			             get_string(method->get_descriptor_utf8()),
+			             old_size, new_size, limit, fell_back});
+		}
+	}
+	for (auto& helper : helpers) {
+		class_file->get_methods()->add(std::move(helper));
+	}
+	return num_methods;
+}
+
+// Syncs the method once done. Every constant the call uses is found before
+// the method changes, so running out of room leaves it as it was.
+bool Probe::apply(ClassFile* class_file, Method* method, ClassState* state,
+                  std::vector<std::unique_ptr<Method>>* helpers) const {
+	ConstantPool* constant_pool = class_file->get_constant_pool();
+	Code* code = method->get_code();
+	if (state->hook_index == 0) {
+		state->hook_index = constant_pool->get_or_create_methodref_index(
+			hook_class.c_str(), hook_method.c_str(),
+			hook_descriptor.c_str()
+		);
+	}
+	if (guarded && state->flag_index == 0) {
+		state->flag_index = get_flag_index(class_file);
+	}
+	if (state->hook_index == 0 || (guarded && state->flag_index == 0)) {
+		return false;
+	}
+	if (state->class_name_string_index == 0 && (arguments & ClassName)) {
+		state->class_name_string_index
+			= constant_pool->get_or_create_string_index(
+				constant_pool->get_class(
+					class_file->get_this_class()
+				).get_name_index()
+			);
+		if (state->class_name_string_index == 0) {
+			return false;
+		}
+	}
+
+	std::vector<uint8_t>& patched = state->patched;
+	bool has_this = !method->is_static()
+	                && !(location == Location::Entry
+	                     && method->is_name("<init>"));
+	for (const Patch& patch : patches) {
+		uint8_t* operand = &patched[patch.offset];
+		// Anything but 0 for the slots that aren't indices
+		uint16_t index = 1;
+		switch (patch.slot) {
+		case Slot::This:
+			*operand = has_this ? ALOAD_0 : ACONST_NULL;
+			break;
+		case Slot::HookMethodref:
+			next_u16(&operand, state->hook_index);
+			break;
+		case Slot::ClassName:
+			next_u16(&operand, state->class_name_string_index);
+			break;
+		case Slot::MethodName:
+			index = constant_pool->get_or_create_string_index(
+				method->get_name_index()
+			);
+			next_u16(&operand, index);
+			break;
+		case Slot::MethodDescriptor:
+			index = constant_pool->get_or_create_string_index(
+				method->get_descriptor_index()
+			);
+			next_u16(&operand, index);
+			break;
+		}
+		if (index == 0) {
+			return false;
+		}
+	}
+
+	std::vector<uint8_t> call;
+	uint16_t call_max_stack = max_stack;
+	if (has_helpers(class_file)) {
+		uint16_t helper_index = get_helper_index(class_file, state,
+		                                         helpers);
+		if (helper_index == 0) {
+			return false;
+		}
+		if (arguments & This) {
+			call.push_back(patched[0]);
+		}
+		call.push_back(INVOKESTATIC);
+		call.push_back(helper_index >> 8);
+		call.push_back(helper_index & 0xFF);
+		call_max_stack = call.size() - 3;
+	}
+	else {
+		call = patched;
+	}
+
+	// The flag is on the stack alone
+	uint16_t guarded_max_stack = std::max<uint16_t>(call_max_stack,
+	                                                guarded);
+	if (location == Location::Entry) {
+		Instruction* first = code->get_instructions().front().get();
+		auto inserter = code->create_front_inserter();
+		if (guarded) {
+			inserter.insert_getstatic(state->flag_index);
+			inserter.insert_ifeq(first);
+		}
+		inserter.insert_bytecode(call.data(), call.size());
+		code->set_max_stack(std::max(code->get_max_stack(),
+		                             guarded_max_stack));
+		if (guarded && class_file->get_major_version() >= 50) {
+			code->sync();
+			StackMapTable* table = code->get_or_create_stack_map_table();
+			if (!table->get_stack_frame_at(first)) {
+				table->insert_initial_frame(first);
+			}
+		}
+	}
+	else if (guarded) {
+		code->insert_guarded_before_returns(call.data(), call.size(),
+		                                    state->flag_index);
+		code->set_max_stack(code->get_max_stack() + guarded_max_stack);
+	}
+	else {
+		code->insert_before_returns(call.data(), call.size());
+		// Whatever was on the stack at a return is still there
+		code->set_max_stack(code->get_max_stack() + call_max_stack);
+	}
+	code->sync();
+	if (code->fix_offsets()) {
+		code->sync();
+	}
+	return true;
+}
@@ -0,0 +1,103 @@
+/*
+ * Copyright 2019-2020 Jonathan Eyolfson
+ *
+ * This program is free software: you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License version 3 as published by the
+ * Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE. See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "segmented_output.hpp"
+
+#include <algorithm>
+#include <cerrno>
+#include <climits>
+#include <cstring>
+
+#include <sys/uio.h>
+
+using namespace project_rescribo;
+
+SegmentedOutput::SegmentedOutput() : byte_size(0) {}
+
+void SegmentedOutput::add_input(const uint8_t* data, uint32_t size) {
+	byte_size += size;
+	if (!parts.empty() && parts.back().input
+	    && parts.back().input + parts.back().size == data) {
+		parts.back().size += size;
+		return;
+	}
+	parts.push_back({data, 0, size});
+}
+
+uint8_t* SegmentedOutput::add_output(uint32_t size) {
+	byte_size += size;
+	uint32_t offset = output.size();
+	output.resize(offset + size);
+	if (!parts.empty() && !parts.back().input) {
+		parts.back().size += size;
+	}
+	else {
+		parts.push_back({nullptr, offset, size});
+	}
+	return output.data() + offset;
+}
+
+void SegmentedOutput::finish() {
+	segments.clear();
+	for (const Part& part : parts) {
+		if (part.size == 0) {
+			continue;
+		}
+		const uint8_t* data = part.input ? part.input
+		                                 : output.data() + part.offset;
+		segments.push_back({data, part.size});
+	}
+}
+
+void SegmentedOutput::flatten(uint8_t* buffer) const {
+	for (const Segment& segment : segments) {
+		memcpy(buffer, segment.data, segment.size);
+		buffer += segment.size;
+	}
+}
+
+bool SegmentedOutput::write(int fd) const {
+	std::vector<struct iovec> iovecs;
+	for (const Segment& segment : segments) {
+		iovecs.push_back({const_cast<uint8_t*>(segment.data),
+		                  segment.size});
+	}
+	size_t first = 0;
+	while (first < iovecs.size()) {
+		int count = std::min<size_t>(iovecs.size() - first, IOV_MAX);
+		ssize_t written = writev(fd, &iovecs[first], count);
+		if (written < 0) {
+			if (errno == EINTR) {
+				continue;
+			}
+			return false;
+		}
+		// Skip what was written, a segment may be left half done
+		size_t remaining = written;
+		while (first < iovecs.size()
+		       && remaining >= iovecs[first].iov_len) {
+			remaining -= iovecs[first].iov_len;
+			++first;
+		}
+		if (remaining > 0) {
+			iovecs[first].iov_base
+				= static_cast<uint8_t*>(iovecs[first].iov_base)
+				  + remaining;
+			iovecs[first].iov_len -= remaining;
+		}
+	}
+	return true;
+}
@@ -18,12 +18,107 @@
 
 #include "buffer.hpp"
 #include "casting.hpp"
+#include "class_file.hpp"
 #include "code.hpp"
+#include "constant_pool.hpp"
+#include "constant_pool_entry.hpp"
+#include "method.hpp"
 
 #include <cassert>
+#include <string>
 
 using namespace project_rescribo;
 
+namespace {
+
+// The locals after a frame, from the ones after the frame before
+void apply_frame(const StackMapFrame* frame,
+                 std::vector<const VariableInfo*>* locals) {
+	if (auto chop = dyn_cast<StackMapChop>(frame)) {
+		assert(chop->get_k() <= locals->size());
+		locals->resize(locals->size() - chop->get_k());
+	}
+	else if (auto append = dyn_cast<StackMapAppend>(frame)) {
+		for (const auto& local : append->get_locals()) {
+			locals->push_back(local.get());
+		}
+	}
+	else if (auto full_frame = dyn_cast<StackMapFullFrame>(frame)) {
+		locals->clear();
+		for (const auto& local : full_frame->get_locals()) {
+			locals->push_back(local.get());
+		}
+	}
+}
+
+// Takes two slots, the second isn't listed
+bool is_wide(const VariableInfo* local) {
+	return local->get_kind() == VariableInfo::Kind::Long
+	       || local->get_kind() == VariableInfo::Kind::Double;
+}
+
+void set_local(std::vector<std::unique_ptr<VariableInfo>>* locals,
+               uint16_t index, const VariableInfo& type) {
+	// One for each slot, with the second slot of a long or double empty
+	std::vector<std::unique_ptr<VariableInfo>> slots;
+	for (auto& local : *locals) {
+		bool wide = is_wide(local.get());
+		slots.push_back(std::move(local));
+		if (wide) {
+			slots.emplace_back();
+		}
+	}
+	uint32_t size = is_wide(&type) ? 2 : 1;
+	while (slots.size() < index + size + 1) {
+		slots.push_back(std::make_unique<TopVariableInfo>());
+	}
+	// A long or double that loses either slot is gone
+	if (!slots[index]) {
+		slots[index - 1] = std::make_unique<TopVariableInfo>();
+	}
+	if (!slots[index + size]) {
+		slots[index + size] = std::make_unique<TopVariableInfo>();
+	}
+	slots[index] = type.clone();
+	if (size == 2) {
+		slots[index + 1].reset();
+	}
+
+	locals->clear();
+	for (auto& slot : slots) {
+		if (slot) {
+			locals->push_back(std::move(slot));
+		}
+	}
+	while (!locals->empty()
+	       && locals->back()->get_kind() == VariableInfo::Kind::Top) {
+		locals->pop_back();
+	}
+}
+
+std::vector<std::unique_ptr<VariableInfo>> get_stack_items(
+	const StackMapFrame* frame
+) {
+	std::vector<std::unique_ptr<VariableInfo>> stack_items;
+	if (auto same_locals = dyn_cast<StackMapSameLocals1StackItem>(frame)) {
+		stack_items.push_back(same_locals->get_stack()->clone());
+	}
+	else if (auto same_locals_extended
+	         = dyn_cast<StackMapSameLocals1StackItemExtended>(frame)) {
+		stack_items.push_back(
+			same_locals_extended->get_stack()->clone()
+		);
+	}
+	else if (auto full_frame = dyn_cast<StackMapFullFrame>(frame)) {
+		for (const auto& item : full_frame->get_stack_items()) {
+			stack_items.push_back(item->clone());
+		}
+	}
+	return stack_items;
+}
+
+}
+
 std::unique_ptr<VariableInfo> VariableInfo::make(const uint8_t** buffer,
                                                  Code* code) {
 	switch (Kind(next_u8(buffer))) {
@@ -62,6 +157,81 @@ std::unique_ptr<VariableInfo> VariableInfo::make(const uint8_t** buffer,
 	}
 }
 
+std::unique_ptr<VariableInfo> VariableInfo::make(
+	const uint8_t* descriptor, uint16_t length,
+	ConstantPool* constant_pool) {
+	assert(length > 0);
+	switch (descriptor[0]) {
+	case 'B':
+	case 'C':
+	case 'I':
+	case 'S':
+	case 'Z':
+		return std::make_unique<IntegerVariableInfo>();
+	case 'F':
+		return std::make_unique<FloatVariableInfo>();
+	case 'D':
+		return std::make_unique<DoubleVariableInfo>();
+	case 'J':
+		return std::make_unique<LongVariableInfo>();
+	case 'L': {
+		std::string name(reinterpret_cast<const char*>(descriptor + 1),
+		                 length - 2);
+		return std::make_unique<ObjectVariableInfo>(
+			constant_pool->get_or_create_class_index(
+				constant_pool->get_or_create_utf8_index(
+					name.c_str()
+				)
+			)
+		);
+	}
+	case '[': {
+		// Array classes are named by their descriptor
+		std::string name(reinterpret_cast<const char*>(descriptor),
+		                 length);
+		return std::make_unique<ObjectVariableInfo>(
+			constant_pool->get_or_create_class_index(
+				constant_pool->get_or_create_utf8_index(
+					name.c_str()
+				)
+			)
+		);
+	}
+	default:
+		assert(false && "Unexpected descriptor");
+		return nullptr;
+	}
+}
+
+std::unique_ptr<VariableInfo> VariableInfo::clone() const {
+	switch (kind) {
+	case Kind::Top:
+		return std::make_unique<TopVariableInfo>();
+	case Kind::Integer:
+		return std::make_unique<IntegerVariableInfo>();
+	case Kind::Float:
+		return std::make_unique<FloatVariableInfo>();
+	case Kind::Double:
+		return std::make_unique<DoubleVariableInfo>();
+	case Kind::Long:
+		return std::make_unique<LongVariableInfo>();
+	case Kind::Null:
+		return std::make_unique<NullVariableInfo>();
+	case Kind::UninitializedThis:
+		return std::make_unique<UninitializedThisVariableInfo>();
+	case Kind::Object:
+		return std::make_unique<ObjectVariableInfo>(
+			cast<ObjectVariableInfo>(this)->get_index()
+		);
+	case Kind::Uninitialized:
+		return std::make_unique<UninitializedVariableInfo>(
+			cast<UninitializedVariableInfo>(this)->get_instruction()
+		);
+	}
+	assert(false && "Unexpected variable info");
+	return nullptr;
+}
+
 void TopVariableInfo::write_buffer(uint8_t** buffer) const {
 	next_u8(buffer, static_cast<uint8_t>(get_kind()));
 }
@@ -95,6 +265,11 @@ void ObjectVariableInfo::write_buffer(uint8_t** buffer) const {
 	next_u16(buffer, index);
 }
 
+void ObjectVariableInfo::visit_constant_pool_indices(
+	ConstantPoolIndexVisitor& visitor) {
+	visitor.visit(index);
+}
+
 uint16_t UninitializedVariableInfo::get_offset() const {
 	return instruction->get_bci();
 }
@@ -186,7 +361,8 @@ StackMapFrame::make(const uint8_t** buffer, StackMapTable* stack_map_table) {
 StackMapTable::StackMapTable(const uint8_t** buffer,
                              uint16_t attribute_name_index,
                              Code* code)
-: Attribute(Kind::StackMapTable, attribute_name_index), code(code) {
+: Attribute(Kind::StackMapTable, attribute_name_index), code(code),
+  is_byte_size_current(false) {
 	uint16_t number_of_entries = next_u16(buffer);
 	for (uint64_t i = 0; i < number_of_entries; ++i) {
 		entries.push_back(StackMapFrame::make(buffer, this));
@@ -214,6 +390,10 @@ StackMapTable::StackMapTable(const uint8_t** buffer,
 	}
 }
 
+StackMapTable::StackMapTable(uint16_t attribute_name_index, Code* code)
+: Attribute(Kind::StackMapTable, attribute_name_index), code(code),
+  is_byte_size_current(false) {}
+
 void StackMapSame::set_offset_delta(uint16_t o) {
 	assert(o <= 63);
 	set_type(o);
@@ -239,6 +419,11 @@ void StackMapSameLocals1StackItem::write_buffer(uint8_t** buffer) const {
 	stack->write_buffer(buffer);
 }
 
+void StackMapSameLocals1StackItem::visit_constant_pool_indices(
+	ConstantPoolIndexVisitor& visitor) {
+	stack->visit_constant_pool_indices(visitor);
+}
+
 uint32_t StackMapSameLocals1StackItemExtended::get_byte_size() const {
 	uint32_t result = 3;
 	result += stack->get_byte_size();
@@ -253,6 +438,11 @@ void StackMapSameLocals1StackItemExtended::write_buffer(
 	stack->write_buffer(buffer);
 }
 
+void StackMapSameLocals1StackItemExtended::visit_constant_pool_indices(
+	ConstantPoolIndexVisitor& visitor) {
+	stack->visit_constant_pool_indices(visitor);
+}
+
 void StackMapChop::write_buffer(uint8_t** buffer) const {
 	next_u8(buffer, get_type());
 	next_u16(buffer, offset_delta);
@@ -279,6 +469,13 @@ void StackMapAppend::write_buffer(uint8_t** buffer) const {
 	}
 }
 
+void StackMapAppend::visit_constant_pool_indices(
+	ConstantPoolIndexVisitor& visitor) {
+	for (auto& var_info : locals) {
+		var_info->visit_constant_pool_indices(visitor);
+	}
+}
+
 uint32_t StackMapFullFrame::get_byte_size() const {
 	// frame_type(1) + offset_delta(2) + number of locals(2) +
 	// locals + num_stack_items(2) + stack_items
@@ -307,6 +504,16 @@ void StackMapFullFrame::write_buffer(uint8_t** buffer) const {
 	}
 }
 
+void StackMapFullFrame::visit_constant_pool_indices(
+	ConstantPoolIndexVisitor& visitor) {
+	for (auto& var_info : locals) {
+		var_info->visit_constant_pool_indices(visitor);
+	}
+	for (auto& item : stack_items) {
+		item->visit_constant_pool_indices(visitor);
+	}
+}
+
 StackMapFrame*
 StackMapTable::get_stack_frame_at(Instruction* instruction) const {
 	for (const auto& frame : entries) {
@@ -318,23 +525,33 @@ StackMapTable::get_stack_frame_at(Instruction* instruction) const {
 }
 
 uint32_t StackMapTable::get_byte_size() const {
-	uint32_t result = 0;
-	result += 8;
+	if (is_byte_size_current) {
+		return byte_size;
+	}
+	byte_size = 8;
 	for (const auto& entry : entries) {
-		result += entry->get_byte_size();
+		byte_size += entry->get_byte_size();
 	}
-	return result;
+	is_byte_size_current = true;
+	return byte_size;
+}
+
+// The code's size is invalidated the first time, until the size is computed
+// again it doesn't need telling
+void StackMapTable::mark_changed() {
+	code->mark_changed();
+	if (!is_byte_size_current) {
+		return;
+	}
+	is_byte_size_current = false;
+	code->invalidate_byte_size();
 }
 
 void StackMapTable::write_buffer(uint8_t** buffer) const {
 	next_u16(buffer, get_attribute_name_index());
 
 	// length not including the first 6 bytes
-	uint32_t len = 2;
-	for (const auto& frame : entries) {
-		len += frame->get_byte_size();
-	}
-	next_u32(buffer, len);
+	next_u32(buffer, get_byte_size() - 6);
 
 	next_u16(buffer, entries.size());
 	for (const auto& frame : entries) {
@@ -342,6 +559,14 @@ void StackMapTable::write_buffer(uint8_t** buffer) const {
 	}
 }
 
+void StackMapTable::visit_constant_pool_indices(
+	ConstantPoolIndexVisitor& visitor) {
+	Attribute::visit_constant_pool_indices(visitor);
+	for (auto& frame : entries) {
+		frame->visit_constant_pool_indices(visitor);
+	}
+}
+
 void StackMapTable::sync_offset_delta() {
 	bool previous_frame_is_initial = true;
 	uint32_t previous_bci = 0;
@@ -359,6 +584,7 @@ void StackMapTable::sync_offset_delta() {
 		StackMapSameLocals1StackItem* same_locals
 			= dyn_cast<StackMapSameLocals1StackItem>(frame);
 		if (same && !same->is_valid(new_offset_delta)) {
+			mark_changed();
 			Instruction* target = frame->get_instruction();
 			entry = std::make_unique<StackMapSameFrameExtended>(
 				251, this, new_offset_delta
@@ -367,6 +593,7 @@ void StackMapTable::sync_offset_delta() {
 		}
 		else if (same_locals
 		         && !same_locals->is_valid(new_offset_delta)) {
+			mark_changed();
 			std::unique_ptr<VariableInfo> stack
 				= same_locals->move_stack();
 			Instruction* target = frame->get_instruction();
@@ -387,3 +614,209 @@ void StackMapTable::sync_offset_delta() {
 		previous_bci = bci;
 	}
 }
+
+// https://docs.oracle.com/javase/specs/jvms/se11/html/jvms-4.html#jvms-4.10.1.6
+StackMapTable::Locals StackMapTable::get_initial_locals() const {
+	Method* method = code->get_method();
+	ClassFile* class_file = code->get_class_file();
+	ConstantPool* constant_pool = code->get_constant_pool();
+	Locals locals;
+	if (!method->is_static()) {
+		uint16_t this_class = class_file->get_this_class();
+		bool is_object = constant_pool->get_utf8(
+			constant_pool->get_class(this_class).get_name_index()
+		).equals("java/lang/Object");
+		if (method->is_name("<init>") && !is_object) {
+			locals.push_back(
+				std::make_unique<UninitializedThisVariableInfo>()
+			);
+		}
+		else {
+			locals.push_back(
+				std::make_unique<ObjectVariableInfo>(this_class)
+			);
+		}
+	}
+
+	// Copied, making a VariableInfo can add a Utf8 and move the descriptor
+	ConstantPoolUtf8 descriptor_utf8 = method->get_descriptor_utf8();
+	std::vector<uint8_t> descriptor(
+		descriptor_utf8.get_data(),
+		descriptor_utf8.get_data() + descriptor_utf8.get_length()
+	);
+	const uint8_t* data = descriptor.data();
+	assert(data[0] == '(');
+	uint32_t i = 1;
+	while (data[i] != ')') {
+		uint32_t start = i;
+		while (data[i] == '[') {
+			++i;
+		}
+		if (data[i] == 'L') {
+			while (data[i] != ';') {
+				++i;
+			}
+		}
+		++i;
+		locals.push_back(VariableInfo::make(data + start, i - start,
+		                                    constant_pool));
+	}
+	return locals;
+}
+
+void StackMapTable::insert_initial_frame(Instruction* instruction) {
+	assert(entries.empty()
+	       || entries.front()->get_instruction()->get_bci()
+	          > instruction->get_bci());
+	// Same as the implicit frame before it
+	auto frame = std::make_unique<StackMapSame>(0, this);
+	frame->set_instruction(instruction);
+	entries.insert(entries.begin(), std::move(frame));
+	mark_changed();
+}
+
+StackMapTable::Locals
+StackMapTable::get_locals(const StackMapFrame* frame) const {
+	Locals initial_locals = get_initial_locals();
+	std::vector<const VariableInfo*> locals;
+	for (const auto& local : initial_locals) {
+		locals.push_back(local.get());
+	}
+	for (const auto& entry : entries) {
+		apply_frame(entry.get(), &locals);
+		if (entry.get() == frame) {
+			break;
+		}
+	}
+	Locals result;
+	for (const VariableInfo* local : locals) {
+		result.push_back(local->clone());
+	}
+	return result;
+}
+
+void StackMapTable::insert_frame(Instruction* instruction,
+                                 Locals frame_locals,
+                                 Locals stack_items) {
+	Locals initial_locals = get_initial_locals();
+	std::vector<const VariableInfo*> locals;
+	for (const auto& local : initial_locals) {
+		locals.push_back(local.get());
+	}
+
+	uint32_t bci = instruction->get_bci();
+	auto iter = entries.begin();
+	for (; iter != entries.end(); ++iter) {
+		uint32_t frame_bci = (*iter)->get_instruction()->get_bci();
+		assert(frame_bci != bci && "Frame already present");
+		if (frame_bci > bci) {
+			break;
+		}
+		apply_frame(iter->get(), &locals);
+	}
+	auto frame = std::make_unique<StackMapFullFrame>(
+		255, this, 0, std::move(frame_locals), std::move(stack_items)
+	);
+	frame->set_instruction(instruction);
+	iter = std::next(entries.insert(iter, std::move(frame)));
+	mark_changed();
+	if (iter == entries.end() || isa<StackMapFullFrame>(iter->get())) {
+		return;
+	}
+
+	StackMapFrame* next = iter->get();
+	apply_frame(next, &locals);
+	Locals next_locals;
+	for (const VariableInfo* local : locals) {
+		next_locals.push_back(local->clone());
+	}
+	Locals next_stack_items;
+	if (auto same_locals = dyn_cast<StackMapSameLocals1StackItem>(next)) {
+		next_stack_items.push_back(same_locals->get_stack()->clone());
+	}
+	else if (auto same_locals_extended
+	         = dyn_cast<StackMapSameLocals1StackItemExtended>(next)) {
+		next_stack_items.push_back(
+			same_locals_extended->get_stack()->clone()
+		);
+	}
+	auto full_frame = std::make_unique<StackMapFullFrame>(
+		255, this, 0, std::move(next_locals),
+		std::move(next_stack_items)
+	);
+	full_frame->set_instruction(next->get_instruction());
+	*iter = std::move(full_frame);
+}
+
+void StackMapTable::declare_local(uint16_t index, const VariableInfo& type,
+                                  Instruction* begin, Instruction* end) {
+	uint32_t begin_bci = begin->get_bci();
+	uint32_t end_bci = end ? end->get_bci() : code->get_next_bci();
+	Locals initial_locals = get_initial_locals();
+	std::vector<const VariableInfo*> locals;
+	for (const auto& local : initial_locals) {
+		locals.push_back(local.get());
+	}
+
+	// The locals point into the frames, so they're replaced at the end
+	std::vector<std::pair<size_t, std::unique_ptr<StackMapFrame>>>
+		replacements;
+	bool after_range = false;
+	for (size_t i = 0; i < entries.size(); ++i) {
+		StackMapFrame* frame = entries[i].get();
+		apply_frame(frame, &locals);
+		uint32_t bci = frame->get_instruction()->get_bci();
+		bool in_range = bci >= begin_bci && bci < end_bci;
+		if (!in_range && !after_range) {
+			continue;
+		}
+		after_range = in_range;
+		if (!in_range && isa<StackMapFullFrame>(frame)) {
+			continue;
+		}
+
+		Locals frame_locals;
+		for (const VariableInfo* local : locals) {
+			frame_locals.push_back(local->clone());
+		}
+		if (in_range) {
+			set_local(&frame_locals, index, type);
+		}
+		auto full_frame = std::make_unique<StackMapFullFrame>(
+			255, this, 0, std::move(frame_locals),
+			get_stack_items(frame)
+		);
+		full_frame->set_instruction(frame->get_instruction());
+		replacements.emplace_back(i, std::move(full_frame));
+	}
+	for (auto& replacement : replacements) {
+		entries[replacement.first] = std::move(replacement.second);
+	}
+	if (!replacements.empty()) {
+		mark_changed();
+	}
+}
+
+bool StackMapTable::is_top(uint16_t index, uint8_t size) const {
+	Locals initial_locals = get_initial_locals();
+	std::vector<const VariableInfo*> locals;
+	for (const auto& local : initial_locals) {
+		locals.push_back(local.get());
+	}
+	for (const auto& entry : entries) {
+		apply_frame(entry.get(), &locals);
+		uint32_t slot = 0;
+		for (const VariableInfo* local : locals) {
+			uint32_t local_size = is_wide(local) ? 2 : 1;
+			if (slot >= index + size) {
+				break;
+			}
+			if (slot + local_size > index
+			    && local->get_kind() != VariableInfo::Kind::Top) {
+				return false;
+			}
+			slot += local_size;
+		}
+	}
+	return true;
+}
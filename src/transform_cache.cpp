@@ -0,0 +1,229 @@
+/*
+ * Copyright 2019-2020 Jonathan Eyolfson
+ *
+ * This program is free software: you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License version 3 as published by the
+ * Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE. See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "transform_cache.hpp"
+
+#include "buffer.hpp"
+#include "class_file_scanner.hpp"
+#include "constant_pool_entry.hpp"
+#include "utf8.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <cstring>
+
+using namespace project_rescribo;
+
+namespace {
+
+typedef ConstantPoolEntry::Kind Kind;
+
+// The entry's tag, or nullptr if the index isn't an entry of this kind
+const uint8_t* get_entry(const ClassFileScanner& scanner, const uint8_t* input,
+                         uint16_t index, Kind kind) {
+	if (index == 0 || index >= scanner.get_constant_pool_count()
+	    || scanner.get_constant_pool_offset(index) == 0) {
+		return nullptr;
+	}
+	const uint8_t* entry = input + scanner.get_constant_pool_offset(index);
+	if (Kind(entry[0]) != kind) {
+		return nullptr;
+	}
+	return entry;
+}
+
+bool get_utf8(const ClassFileScanner& scanner, const uint8_t* input,
+              uint16_t index, std::string* value) {
+	const uint8_t* entry = get_entry(scanner, input, index, Kind::Utf8);
+	if (!entry) {
+		return false;
+	}
+	value->assign(reinterpret_cast<const char*>(entry + 3),
+	              convert_big_endian_to_host_u16(entry + 1));
+	return true;
+}
+
+bool matches(const NameMatcher& matcher, const std::string& name) {
+	return matcher.matches(reinterpret_cast<const uint8_t*>(name.data()),
+	                       name.size());
+}
+
+bool matches(const NameMatcher& matcher, const std::string& name,
+             const std::string& descriptor) {
+	return matcher.matches(
+		reinterpret_cast<const uint8_t*>(name.data()), name.size(),
+		reinterpret_cast<const uint8_t*>(descriptor.data()),
+		descriptor.size()
+	);
+}
+
+}
+
+void RuleSet::add(const std::string& key,
+                  const NameMatcher& classes,
+                  const NameMatcher& methods) {
+	assert(find(key) == nullptr && "Duplicate rule key");
+	rules.push_back({key, classes, methods});
+}
+
+const RuleSet::Rule* RuleSet::find(const std::string& key) const {
+	for (const Rule& rule : rules) {
+		if (rule.key == key) {
+			return &rule;
+		}
+	}
+	return nullptr;
+}
+
+// Names come from the input, so members the transformation added, such as
+// a Probe's helpers, are never matched against rules
+bool TransformCache::add(const uint8_t* input, uint32_t input_length,
+                         std::vector<uint8_t> output) {
+	ClassFileScanner scanner;
+	if (!scanner.scan(input, input_length)) {
+		return false;
+	}
+	const uint8_t* this_class = get_entry(scanner, input,
+	                                      scanner.get_this_class(),
+	                                      Kind::Class);
+	std::string class_name;
+	if (!this_class
+	    || !get_utf8(scanner, input,
+	                 convert_big_endian_to_host_u16(this_class + 1),
+	                 &class_name)) {
+		return false;
+	}
+	Entry entry;
+	for (const auto& method : scanner.get_methods()) {
+		std::string name;
+		std::string descriptor;
+		if (!get_utf8(scanner, input, method.name_index, &name)
+		    || !get_utf8(scanner, input, method.descriptor_index,
+		                 &descriptor)) {
+			return false;
+		}
+		entry.methods.push_back(std::move(name));
+		entry.methods.push_back(std::move(descriptor));
+	}
+	entry.input_hash = utf8_hash(input, input_length);
+	entry.input.assign(input, input + input_length);
+	entry.is_unchanged = output.size() == input_length
+	                     && memcmp(output.data(), input, input_length) == 0;
+	if (!entry.is_unchanged) {
+		entry.output = std::move(output);
+	}
+
+	std::lock_guard<std::mutex> lock(mutex);
+	entries[class_name] = std::move(entry);
+	return true;
+}
+
+bool TransformCache::find(const std::string& class_name,
+                          const uint8_t* input, uint32_t input_length,
+                          std::vector<uint8_t>* output) const {
+	uint64_t input_hash = utf8_hash(input, input_length);
+	std::lock_guard<std::mutex> lock(mutex);
+	auto it = entries.find(class_name);
+	if (it == entries.end() || it->second.input.size() != input_length
+	    || it->second.input_hash != input_hash
+	    || memcmp(it->second.input.data(), input, input_length) != 0) {
+		return false;
+	}
+	const Entry& entry = it->second;
+	*output = entry.is_unchanged ? entry.input : entry.output;
+	return true;
+}
+
+uint32_t TransformCache::get_num_classes() const {
+	std::lock_guard<std::mutex> lock(mutex);
+	return entries.size();
+}
+
+// Either rule may be missing, when it's only in one of the sets
+bool TransformCache::is_affected(const std::string& class_name,
+                                 const Entry& entry,
+                                 const RuleSet::Rule* previous,
+                                 const RuleSet::Rule* next) {
+	bool previous_class = previous && matches(previous->classes,
+	                                          class_name);
+	bool next_class = next && matches(next->classes, class_name);
+	if (!previous_class && !next_class) {
+		return false;
+	}
+	for (size_t i = 0; i < entry.methods.size(); i += 2) {
+		const std::string& name = entry.methods[i];
+		const std::string& descriptor = entry.methods[i + 1];
+		bool previous_method = previous_class
+		                       && matches(previous->methods, name,
+		                                  descriptor);
+		bool next_method = next_class
+		                   && matches(next->methods, name, descriptor);
+		if (previous_method != next_method) {
+			return true;
+		}
+	}
+	return false;
+}
+
+std::vector<std::vector<std::string>> TransformCache::invalidate(
+	const RuleSet& previous, const RuleSet& next, uint32_t batch_size) {
+	assert(batch_size > 0);
+	// Rules that are the same in both can't change anything
+	std::vector<std::pair<const RuleSet::Rule*, const RuleSet::Rule*>>
+		changed;
+	for (const auto& rule : previous.get_rules()) {
+		const RuleSet::Rule* next_rule = next.find(rule.key);
+		if (next_rule == nullptr || next_rule->classes != rule.classes
+		    || next_rule->methods != rule.methods) {
+			changed.emplace_back(&rule, next_rule);
+		}
+	}
+	for (const auto& rule : next.get_rules()) {
+		if (previous.find(rule.key) == nullptr) {
+			changed.emplace_back(nullptr, &rule);
+		}
+	}
+
+	std::vector<std::string> class_names;
+	if (!changed.empty()) {
+		std::lock_guard<std::mutex> lock(mutex);
+		for (auto it = entries.begin(); it != entries.end();) {
+			bool affected = false;
+			for (const auto& rules : changed) {
+				affected = is_affected(it->first, it->second,
+				                       rules.first, rules.second);
+				if (affected) {
+					break;
+				}
+			}
+			if (!affected) {
+				++it;
+				continue;
+			}
+			class_names.push_back(it->first);
+			it = entries.erase(it);
+		}
+	}
+	std::sort(class_names.begin(), class_names.end());
+
+	std::vector<std::vector<std::string>> batches;
+	for (size_t i = 0; i < class_names.size(); i += batch_size) {
+		size_t end = std::min<size_t>(i + batch_size, class_names.size());
+		batches.emplace_back(class_names.begin() + i,
+		                     class_names.begin() + end);
+	}
+	return batches;
+}
@@ -0,0 +1,197 @@
+/*
+ * Copyright 2019-2020 Jonathan Eyolfson
+ *
+ * This program is free software: you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License version 3 as published by the
+ * Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE. See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "transform_stats.hpp"
+
+#include <cstdlib>
+
+using namespace project_rescribo;
+
+namespace {
+
+const char* PHASE_NAMES[TransformStats::NUM_PHASES] = {
+	"parse",
+	"transform",
+	"sync",
+	"write",
+};
+
+size_t get_bucket(uint64_t value) {
+	if (value == 0) {
+		return 0;
+	}
+	return 64 - __builtin_clzll(value);
+}
+
+uint64_t get_bucket_limit(size_t bucket) {
+	if (bucket == 0) {
+		return 0;
+	}
+	if (bucket == 64) {
+		return UINT64_MAX;
+	}
+	return (UINT64_C(1) << bucket) - 1;
+}
+
+void print_histogram(FILE* file, const char* name,
+                     const Histogram& histogram) {
+	uint64_t count = histogram.get_count();
+	if (count == 0) {
+		return;
+	}
+	fprintf(file, "  %-10s %8lu classes %14lu ns %10lu ns mean "
+	              "p50 <= %10lu p99 <= %10lu\n",
+	        name,
+	        static_cast<unsigned long>(count),
+	        static_cast<unsigned long>(histogram.get_sum()),
+	        static_cast<unsigned long>(histogram.get_sum() / count),
+	        static_cast<unsigned long>(histogram.get_percentile(0.50)),
+	        static_cast<unsigned long>(histogram.get_percentile(0.99)));
+}
+
+void print_global() {
+	TransformStatsAggregator::get_global().print(stderr);
+}
+
+}
+
+TransformStats::TransformStats()
+: nanoseconds{}, total_nanoseconds(0), num_running{}, num_running_total(0),
+  input_size(0), output_size(0), input_instructions(0),
+  output_instructions(0), input_constant_pool_size(0),
+  output_constant_pool_size(0), num_writes(0) {}
+
+void TransformStats::print(FILE* file) const {
+	for (size_t i = 0; i < NUM_PHASES; ++i) {
+		fprintf(file, "%s: %lu ns\n", PHASE_NAMES[i],
+		        static_cast<unsigned long>(nanoseconds[i]));
+	}
+	fprintf(file, "total: %lu ns\n",
+	        static_cast<unsigned long>(total_nanoseconds));
+	fprintf(file, "size: %u -> %u bytes\n", input_size, output_size);
+	fprintf(file, "instructions: %u -> %u\n",
+	        input_instructions, output_instructions);
+	fprintf(file, "constant pool: %u -> %u entries\n",
+	        input_constant_pool_size, output_constant_pool_size);
+}
+
+Histogram::Histogram() : buckets{}, count(0), sum(0) {}
+
+void Histogram::add(uint64_t value) {
+	buckets[get_bucket(value)].fetch_add(1, std::memory_order_relaxed);
+	count.fetch_add(1, std::memory_order_relaxed);
+	sum.fetch_add(value, std::memory_order_relaxed);
+}
+
+void Histogram::reset() {
+	for (auto& bucket : buckets) {
+		bucket.store(0, std::memory_order_relaxed);
+	}
+	count.store(0, std::memory_order_relaxed);
+	sum.store(0, std::memory_order_relaxed);
+}
+
+uint64_t Histogram::get_percentile(double fraction) const {
+	uint64_t total = get_count();
+	if (total == 0) {
+		return 0;
+	}
+	uint64_t rank = static_cast<uint64_t>(fraction * (total - 1)) + 1;
+	uint64_t seen = 0;
+	for (size_t i = 0; i < NUM_BUCKETS; ++i) {
+		seen += buckets[i].load(std::memory_order_relaxed);
+		if (seen >= rank) {
+			return get_bucket_limit(i);
+		}
+	}
+	return UINT64_MAX;
+}
+
+TransformStatsAggregator::TransformStatsAggregator()
+: num_classes(0), input_bytes(0), output_bytes(0), input_instructions(0),
+  output_instructions(0), constant_pool_growth(0) {}
+
+void TransformStatsAggregator::add(const TransformStats& stats) {
+	num_classes.fetch_add(1, std::memory_order_relaxed);
+	input_bytes.fetch_add(stats.get_input_size(),
+	                      std::memory_order_relaxed);
+	input_instructions.fetch_add(stats.get_input_instructions(),
+	                             std::memory_order_relaxed);
+	for (size_t i = 0; i < TransformStats::NUM_PHASES; ++i) {
+		auto phase = static_cast<TransformStats::Phase>(i);
+		uint64_t ns = stats.get_nanoseconds(phase);
+		if (ns != 0) {
+			phase_histograms[i].add(ns);
+		}
+	}
+	total_histogram.add(stats.get_total_nanoseconds());
+
+	// Classes that were only inspected don't have any output
+	if (stats.get_num_writes() == 0) {
+		return;
+	}
+	output_bytes.fetch_add(stats.get_output_size(),
+	                       std::memory_order_relaxed);
+	output_instructions.fetch_add(stats.get_output_instructions(),
+	                              std::memory_order_relaxed);
+	constant_pool_growth.fetch_add(
+		int64_t(stats.get_output_constant_pool_size())
+		- int64_t(stats.get_input_constant_pool_size()),
+		std::memory_order_relaxed
+	);
+}
+
+void TransformStatsAggregator::reset() {
+	num_classes.store(0, std::memory_order_relaxed);
+	input_bytes.store(0, std::memory_order_relaxed);
+	output_bytes.store(0, std::memory_order_relaxed);
+	input_instructions.store(0, std::memory_order_relaxed);
+	output_instructions.store(0, std::memory_order_relaxed);
+	constant_pool_growth.store(0, std::memory_order_relaxed);
+	for (auto& histogram : phase_histograms) {
+		histogram.reset();
+	}
+	total_histogram.reset();
+}
+
+void TransformStatsAggregator::print(FILE* file) const {
+	fprintf(file, "Transformed classes: %lu\n",
+	        static_cast<unsigned long>(get_num_classes()));
+	fprintf(file, "  bytes: %lu in, %lu out\n",
+	        static_cast<unsigned long>(input_bytes.load()),
+	        static_cast<unsigned long>(output_bytes.load()));
+	fprintf(file, "  instructions: %lu in, %lu out\n",
+	        static_cast<unsigned long>(input_instructions.load()),
+	        static_cast<unsigned long>(output_instructions.load()));
+	fprintf(file, "  constant pool growth: %ld entries\n",
+	        static_cast<long>(constant_pool_growth.load()));
+	fprintf(file, "Time by phase:\n");
+	for (size_t i = 0; i < TransformStats::NUM_PHASES; ++i) {
+		print_histogram(file, PHASE_NAMES[i], phase_histograms[i]);
+	}
+	print_histogram(file, "total", total_histogram);
+}
+
+TransformStatsAggregator& TransformStatsAggregator::get_global() {
+	static TransformStatsAggregator global;
+	return global;
+}
+
+void TransformStatsAggregator::print_global_at_exit() {
+	// Construct the global first so it outlives the exit handler
+	static bool registered = (get_global(), atexit(print_global) == 0);
+	(void) registered;
+}
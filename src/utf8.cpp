@@ -0,0 +1,428 @@
+/*
+ * Copyright 2019-2020 Jonathan Eyolfson
+ *
+ * This program is free software: you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License version 3 as published by the
+ * Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE. See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "utf8.hpp"
+
+#include <atomic>
+#include <cassert>
+#include <cstring>
+
+#if defined(__x86_64__)
+#include <immintrin.h>
+#endif
+
+using namespace project_rescribo;
+
+namespace {
+
+struct Utf8Functions {
+	Utf8Implementation implementation;
+	bool (*bytes_equal)(const uint8_t* a, const uint8_t* b, size_t length);
+	bool (*is_ascii)(const uint8_t* data, size_t length);
+	// Widens the leading ASCII bytes, returns how many were written
+	size_t (*widen_ascii)(const uint8_t* data, size_t length,
+	                      char16_t* output);
+};
+
+bool bytes_equal_scalar(const uint8_t* a, const uint8_t* b, size_t length) {
+	return memcmp(a, b, length) == 0;
+}
+
+bool is_ascii_scalar(const uint8_t* data, size_t length) {
+	size_t i = 0;
+	for (; i + 8 <= length; i += 8) {
+		uint64_t word;
+		memcpy(&word, data + i, 8);
+		if (word & UINT64_C(0x8080808080808080)) {
+			return false;
+		}
+	}
+	for (; i < length; ++i) {
+		if (data[i] & 0x80) {
+			return false;
+		}
+	}
+	return true;
+}
+
+size_t widen_ascii_scalar(const uint8_t* data, size_t length,
+                          char16_t* output) {
+	size_t i = 0;
+	for (; i < length && data[i] < 0x80; ++i) {
+		output[i] = data[i];
+	}
+	return i;
+}
+
+#if defined(__x86_64__)
+
+// SSE2 is part of the x86-64 baseline, so it needs no target attribute
+bool bytes_equal_sse2(const uint8_t* a, const uint8_t* b, size_t length) {
+	size_t i = 0;
+	for (; i + 16 <= length; i += 16) {
+		__m128i x = _mm_loadu_si128(
+			reinterpret_cast<const __m128i*>(a + i)
+		);
+		__m128i y = _mm_loadu_si128(
+			reinterpret_cast<const __m128i*>(b + i)
+		);
+		if (_mm_movemask_epi8(_mm_cmpeq_epi8(x, y)) != 0xFFFF) {
+			return false;
+		}
+	}
+	return bytes_equal_scalar(a + i, b + i, length - i);
+}
+
+bool is_ascii_sse2(const uint8_t* data, size_t length) {
+	size_t i = 0;
+	__m128i combined = _mm_setzero_si128();
+	for (; i + 16 <= length; i += 16) {
+		combined = _mm_or_si128(combined, _mm_loadu_si128(
+			reinterpret_cast<const __m128i*>(data + i)
+		));
+	}
+	if (_mm_movemask_epi8(combined) != 0) {
+		return false;
+	}
+	return is_ascii_scalar(data + i, length - i);
+}
+
+size_t widen_ascii_sse2(const uint8_t* data, size_t length,
+                        char16_t* output) {
+	size_t i = 0;
+	const __m128i zero = _mm_setzero_si128();
+	for (; i + 16 <= length; i += 16) {
+		__m128i bytes = _mm_loadu_si128(
+			reinterpret_cast<const __m128i*>(data + i)
+		);
+		if (_mm_movemask_epi8(bytes) != 0) {
+			break;
+		}
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(output + i),
+		                 _mm_unpacklo_epi8(bytes, zero));
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(output + i + 8),
+		                 _mm_unpackhi_epi8(bytes, zero));
+	}
+	return i + widen_ascii_scalar(data + i, length - i, output + i);
+}
+
+__attribute__((target("avx2")))
+bool bytes_equal_avx2(const uint8_t* a, const uint8_t* b, size_t length) {
+	size_t i = 0;
+	for (; i + 32 <= length; i += 32) {
+		__m256i x = _mm256_loadu_si256(
+			reinterpret_cast<const __m256i*>(a + i)
+		);
+		__m256i y = _mm256_loadu_si256(
+			reinterpret_cast<const __m256i*>(b + i)
+		);
+		if (_mm256_movemask_epi8(_mm256_cmpeq_epi8(x, y)) != -1) {
+			return false;
+		}
+	}
+	return bytes_equal_sse2(a + i, b + i, length - i);
+}
+
+__attribute__((target("avx2")))
+bool is_ascii_avx2(const uint8_t* data, size_t length) {
+	size_t i = 0;
+	__m256i combined = _mm256_setzero_si256();
+	for (; i + 32 <= length; i += 32) {
+		combined = _mm256_or_si256(combined, _mm256_loadu_si256(
+			reinterpret_cast<const __m256i*>(data + i)
+		));
+	}
+	if (_mm256_movemask_epi8(combined) != 0) {
+		return false;
+	}
+	return is_ascii_sse2(data + i, length - i);
+}
+
+__attribute__((target("avx2")))
+size_t widen_ascii_avx2(const uint8_t* data, size_t length,
+                        char16_t* output) {
+	size_t i = 0;
+	for (; i + 32 <= length; i += 32) {
+		__m256i bytes = _mm256_loadu_si256(
+			reinterpret_cast<const __m256i*>(data + i)
+		);
+		if (_mm256_movemask_epi8(bytes) != 0) {
+			break;
+		}
+		_mm256_storeu_si256(
+			reinterpret_cast<__m256i*>(output + i),
+			_mm256_cvtepu8_epi16(_mm256_castsi256_si128(bytes))
+		);
+		_mm256_storeu_si256(
+			reinterpret_cast<__m256i*>(output + i + 16),
+			_mm256_cvtepu8_epi16(_mm256_extracti128_si256(bytes, 1))
+		);
+	}
+	return i + widen_ascii_sse2(data + i, length - i, output + i);
+}
+
+#endif
+
+const Utf8Functions SCALAR_FUNCTIONS = {
+	Utf8Implementation::Scalar,
+	bytes_equal_scalar,
+	is_ascii_scalar,
+	widen_ascii_scalar,
+};
+
+#if defined(__x86_64__)
+const Utf8Functions SSE2_FUNCTIONS = {
+	Utf8Implementation::SSE2,
+	bytes_equal_sse2,
+	is_ascii_sse2,
+	widen_ascii_sse2,
+};
+
+const Utf8Functions AVX2_FUNCTIONS = {
+	Utf8Implementation::AVX2,
+	bytes_equal_avx2,
+	is_ascii_avx2,
+	widen_ascii_avx2,
+};
+#endif
+
+const Utf8Functions* find_functions(Utf8Implementation implementation) {
+	switch (implementation) {
+	case Utf8Implementation::Scalar:
+		return &SCALAR_FUNCTIONS;
+#if defined(__x86_64__)
+	case Utf8Implementation::SSE2:
+		return &SSE2_FUNCTIONS;
+	case Utf8Implementation::AVX2:
+		if (__builtin_cpu_supports("avx2")) {
+			return &AVX2_FUNCTIONS;
+		}
+		return nullptr;
+#endif
+	default:
+		return nullptr;
+	}
+}
+
+const Utf8Functions* detect_functions() {
+	const Utf8Implementation preferred[] = {
+		Utf8Implementation::AVX2,
+		Utf8Implementation::SSE2,
+	};
+	for (Utf8Implementation implementation : preferred) {
+		if (const Utf8Functions* functions
+		    = find_functions(implementation)) {
+			return functions;
+		}
+	}
+	return &SCALAR_FUNCTIONS;
+}
+
+std::atomic<const Utf8Functions*> current_functions{nullptr};
+
+const Utf8Functions* get_functions() {
+	const Utf8Functions* functions
+		= current_functions.load(std::memory_order_relaxed);
+	if (!functions) {
+		functions = detect_functions();
+		current_functions.store(functions, std::memory_order_relaxed);
+	}
+	return functions;
+}
+
+uint64_t mix(uint64_t h) {
+	h ^= h >> 33;
+	h *= UINT64_C(0xFF51AFD7ED558CCD);
+	h ^= h >> 33;
+	h *= UINT64_C(0xC4CEB9FE1A85EC53);
+	h ^= h >> 33;
+	return h;
+}
+
+// Returns the next UTF-16 code unit and advances i
+char16_t decode(const uint8_t* data, size_t length, size_t& i) {
+	uint8_t first = data[i];
+	if (first < 0x80) {
+		i += 1;
+		return first;
+	}
+	if ((first & 0xE0) == 0xC0) {
+		assert(i + 1 < length && "Truncated modified UTF-8");
+		char16_t unit = ((first & 0x1F) << 6) | (data[i + 1] & 0x3F);
+		i += 2;
+		return unit;
+	}
+	assert((first & 0xF0) == 0xE0 && "Malformed modified UTF-8");
+	assert(i + 2 < length && "Truncated modified UTF-8");
+	char16_t unit = ((first & 0x0F) << 12)
+	                | ((data[i + 1] & 0x3F) << 6)
+	                | (data[i + 2] & 0x3F);
+	i += 3;
+	return unit;
+}
+
+void append_code_point(std::string& result, uint32_t code_point) {
+	if (code_point < 0x80) {
+		result.push_back(code_point);
+	}
+	else if (code_point < 0x800) {
+		result.push_back(0xC0 | (code_point >> 6));
+		result.push_back(0x80 | (code_point & 0x3F));
+	}
+	else if (code_point < 0x10000) {
+		result.push_back(0xE0 | (code_point >> 12));
+		result.push_back(0x80 | ((code_point >> 6) & 0x3F));
+		result.push_back(0x80 | (code_point & 0x3F));
+	}
+	else {
+		result.push_back(0xF0 | (code_point >> 18));
+		result.push_back(0x80 | ((code_point >> 12) & 0x3F));
+		result.push_back(0x80 | ((code_point >> 6) & 0x3F));
+		result.push_back(0x80 | (code_point & 0x3F));
+	}
+}
+
+bool is_high_surrogate(char16_t unit) {
+	return unit >= 0xD800 && unit <= 0xDBFF;
+}
+
+bool is_low_surrogate(char16_t unit) {
+	return unit >= 0xDC00 && unit <= 0xDFFF;
+}
+
+}
+
+Utf8Implementation project_rescribo::get_utf8_implementation() {
+	return get_functions()->implementation;
+}
+
+const char* project_rescribo::get_utf8_implementation_name(
+	Utf8Implementation implementation
+) {
+	switch (implementation) {
+	case Utf8Implementation::Scalar:
+		return "scalar";
+	case Utf8Implementation::SSE2:
+		return "sse2";
+	case Utf8Implementation::AVX2:
+		return "avx2";
+	}
+	return "unknown";
+}
+
+bool project_rescribo::set_utf8_implementation(
+	Utf8Implementation implementation
+) {
+	const Utf8Functions* functions = find_functions(implementation);
+	if (!functions) {
+		return false;
+	}
+	current_functions.store(functions, std::memory_order_relaxed);
+	return true;
+}
+
+bool project_rescribo::utf8_equals(const uint8_t* a, size_t a_length,
+                                   const uint8_t* b, size_t b_length) {
+	if (a_length != b_length) {
+		return false;
+	}
+	return get_functions()->bytes_equal(a, b, a_length);
+}
+
+bool project_rescribo::utf8_starts_with(const uint8_t* data, size_t length,
+                                        const uint8_t* prefix,
+                                        size_t prefix_length) {
+	if (prefix_length > length) {
+		return false;
+	}
+	return get_functions()->bytes_equal(data, prefix, prefix_length);
+}
+
+bool project_rescribo::utf8_ends_with(const uint8_t* data, size_t length,
+                                      const uint8_t* suffix,
+                                      size_t suffix_length) {
+	if (suffix_length > length) {
+		return false;
+	}
+	return get_functions()->bytes_equal(data + length - suffix_length,
+	                                    suffix, suffix_length);
+}
+
+bool project_rescribo::utf8_is_ascii(const uint8_t* data, size_t length) {
+	return get_functions()->is_ascii(data, length);
+}
+
+uint64_t project_rescribo::utf8_hash(const uint8_t* data, size_t length) {
+	const uint64_t multiplier = UINT64_C(0x9E3779B97F4A7C15);
+	uint64_t h = length * multiplier;
+	size_t i = 0;
+	for (; i + 8 <= length; i += 8) {
+		uint64_t word;
+		memcpy(&word, data + i, 8);
+		h = (h ^ word) * multiplier;
+		h ^= h >> 29;
+	}
+	if (i < length) {
+		uint64_t word = 0;
+		memcpy(&word, data + i, length - i);
+		h = (h ^ word) * multiplier;
+	}
+	return mix(h);
+}
+
+std::u16string project_rescribo::utf8_to_utf16(const uint8_t* data,
+                                               size_t length) {
+	// Never more code units than bytes
+	std::u16string result(length, u'\0');
+	size_t written = get_functions()->widen_ascii(data, length,
+	                                              &result[0]);
+	size_t i = written;
+	while (i < length) {
+		result[written++] = decode(data, length, i);
+	}
+	result.resize(written);
+	return result;
+}
+
+std::string project_rescribo::utf8_to_string(const uint8_t* data,
+                                             size_t length) {
+	if (utf8_is_ascii(data, length)) {
+		return std::string(reinterpret_cast<const char*>(data), length);
+	}
+	std::string result;
+	result.reserve(length);
+	size_t i = 0;
+	while (i < length) {
+		char16_t unit = decode(data, length, i);
+		if (is_high_surrogate(unit) && i < length) {
+			size_t next = i;
+			char16_t low = decode(data, length, next);
+			if (is_low_surrogate(low)) {
+				i = next;
+				append_code_point(result, 0x10000
+				                          + ((unit - 0xD800) << 10)
+				                          + (low - 0xDC00));
+				continue;
+			}
+		}
+		if (is_high_surrogate(unit) || is_low_surrogate(unit)) {
+			append_code_point(result, 0xFFFD);
+			continue;
+		}
+		append_code_point(result, unit);
+	}
+	return result;
+}